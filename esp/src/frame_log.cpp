@@ -0,0 +1,218 @@
+#include "frame_log.h"
+
+static const uint32_t RECORD_MAGIC = 0x31474c46;  // "FLG1"
+static const uint32_t COMMITTED = 0x00000000;     // programmed over the erased 0xFFFFFFFF
+
+// First 32 bytes of a record's first sector. crc and commit stay erased
+// (0xFF) until commit() programs them.
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t len;
+  uint32_t reserved;
+  uint32_t crc;
+  uint32_t commit;
+  uint32_t pad[2];
+};
+static_assert(sizeof(RecordHeader) == FrameLog::HEADER, "record header size");
+
+bool FrameLog::begin(const char* label) {
+  part_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (!part_ || part_->size < 2 * SECTOR) {
+    part_ = nullptr;
+    return false;
+  }
+  scan();
+  return true;
+}
+
+// Rebuilds the index from the committed records and continues after the
+// newest one. What lies beyond it is not trusted to be erased.
+void FrameLog::scan() {
+  indexCount_ = 0;
+  uint32_t maxSeq = 0;     // any record, committed or not
+  uint32_t newestSeq = 0;  // committed
+  uint32_t newestEnd = 0;
+  for (uint32_t off = 0; off + SECTOR <= part_->size;) {
+    RecordHeader h;
+    if (esp_partition_read(part_, off, &h, sizeof(h)) != ESP_OK || h.magic != RECORD_MAGIC) {
+      off += SECTOR;
+      continue;
+    }
+    if (h.seq > maxSeq) maxSeq = h.seq;
+    uint32_t span = sectorsFor(h.len) * SECTOR;
+    if (h.commit != COMMITTED || h.len == 0 || off + span > part_->size) {
+      off += SECTOR;  // aborted or cut short
+      continue;
+    }
+    FrameRef ref;
+    ref.offset = off;
+    ref.len = h.len;
+    ref.seq = h.seq;
+    ref.crc = (uint16_t)h.crc;
+    insertIndex(ref);
+    if (h.seq > newestSeq) {
+      newestSeq = h.seq;
+      newestEnd = off + span;
+    }
+    off += span;
+  }
+  nextSeq_ = maxSeq + 1;
+  head_ = newestEnd < part_->size ? newestEnd : 0;
+  erasedAhead_ = 0;
+}
+
+// Keeps the INDEX_MAX newest records, oldest first
+void FrameLog::insertIndex(const FrameRef& ref) {
+  if (indexCount_ == INDEX_MAX) {
+    if (ref.seq < index_[0].seq) return;
+    for (size_t i = 1; i < indexCount_; ++i) index_[i - 1] = index_[i];
+    --indexCount_;
+  }
+  size_t i = indexCount_;
+  while (i > 0 && index_[i - 1].seq > ref.seq) {
+    index_[i] = index_[i - 1];
+    --i;
+  }
+  index_[i] = ref;
+  ++indexCount_;
+}
+
+void FrameLog::dropOverlapping(uint32_t start, uint32_t end) {
+  size_t kept = 0;
+  for (size_t i = 0; i < indexCount_; ++i) {
+    const FrameRef& r = index_[i];
+    uint32_t rEnd = r.offset + sectorsFor(r.len) * SECTOR;
+    if (r.offset < end && start < rEnd) continue;
+    index_[kept++] = r;
+  }
+  indexCount_ = kept;
+}
+
+bool FrameLog::eraseNext() {
+  if (erasedAhead_ >= part_->size) return false;
+  uint32_t pos = (head_ + erasedAhead_) % part_->size;
+  dropOverlapping(pos, pos + SECTOR);
+  if (esp_partition_erase_range(part_, pos, SECTOR) != ESP_OK) return false;
+  erasedAhead_ += SECTOR;
+  return true;
+}
+
+bool FrameLog::reserve(uint32_t maxLen) {
+  if (!part_ || writing_) return false;
+  uint32_t need = sectorsFor(maxLen) * SECTOR;
+  if (need > part_->size) return false;
+  if (head_ + need > part_->size) need += part_->size - head_;  // tail is skipped
+  while (erasedAhead_ < need) {
+    if (!eraseNext()) return false;
+  }
+  return true;
+}
+
+bool FrameLog::service() {
+  if (!part_ || writing_ || !reserveLen_) return false;
+  uint32_t need = sectorsFor(reserveLen_) * SECTOR;
+  if (head_ + need > part_->size) need += part_->size - head_;
+  return erasedAhead_ < need && need <= part_->size && eraseNext();
+}
+
+bool FrameLog::beginRecord(uint32_t len) {
+  if (!part_ || writing_ || len == 0) return false;
+  uint32_t span = sectorsFor(len) * SECTOR;
+  if (span > part_->size) return false;
+  if (head_ + span > part_->size) {
+    // Does not fit before the end: skip the tail and start over at 0
+    uint32_t skip = part_->size - head_;
+    erasedAhead_ = erasedAhead_ > skip ? erasedAhead_ - skip : 0;
+    head_ = 0;
+  }
+  if (erasedAhead_ < span) return false;  // not reserved
+
+  cur_ = FrameRef();
+  cur_.offset = head_;
+  cur_.len = len;
+  cur_.seq = nextSeq_++;
+  RecordHeader h;
+  memset(&h, 0xFF, sizeof(h));
+  h.magic = RECORD_MAGIC;
+  h.seq = cur_.seq;
+  h.len = len;
+  memcpy(sector_, &h, sizeof(h));
+  buffered_ = sizeof(h);
+  written_ = 0;
+  writing_ = true;
+  return true;
+}
+
+// Programs sector_ at the next sector of the record; pads a partial one
+bool FrameLog::flushSector() {
+  if (buffered_ < SECTOR) memset(sector_ + buffered_, 0xFF, SECTOR - buffered_);
+  uint32_t t0 = micros();
+  bool ok = esp_partition_write(part_, cur_.offset + written_, sector_, SECTOR) == ESP_OK;
+  lastSectorUs_ = micros() - t0;
+  if (lastSectorUs_ > maxSectorUs_) maxSectorUs_ = lastSectorUs_;
+  written_ += SECTOR;
+  buffered_ = 0;
+  return ok;
+}
+
+bool FrameLog::append(const uint8_t* data, size_t n) {
+  if (!writing_) return false;
+  if (written_ + buffered_ + n > HEADER + cur_.len) return false;
+  while (n) {
+    size_t take = SECTOR - buffered_;
+    if (take > n) take = n;
+    memcpy(sector_ + buffered_, data, take);
+    buffered_ += take;
+    data += take;
+    n -= take;
+    if (buffered_ == SECTOR && !flushSector()) return false;
+  }
+  return true;
+}
+
+bool FrameLog::commit(uint16_t crc) {
+  if (!writing_) return false;
+  if (written_ + buffered_ != HEADER + cur_.len) {
+    abort();
+    return false;
+  }
+  if (buffered_ && !flushSector()) {
+    abort();
+    return false;
+  }
+  // crc and commit words sit together at offset 16 of the header
+  uint32_t words[2] = { crc, COMMITTED };
+  bool ok = esp_partition_write(part_, cur_.offset + 16, words, sizeof(words)) == ESP_OK;
+  head_ += written_;
+  erasedAhead_ -= written_;
+  writing_ = false;
+  if (!ok) return false;
+  cur_.crc = crc;
+  insertIndex(cur_);
+  return true;
+}
+
+void FrameLog::abort() {
+  if (!writing_) return;
+  // Sectors already programmed cannot be reused until erased again
+  head_ += written_;
+  erasedAhead_ -= written_;
+  writing_ = false;
+  buffered_ = 0;
+}
+
+bool FrameLog::latest(FrameRef& out) const {
+  if (!indexCount_) return false;
+  out = index_[indexCount_ - 1];
+  return true;
+}
+
+const uint8_t* FrameLog::map(const FrameRef& ref, spi_flash_mmap_handle_t& handle) const {
+  const void* ptr = nullptr;
+  if (!part_ || esp_partition_mmap(part_, ref.offset + HEADER, ref.len, ESP_PARTITION_MMAP_DATA,
+                                   &ptr, &handle) != ESP_OK) {
+    return nullptr;
+  }
+  return static_cast<const uint8_t*>(ptr);
+}
@@ -0,0 +1,92 @@
+// ========= Frame log on a raw flash partition =========
+// Captured frames are appended to the "framelog" data partition (see
+// partitions.csv) instead of SPIFFS files. Each record starts on a 4 KB
+// sector with a small header, and the body follows in whole-sector writes.
+//
+// Erasing is what makes flash writes slow and unpredictable (tens of ms per
+// sector, and SPIFFS garbage collection can stack hundreds of them), so it
+// never happens while a frame is coming in: service() erases ahead of the
+// write position from setup() and loop(), and reserve() finishes the job
+// before the camera is triggered. During a transfer the only flash work is one sector
+// program per 4 KB received.
+//
+// The log is a ring: erasing ahead eventually reaches the oldest records,
+// which drop out of the index. A record becomes visible only once commit()
+// programs its header's commit word, so a frame cut short by a reset or a
+// CRC failure is skipped by the boot scan. Records are read through the
+// flash cache (esp_partition_mmap) without copying.
+#pragma once
+#include <Arduino.h>
+#include <esp_partition.h>
+
+struct FrameRef {
+  uint32_t offset = 0;  // of the record header, within the partition
+  uint32_t len = 0;     // body bytes
+  uint32_t seq = 0;
+  uint16_t crc = 0;
+};
+
+class FrameLog {
+ public:
+  static const uint32_t SECTOR = 4096;
+  static const uint32_t HEADER = 32;       // bytes before the body
+  static const size_t INDEX_MAX = 16;      // newest records kept in RAM
+
+  bool begin(const char* label = "framelog");
+
+  // Makes sure a record of up to maxLen body bytes can be written without
+  // erasing, erasing synchronously whatever is missing. False if maxLen
+  // can never fit.
+  bool reserve(uint32_t maxLen);
+  // Erases at most one sector towards the reserve; cheap when done. False
+  // once the reserve is erased (or cannot be).
+  bool service();
+  void setReserve(uint32_t maxLen) { reserveLen_ = maxLen; }
+
+  // Writing a record: begin, append the body as it arrives, then commit
+  // (with the CRC the caller verified) or abort.
+  bool beginRecord(uint32_t len);
+  bool append(const uint8_t* data, size_t n);
+  bool commit(uint16_t crc);
+  void abort();
+
+  bool latest(FrameRef& out) const;
+  size_t count() const { return indexCount_; }
+  uint32_t capacity() const { return part_ ? part_->size : 0; }
+
+  // Memory-maps a record's body; release with unmap(handle).
+  const uint8_t* map(const FrameRef& ref, spi_flash_mmap_handle_t& handle) const;
+  static void unmap(spi_flash_mmap_handle_t handle) { spi_flash_munmap(handle); }
+
+  // Write-path timing, for /status.json
+  uint32_t lastSectorUs() const { return lastSectorUs_; }
+  uint32_t maxSectorUs() const { return maxSectorUs_; }
+  uint32_t erasedAhead() const { return erasedAhead_; }
+
+ private:
+  static uint32_t sectorsFor(uint32_t len) { return (HEADER + len + SECTOR - 1) / SECTOR; }
+  void scan();
+  bool eraseNext();
+  bool flushSector();
+  void insertIndex(const FrameRef& ref);
+  void dropOverlapping(uint32_t start, uint32_t end);
+
+  const esp_partition_t* part_ = nullptr;
+  uint32_t head_ = 0;         // next record starts here (sector aligned)
+  uint32_t erasedAhead_ = 0;  // bytes erased from head_ onwards
+  uint32_t reserveLen_ = 0;
+  uint32_t nextSeq_ = 1;
+
+  // Record being written
+  bool writing_ = false;
+  FrameRef cur_;
+  uint32_t written_ = 0;   // bytes of the record (header included) on flash
+  uint32_t buffered_ = 0;  // bytes in sector_
+  uint8_t sector_[SECTOR];
+
+  FrameRef index_[INDEX_MAX];  // oldest first
+  size_t indexCount_ = 0;
+
+  uint32_t lastSectorUs_ = 0;
+  uint32_t maxSectorUs_ = 0;
+};
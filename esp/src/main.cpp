@@ -2,9 +2,11 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <WebServer.h>
-#include <SPIFFS.h>
 #include <Wire.h>
 #include <U8g2lib.h>
+#include "frame_log.h"
+#include "http_cache.h"
+#include "web_assets.h"
 
 // ---------------- WiFi ----------------
 const char* WIFI_SSID = "Room-1010";
@@ -20,9 +22,13 @@ const uint32_t PI_RESPONSE_TIMEOUT_MS = 7000;
 #define UART_RX   16   // from CAM TX (GPIO1)
 #define UART_TX   17   // to   CAM RX (GPIO3)
 #define UART_BAUD 2000000
+#define UART_RX_BUFFER 16384  // absorbs the bytes that arrive while a flash sector is programmed
 
 // ------------- Button (to GND) --------
 #define BTN_PIN   14
+#define BTN_DEBOUNCE_MS 40   // line quiet this long before a falling edge counts
+#define BTN_QUEUE       8    // presses held while a capture is running
+#define BTN_COALESCE_MS 600  // presses this close merge into one capture
 
 // ------------- OLED (1.3" SH1106) -----
 #define SDA_PIN   21
@@ -38,9 +44,53 @@ bool lastUploadOk = false;
 String lastUploadName;
 String lastUploadErr;
 uint32_t lastUploadTimestamp = 0;
+uint32_t uploadCount = 0;
+uint32_t captureCount = 0;   // lets the page cache-bust /image
+
+// Button presses are timestamped by a GPIO interrupt and queued, so the
+// ones made during a capture are not lost. The interrupt also records which
+// capture was running, if any: all presses made during the same capture,
+// and any within BTN_COALESCE_MS of the one acted on, give one capture.
+struct BtnPress {
+  uint32_t us;       // micros() at the press
+  uint32_t capture;  // btnCapture while one ran, 0 when idle
+};
+QueueHandle_t btnQueue = nullptr;  // BtnPress entries
+volatile uint32_t btnLastEdgeUs = 0;
+volatile uint32_t btnPresses = 0;
+volatile uint32_t btnOverflows = 0;  // presses lost to a full queue
+volatile bool btnBusy = false;
+volatile uint32_t btnCapture = 0;  // numbers the captures a press can wait for
+uint32_t btnCoalesced = 0;
+uint32_t btnLastLatencyUs = 0;  // press to capture trigger
+uint32_t btnMaxLatencyUs = 0;
+
+// Marks a capture, from the button or /capture, for the presses made during it
+struct BtnBusy {
+  BtnBusy() {
+    btnCapture = btnCapture + 1;
+    btnBusy = true;
+  }
+  ~BtnBusy() { btnBusy = false; }
+};
+
+void IRAM_ATTR buttonIsr() {
+  uint32_t now = micros();
+  uint32_t quiet = now - btnLastEdgeUs;
+  btnLastEdgeUs = now;
+  if (digitalRead(BTN_PIN) != LOW || quiet < BTN_DEBOUNCE_MS * 1000UL) return;
+  btnPresses = btnPresses + 1;
+  BtnPress press = {now, btnBusy ? btnCapture : 0};
+  BaseType_t woken = pdFALSE;
+  if (xQueueSendFromISR(btnQueue, &press, &woken) != pdTRUE) {
+    btnOverflows = btnOverflows + 1;
+  }
+  if (woken) portYIELD_FROM_ISR();
+}
 
 void setLastUploadStatus(bool ok, const String& name, const String& err) {
   lastUploadOk = ok;
+  uploadCount++;
   lastUploadTimestamp = millis();
   if (ok) {
     lastUploadName = name;
@@ -51,9 +101,50 @@ void setLastUploadStatus(bool ok, const String& name, const String& err) {
   }
 }
 
+// ------------- Server-sent events ------
+// /events stays open; capture, upload and result stages are written to every
+// open one as they happen, so the page updates exactly when data is ready.
+// Each holds one of the few lwIP sockets, hence the small limit.
+#define SSE_MAX_CLIENTS  3
+#define SSE_KEEPALIVE_MS 15000
+WiFiClient sseClients[SSE_MAX_CLIENTS];
+uint32_t sseLastWriteMs = 0;
+
+void sseWrite(const String& msg) {
+  for (int i = 0; i < SSE_MAX_CLIENTS; ++i) {
+    if (!sseClients[i].connected()) continue;
+    if (sseClients[i].write((const uint8_t*)msg.c_str(), msg.length()) != msg.length()) {
+      sseClients[i].stop();
+    }
+  }
+  sseLastWriteMs = millis();
+}
+
+// data is a JSON object (one line)
+void sseEvent(const char* event, const String& data) {
+  String msg;
+  msg.reserve(data.length() + 24);
+  msg += "event: ";
+  msg += event;
+  msg += "\ndata: ";
+  msg += data;
+  msg += "\n\n";
+  sseWrite(msg);
+}
+
 // ------------- Helpers -----------------
-static uint16_t crc16(const uint8_t* data, size_t n) {
-  uint16_t crc = 0xFFFF;
+static void appendJsonString(String& out, const String& s) {
+  out += '"';
+  for (size_t i = 0; i < s.length(); ++i) {
+    char c = s[i];
+    if (c == '"' || c == '\\') { out += '\\'; out += c; }
+    else if ((uint8_t)c < 0x20) out += ' ';
+    else out += c;
+  }
+  out += '"';
+}
+
+static uint16_t crc16Update(uint16_t crc, const uint8_t* data, size_t n) {
   for (size_t i = 0; i < n; ++i) {
     crc ^= data[i];
     for (int b = 0; b < 8; ++b) {
@@ -64,13 +155,63 @@ static uint16_t crc16(const uint8_t* data, size_t n) {
   return crc;
 }
 
+// OLED text lines. Each line owns a band of rows around its baseline; only
+// lines whose text changed are redrawn, and only the 8-pixel tile rows
+// they cover are sent (updateDisplayArea) instead of the whole 1 KB buffer.
+const uint8_t OLED_LINES = 3;
+const uint8_t OLED_BASELINE[OLED_LINES] = {12, 26, 40};
+const uint8_t OLED_BAND_ABOVE = 11; // 6x12 glyph rows above and incl. the baseline
+const uint8_t OLED_BAND_BELOW = 2;  // descender rows
+String oledShown[OLED_LINES];
+bool oledValid = false;
+uint32_t oledRenders = 0;   // calls that changed the screen
+uint32_t oledUnchanged = 0; // calls with the same text, nothing sent
+uint32_t oledLastUs = 0;
+uint32_t oledMaxUs = 0;
+
 void oledPrint(const String& l1, const String& l2="", const String& l3="") {
-  u8g2.clearBuffer();
+  uint32_t t0 = micros();
+  const String* next[OLED_LINES] = {&l1, &l2, &l3};
+  uint8_t tileRows = 0; // bit per 8-pixel tile row to send
   u8g2.setFont(u8g2_font_6x12_tf);
-  u8g2.drawStr(0, 12, l1.c_str());
-  if (!l2.isEmpty()) u8g2.drawStr(0, 26, l2.c_str());
-  if (!l3.isEmpty()) u8g2.drawStr(0, 40, l3.c_str());
-  u8g2.sendBuffer();
+  for (uint8_t i = 0; i < OLED_LINES; ++i) {
+    if (oledValid && *next[i] == oledShown[i]) continue;
+    oledShown[i] = *next[i];
+    int top = OLED_BASELINE[i] - OLED_BAND_ABOVE;
+    int bottom = OLED_BASELINE[i] + OLED_BAND_BELOW;
+    u8g2.setDrawColor(0);
+    u8g2.drawBox(0, top, u8g2.getDisplayWidth(), bottom - top + 1);
+    u8g2.setDrawColor(1);
+    if (!next[i]->isEmpty()) u8g2.drawStr(0, OLED_BASELINE[i], next[i]->c_str());
+    for (int t = top / 8; t <= bottom / 8; ++t) tileRows |= (uint8_t)(1u << t);
+  }
+  oledValid = true;
+  if (!tileRows) {
+    ++oledUnchanged;
+    return;
+  }
+  // Send each contiguous run of dirty tile rows in one call
+  for (uint8_t t = 0; t < 8;) {
+    if (!(tileRows & (1u << t))) { ++t; continue; }
+    uint8_t end = t;
+    while (end < 8 && (tileRows & (1u << end))) ++end;
+    u8g2.updateDisplayArea(0, t, u8g2.getBufferTileWidth(), end - t);
+    t = end;
+  }
+  uint32_t us = micros() - t0;
+  ++oledRenders;
+  oledLastUs = us;
+  if (us > oledMaxUs) oledMaxUs = us;
+}
+
+// Capture ID sent with the upload and echoed by the Pi: random per boot in
+// the high half, a sequence number in the low half
+uint16_t captureBootTag = 0;
+String makeCaptureId() {
+  static uint16_t seq = 0;
+  char buf[9];
+  snprintf(buf, sizeof(buf), "%04x%04x", (unsigned)captureBootTag, (unsigned)++seq);
+  return String(buf);
 }
 
 String makeRemoteFilename() {
@@ -101,9 +242,17 @@ bool readExact(uint8_t* dst, size_t n, uint32_t timeout_ms) {
   return true;
 }
 
-bool requestCaptureAndSave(const char* path, String& err) {
+// Frames are kept in the flash ring log; FRAME_MAX_LEN is erased ahead of
+// every capture, so receiving one never waits for an erase.
+#define FRAME_MAX_LEN (384 * 1024)
+FrameLog frameLog;
+
+bool requestCaptureAndSave(FrameRef& out, String& err) {
   err = "";
 
+  // Erase before triggering, not while the frame streams in
+  if (!frameLog.reserve(FRAME_MAX_LEN)) { err = "frame log"; return false; }
+
   // purge input
   while (Serial2.available()) Serial2.read();
 
@@ -127,76 +276,48 @@ bool requestCaptureAndSave(const char* path, String& err) {
                (uint32_t)header[7];
 
   uint16_t want_crc = ((uint16_t)header[8] << 8) | (uint16_t)header[9];
-  if (L < 16 || L > 2*1024*1024) { err = "bad len"; return false; }
+  if (L < 16 || L > FRAME_MAX_LEN) { err = "bad len"; return false; }
 
-  // receive body to SPIFFS
-  File f = SPIFFS.open(path, FILE_WRITE);
-  if (!f) { err = "file open fail"; return false; }
-
-  const size_t BUFSZ = 2048;
-  uint8_t* buf = (uint8_t*)malloc(BUFSZ);
-  if (!buf) { f.close(); err = "oom"; return false; }
+  // receive body into the frame log, one sector write per 4 KB
+  if (!frameLog.beginRecord(L)) { err = "frame log"; return false; }
 
+  uint8_t buf[1024];
   size_t got = 0;
   uint16_t run_crc = 0xFFFF;
   uint32_t start = millis();
 
   while (got < L) {
-    if (millis() - start > 8000) { free(buf); f.close(); err = "timeout body"; return false; }
+    if (millis() - start > 8000) { frameLog.abort(); err = "timeout body"; return false; }
     int avail = Serial2.available();
     if (avail <= 0) { delay(1); continue; }
 
     size_t chunk = (size_t)avail;
     size_t remaining = L - got;
     if (chunk > remaining) chunk = remaining;
-    if (chunk > BUFSZ) chunk = BUFSZ;
+    if (chunk > sizeof(buf)) chunk = sizeof(buf);
 
     int r = Serial2.read(buf, chunk);
     if (r > 0) {
-      f.write(buf, (size_t)r);
-      run_crc = crc16(buf, (size_t)r) ^ (run_crc ^ 0xFFFF) ? // quick combine not trivial; do incremental:
-                crc16(buf, (size_t)r) : run_crc;             // simpler: recompute incrementally below
-      // simpler & correct incremental CRC:
-      run_crc = crc16(buf, (size_t)r) ^ 0; // recalc on chunk; to be strictly incremental we’d update bitwise;
-                                            // but to keep it simple we’ll compute a final CRC by re-reading the file later.
+      run_crc = crc16Update(run_crc, buf, (size_t)r);
+      if (!frameLog.append(buf, (size_t)r)) { frameLog.abort(); err = "flash write"; return false; }
       got += (size_t)r;
       start = millis();
     }
   }
-  f.close();
-  free(buf);
-
-  // recompute crc on the saved file (simple & safe)
-  File rf = SPIFFS.open(path, FILE_READ);
-  if (!rf) { err = "file reopen fail"; return false; }
-  uint16_t crc_final = 0xFFFF;
-  while (true) {
-    uint8_t tmp[1024];
-    int r = rf.read(tmp, sizeof(tmp));
-    if (r <= 0) break;
-    // true incremental:
-    for (int i = 0; i < r; ++i) {
-      crc_final ^= tmp[i];
-      for (int b = 0; b < 8; ++b) {
-        if (crc_final & 1) crc_final = (crc_final >> 1) ^ 0xA001;
-        else crc_final >>= 1;
-      }
-    }
-  }
-  rf.close();
 
-  if (crc_final != want_crc) { err = "crc mismatch"; return false; }
-  return true;
+  if (run_crc != want_crc) { frameLog.abort(); err = "crc mismatch"; return false; }
+  if (!frameLog.commit(run_crc)) { err = "flash commit"; return false; }
+  return frameLog.latest(out);
 }
 
-bool uploadFileToPi(const char* path, const String& remoteName, String& err) {
+// outBody receives the Pi's JSON reply (its analysis of the image)
+bool uploadFrameToPi(const FrameRef& frame, const String& remoteName, const String& captureId,
+                     String& err, String& outBody) {
   err = "";
+  outBody = "";
   if (WiFi.status() != WL_CONNECTED) { err = "wifi disconnected"; return false; }
 
-  File f = SPIFFS.open(path, FILE_READ);
-  if (!f) { err = "open fail"; return false; }
-  size_t total = f.size();
-  if (total == 0) { f.close(); err = "empty file"; return false; }
+  size_t total = frame.len;
 
   String safePath = PI_UPLOAD_PATH;
   if (!safePath.startsWith('/')) safePath = '/' + safePath;
@@ -206,31 +327,33 @@ bool uploadFileToPi(const char* path, const String& remoteName, String& err) {
   WiFiClient client;
   client.setTimeout(PI_RESPONSE_TIMEOUT_MS);
   if (!client.connect(PI_HOST, PI_PORT)) {
-    f.close();
     err = "connect fail";
     return false;
   }
 
-  client.print(String("POST ") + safePath + "?name=" + queryName + " HTTP/1.1\r\n");
+  client.print(String("POST ") + safePath + "?name=" + queryName + "&capture_id=" + captureId + " HTTP/1.1\r\n");
+  client.print(String("X-Capture-Id: ") + captureId + "\r\n");
   client.print(String("Host: ") + PI_HOST + ":" + String(PI_PORT) + "\r\n");
   client.print("Content-Type: image/jpeg\r\n");
   client.print("Connection: close\r\n");
   client.print(String("Content-Length: ") + (unsigned long)total + "\r\n\r\n");
 
-  const size_t BUF_SZ = 1024;
-  uint8_t buf[BUF_SZ];
-  while (f.available()) {
-    size_t n = f.read(buf, BUF_SZ);
-    if (!n) continue;
-    size_t written = client.write(buf, n);
+  // Body straight from the memory-mapped log, no staging buffer
+  spi_flash_mmap_handle_t map;
+  const uint8_t* body = frameLog.map(frame, map);
+  if (!body) { client.stop(); err = "flash map"; return false; }
+  for (size_t sent = 0; sent < total;) {
+    size_t n = total - sent < 4096 ? total - sent : 4096;
+    size_t written = client.write(body + sent, n);
     if (written != n) {
-      f.close();
+      FrameLog::unmap(map);
       client.stop();
       err = "socket write";
       return false;
     }
+    sent += n;
   }
-  f.close();
+  FrameLog::unmap(map);
 
   uint32_t start = millis();
   while (!client.available()) {
@@ -250,6 +373,21 @@ bool uploadFileToPi(const char* path, const String& remoteName, String& err) {
     return false;
   }
 
+  // Skip headers; the Pi closes the connection after the body
+  while (client.connected() || client.available()) {
+    String line = client.readStringUntil('\n');
+    if (line == "\r" || line.length() == 0) break;
+  }
+  while ((client.connected() || client.available()) && outBody.length() < 2048) {
+    int c = client.read();
+    if (c < 0) {
+      if (millis() - start > PI_RESPONSE_TIMEOUT_MS) break;
+      delay(1);
+      continue;
+    }
+    if (c != '\r' && c != '\n') outBody += (char)c;
+  }
+
   client.stop();
   return true;
 }
@@ -257,76 +395,143 @@ bool uploadFileToPi(const char* path, const String& remoteName, String& err) {
 bool captureAndUpload(String& err, String& remoteName) {
   err = "";
   remoteName = "";
-  const char* localPath = "/latest.jpg";
+  FrameRef frame;
 
+  uint32_t t0 = millis();
+  String captureId = makeCaptureId();
+  sseEvent("capture", String("{\"stage\":\"start\",\"t\":") + t0 + ",\"capture_id\":\"" + captureId + "\"}");
   String captureErr;
-  if (!requestCaptureAndSave(localPath, captureErr)) {
+  if (!requestCaptureAndSave(frame, captureErr)) {
     err = String("capture: ") + captureErr;
+    String ev = String("{\"stage\":\"error\",\"ms\":") + (millis() - t0) + ",\"err\":";
+    appendJsonString(ev, captureErr);
+    sseEvent("capture", ev + "}");
     return false;
   }
+  captureCount++;
+  size_t bytes = frame.len;
+  sseEvent("capture", String("{\"stage\":\"done\",\"ms\":") + (millis() - t0) +
+                      ",\"bytes\":" + bytes + ",\"captures\":" + captureCount + "}");
 
   remoteName = makeRemoteFilename();
 
+  uint32_t t1 = millis();
+  sseEvent("upload", String("{\"stage\":\"start\",\"bytes\":") + bytes + "}");
   String uploadErr;
-  if (!uploadFileToPi(localPath, remoteName, uploadErr)) {
+  String reply;
+  if (!uploadFrameToPi(frame, remoteName, captureId, uploadErr, reply)) {
     err = String("upload: ") + uploadErr;
     remoteName = "";
+    String ev = String("{\"stage\":\"error\",\"ms\":") + (millis() - t1) + ",\"err\":";
+    appendJsonString(ev, uploadErr);
+    sseEvent("upload", ev + "}");
     return false;
   }
+  String ev = String("{\"stage\":\"done\",\"ms\":") + (millis() - t1) + ",\"name\":";
+  appendJsonString(ev, remoteName);
+  sseEvent("upload", ev + "}");
+  if (reply.startsWith("{")) {
+    sseEvent("result", reply);
+  }
 
   return true;
 }
 
 // ----------- Web handlers -----------
-void handleRoot() {
-  String ip = WiFi.localIP().toString();
-  String target = String(PI_HOST) + ":" + String(PI_PORT) + String(PI_UPLOAD_PATH);
-  String targetHtml = target;
-  targetHtml.replace("&", "&amp;");
-  targetHtml.replace("<", "&lt;");
-  targetHtml.replace(">", "&gt;");
-
-  String status;
-  if (lastUploadTimestamp == 0) {
-    status = "No uploads yet";
-  } else if (lastUploadOk) {
-    status = String("Last upload OK &rarr; ") + lastUploadName;
+// The page is static (web/esp/, gzipped into web_assets.h at build time);
+// everything that changes comes from /status.json.
+void sendWebAsset(const WebAsset& a) {
+  String etag = String("\"") + a.version + "\"";
+  server.sendHeader("ETag", etag);
+  if (a.versioned && server.arg("v") == a.version) {
+    server.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
   } else {
-    status = String("Last upload FAIL: ") + lastUploadErr;
-  }
-  status.replace("&", "&amp;");
-  status.replace("<", "&lt;");
-  status.replace(">", "&gt;");
-
-  String html =
-    "<!doctype html><html><head><meta charset='utf-8'>"
-    "<meta name='viewport' content='width=device-width, initial-scale=1'/>"
-    "<title>ESP32 Leaf Viewer</title>"
-    "<style>body{font-family:sans-serif;margin:1rem}img{max-width:100%;height:auto;border:1px solid #ccc}</style>"
-    "</head><body>"
-    "<h2>ESP32 Leaf Viewer</h2>"
-    "<p>IP: " + ip + "</p>"
-    "<p>Pi target: " + targetHtml + "</p>"
-    "<p>" + status + "</p>"
-    "<button onclick=\"fetch('/capture').then(()=>setTimeout(()=>location.reload(),1500))\">Capture</button>"
-    "<p><img src='/image?ts="
-    + String(millis()) +
-    "'/></p>"
-    "</body></html>";
-  server.send(200, "text/html", html);
+    server.sendHeader("Cache-Control", "no-cache");
+  }
+  if (server.header("If-None-Match").indexOf(etag) >= 0) {
+    server.send(304);
+    return;
+  }
+  // There is no plain copy in flash: a client that refuses gzip gets 406
+  server.sendHeader("Vary", "Accept-Encoding");
+  bool hasAccept = server.hasHeader("Accept-Encoding");
+  if (!acceptsCoding(hasAccept ? server.header("Accept-Encoding").c_str() : nullptr, "gzip")) {
+    server.send(406, "text/plain", "This asset is only available gzip-encoded");
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, a.contentType, (const char*)a.gz, a.gzLen);
+}
+
+void handleStatus() {
+  String json;
+  json.reserve(192 + lastUploadName.length() + lastUploadErr.length());
+  json += "{\"ip\":\"";
+  json += WiFi.localIP().toString();
+  json += "\",\"target\":\"";
+  json += PI_HOST;
+  json += ':';
+  json += PI_PORT;
+  json += PI_UPLOAD_PATH;
+  json += "\",\"captures\":";
+  json += captureCount;
+  json += ",\"uploads\":";
+  json += uploadCount;
+  json += ",\"last_ok\":";
+  json += lastUploadOk ? "true" : "false";
+  json += ",\"last_name\":";
+  appendJsonString(json, lastUploadName);
+  json += ",\"last_err\":";
+  appendJsonString(json, lastUploadErr);
+  json += ",\"last_age_ms\":";
+  json += lastUploadTimestamp ? millis() - lastUploadTimestamp : 0;
+  json += ",\"btn_presses\":";
+  json += btnPresses;
+  json += ",\"btn_overflows\":";
+  json += btnOverflows;
+  json += ",\"btn_coalesced\":";
+  json += btnCoalesced;
+  json += ",\"btn_latency_us\":";
+  json += btnLastLatencyUs;
+  json += ",\"btn_max_latency_us\":";
+  json += btnMaxLatencyUs;
+  json += ",\"frame_log_count\":";
+  json += (uint32_t)frameLog.count();
+  json += ",\"frame_log_sector_us\":";
+  json += frameLog.lastSectorUs();
+  json += ",\"frame_log_max_sector_us\":";
+  json += frameLog.maxSectorUs();
+  json += ",\"oled_renders\":";
+  json += oledRenders;
+  json += ",\"oled_unchanged\":";
+  json += oledUnchanged;
+  json += ",\"oled_last_us\":";
+  json += oledLastUs;
+  json += ",\"oled_max_us\":";
+  json += oledMaxUs;
+  json += '}';
+  server.sendHeader("Cache-Control", "no-store");
+  server.send(200, "application/json", json);
 }
 
 void handleImage() {
-  if (!SPIFFS.exists("/latest.jpg")) {
+  FrameRef frame;
+  if (!frameLog.latest(frame)) {
     server.send(404, "text/plain", "No image yet");
     return;
   }
-  File f = SPIFFS.open("/latest.jpg", FILE_READ);
-  server.streamFile(f, "image/jpeg");
-  f.close();
+  spi_flash_mmap_handle_t map;
+  const uint8_t* jpeg = frameLog.map(frame, map);
+  if (!jpeg) {
+    server.send(500, "text/plain", "flash map failed");
+    return;
+  }
+  server.send_P(200, "image/jpeg", (PGM_P)jpeg, frame.len);
+  FrameLog::unmap(map);
 }
 
 void handleCapture() {
+  BtnBusy busy;
   String err;
   String remoteName;
   oledPrint("CAPTURE...", "sending to Pi");
@@ -343,25 +548,50 @@ void handleCapture() {
   }
 }
 
+void handleEvents() {
+  int slot = -1;
+  for (int i = 0; i < SSE_MAX_CLIENTS && slot < 0; ++i) {
+    if (!sseClients[i].connected()) slot = i;
+  }
+  if (slot < 0) {
+    server.send(503, "text/plain", "Too many event listeners");
+    return;
+  }
+  // Headers by hand: the stream outlives this handler. The copy of the client
+  // keeps the socket open after WebServer drops its own reference.
+  WiFiClient c = server.client();
+  c.print("HTTP/1.1 200 OK\r\n"
+          "Content-Type: text/event-stream\r\n"
+          "Cache-Control: no-cache\r\n"
+          "Connection: keep-alive\r\n\r\n"
+          "retry: 2000\n\n");
+  sseClients[slot] = c;
+}
+
 void setup() {
   Serial.begin(115200);
   delay(200);
+  captureBootTag = (uint16_t)esp_random();
 
   // UART to camera
+  Serial2.setRxBufferSize(UART_RX_BUFFER);
   Serial2.begin(UART_BAUD, SERIAL_8N1, UART_RX, UART_TX);
 
   // Button
   pinMode(BTN_PIN, INPUT_PULLUP);
+  btnQueue = xQueueCreate(BTN_QUEUE, sizeof(BtnPress));
+  attachInterrupt(digitalPinToInterrupt(BTN_PIN), buttonIsr, CHANGE);
 
   // OLED
   Wire.begin(SDA_PIN, SCL_PIN);
   u8g2.begin();
   oledPrint("Booting...");
 
-  // FS
-  if (!SPIFFS.begin(true)) {
-    oledPrint("SPIFFS fail");
+  // Frame log (erases ahead of itself while WiFi connects, then from loop())
+  if (!frameLog.begin()) {
+    oledPrint("Frame log fail", "check partitions");
   }
+  frameLog.setReserve(FRAME_MAX_LEN);
 
   // WiFi
   WiFi.mode(WIFI_STA);
@@ -369,43 +599,61 @@ void setup() {
   oledPrint("WiFi connecting", WIFI_SSID);
   uint32_t t0 = millis();
   while (WiFi.status() != WL_CONNECTED && millis() - t0 < 15000) {
-    delay(200);
+    if (!frameLog.service()) delay(200);
   }
   if (WiFi.status() == WL_CONNECTED) {
     oledPrint("WiFi OK", WiFi.localIP().toString());
   } else {
     oledPrint("WiFi FAIL", "Check SSID/PASS");
   }
+  // Whatever the WiFi wait left, so the first capture has nothing to erase
+  frameLog.reserve(FRAME_MAX_LEN);
 
   // Web
-  server.on("/", handleRoot);
+  for (size_t i = 0; i < WEB_ASSET_COUNT; ++i) {
+    const WebAsset* a = &WEB_ASSETS[i];
+    server.on(a->path, HTTP_GET, [a]() { sendWebAsset(*a); });
+  }
+  server.on("/status.json", HTTP_GET, handleStatus);
   server.on("/image", handleImage);
   server.on("/capture", handleCapture);
+  server.on("/events", HTTP_GET, handleEvents);
+  const char* headerKeys[] = {"If-None-Match", "Accept-Encoding"};
+  server.collectHeaders(headerKeys, 2);
   server.begin();
 }
 
-uint32_t lastBtnMs = 0;
-bool lastBtn = true;
+void serviceButton() {
+  BtnPress press, next;
+  if (xQueueReceive(btnQueue, &press, 0) != pdTRUE) return;
+  while (xQueuePeek(btnQueue, &next, 0) == pdTRUE &&
+         (next.us - press.us < BTN_COALESCE_MS * 1000UL ||
+          (press.capture && next.capture == press.capture))) {
+    xQueueReceive(btnQueue, &next, 0);
+    ++btnCoalesced;
+  }
+
+  BtnBusy busy;
+  btnLastLatencyUs = micros() - press.us;
+  if (btnLastLatencyUs > btnMaxLatencyUs) btnMaxLatencyUs = btnLastLatencyUs;
+  String err;
+  String remoteName;
+  oledPrint("BTN -> CAPTURE", "sending to Pi");
+  bool ok = captureAndUpload(err, remoteName);
+  if (ok) {
+    setLastUploadStatus(true, remoteName, "");
+    oledPrint("BTN OK", remoteName, "-> Pi");
+  } else {
+    setLastUploadStatus(false, "", err);
+    oledPrint("BTN FAIL", err);
+  }
+}
 
 void loop() {
   server.handleClient();
-
-  // Poll button (to GND, pullup)
-  bool now = digitalRead(BTN_PIN);
-  uint32_t ms = millis();
-  if (lastBtn && !now && (ms - lastBtnMs > 200)) { // falling edge
-    lastBtnMs = ms;
-    String err;
-    String remoteName;
-    oledPrint("BTN -> CAPTURE", "sending to Pi");
-    bool ok = captureAndUpload(err, remoteName);
-    if (ok) {
-      setLastUploadStatus(true, remoteName, "");
-      oledPrint("BTN OK", remoteName, "-> Pi");
-    } else {
-      setLastUploadStatus(false, "", err);
-      oledPrint("BTN FAIL", err);
-    }
+  if (millis() - sseLastWriteMs > SSE_KEEPALIVE_MS) {
+    sseWrite(": keepalive\n\n");  // also finds listeners that went away
   }
-  lastBtn = now;
+  serviceButton();
+  frameLog.service();
 }
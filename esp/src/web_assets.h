@@ -0,0 +1,109 @@
+// Generated by tools/gen_web_assets.py from web/esp/ -- do not edit.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Plain const data on the ESP32 (flash is memory-mapped) and on the host
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+struct WebAsset {
+  const char* path;
+  const char* contentType;
+  const uint8_t* gz;      // gzip-compressed body
+  size_t gzLen;
+  size_t rawLen;
+  const char* version;    // content hash; the ETag is the quoted version
+  bool versioned;         // linked as path?v=version, cacheable forever
+};
+
+// index.html: 621 -> 350 bytes
+static const uint8_t INDEX_HTML_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6d, 0x52, 0x41, 0x4e, 0xc3, 0x30,
+  0x10, 0xbc, 0xf3, 0x8a, 0xc5, 0x27, 0x90, 0x68, 0x53, 0x52, 0x51, 0x05, 0x64, 0x87, 0x03, 0xe2,
+  0x80, 0x84, 0x50, 0x25, 0x24, 0xee, 0x8e, 0xb3, 0x49, 0x4c, 0x9d, 0xc4, 0xb2, 0x37, 0xad, 0xf2,
+  0x7b, 0x9c, 0xb8, 0x94, 0x4a, 0xf4, 0xe4, 0xf5, 0xcc, 0x78, 0xc7, 0x3b, 0x36, 0xbf, 0x2e, 0x7b,
+  0x45, 0xa3, 0x45, 0x68, 0xa8, 0x35, 0xf9, 0x15, 0x8f, 0x0b, 0x00, 0x6f, 0x50, 0x96, 0x53, 0x11,
+  0xca, 0x16, 0x49, 0x82, 0x6a, 0xa4, 0xf3, 0x48, 0x82, 0x0d, 0x54, 0x2d, 0x32, 0x06, 0xc9, 0x39,
+  0xd9, 0xc9, 0x16, 0x05, 0xdb, 0x6b, 0x3c, 0xd8, 0xde, 0x11, 0x03, 0xd5, 0x77, 0x84, 0x5d, 0x10,
+  0x1f, 0x74, 0x49, 0x8d, 0x28, 0x71, 0xaf, 0x15, 0x2e, 0xe6, 0xcd, 0x1d, 0xe8, 0x4e, 0x93, 0x96,
+  0x66, 0xe1, 0x95, 0x34, 0x28, 0xee, 0xff, 0x5a, 0x91, 0x26, 0x83, 0xf9, 0xeb, 0xe7, 0x76, 0x9d,
+  0xc2, 0x3b, 0xca, 0x0a, 0xbe, 0x42, 0x43, 0x74, 0x3c, 0x89, 0x44, 0x14, 0x19, 0xdd, 0xed, 0xc0,
+  0xa1, 0x11, 0xcc, 0xd3, 0x68, 0xd0, 0x37, 0x88, 0xc1, 0xb0, 0x71, 0x58, 0x1d, 0x91, 0xa5, 0xf2,
+  0xfe, 0x79, 0x2f, 0xb2, 0x87, 0x72, 0x95, 0x15, 0x6a, 0xfd, 0x58, 0x6c, 0x1e, 0x8e, 0x16, 0x3c,
+  0xf9, 0x1d, 0x8a, 0x17, 0x7d, 0x39, 0x1e, 0x1b, 0x36, 0xe9, 0x25, 0xcb, 0x80, 0x46, 0xda, 0xe6,
+  0x6f, 0xdb, 0x27, 0xe0, 0xde, 0xca, 0x0e, 0x74, 0x29, 0x98, 0xb6, 0x2c, 0xe7, 0xc9, 0xb4, 0x0d,
+  0x8b, 0x3d, 0x89, 0xb6, 0x1a, 0x48, 0xba, 0x1a, 0xe9, 0x5c, 0x1b, 0x91, 0x4b, 0xfa, 0x99, 0xf6,
+  0x24, 0x69, 0xf0, 0xec, 0x1f, 0x6e, 0x5d, 0x5f, 0x3b, 0xf4, 0x17, 0x98, 0x80, 0x0e, 0x86, 0xce,
+  0xf1, 0x62, 0x20, 0xea, 0xa3, 0x9b, 0x92, 0x96, 0x06, 0x87, 0x0c, 0xfa, 0x4e, 0x19, 0xad, 0x76,
+  0x27, 0xe4, 0xe6, 0x96, 0xe5, 0x2f, 0xb1, 0xe4, 0x49, 0x3c, 0x70, 0xba, 0x37, 0xd7, 0x6d, 0x1d,
+  0xe7, 0x6a, 0x6b, 0x06, 0xd2, 0x84, 0x37, 0xfb, 0xe8, 0x41, 0xb7, 0xb2, 0x46, 0x18, 0xa7, 0x64,
+  0x93, 0x33, 0x33, 0xaf, 0x9c, 0xb6, 0x04, 0xde, 0x29, 0xc1, 0xa4, 0xb5, 0xcb, 0xef, 0x29, 0xe8,
+  0x42, 0xad, 0xd2, 0xb4, 0x5a, 0xaf, 0x70, 0x53, 0x64, 0xf3, 0xa8, 0xb3, 0x28, 0xe6, 0x1d, 0x63,
+  0x0e, 0x69, 0xce, 0xbf, 0xea, 0x07, 0x3a, 0x00, 0xd2, 0x74, 0x6d, 0x02, 0x00, 0x00,
+};
+
+// app.js: 1840 -> 654 bytes
+static const uint8_t APP_JS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xbd, 0x55, 0xc1, 0x6e, 0xdb, 0x30,
+  0x0c, 0xbd, 0xfb, 0x2b, 0x38, 0xa0, 0x80, 0x6d, 0x74, 0x53, 0xee, 0x0d, 0xb2, 0x61, 0x2b, 0x3a,
+  0xa0, 0x5b, 0xd1, 0x1e, 0x8a, 0x9d, 0x07, 0xc5, 0xa6, 0x13, 0x6d, 0xb6, 0x64, 0x88, 0xd2, 0xb2,
+  0xa0, 0xc8, 0x75, 0x1f, 0xb0, 0x4f, 0xdc, 0x97, 0x8c, 0x92, 0x9c, 0x26, 0x6e, 0xd3, 0x36, 0xd8,
+  0x61, 0x27, 0xc9, 0x16, 0xdf, 0xa3, 0xf8, 0x1e, 0x4d, 0x37, 0x5e, 0x57, 0x4e, 0x19, 0x0d, 0x27,
+  0x85, 0xaa, 0xcb, 0x3b, 0xb0, 0xe8, 0xbc, 0xd5, 0x50, 0x9b, 0xca, 0x77, 0xa8, 0x9d, 0x58, 0xa0,
+  0xbb, 0x68, 0x31, 0x6c, 0x3f, 0xac, 0x2f, 0xeb, 0x10, 0x33, 0x85, 0x4d, 0x26, 0x69, 0xad, 0x2b,
+  0x68, 0xb6, 0x58, 0x72, 0xd2, 0x79, 0x2a, 0xca, 0xbb, 0x0c, 0xc0, 0xd9, 0x35, 0x84, 0x15, 0xa0,
+  0x32, 0x9a, 0x1c, 0x10, 0xcc, 0x40, 0xae, 0xa4, 0x72, 0x50, 0xa4, 0xa5, 0x41, 0x57, 0x2d, 0x8b,
+  0x7c, 0x92, 0x40, 0xe2, 0x1b, 0x19, 0x9d, 0x97, 0x65, 0x5c, 0x8b, 0x72, 0x1a, 0x91, 0x27, 0x45,
+  0xae, 0xfa, 0xbc, 0x14, 0x0e, 0x7f, 0xba, 0x73, 0xa3, 0x1d, 0x67, 0x67, 0x16, 0x12, 0xaa, 0xbf,
+  0x3f, 0x77, 0xd2, 0xf2, 0xd5, 0x0e, 0xc4, 0xa4, 0x83, 0x14, 0xa7, 0x1a, 0x28, 0x5e, 0x91, 0xf0,
+  0x7d, 0x6b, 0x64, 0x4d, 0x65, 0xc0, 0xa5, 0xac, 0x8f, 0x70, 0xf9, 0xb5, 0x81, 0x21, 0x0c, 0xd6,
+  0xcc, 0x9b, 0xf0, 0xd8, 0x12, 0x46, 0x12, 0x12, 0xad, 0x24, 0xf7, 0xd5, 0x7c, 0x7f, 0x96, 0xe3,
+  0x8a, 0x63, 0x06, 0x16, 0xb8, 0xf9, 0x0c, 0x7f, 0x7e, 0xfd, 0x86, 0x1c, 0x4e, 0x61, 0x00, 0x6b,
+  0xd9, 0xe1, 0x1e, 0xed, 0x91, 0x3c, 0x1f, 0xdf, 0x5f, 0x5e, 0x9d, 0xed, 0xd3, 0xa0, 0xb5, 0xbb,
+  0xe2, 0x48, 0x54, 0xb2, 0x67, 0xc3, 0x30, 0x15, 0xa7, 0xba, 0x05, 0xb3, 0x91, 0xad, 0x02, 0xcb,
+  0x44, 0x75, 0x72, 0x81, 0xef, 0xf4, 0x2c, 0x81, 0xb7, 0x81, 0x01, 0xbc, 0x81, 0x4a, 0x06, 0x13,
+  0xb0, 0xbc, 0xdb, 0x64, 0x9b, 0x6c, 0x32, 0x81, 0x5b, 0xc7, 0xb1, 0x80, 0x3f, 0xf8, 0x06, 0x04,
+  0xbd, 0xa7, 0x25, 0xd6, 0x30, 0x5f, 0x83, 0x5b, 0x22, 0x2c, 0xfd, 0x1c, 0x56, 0x4b, 0xd5, 0x22,
+  0x48, 0x18, 0x48, 0xc0, 0x7a, 0x4d, 0x50, 0xcc, 0xbd, 0x73, 0xec, 0xbe, 0xb1, 0xd0, 0x33, 0xba,
+  0xcc, 0xee, 0xfb, 0xa1, 0x55, 0xc4, 0xb5, 0xa4, 0x7e, 0x48, 0x5d, 0x80, 0xa1, 0x0d, 0x34, 0xae,
+  0xe0, 0x22, 0xa4, 0xb8, 0x35, 0xde, 0x56, 0xc8, 0x3d, 0x90, 0x12, 0xe6, 0xd1, 0x76, 0x24, 0x21,
+  0xeb, 0x3a, 0x9e, 0x5f, 0x45, 0x3c, 0xda, 0x22, 0x1f, 0x12, 0xe6, 0xaf, 0xa1, 0xe8, 0x4a, 0x98,
+  0xbd, 0x1d, 0xb5, 0x16, 0x32, 0xe7, 0xa7, 0xdb, 0x9b, 0x6b, 0xd1, 0x4b, 0x4b, 0x58, 0x74, 0xa2,
+  0x96, 0x4e, 0x96, 0x3b, 0x75, 0x50, 0x50, 0x2c, 0x6b, 0x36, 0x63, 0x39, 0x78, 0x6b, 0xb9, 0x5f,
+  0x82, 0x4c, 0xbd, 0x35, 0x0b, 0x56, 0xe2, 0x80, 0xf2, 0xe7, 0x31, 0x9d, 0xd2, 0x0b, 0x21, 0xc4,
+  0xc3, 0x1e, 0x18, 0xb1, 0xd5, 0x46, 0x23, 0x93, 0xa5, 0xdb, 0xc0, 0x31, 0xa4, 0x2c, 0x68, 0x30,
+  0x02, 0xc5, 0x7c, 0xed, 0x58, 0x8d, 0x53, 0x7e, 0x4a, 0x3b, 0xa5, 0x87, 0x83, 0x2e, 0xbd, 0xed,
+  0x68, 0xc8, 0x0c, 0xcf, 0x5b, 0x8a, 0x23, 0x4b, 0x83, 0xa9, 0xdb, 0xbe, 0x7a, 0xf1, 0x2a, 0xd0,
+  0x48, 0xf6, 0xb3, 0x3e, 0x1b, 0x12, 0x0f, 0x2d, 0xb5, 0x79, 0xda, 0x86, 0xd4, 0x8c, 0xff, 0xcb,
+  0x85, 0x2f, 0x31, 0x1b, 0xbb, 0x70, 0x58, 0xb1, 0x23, 0xbd, 0x39, 0x22, 0x05, 0x7b, 0xf2, 0xa4,
+  0xfa, 0x2f, 0x8b, 0x99, 0x38, 0x0e, 0x6b, 0x39, 0x2e, 0xfd, 0xd5, 0x7e, 0xe9, 0xdb, 0x61, 0xf9,
+  0x82, 0xe4, 0x9c, 0xd3, 0xb7, 0xee, 0x5f, 0x25, 0x6f, 0x51, 0x36, 0x71, 0xe2, 0x44, 0x1d, 0x06,
+  0xae, 0x87, 0x15, 0xec, 0x85, 0x85, 0xda, 0xb7, 0x25, 0xd4, 0x8a, 0x50, 0x52, 0x7c, 0x05, 0x6f,
+  0x86, 0x77, 0x64, 0x5a, 0x1f, 0x3e, 0xed, 0xd1, 0xa5, 0x8d, 0x36, 0x3d, 0xea, 0x30, 0x75, 0x63,
+  0x49, 0xd3, 0xec, 0xd1, 0x8f, 0x61, 0xe8, 0xd0, 0x34, 0x09, 0x4e, 0x76, 0x9f, 0x73, 0x19, 0x92,
+  0xc8, 0x39, 0xeb, 0xc6, 0x68, 0x67, 0x7d, 0x1c, 0x8c, 0xf1, 0xcf, 0x01, 0xe3, 0x9f, 0xc4, 0x3d,
+  0x60, 0x3a, 0x1e, 0x5a, 0x4f, 0xb3, 0x35, 0x92, 0x8d, 0x0b, 0x74, 0x71, 0xf8, 0xaf, 0x94, 0xae,
+  0xcd, 0x4a, 0xec, 0x4d, 0x9d, 0x7d, 0x03, 0x36, 0x59, 0x08, 0x3a, 0x14, 0xb3, 0x9d, 0x60, 0xd3,
+  0x2c, 0xf6, 0xc1, 0x0e, 0xf2, 0x17, 0x0d, 0x3b, 0x03, 0xa5, 0x30, 0x07, 0x00, 0x00,
+};
+
+// style.css: 111 -> 117 bytes
+static const uint8_t STYLE_CSS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x15, 0xcb, 0x4b, 0x0a, 0xc3, 0x30,
+  0x0c, 0x45, 0xd1, 0x79, 0x57, 0xf1, 0xa0, 0x74, 0x68, 0x48, 0xa7, 0xf6, 0x6a, 0x14, 0x7f, 0x05,
+  0xb1, 0x55, 0x64, 0x87, 0x24, 0x94, 0xec, 0xbd, 0xee, 0xf8, 0xdc, 0xbb, 0x4a, 0xb8, 0xf0, 0x45,
+  0x92, 0x36, 0x4c, 0xa2, 0xca, 0xdb, 0x65, 0xd1, 0xa9, 0x75, 0xd3, 0xa3, 0x72, 0x72, 0xa8, 0xa4,
+  0x99, 0x9b, 0xc5, 0x5b, 0x63, 0x75, 0xb8, 0x1f, 0x5c, 0xf3, 0xcc, 0x2b, 0x9d, 0xe6, 0xe0, 0x30,
+  0xca, 0x84, 0x65, 0x79, 0x39, 0x94, 0xc8, 0xb9, 0x0c, 0x0b, 0xda, 0x87, 0x38, 0xac, 0xa2, 0x21,
+  0xea, 0xb4, 0xcf, 0x89, 0x2e, 0x1b, 0x07, 0x3c, 0xbd, 0xf7, 0xff, 0xfd, 0x07, 0x4a, 0xa5, 0x19,
+  0x13, 0x6f, 0x00, 0x00, 0x00,
+};
+
+static const WebAsset WEB_ASSETS[] = {
+  {"/", "text/html", INDEX_HTML_GZ, sizeof(INDEX_HTML_GZ), 621, "54aeca00b28a", false},
+  {"/app.js", "application/javascript", APP_JS_GZ, sizeof(APP_JS_GZ), 1840, "bc022f30e6b8", true},
+  {"/style.css", "text/css", STYLE_CSS_GZ, sizeof(STYLE_CSS_GZ), 111, "85d08bc39b65", true},
+};
+static const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);
@@ -0,0 +1,79 @@
+#include "batch_frame.h"
+#include "crc16.h"
+
+BatchWriter::BatchWriter(size_t maxBytes, uint16_t maxFrames, uint32_t maxAgeMs)
+  : maxBytes_(maxBytes),
+    maxFrames_(maxFrames > BATCH_MAX_FRAMES ? BATCH_MAX_FRAMES : maxFrames),
+    maxAgeMs_(maxAgeMs) {}
+
+bool BatchWriter::add(const uint8_t* jpg, size_t len, uint32_t nowMs) {
+  if (!jpg || len == 0) return false;
+  if (count_ >= maxFrames_) return false;
+  size_t base = count_ ? buf_.size() : BATCH_HEADER_LEN;
+  size_t need = base + BATCH_FRAME_HEADER_LEN + len;
+  // An oversized frame is still accepted on its own so it can be sent.
+  if (count_ && need > maxBytes_) return false;
+
+  if (!count_) {
+    buf_.clear();
+    buf_.reserve(need);
+    const uint8_t hdr[BATCH_HEADER_LEN] = {'P', 'V', 'I', 'B', 0, 0};
+    buf_.insert(buf_.end(), hdr, hdr + BATCH_HEADER_LEN);
+    firstMs_ = nowMs;
+  }
+  uint16_t crc = crc16(jpg, len);
+  const uint8_t fh[BATCH_FRAME_HEADER_LEN] = {
+    (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len,
+    (uint8_t)(crc >> 8), (uint8_t)crc
+  };
+  buf_.insert(buf_.end(), fh, fh + BATCH_FRAME_HEADER_LEN);
+  buf_.insert(buf_.end(), jpg, jpg + len);
+  ++count_;
+  buf_[4] = (uint8_t)(count_ >> 8);
+  buf_[5] = (uint8_t)count_;
+  return true;
+}
+
+bool BatchWriter::shouldFlush(uint32_t nowMs) const {
+  if (!count_) return false;
+  if (count_ >= maxFrames_) return true;
+  if (buf_.size() >= maxBytes_) return true;
+  return nowMs - firstMs_ >= maxAgeMs_;
+}
+
+void BatchWriter::clear() {
+  buf_.clear();
+  count_ = 0;
+  firstMs_ = 0;
+}
+
+bool parseBatch(const uint8_t* data, size_t len, std::vector<BatchFrameView>& out, std::string& err) {
+  out.clear();
+  if (len < BATCH_HEADER_LEN || data[0] != 'P' || data[1] != 'V' || data[2] != 'I' || data[3] != 'B') {
+    err = "bad magic";
+    return false;
+  }
+  uint16_t count = (uint16_t)data[4] << 8 | data[5];
+  if (count == 0 || count > BATCH_MAX_FRAMES) {
+    err = "bad count";
+    return false;
+  }
+  size_t pos = BATCH_HEADER_LEN;
+  for (uint16_t i = 0; i < count; ++i) {
+    if (len - pos < BATCH_FRAME_HEADER_LEN) { err = "truncated header"; return false; }
+    const uint8_t* h = data + pos;
+    uint32_t n = (uint32_t)h[0] << 24 | (uint32_t)h[1] << 16 | (uint32_t)h[2] << 8 | (uint32_t)h[3];
+    uint16_t crc = (uint16_t)h[4] << 8 | h[5];
+    pos += BATCH_FRAME_HEADER_LEN;
+    if (n == 0 || n > len - pos) { err = "truncated frame"; return false; }
+    if (crc16(data + pos, n) != crc) { err = "crc mismatch"; return false; }
+    BatchFrameView v = { data + pos, n };
+    out.push_back(v);
+    pos += n;
+  }
+  if (pos != len) {
+    err = "trailing bytes";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// ====== Batched upload format ======
+// Several JPEGs sent to the Pi in one POST /upload_batch request, framed the
+// same way the camera frames a single image on the UART link:
+//   'P''V''I''B' + 2-byte BE frame count
+//   per frame: 4-byte BE length + 2-byte BE CRC16 + JPEG bytes
+static const char BATCH_CONTENT_TYPE[] = "application/x-pvic-batch";
+static const size_t BATCH_HEADER_LEN = 6;
+static const size_t BATCH_FRAME_HEADER_LEN = 6;
+static const uint16_t BATCH_MAX_FRAMES = 64;
+
+// Accumulates frames until a size, count or age limit is reached.
+class BatchWriter {
+ public:
+  BatchWriter(size_t maxBytes, uint16_t maxFrames, uint32_t maxAgeMs);
+
+  // Appends a frame. Returns false (and leaves the batch untouched) when the
+  // frame does not fit; flush and retry in that case.
+  bool add(const uint8_t* jpg, size_t len, uint32_t nowMs);
+
+  // True once any limit is hit: byte budget, frame count or age of the
+  // oldest queued frame.
+  bool shouldFlush(uint32_t nowMs) const;
+
+  bool empty() const { return count_ == 0; }
+  uint16_t count() const { return count_; }
+  size_t bytes() const { return buf_.size(); }
+  const std::vector<uint8_t>& body() const { return buf_; }
+  void clear();
+
+ private:
+  size_t maxBytes_;
+  uint16_t maxFrames_;
+  uint32_t maxAgeMs_;
+  uint32_t firstMs_ = 0;
+  uint16_t count_ = 0;
+  std::vector<uint8_t> buf_;
+};
+
+struct BatchFrameView {
+  const uint8_t* data;
+  size_t len;
+};
+
+// Splits a batch body into frames, checking every CRC. Views point into data.
+bool parseBatch(const uint8_t* data, size_t len, std::vector<BatchFrameView>& out, std::string& err);
@@ -0,0 +1,233 @@
+#include "camera_scheduler.h"
+
+const char* cameraStateName(CameraState s) {
+  switch (s) {
+    case CAM_IDLE: return "idle";
+    case CAM_EXPOSING: return "exposing";
+    case CAM_TRANSFER: return "transfer";
+  }
+  return "?";
+}
+
+// Wrap-safe "a is at or after b" for millisecond clocks
+static bool reached(uint32_t now, uint32_t at) {
+  return (int32_t)(now - at) >= 0;
+}
+
+CaptureScheduler::CaptureScheduler(size_t cameras, size_t queueDepth, uint32_t timeoutMs)
+    : cams_(cameras < 1 ? 1 : cameras > CAM_MAX ? CAM_MAX : cameras),
+      links_(cams_.size()),
+      queueDepth_(queueDepth < 1 ? 1 : queueDepth),
+      timeoutMs_(timeoutMs) {
+  for (size_t i = 0; i < cams_.size(); ++i) {
+    cams_[i].st.link = (uint8_t)i;
+    cams_[i].address = (uint8_t)(i + 1);
+  }
+}
+
+void CaptureScheduler::setLink(uint8_t cam, uint8_t link, bool bus) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (cam >= cams_.size() || link >= CAM_MAX) return;
+  if (link >= links_.size()) links_.resize(link + 1);
+  links_[link].bus = bus;
+  cams_[cam].st.link = link;
+}
+
+void CaptureScheduler::request(uint8_t cam, uint16_t n) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (cam >= cams_.size()) return;
+  uint16_t& p = cams_[cam].st.pending;
+  p = (uint32_t)p + n > 0xFFFF ? 0xFFFF : (uint16_t)(p + n);
+}
+
+void CaptureScheduler::requestAll(uint16_t n) {
+  for (size_t i = 0; i < cams_.size(); ++i) request((uint8_t)i, n);
+}
+
+bool CaptureScheduler::hasRoom(const Camera& c) const {
+  return c.queue.size() + (c.st.state != CAM_IDLE ? 1 : 0) < queueDepth_;
+}
+
+void CaptureScheduler::release(uint8_t cam) {
+  Camera& c = cams_[cam];
+  c.st.state = CAM_IDLE;
+  Link& l = links_[c.st.link];
+  if (l.owner == (int)cam) l.owner = -1;
+}
+
+bool CaptureScheduler::pickTrigger(uint8_t link, uint32_t nowMs, CameraAction& out) {
+  Link& l = links_[link];
+  if (l.owner >= 0) return false;  // a point-to-point link is busy, or a bus is in use
+  for (size_t k = 0; k < cams_.size(); ++k) {
+    size_t i = (triggerRr_ + k) % cams_.size();
+    Camera& c = cams_[i];
+    if (c.st.link != link || c.st.state != CAM_IDLE || !c.st.pending || !hasRoom(c)) continue;
+    if (++seq_ == 0) ++seq_;
+    c.captureId = idBase_ | seq_;
+    --c.st.pending;
+    ++c.st.triggers;
+    c.triggerMs = nowMs;
+    c.deadlineMs = nowMs + timeoutMs_;
+    if (l.bus) {
+      c.st.state = CAM_EXPOSING;
+    } else {
+      c.st.state = CAM_TRANSFER;
+      l.owner = (int)i;
+    }
+    triggerRr_ = i + 1;
+    out.kind = CameraAction::TRIGGER;
+    out.cam = (uint8_t)i;
+    out.link = link;
+    out.captureId = c.captureId;
+    return true;
+  }
+  return false;
+}
+
+// Bus only: the free bus goes to the camera triggered longest ago whose
+// exposure should be over
+bool CaptureScheduler::pickGrant(uint8_t link, uint32_t nowMs, CameraAction& out) {
+  Link& l = links_[link];
+  if (!l.bus || l.owner >= 0) return false;
+  int best = -1;
+  for (size_t i = 0; i < cams_.size(); ++i) {
+    const Camera& c = cams_[i];
+    if (c.st.link != link || c.st.state != CAM_EXPOSING) continue;
+    if (!reached(nowMs, c.triggerMs + c.exposeMs)) continue;
+    if (best < 0 || (int32_t)(c.triggerMs - cams_[best].triggerMs) < 0) best = (int)i;
+  }
+  if (best < 0) return false;
+  Camera& c = cams_[best];
+  c.st.state = CAM_TRANSFER;
+  c.deadlineMs = nowMs + timeoutMs_;
+  l.owner = best;
+  out.kind = CameraAction::GRANT;
+  out.cam = (uint8_t)best;
+  out.link = link;
+  out.captureId = c.captureId;
+  return true;
+}
+
+bool CaptureScheduler::next(uint32_t nowMs, CameraAction& out) {
+  std::lock_guard<std::mutex> g(lock_);
+  for (size_t i = 0; i < cams_.size(); ++i) {
+    Camera& c = cams_[i];
+    if (c.st.state != CAM_IDLE && reached(nowMs, c.deadlineMs)) {
+      ++c.st.timeouts;
+      release((uint8_t)i);
+    }
+  }
+  // Triggers first: on a bus they have to go out before the next transfer
+  for (size_t l = 0; l < links_.size(); ++l) {
+    if (pickTrigger((uint8_t)l, nowMs, out)) return true;
+  }
+  for (size_t l = 0; l < links_.size(); ++l) {
+    if (pickGrant((uint8_t)l, nowMs, out)) return true;
+  }
+  out = CameraAction();
+  return false;
+}
+
+uint8_t CaptureScheduler::cameraAt(uint8_t link, uint8_t address) const {
+  std::lock_guard<std::mutex> g(lock_);
+  for (size_t i = 0; i < cams_.size(); ++i) {
+    if (cams_[i].st.link == link && cams_[i].address == address) return (uint8_t)i;
+  }
+  return CAM_MAX;
+}
+
+uint8_t CaptureScheduler::cameraOn(uint8_t link) const {
+  std::lock_guard<std::mutex> g(lock_);
+  for (size_t i = 0; i < cams_.size(); ++i) {
+    if (cams_[i].st.link == link) return (uint8_t)i;
+  }
+  return CAM_MAX;
+}
+
+bool CaptureScheduler::onFrame(uint8_t cam, uint32_t captureId, const SharedBytes& jpg,
+                               uint16_t crc, uint16_t camMs, uint32_t nowMs) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (cam >= cams_.size()) return false;
+  Camera& c = cams_[cam];
+  if (c.st.state != CAM_TRANSFER || captureId != c.captureId || !jpg) {
+    ++c.st.stale;
+    return false;
+  }
+  QueuedFrame f;
+  f.jpg = jpg;
+  f.cam = cam;
+  f.crc = crc;
+  f.captureId = captureId;
+  f.camMs = camMs;
+  f.linkMs = nowMs - c.triggerMs;
+  f.readyMs = nowMs;
+  c.queue.push_back(f);
+  ++c.st.frames;
+  c.st.bytes += jpg->size();
+  c.st.lastCamMs = camMs;
+  c.st.lastLinkMs = f.linkMs;
+  c.st.lastFrameMs = nowMs;
+  c.exposeMs = c.exposeMs ? (c.exposeMs * 3 + camMs) / 4 : camMs;
+  release(cam);
+  return true;
+}
+
+void CaptureScheduler::onFailure(uint8_t cam, uint32_t nowMs) {
+  (void)nowMs;
+  std::lock_guard<std::mutex> g(lock_);
+  if (cam >= cams_.size() || cams_[cam].st.state == CAM_IDLE) return;
+  ++cams_[cam].st.failures;
+  release(cam);
+}
+
+bool CaptureScheduler::takeUpload(QueuedFrame& out) {
+  std::lock_guard<std::mutex> g(lock_);
+  for (size_t k = 0; k < cams_.size(); ++k) {
+    size_t i = (uploadRr_ + k) % cams_.size();
+    Camera& c = cams_[i];
+    if (c.queue.empty()) continue;
+    out = c.queue.front();
+    c.queue.pop_front();
+    uploadRr_ = i + 1;
+    return true;
+  }
+  return false;
+}
+
+void CaptureScheduler::uploaded(uint8_t cam, bool ok) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (cam >= cams_.size()) return;
+  if (ok) {
+    ++cams_[cam].st.uploads;
+  } else {
+    ++cams_[cam].st.uploadFailures;
+  }
+}
+
+bool CaptureScheduler::linkIsBus(uint8_t link) const {
+  std::lock_guard<std::mutex> g(lock_);
+  return link < links_.size() && links_[link].bus;
+}
+
+CameraStats CaptureScheduler::stats(uint8_t cam) const {
+  std::lock_guard<std::mutex> g(lock_);
+  if (cam >= cams_.size()) return CameraStats();
+  CameraStats st = cams_[cam].st;
+  st.queued = (uint8_t)cams_[cam].queue.size();
+  return st;
+}
+
+size_t CaptureScheduler::queuedTotal() const {
+  std::lock_guard<std::mutex> g(lock_);
+  size_t n = 0;
+  for (const Camera& c : cams_) n += c.queue.size();
+  return n;
+}
+
+bool CaptureScheduler::idle() const {
+  std::lock_guard<std::mutex> g(lock_);
+  for (const Camera& c : cams_) {
+    if (c.st.pending || c.st.state != CAM_IDLE || !c.queue.empty()) return false;
+  }
+  return true;
+}
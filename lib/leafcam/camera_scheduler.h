@@ -0,0 +1,146 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "http_event.h"
+
+// ====== Multi-camera capture scheduling ======
+// Decides, for several cameras, when to trigger which one and which frame
+// goes up next, so that camera links and the WiFi uplink stay busy at the
+// same time: while one frame is being uploaded the next ones are already
+// being exposed and transferred.
+//
+// Cameras sit on links. A point-to-point link (its own UART) carries one
+// camera, which sends its frame as soon as it is taken, so the link is busy
+// from trigger to frame. A bus link (RS-485) is shared and half duplex:
+// commands only go out while nobody transmits, and an addressed camera
+// keeps its frame until it is granted the bus. Idle cameras are triggered
+// first, so their exposures overlap the transfer in progress; the grant
+// goes to the camera triggered longest ago once its usual exposure time
+// has passed.
+//
+// Each camera has a request count, a queue of received frames (at most
+// queueDepth, counting the one in flight, so a slow uplink holds cameras
+// back instead of dropping frames) and its own statistics. Triggers and
+// uploads both go round robin over the cameras that can use them.
+//
+// Nothing here touches hardware: next() says what to send and on*() report
+// what arrived, with the time passed in, so the link task of the hub and a
+// host simulation drive the same code. Thread-safe.
+
+static const size_t CAM_MAX = 8;
+
+enum CameraState {
+  CAM_IDLE = 0,
+  CAM_EXPOSING,  // triggered on a bus, waiting for the grant
+  CAM_TRANSFER,  // sending (or about to send) its frame
+};
+const char* cameraStateName(CameraState s);
+
+struct CameraAction {
+  enum Kind { NONE, TRIGGER, GRANT };
+  Kind kind = NONE;
+  uint8_t cam = 0;
+  uint8_t link = 0;
+  uint32_t captureId = 0;  // TRIGGER: the ID the frame must echo
+};
+
+struct QueuedFrame {
+  SharedBytes jpg;
+  uint8_t cam = 0;
+  uint16_t crc = 0;
+  uint32_t captureId = 0;
+  uint16_t camMs = 0;    // reported by the camera
+  uint32_t linkMs = 0;   // trigger to last byte received
+  uint32_t readyMs = 0;  // when it was queued
+};
+
+struct CameraStats {
+  CameraState state = CAM_IDLE;
+  uint8_t link = 0;
+  uint16_t pending = 0;  // captures requested, not yet triggered
+  uint8_t queued = 0;    // frames waiting for the uplink
+  uint32_t triggers = 0;
+  uint32_t frames = 0;
+  uint32_t failures = 0;  // error frames and bad CRCs
+  uint32_t timeouts = 0;
+  uint32_t stale = 0;     // frames nobody was waiting for
+  uint32_t uploads = 0;
+  uint32_t uploadFailures = 0;
+  uint64_t bytes = 0;
+  uint32_t lastCamMs = 0;
+  uint32_t lastLinkMs = 0;
+  uint32_t lastFrameMs = 0;  // scheduler time of the last frame
+};
+
+class CaptureScheduler {
+ public:
+  // Every camera starts on its own point-to-point link (link = camera).
+  CaptureScheduler(size_t cameras, size_t queueDepth, uint32_t timeoutMs);
+
+  // Puts cam on link; bus links are shared and need grants. Set up before use.
+  void setLink(uint8_t cam, uint8_t link, bool bus);
+  // Capture IDs are base | sequence (the hub's boot tag in the high half).
+  void setCaptureIdBase(uint32_t base) { idBase_ = base; }
+
+  void request(uint8_t cam, uint16_t n = 1);
+  void requestAll(uint16_t n = 1);
+
+  // Link side. The next command due at nowMs; call until it returns false.
+  // Transfers past their deadline are failed here.
+  bool next(uint32_t nowMs, CameraAction& out);
+  // Camera on a bus link by its 1-based address, CAM_MAX if none.
+  uint8_t cameraAt(uint8_t link, uint8_t address) const;
+  // Camera of a point-to-point link, CAM_MAX if none.
+  uint8_t cameraOn(uint8_t link) const;
+  // A frame with a valid CRC from cam. False (and nothing queued) unless it
+  // is the one cam was triggered for.
+  bool onFrame(uint8_t cam, uint32_t captureId, const SharedBytes& jpg, uint16_t crc,
+               uint16_t camMs, uint32_t nowMs);
+  // cam answered with an error, or its frame failed the CRC.
+  void onFailure(uint8_t cam, uint32_t nowMs);
+
+  // Uplink side: the next queued frame, round robin over cameras.
+  bool takeUpload(QueuedFrame& out);
+  void uploaded(uint8_t cam, bool ok);
+
+  size_t cameras() const { return cams_.size(); }
+  size_t links() const { return links_.size(); }
+  bool linkIsBus(uint8_t link) const;
+  CameraStats stats(uint8_t cam) const;
+  size_t queuedTotal() const;
+  bool idle() const;  // nothing requested, in flight or queued
+
+ private:
+  struct Camera {
+    CameraStats st;
+    uint8_t address = 0;  // on a bus, 1-based
+    uint32_t captureId = 0;
+    uint32_t triggerMs = 0;
+    uint32_t deadlineMs = 0;
+    uint32_t exposeMs = 0;  // running average of camMs, for grants
+    std::deque<QueuedFrame> queue;
+  };
+  struct Link {
+    bool bus = false;
+    int owner = -1;  // camera transferring, -1 when free
+  };
+
+  bool hasRoom(const Camera& c) const;
+  void release(uint8_t cam);
+  bool pickTrigger(uint8_t link, uint32_t nowMs, CameraAction& out);
+  bool pickGrant(uint8_t link, uint32_t nowMs, CameraAction& out);
+
+  mutable std::mutex lock_;
+  std::vector<Camera> cams_;
+  std::vector<Link> links_;
+  size_t queueDepth_;
+  uint32_t timeoutMs_;
+  uint32_t idBase_ = 0;
+  uint16_t seq_ = 0;
+  size_t triggerRr_ = 0;
+  size_t uploadRr_ = 0;
+};
@@ -0,0 +1,142 @@
+#include "camera_transport.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const int CAMERA_SEND_TIMEOUT_MS = 2000;
+
+static bool wouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static void setBlocking(int fd, bool blocking) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+}
+
+bool SocketCameraTransport::listen(uint16_t port, bool loopbackOnly) {
+  end();
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd_ < 0) return false;
+  int one = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+  if (bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd_, 2) != 0) {
+    end();
+    return false;
+  }
+  socklen_t alen = sizeof(addr);
+  getsockname(listenFd_, (sockaddr*)&addr, &alen);
+  port_ = ntohs(addr.sin_port);
+  setBlocking(listenFd_, false);
+  return true;
+}
+
+bool SocketCameraTransport::connect(const char* host, uint16_t port) {
+  end();
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", (unsigned)port);
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host, service, &hints, &res) != 0 || !res) return false;
+  int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  bool ok = fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) == 0;
+  freeaddrinfo(res);
+  if (!ok) {
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  port_ = port;
+  adopt(fd);
+  return true;
+}
+
+void SocketCameraTransport::end() {
+  drop();
+  if (listenFd_ >= 0) close(listenFd_);
+  listenFd_ = -1;
+  port_ = 0;
+}
+
+// Commands are a few bytes and wait for an answer: no Nagle delay
+void SocketCameraTransport::adopt(int fd) {
+  drop();
+  setBlocking(fd, true);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  timeval tv;
+  tv.tv_sec = CAMERA_SEND_TIMEOUT_MS / 1000;
+  tv.tv_usec = (CAMERA_SEND_TIMEOUT_MS % 1000) * 1000;
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  fd_ = fd;
+  ++connects_;
+}
+
+void SocketCameraTransport::acceptPending() {
+  if (listenFd_ < 0) return;
+  for (;;) {
+    int c = accept(listenFd_, nullptr, nullptr);
+    if (c < 0) return;
+    adopt(c);  // the newest connection wins
+  }
+}
+
+void SocketCameraTransport::drop() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+}
+
+size_t SocketCameraTransport::read(uint8_t* buf, size_t n) {
+  if (fd_ < 0) acceptPending();
+  if (fd_ < 0 || n == 0) return 0;
+  int r = (int)recv(fd_, buf, n, MSG_DONTWAIT);
+  if (r > 0) return (size_t)r;
+  if (r < 0 && wouldBlock()) return 0;
+  drop();  // 0 is an orderly shutdown
+  return 0;
+}
+
+bool SocketCameraTransport::write(const uint8_t* data, size_t n) {
+  if (fd_ < 0) acceptPending();
+  while (fd_ >= 0 && n) {
+    int w = (int)send(fd_, data, n, MSG_NOSIGNAL);
+    if (w > 0) {
+      data += w;
+      n -= (size_t)w;
+    } else if (w < 0 && errno == EINTR) {
+      continue;
+    } else {
+      drop();  // peer gone, or stuck past the send timeout
+    }
+  }
+  return fd_ >= 0;
+}
+
+bool SocketCameraTransport::connected() {
+  acceptPending();
+  return fd_ >= 0;
+}
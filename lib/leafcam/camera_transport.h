@@ -0,0 +1,67 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ====== Camera transports ======
+// The byte stream between hub and camera. Commands and frames
+// (uart_frame.h) are the same on every transport; only how the bytes move
+// differs:
+//  - UART: the hub's HardwareSerial, wrapped in src/hub/main.cpp
+//  - TCP (SocketCameraTransport): a camera on WiFi where a cable is
+//    impractical, or hub and camera code as two Linux processes
+//  - ESP-NOW would fit the same way: received datagrams (up to 250 bytes)
+//    appended to a ring that read() drains, write() split into datagrams.
+// read() never blocks, so a loop or link task can service a transport
+// next to other work; timeouts stay with the caller and its clock.
+class CameraTransport {
+ public:
+  virtual ~CameraTransport() {}
+  virtual const char* name() const = 0;
+  // Up to n bytes that have arrived, 0 if none (or nobody is connected)
+  virtual size_t read(uint8_t* buf, size_t n) = 0;
+  // Sends all n bytes; false if the link is down
+  virtual bool write(const uint8_t* data, size_t n) = 0;
+  // Returns once written bytes are on the wire (RS-485 turnaround)
+  virtual void flush() {}
+  // False while no camera is attached; UARTs always are
+  virtual bool connected() { return true; }
+
+  // Drops bytes received but not read yet
+  void discard() {
+    uint8_t buf[64];
+    while (read(buf, sizeof(buf))) {
+    }
+  }
+};
+
+// BSD sockets, so the same class runs on lwIP and Linux. Sends block (up
+// to the send timeout) until the stack has taken the bytes; receives never do.
+class SocketCameraTransport : public CameraTransport {
+ public:
+  ~SocketCameraTransport() { end(); }
+
+  // Hub side: wait for the camera on port (0 picks a free one, see port()).
+  // A new connection replaces the current one, so a camera that restarted
+  // is back at once, without waiting for the old socket to time out.
+  bool listen(uint16_t port, bool loopbackOnly = false);
+  // Camera side: connect to the hub (blocking)
+  bool connect(const char* host, uint16_t port);
+  void end();
+  uint16_t port() const { return port_; }
+  uint32_t connects() const { return connects_; }
+
+  const char* name() const { return "tcp"; }
+  size_t read(uint8_t* buf, size_t n);
+  bool write(const uint8_t* data, size_t n);
+  bool connected();
+
+ private:
+  void adopt(int fd);
+  void acceptPending();
+  void drop();
+
+  int listenFd_ = -1;
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  uint32_t connects_ = 0;
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// simple CRC16 (Modbus-ish), must match the camera sketch
+static inline uint16_t crc16Update(uint16_t crc, const uint8_t* data, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; ++b) {
+      if (crc & 1) crc = (crc >> 1) ^ 0xA001;
+      else crc >>= 1;
+    }
+  }
+  return crc;
+}
+
+static inline uint16_t crc16(const uint8_t* data, size_t n) {
+  return crc16Update(0xFFFF, data, n);
+}
@@ -0,0 +1,374 @@
+#include "history_store.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+static const uint32_t RECORD_MAGIC = 0x31545348;  // "HST1"
+static const uint32_t COMMITTED = 0x00000000;     // programmed over the erased 0xFFFFFFFF
+static const uint16_t NO_RESULT = 0xFFFF;         // textLen of an unwritten slot
+
+struct HistoryRecordHeader {
+  uint32_t magic;
+  uint32_t id;
+  uint32_t captureId;
+  uint32_t timeMs;
+  uint32_t len;
+  uint16_t crc;
+  uint16_t camMs;
+  uint16_t linkMs;
+  uint16_t reserved;
+  uint32_t commit;
+};
+static_assert(sizeof(HistoryRecordHeader) == 32, "record header size");
+static const uint32_t COMMIT_OFFSET = 28;
+
+struct HistoryResultSlot {
+  uint16_t uploadMs;
+  uint16_t totalMs;
+  uint16_t textLen;
+  uint16_t reserved;
+  char text[HISTORY_RESULT_MAX];
+};
+static_assert(sizeof(HistoryRecordHeader) + sizeof(HistoryResultSlot) == HISTORY_RECORD_HEAD,
+              "record head size");
+static const uint32_t SLOT_OFFSET = sizeof(HistoryRecordHeader);
+static const uint32_t SLOT_FIXED = 8;  // slot bytes before the text
+
+MemoryHistoryStorage::MemoryHistoryStorage(uint32_t size, uint32_t blockSize)
+    : mem_(size, 0xFF), block_(blockSize) {}
+
+bool MemoryHistoryStorage::erase(uint32_t offset, uint32_t len) {
+  if (offset % block_ || len % block_ || offset + len > mem_.size()) return false;
+  memset(mem_.data() + offset, 0xFF, len);
+  erases_ += len / block_;
+  return true;
+}
+
+bool MemoryHistoryStorage::write(uint32_t offset, const void* data, uint32_t len) {
+  if (offset + len > mem_.size()) return false;
+  const uint8_t* src = static_cast<const uint8_t*>(data);
+  for (uint32_t i = 0; i < len; ++i) {
+    uint8_t& dst = mem_[offset + i];
+    if ((dst & src[i]) != src[i]) ++badWrites_;
+    dst &= src[i];
+  }
+  return true;
+}
+
+bool MemoryHistoryStorage::read(uint32_t offset, void* data, uint32_t len) {
+  if (offset + len > mem_.size()) return false;
+  memcpy(data, mem_.data() + offset, len);
+  return true;
+}
+
+HistoryStore::HistoryStore(HistoryStorage& storage, size_t maxEntries)
+    : storage_(storage), block_(storage.blockSize()), ring_(maxEntries ? maxEntries : 1) {}
+
+uint32_t HistoryStore::spanFor(uint32_t len) const {
+  return (HISTORY_RECORD_HEAD + len + block_ - 1) / block_ * block_;
+}
+
+// Index of id by position, or by binary search when ids have gaps
+const HistoryEntry* HistoryStore::find(uint32_t id) const {
+  if (!count_ || id < at(0).id) return nullptr;
+  size_t guess = id - at(0).id;
+  if (guess < count_ && at(guess).id == id) return &at(guess);
+  size_t lo = 0, hi = count_;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (at(mid).id < id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo < count_ && at(lo).id == id ? &at(lo) : nullptr;
+}
+
+void HistoryStore::push(const HistoryEntry& e) {
+  if (count_ == ring_.size()) popFront();
+  ring_[(front_ + count_) % ring_.size()] = e;
+  ++count_;
+}
+
+void HistoryStore::popFront() {
+  if (!count_) return;
+  front_ = (front_ + 1) % ring_.size();
+  --count_;
+  ++stats_.evicted;
+}
+
+void HistoryStore::open() {
+  std::lock_guard<std::mutex> g(lock_);
+  front_ = count_ = 0;
+  pending_.reset();
+  std::vector<HistoryEntry> found;
+  uint32_t maxId = 0;
+  uint32_t newestEnd = 0;
+  for (uint32_t off = 0; off + block_ <= storage_.size();) {
+    HistoryRecordHeader h;
+    if (!storage_.read(off, &h, sizeof(h)) || h.magic != RECORD_MAGIC) {
+      off += block_;
+      continue;
+    }
+    if (h.id > maxId) maxId = h.id;
+    uint32_t span = spanFor(h.len);
+    if (h.commit != COMMITTED || h.len == 0 || off + span > storage_.size()) {
+      off += block_;  // cut short
+      continue;
+    }
+    HistoryEntry e;
+    e.id = h.id;
+    e.captureId = h.captureId;
+    e.timeMs = h.timeMs;
+    e.offset = off;
+    e.len = h.len;
+    e.crc = h.crc;
+    e.stageMs[HISTORY_CAM] = h.camMs;
+    e.stageMs[HISTORY_LINK] = h.linkMs;
+    uint16_t slot[4];
+    if (storage_.read(off + SLOT_OFFSET, slot, sizeof(slot)) && slot[2] != NO_RESULT) {
+      e.flags |= HISTORY_HAS_RESULT;
+      e.stageMs[HISTORY_UPLOAD] = slot[0];
+      e.stageMs[HISTORY_TOTAL] = slot[1];
+    }
+    found.push_back(e);
+    off += span;
+  }
+  std::sort(found.begin(), found.end(),
+            [](const HistoryEntry& a, const HistoryEntry& b) { return a.id < b.id; });
+  if (!found.empty()) newestEnd = found.back().offset + spanFor(found.back().len);
+  size_t skip = found.size() > ring_.size() ? found.size() - ring_.size() : 0;
+  for (size_t i = skip; i < found.size(); ++i) push(found[i]);
+  stats_ = HistoryStats();
+  nextId_ = maxId + 1;
+  head_ = newestEnd < storage_.size() ? newestEnd : 0;
+  erasedAhead_ = 0;  // what follows the newest record is not trusted to be erased
+}
+
+// Erases the block at the end of the erased run, dropping the records on it
+bool HistoryStore::eraseNext() {
+  if (erasedAhead_ >= storage_.size()) return false;
+  uint32_t pos = (head_ + erasedAhead_) % storage_.size();
+  if (pending_ && pos < pendingOffset_ + pendingSpan_ && pendingOffset_ < pos + block_) {
+    return false;  // would reach the record being written
+  }
+  while (count_) {
+    const HistoryEntry& e = at(0);
+    if (!(e.offset < pos + block_ && pos < e.offset + spanFor(e.len))) break;
+    popFront();
+  }
+  if (!storage_.erase(pos, block_)) return false;
+  erasedAhead_ += block_;
+  return true;
+}
+
+uint32_t HistoryStore::add(const SharedBytes& frame, uint16_t crc, uint32_t captureId,
+                           uint32_t timeMs, uint16_t camMs, uint16_t linkMs) {
+  std::lock_guard<std::mutex> g(lock_);
+  uint32_t len = frame ? (uint32_t)frame->size() : 0;
+  uint32_t span = spanFor(len);
+  if (!len || span > storage_.size()) {
+    ++stats_.rejected;
+    return 0;
+  }
+  while (pending_) {
+    if (!writeBlock()) break;
+  }
+  if (head_ + span > storage_.size()) {
+    // Does not fit before the end: the tail is skipped, and with it the
+    // oldest records still on it
+    uint32_t skip = storage_.size() - head_;
+    while (count_ && at(0).offset >= head_) popFront();
+    erasedAhead_ = erasedAhead_ > skip ? erasedAhead_ - skip : 0;
+    head_ = 0;
+  }
+  while (erasedAhead_ < span) {
+    if (!eraseNext()) {
+      ++stats_.rejected;
+      return 0;
+    }
+    ++stats_.syncErases;
+  }
+
+  HistoryEntry e;
+  e.id = nextId_++;
+  e.captureId = captureId;
+  e.timeMs = timeMs;
+  e.offset = head_;
+  e.len = len;
+  e.crc = crc;
+  e.flags = HISTORY_WRITING;
+  e.stageMs[HISTORY_CAM] = camMs;
+  e.stageMs[HISTORY_LINK] = linkMs;
+  push(e);
+
+  pending_ = frame;
+  pendingId_ = e.id;
+  pendingOffset_ = head_;
+  pendingWritten_ = 0;
+  pendingSpan_ = span;
+  head_ += span;
+  erasedAhead_ -= span;
+  ++stats_.added;
+  if (!writeBlock()) return 0;  // the header: from now on open() sees the record
+  return e.id;
+}
+
+// Programs the next block of the pending record; the last one also commits it
+bool HistoryStore::writeBlock() {
+  if (!pending_) return false;
+  const std::vector<uint8_t>& frame = *pending_;
+  uint32_t recordLen = HISTORY_RECORD_HEAD + (uint32_t)frame.size();
+  uint32_t start = pendingWritten_;
+  uint32_t end = std::min(start + block_, recordLen);
+  bool ok = true;
+  if (start == 0) {
+    HistoryRecordHeader h;
+    memset(&h, 0xFF, sizeof(h));
+    const HistoryEntry& e = at(count_ - 1);
+    h.magic = RECORD_MAGIC;
+    h.id = e.id;
+    h.captureId = e.captureId;
+    h.timeMs = e.timeMs;
+    h.len = e.len;
+    h.crc = e.crc;
+    h.camMs = e.stageMs[HISTORY_CAM];
+    h.linkMs = e.stageMs[HISTORY_LINK];
+    ok = storage_.write(pendingOffset_, &h, sizeof(h));
+    start = HISTORY_RECORD_HEAD;  // the result slot stays erased for setResult()
+  }
+  if (ok && end > start) {
+    ok = storage_.write(pendingOffset_ + start, frame.data() + (start - HISTORY_RECORD_HEAD),
+                        end - start);
+  }
+  if (!ok) {
+    // The newest entry is the pending one; its blocks stay used until erased
+    --count_;
+    ++stats_.rejected;
+    pending_.reset();
+    return false;
+  }
+  pendingWritten_ = end;
+  if (pendingWritten_ >= recordLen) finishWrite();
+  return true;
+}
+
+void HistoryStore::finishWrite() {
+  uint32_t commit = COMMITTED;
+  storage_.write(pendingOffset_ + COMMIT_OFFSET, &commit, sizeof(commit));
+  const HistoryEntry* e = find(pendingId_);
+  if (e) const_cast<HistoryEntry*>(e)->flags &= ~HISTORY_WRITING;
+  pending_.reset();
+}
+
+bool HistoryStore::service() {
+  std::lock_guard<std::mutex> g(lock_);
+  if (pending_) return writeBlock();
+  if (!reserveLen_) return false;
+  uint32_t need = spanFor(reserveLen_);
+  if (head_ + need > storage_.size()) need += storage_.size() - head_;  // tail is skipped
+  if (erasedAhead_ >= need || need > storage_.size()) return false;
+  return eraseNext();
+}
+
+bool HistoryStore::setResult(uint32_t id, const char* text, uint16_t uploadMs,
+                             uint16_t totalMs) {
+  std::lock_guard<std::mutex> g(lock_);
+  const HistoryEntry* found = find(id);
+  if (!found || (found->flags & HISTORY_HAS_RESULT)) return false;
+  HistoryEntry* e = const_cast<HistoryEntry*>(found);
+  HistoryResultSlot slot;
+  size_t n = text ? strlen(text) : 0;
+  if (n > HISTORY_RESULT_MAX) n = HISTORY_RESULT_MAX;
+  slot.uploadMs = uploadMs;
+  slot.totalMs = totalMs;
+  slot.textLen = (uint16_t)n;
+  slot.reserved = 0xFFFF;
+  if (n) memcpy(slot.text, text, n);
+  if (!storage_.write(e->offset + SLOT_OFFSET, &slot, SLOT_FIXED + (uint32_t)n)) return false;
+  e->flags |= HISTORY_HAS_RESULT;
+  e->stageMs[HISTORY_UPLOAD] = uploadMs;
+  e->stageMs[HISTORY_TOTAL] = totalMs;
+  return true;
+}
+
+size_t HistoryStore::list(uint32_t beforeId, HistoryEntry* out, size_t max) const {
+  std::lock_guard<std::mutex> g(lock_);
+  // Entries below i have ids < beforeId
+  size_t i = count_;
+  if (beforeId && count_ && beforeId <= at(count_ - 1).id) {
+    size_t lo = 0, hi = count_;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (at(mid).id < beforeId) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    i = lo;
+  }
+  size_t n = 0;
+  while (i > 0 && n < max) out[n++] = at(--i);
+  return n;
+}
+
+bool HistoryStore::get(uint32_t id, HistoryEntry& out) const {
+  std::lock_guard<std::mutex> g(lock_);
+  const HistoryEntry* e = find(id);
+  if (!e) return false;
+  out = *e;
+  return true;
+}
+
+bool HistoryStore::result(uint32_t id, char* buf, size_t n) const {
+  std::lock_guard<std::mutex> g(lock_);
+  const HistoryEntry* e = find(id);
+  if (!e || !(e->flags & HISTORY_HAS_RESULT) || !n) return false;
+  uint16_t fixed[4];
+  if (!storage_.read(e->offset + SLOT_OFFSET, fixed, sizeof(fixed))) return false;
+  size_t len = fixed[2] > HISTORY_RESULT_MAX ? HISTORY_RESULT_MAX : fixed[2];
+  if (len > n - 1) len = n - 1;
+  if (len && !storage_.read(e->offset + SLOT_OFFSET + SLOT_FIXED, buf, (uint32_t)len)) {
+    return false;
+  }
+  buf[len] = 0;
+  return true;
+}
+
+size_t HistoryStore::readFrame(uint32_t id, size_t offset, uint8_t* buf, size_t n) const {
+  std::lock_guard<std::mutex> g(lock_);
+  const HistoryEntry* e = find(id);
+  if (!e || offset >= e->len) return 0;
+  if (n > e->len - offset) n = e->len - offset;
+  if ((e->flags & HISTORY_WRITING) && pending_ && pendingId_ == id) {
+    memcpy(buf, pending_->data() + offset, n);
+    return n;
+  }
+  if (!storage_.read(e->offset + HISTORY_RECORD_HEAD + (uint32_t)offset, buf, (uint32_t)n)) {
+    return 0;
+  }
+  return n;
+}
+
+size_t HistoryStore::count() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return count_;
+}
+
+uint32_t HistoryStore::newestId() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return count_ ? at(count_ - 1).id : 0;
+}
+
+uint32_t HistoryStore::oldestId() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return count_ ? at(0).id : 0;
+}
+
+HistoryStats HistoryStore::stats() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return stats_;
+}
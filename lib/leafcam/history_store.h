@@ -0,0 +1,170 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include "http_event.h"
+
+// ====== Capture history ======
+// The last frames the hub captured, with their results and stage timings,
+// for the dashboard's history view. Frames live in a flash region written as
+// a ring of block-aligned records; only the index is in RAM, one 32-byte
+// HistoryEntry per record, so a page of /history costs a few small reads
+// and a frame is served straight from flash a chunk at a time.
+//
+// A record is its header (what the index holds), a write-once result slot
+// and the JPEG:
+//
+//   0    HistoryRecordHeader (magic, id, capture id, time, length, CRC ...)
+//   32   result slot: upload/total ms and the result text, '\n'-separated
+//   256  frame bytes, up to the next block boundary
+//
+// Flash can only be programmed after an erase, and erasing is slow, so the
+// store erases ahead of its write position from service() and add() only
+// has to program. Erasing reaches the oldest records first; they leave the
+// index right before their block goes. add() programs the first block and
+// leaves the rest to service(), one block per call, so a capture never
+// waits for the whole frame to be written; until then reads come from the
+// frame in RAM. The commit word is programmed last, so a boot scan with
+// open() skips a record cut short by a reset.
+//
+// Ids increase by one per record, so a lookup is an index computation; a
+// binary search covers the gaps an interrupted write leaves.
+
+// Raw storage the records go to: a flash partition on the hub, a vector on
+// the host. Writes only clear bits, like NOR flash.
+class HistoryStorage {
+ public:
+  virtual ~HistoryStorage() {}
+  virtual uint32_t size() const = 0;
+  virtual uint32_t blockSize() const = 0;  // erase unit
+  virtual bool erase(uint32_t offset, uint32_t len) = 0;  // block aligned
+  virtual bool write(uint32_t offset, const void* data, uint32_t len) = 0;
+  virtual bool read(uint32_t offset, void* data, uint32_t len) = 0;
+};
+
+// Host stand-in for a flash partition. erase() sets 0xFF, write() ANDs.
+class MemoryHistoryStorage : public HistoryStorage {
+ public:
+  explicit MemoryHistoryStorage(uint32_t size, uint32_t blockSize = 4096);
+  uint32_t size() const override { return (uint32_t)mem_.size(); }
+  uint32_t blockSize() const override { return block_; }
+  bool erase(uint32_t offset, uint32_t len) override;
+  bool write(uint32_t offset, const void* data, uint32_t len) override;
+  bool read(uint32_t offset, void* data, uint32_t len) override;
+
+  uint32_t erases() const { return erases_; }
+  uint32_t badWrites() const { return badWrites_; }  // onto unerased bits
+
+ private:
+  std::vector<uint8_t> mem_;
+  uint32_t block_;
+  uint32_t erases_ = 0;
+  uint32_t badWrites_ = 0;
+};
+
+static const uint32_t HISTORY_RECORD_HEAD = 256;  // header + result slot
+static const size_t HISTORY_RESULT_MAX = 216;     // result text bytes
+
+// Stage timings kept per capture, in milliseconds (0xFFFF: not reached)
+enum HistoryStage {
+  HISTORY_CAM = 0,   // camera exposure and encode (reported by the camera)
+  HISTORY_LINK,      // UART transfer
+  HISTORY_UPLOAD,    // upload to the result
+  HISTORY_TOTAL,     // trigger to result on the OLED
+  HISTORY_STAGES
+};
+static const uint16_t HISTORY_NO_TIME = 0xFFFF;
+
+struct HistoryEntry {
+  uint32_t id = 0;
+  uint32_t captureId = 0;
+  uint32_t timeMs = 0;   // millis() at capture
+  uint32_t offset = 0;   // record start in storage
+  uint32_t len = 0;      // frame bytes
+  uint16_t crc = 0;
+  uint16_t flags = 0;    // HISTORY_* below
+  uint16_t stageMs[HISTORY_STAGES] = {HISTORY_NO_TIME, HISTORY_NO_TIME, HISTORY_NO_TIME,
+                                      HISTORY_NO_TIME};
+};
+static const uint16_t HISTORY_HAS_RESULT = 1;
+static const uint16_t HISTORY_WRITING = 2;  // frame still partly in RAM
+
+struct HistoryStats {
+  uint32_t added = 0;
+  uint32_t evicted = 0;
+  uint32_t rejected = 0;     // frames that could never fit, or storage errors
+  uint32_t syncErases = 0;   // blocks add() had to erase itself
+};
+
+class HistoryStore {
+ public:
+  // maxEntries bounds the index; storage bounds the bytes. Whichever runs
+  // out first evicts the oldest record.
+  HistoryStore(HistoryStorage& storage, size_t maxEntries);
+
+  // Rebuilds the index from committed records (after a reboot). Without it
+  // the store starts empty and overwrites whatever storage holds.
+  void open();
+
+  // Records a CRC-checked frame and returns its id, 0 if it was not stored.
+  // The frame is held until service() has written all of it.
+  uint32_t add(const SharedBytes& frame, uint16_t crc, uint32_t captureId, uint32_t timeMs,
+               uint16_t camMs, uint16_t linkMs);
+  // Stores the result of a frame once; later calls for it are ignored.
+  bool setResult(uint32_t id, const char* text, uint16_t uploadMs, uint16_t totalMs);
+
+  // One step of background work: programs one block of the frame being
+  // written, else erases one block ahead. Returns false when idle.
+  bool service();
+  // Bytes service() keeps erased ahead: the largest frame expected.
+  void setReserve(uint32_t frameLen) { reserveLen_ = frameLen; }
+
+  // Entries with id < beforeId (0: from the newest), newest first.
+  size_t list(uint32_t beforeId, HistoryEntry* out, size_t max) const;
+  bool get(uint32_t id, HistoryEntry& out) const;
+  // Result text of id into buf (NUL-terminated); false without a result.
+  bool result(uint32_t id, char* buf, size_t n) const;
+  // Copies frame bytes [offset, offset+n) of id; 0 once it was evicted.
+  size_t readFrame(uint32_t id, size_t offset, uint8_t* buf, size_t n) const;
+
+  size_t count() const;
+  uint32_t newestId() const;
+  uint32_t oldestId() const;
+  size_t capacity() const { return ring_.size(); }
+  uint32_t storageBytes() const { return storage_.size(); }
+  HistoryStats stats() const;
+
+ private:
+  uint32_t spanFor(uint32_t len) const;
+  const HistoryEntry* find(uint32_t id) const;
+  HistoryEntry& at(size_t i) { return ring_[(front_ + i) % ring_.size()]; }
+  const HistoryEntry& at(size_t i) const { return ring_[(front_ + i) % ring_.size()]; }
+  void push(const HistoryEntry& e);
+  void popFront();
+  bool eraseNext();
+  bool writeBlock();
+  void finishWrite();
+
+  HistoryStorage& storage_;
+  uint32_t block_;
+  mutable std::mutex lock_;  // add/service on the capture task, reads on the web task
+  std::vector<HistoryEntry> ring_;
+  size_t front_ = 0;
+  size_t count_ = 0;
+  uint32_t nextId_ = 1;
+  uint32_t head_ = 0;         // next record starts here (block aligned)
+  uint32_t erasedAhead_ = 0;  // bytes erased from head_ onwards
+  uint32_t reserveLen_ = 0;
+
+  // Record whose frame service() is still programming
+  SharedBytes pending_;
+  uint32_t pendingId_ = 0;
+  uint32_t pendingOffset_ = 0;
+  uint32_t pendingWritten_ = 0;  // record bytes programmed (header included)
+  uint32_t pendingSpan_ = 0;
+  std::vector<uint8_t> blockBuf_;
+
+  HistoryStats stats_;
+};
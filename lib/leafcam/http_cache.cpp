@@ -0,0 +1,96 @@
+#include "http_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+void frameEtag(const FrameKey& key, char* buf, size_t n) {
+  snprintf(buf, n, "\"%04x-%08lx-%08lx%08lx\"", (unsigned)key.crc, (unsigned long)key.len,
+           (unsigned long)(key.hash >> 32), (unsigned long)(key.hash & 0xFFFFFFFFUL));
+}
+
+bool etagMatches(const char* ifNoneMatch, const char* etag) {
+  if (!ifNoneMatch || !*ifNoneMatch || !etag || !*etag) return false;
+  size_t elen = strlen(etag);
+  const char* p = ifNoneMatch;
+  while (*p) {
+    while (*p == ' ' || *p == ',') ++p;
+    if (*p == '*') return true;
+    if (p[0] == 'W' && p[1] == '/') p += 2;
+    const char* end = p;
+    if (*end == '"') {
+      end = strchr(end + 1, '"');
+      if (!end) return false;
+      ++end;
+    } else {
+      while (*end && *end != ',') ++end;
+    }
+    if ((size_t)(end - p) == elen && strncmp(p, etag, elen) == 0) return true;
+    p = end;
+  }
+  return false;
+}
+
+bool acceptsCoding(const char* acceptEncoding, const char* coding) {
+  if (!acceptEncoding) return true;
+  size_t clen = strlen(coding);
+  int exact = -1, wildcard = -1;  // -1 unlisted, else 0 refused / 1 accepted
+  const char* p = acceptEncoding;
+  while (*p) {
+    while (*p == ' ' || *p == ',') ++p;
+    const char* name = p;
+    while (*p && *p != ',' && *p != ';' && *p != ' ') ++p;
+    size_t nlen = (size_t)(p - name);
+    double q = 1.0;
+    while (*p && *p != ',') {
+      if (*p == ';') {
+        ++p;
+        while (*p == ' ') ++p;
+        if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') q = strtod(p + 2, nullptr);
+      } else {
+        ++p;
+      }
+    }
+    int ok = q > 0 ? 1 : 0;
+    bool aliased = nlen == clen + 2 && strncasecmp(name, "x-", 2) == 0;  // x-gzip
+    if ((nlen == clen || aliased) && strncasecmp(name + (aliased ? 2 : 0), coding, clen) == 0) {
+      exact = ok;
+    } else if (nlen == 1 && *name == '*') {
+      wildcard = ok;
+    }
+  }
+  if (exact >= 0) return exact == 1;
+  return wildcard == 1;
+}
+
+RangeResult parseByteRange(const char* header, size_t total, size_t& start, size_t& len) {
+  if (!header || strncmp(header, "bytes=", 6) != 0) return RANGE_NONE;
+  const char* spec = header + 6;
+  if (strchr(spec, ',')) return RANGE_NONE;
+  while (*spec == ' ') ++spec;
+  char* end = nullptr;
+  if (*spec == '-') {
+    unsigned long suffix = strtoul(spec + 1, &end, 10);
+    if (end == spec + 1) return RANGE_NONE;
+    if (suffix == 0 || total == 0) return RANGE_UNSATISFIABLE;
+    if (suffix > total) suffix = total;
+    start = total - suffix;
+    len = suffix;
+    return RANGE_OK;
+  }
+  unsigned long first = strtoul(spec, &end, 10);
+  if (end == spec || *end != '-') return RANGE_NONE;
+  if (first >= total) return RANGE_UNSATISFIABLE;
+  const char* lastSpec = end + 1;
+  unsigned long last = total - 1;
+  if (*lastSpec) {
+    last = strtoul(lastSpec, &end, 10);
+    if (end == lastSpec) return RANGE_NONE;
+    if (last < first) return RANGE_NONE;
+    if (last >= total) last = total - 1;
+  }
+  start = first;
+  len = last - first + 1;
+  return RANGE_OK;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "result_cache.h"
+
+// Conditional and partial GET helpers for serving frames.
+
+// Strong ETag for a frame: "crc16-len-fnv64" in hex, quotes included.
+// buf must hold at least FRAME_ETAG_LEN bytes.
+static const size_t FRAME_ETAG_LEN = 36;
+void frameEtag(const FrameKey& key, char* buf, size_t n);
+
+// If-None-Match semantics: "*" or any listed tag equal to etag (weak
+// comparison, so W/"x" matches "x").
+bool etagMatches(const char* ifNoneMatch, const char* etag);
+
+enum RangeResult {
+  RANGE_NONE,           // no usable Range header: send the whole body
+  RANGE_OK,             // send [start, start + len)
+  RANGE_UNSATISFIABLE,  // reply 416 with Content-Range: bytes */total
+};
+
+// Accept-Encoding semantics for one content coding ("gzip"): listed (also
+// as "x-gzip") or covered by "*", with a q-value above 0. An explicit
+// entry overrides "*".
+// acceptEncoding is null when the request has no such header, which
+// accepts any coding; an empty value accepts none.
+bool acceptsCoding(const char* acceptEncoding, const char* coding);
+
+// Parses a single "bytes=a-b", "bytes=a-" or "bytes=-n" range against a body
+// of total bytes. Multiple ranges are not supported and yield RANGE_NONE.
+RangeResult parseByteRange(const char* header, size_t total, size_t& start, size_t& len);
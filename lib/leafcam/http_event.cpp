@@ -0,0 +1,560 @@
+#include "http_event.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string lowerCase(std::string s) {
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (s[i] >= 'A' && s[i] <= 'Z') s[i] = (char)(s[i] - 'A' + 'a');
+  }
+  return s;
+}
+
+static std::string trim(const std::string& s) {
+  size_t b = 0, e = s.size();
+  while (b < e && (s[b] == ' ' || s[b] == '\t')) ++b;
+  while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t' || s[e - 1] == '\r')) --e;
+  return s.substr(b, e - b);
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static std::string urlDecode(const std::string& s) {
+  std::string out;
+  out.reserve(s.size());
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (s[i] == '+') {
+      out += ' ';
+    } else if (s[i] == '%' && i + 2 < s.size() && hexValue(s[i + 1]) >= 0 && hexValue(s[i + 2]) >= 0) {
+      out += (char)(hexValue(s[i + 1]) * 16 + hexValue(s[i + 2]));
+      i += 2;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+// Finds name in the query string; on success value is the raw (encoded) text.
+static bool findArg(const std::string& query, const char* name, std::string& value) {
+  size_t nlen = strlen(name);
+  size_t pos = 0;
+  while (pos <= query.size()) {
+    size_t amp = query.find('&', pos);
+    if (amp == std::string::npos) amp = query.size();
+    size_t eq = query.find('=', pos);
+    size_t keyEnd = (eq == std::string::npos || eq > amp) ? amp : eq;
+    if (keyEnd - pos == nlen && query.compare(pos, nlen, name) == 0) {
+      value = keyEnd < amp ? query.substr(keyEnd + 1, amp - keyEnd - 1) : std::string();
+      return true;
+    }
+    pos = amp + 1;
+  }
+  return false;
+}
+
+std::string HttpRequest::header(const char* name) const {
+  std::string key = lowerCase(name);
+  for (size_t i = 0; i < headers.size(); ++i) {
+    if (headers[i].first == key) return headers[i].second;
+  }
+  return std::string();
+}
+
+bool HttpRequest::hasHeader(const char* name) const {
+  std::string key = lowerCase(name);
+  for (size_t i = 0; i < headers.size(); ++i) {
+    if (headers[i].first == key) return true;
+  }
+  return false;
+}
+
+bool HttpRequest::hasArg(const char* name) const {
+  std::string v;
+  return findArg(query, name, v);
+}
+
+std::string HttpRequest::arg(const char* name) const {
+  std::string v;
+  return findArg(query, name, v) ? urlDecode(v) : std::string();
+}
+
+void HttpResponse::setHeader(const char* name, const std::string& value) {
+  headers_ += name;
+  headers_ += ": ";
+  headers_ += value;
+  headers_ += "\r\n";
+}
+
+void HttpResponse::send(int status, const char* contentType, const std::string& body) {
+  status_ = status;
+  contentType_ = contentType ? contentType : "";
+  text_ = body;
+  data_ = nullptr;
+  shared_.reset();
+  len_ = body.size();
+  reader_ = nullptr;
+}
+
+void HttpResponse::sendStatic(int status, const char* contentType, const uint8_t* data, size_t len) {
+  status_ = status;
+  contentType_ = contentType ? contentType : "";
+  text_.clear();
+  data_ = data;
+  shared_.reset();
+  len_ = len;
+  reader_ = nullptr;
+}
+
+void HttpResponse::sendShared(int status, const char* contentType, const SharedBytes& data,
+                              size_t offset, size_t len) {
+  status_ = status;
+  contentType_ = contentType ? contentType : "";
+  text_.clear();
+  shared_ = data;
+  data_ = data ? data->data() + offset : nullptr;
+  len_ = data ? len : 0;
+  reader_ = nullptr;
+}
+
+void HttpResponse::sendReader(int status, const char* contentType, HttpBodyReader reader,
+                              size_t len) {
+  status_ = status;
+  contentType_ = contentType ? contentType : "";
+  text_.clear();
+  data_ = nullptr;
+  shared_.reset();
+  reader_ = reader;
+  len_ = reader_ ? len : 0;
+}
+
+void HttpResponse::sendEmpty(int status) {
+  status_ = status;
+  contentType_.clear();
+  text_.clear();
+  data_ = nullptr;
+  shared_.reset();
+  len_ = 0;
+  reader_ = nullptr;
+}
+
+void HttpResponse::stream(uint8_t channel, const char* contentType, size_t maxQueued) {
+  sendEmpty(200);
+  contentType_ = contentType ? contentType : "";
+  channel_ = channel < HTTP_MAX_CHANNELS ? channel : 0;
+  maxQueued_ = maxQueued ? maxQueued : 1;
+}
+
+HttpEventServer::HttpEventServer(size_t maxClients, Handler handler)
+    : conns_(maxClients ? maxClients : 1), handler_(handler) {}
+
+bool HttpEventServer::hasFreeSlot() const {
+  for (size_t i = 0; i < conns_.size(); ++i) {
+    if (!conns_[i].sock) return true;
+  }
+  return false;
+}
+
+size_t HttpEventServer::clients() const {
+  size_t n = 0;
+  for (size_t i = 0; i < conns_.size(); ++i) n += conns_[i].sock ? 1 : 0;
+  return n;
+}
+
+bool HttpEventServer::adopt(HttpSocket* sock, uint32_t nowMs) {
+  for (size_t i = 0; i < conns_.size(); ++i) {
+    Conn& c = conns_[i];
+    if (c.sock) continue;
+    c = Conn();
+    c.sock.reset(sock);
+    c.lastMs = nowMs;
+    return true;
+  }
+  ++rejected_;
+  delete sock;
+  return false;
+}
+
+void HttpEventServer::watchList(std::vector<std::pair<int, bool> >& out) const {
+  out.clear();
+  for (size_t i = 0; i < conns_.size(); ++i) {
+    const Conn& c = conns_[i];
+    if (c.sock && c.sock->fd() >= 0) {
+      bool streamPending = c.state == STREAMING &&
+                           (c.outPos < c.out.size() || c.bodyPos < c.bodyEnd || !c.queue.empty());
+      out.push_back(std::make_pair(c.sock->fd(), c.state == WRITING || streamPending));
+    }
+  }
+}
+
+void HttpEventServer::complete(uint32_t token, const HttpResponse& resp) {
+  std::lock_guard<std::mutex> g(lock_);
+  done_.push_back(std::make_pair(token, resp));
+}
+
+void HttpEventServer::publish(uint8_t channel, const SharedBytes& chunk) {
+  if (!chunk || channel == 0 || channel >= HTTP_MAX_CHANNELS) return;
+  std::lock_guard<std::mutex> g(lock_);
+  if (subscribers_[channel]) published_.push_back(std::make_pair(channel, chunk));
+}
+
+uint8_t HttpEventServer::subscribers(uint8_t channel) const {
+  if (channel >= HTTP_MAX_CHANNELS) return 0;
+  std::lock_guard<std::mutex> g(lock_);
+  return subscribers_[channel];
+}
+
+bool HttpEventServer::poll(uint32_t nowMs) {
+  std::vector<std::pair<uint32_t, HttpResponse> > done;
+  std::vector<std::pair<uint8_t, SharedBytes> > published;
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    done.swap(done_);
+    published.swap(published_);
+  }
+  bool moved = false;
+  for (size_t p = 0; p < published.size(); ++p) {
+    for (size_t i = 0; i < conns_.size(); ++i) {
+      Conn& c = conns_[i];
+      if (!c.sock || c.state != STREAMING || c.channel != published[p].first) continue;
+      if (c.queue.size() >= c.maxQueued) c.queue.erase(c.queue.begin());  // slow client: skip ahead
+      c.queue.push_back(published[p].second);
+    }
+  }
+  for (size_t d = 0; d < done.size(); ++d) {
+    for (size_t i = 0; i < conns_.size(); ++i) {
+      Conn& c = conns_[i];
+      if (c.sock && c.state == WAITING && c.token == done[d].first) {
+        startResponse(c, done[d].second, nowMs);
+        break;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < conns_.size(); ++i) {
+    Conn& c = conns_[i];
+    if (!c.sock) continue;
+    if (c.state == READING) {
+      moved |= readRequest(c, nowMs);
+      if (c.sock && c.state == READING && nowMs - c.lastMs > HTTP_IDLE_TIMEOUT_MS) {
+        close(c);
+      }
+    } else if (c.state == WAITING) {
+      if (c.deferTimeoutMs && nowMs - c.lastMs > c.deferTimeoutMs) {
+        HttpResponse timeout;
+        timeout.send(503, "text/plain", "Timed out");
+        c.keepAlive = false;
+        startResponse(c, timeout, nowMs);
+      }
+    }
+    if (c.sock && c.state == WRITING) {
+      moved |= writeSome(c, nowMs);
+      if (c.sock && c.state == WRITING && nowMs - c.lastMs > HTTP_IDLE_TIMEOUT_MS) {
+        close(c);
+      }
+    } else if (c.sock && c.state == STREAMING) {
+      // Nothing is expected from a streaming client; reading only notices it
+      // leaving, which a quiet channel would otherwise never reveal
+      uint8_t scratch[64];
+      if (c.sock->recvSome(scratch, sizeof(scratch)) < 0) {
+        close(c);
+        continue;
+      }
+      moved |= writeSome(c, nowMs);
+    }
+  }
+
+  uint8_t subs[HTTP_MAX_CHANNELS] = {0};
+  for (size_t i = 0; i < conns_.size(); ++i) {
+    if (conns_[i].sock && conns_[i].state == STREAMING) ++subs[conns_[i].channel];
+  }
+  std::lock_guard<std::mutex> g(lock_);
+  memcpy(subscribers_, subs, sizeof(subs));
+  return moved;
+}
+
+bool HttpEventServer::readRequest(Conn& c, uint32_t nowMs) {
+  bool moved = false;
+  uint8_t buf[512];
+  while (c.in.size() < HTTP_MAX_HEAD + HTTP_MAX_BODY) {
+    int n = c.sock->recvSome(buf, sizeof(buf));
+    if (n < 0) {
+      close(c);
+      return moved;
+    }
+    if (n == 0) break;
+    c.in.append((const char*)buf, (size_t)n);
+    c.lastMs = nowMs;
+    moved = true;
+  }
+
+  if (c.headLen == 0) {
+    size_t end = c.in.find("\r\n\r\n");
+    if (end == std::string::npos) {
+      if (c.in.size() > HTTP_MAX_HEAD) {
+        HttpResponse r;
+        r.send(431, "text/plain", "Request header too large");
+        c.keepAlive = false;
+        startResponse(c, r, nowMs);
+      }
+      return moved;
+    }
+    c.headLen = end + 4;
+    if (!parseHead(c)) {
+      HttpResponse r;
+      r.send(400, "text/plain", "Bad request");
+      c.keepAlive = false;
+      startResponse(c, r, nowMs);
+      return moved;
+    }
+    if (c.bodyLen > HTTP_MAX_BODY) {
+      HttpResponse r;
+      r.send(413, "text/plain", "Request body too large");
+      c.keepAlive = false;
+      startResponse(c, r, nowMs);
+      return moved;
+    }
+  }
+  if (c.in.size() < c.headLen + c.bodyLen) return moved;
+
+  c.req.body = c.in.substr(c.headLen, c.bodyLen);
+  c.in.erase(0, c.headLen + c.bodyLen);  // keeps a pipelined next request
+  c.headLen = 0;
+  dispatch(c, nowMs);
+  return true;
+}
+
+bool HttpEventServer::parseHead(Conn& c) {
+  HttpRequest& req = c.req;
+  req = HttpRequest();
+  size_t lineEnd = c.in.find("\r\n");
+  std::string line = c.in.substr(0, lineEnd);
+  size_t sp1 = line.find(' ');
+  size_t sp2 = line.rfind(' ');
+  if (sp1 == std::string::npos || sp2 == sp1) return false;
+  req.method = line.substr(0, sp1);
+  std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+  std::string version = line.substr(sp2 + 1);
+  size_t q = target.find('?');
+  req.path = target.substr(0, q);
+  if (q != std::string::npos) req.query = target.substr(q + 1);
+  if (req.path.empty() || req.path[0] != '/') return false;
+
+  c.keepAlive = version == "HTTP/1.1";
+  c.bodyLen = 0;
+  size_t pos = lineEnd + 2;
+  while (pos < c.headLen - 2) {
+    size_t e = c.in.find("\r\n", pos);
+    std::string h = c.in.substr(pos, e - pos);
+    pos = e + 2;
+    size_t colon = h.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = lowerCase(trim(h.substr(0, colon)));
+    std::string value = trim(h.substr(colon + 1));
+    if (name == "content-length") {
+      c.bodyLen = (size_t)strtoul(value.c_str(), nullptr, 10);
+    } else if (name == "connection") {
+      std::string v = lowerCase(value);
+      if (v.find("close") != std::string::npos) c.keepAlive = false;
+      if (v.find("keep-alive") != std::string::npos) c.keepAlive = true;
+    } else if (name == "transfer-encoding") {
+      return false;  // chunked request bodies are not supported
+    }
+    req.headers.push_back(std::make_pair(name, value));
+  }
+  c.headOnly = req.method == "HEAD";
+  return true;
+}
+
+void HttpEventServer::dispatch(Conn& c, uint32_t nowMs) {
+  HttpResponse resp;
+  c.token = nextToken_++;
+  if (nextToken_ == 0) nextToken_ = 1;
+  resp.token_ = c.token;
+  ++requests_;
+  handler_(c.req, resp);
+  c.lastMs = nowMs;
+  if (resp.deferred() && !resp.sent()) {
+    c.state = WAITING;
+    c.deferTimeoutMs = resp.deferTimeoutMs_;
+    return;
+  }
+  if (!resp.sent()) resp.send(500, "text/plain", "No response");
+  startResponse(c, resp, nowMs);
+}
+
+void HttpEventServer::startResponse(Conn& c, const HttpResponse& resp, uint32_t nowMs) {
+  char line[96];
+  bool noBody = resp.status_ == 304 || resp.status_ == 204 || resp.status_ < 200;
+  snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", resp.status_, httpStatusText(resp.status_));
+  c.out = line;
+  if (!resp.contentType_.empty()) {
+    c.out += "Content-Type: ";
+    c.out += resp.contentType_;
+    c.out += "\r\n";
+  }
+  if (resp.channel_) {
+    c.keepAlive = false;  // the body ends when the connection does
+  } else if (!noBody) {
+    snprintf(line, sizeof(line), "Content-Length: %lu\r\n", (unsigned long)resp.len_);
+    c.out += line;
+  }
+  c.out += c.keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+  c.out += resp.headers_;
+  c.out += "\r\n";
+  c.outPos = 0;
+  c.body = nullptr;
+  c.bodyPos = c.bodyEnd = 0;
+  c.keep.reset();
+  c.reader = nullptr;
+  c.readerPos = c.readerEnd = 0;
+  if (!noBody && !c.headOnly) {
+    if (resp.data_) {
+      c.body = resp.data_;
+      c.bodyEnd = resp.len_;
+      c.keep = resp.shared_;
+    } else if (resp.reader_) {
+      c.reader = resp.reader_;
+      c.readerEnd = resp.len_;
+    } else {
+      c.out += resp.text_;
+    }
+  }
+  c.state = WRITING;
+  c.lastMs = nowMs;
+  if (resp.channel_ && !c.headOnly) {
+    c.state = STREAMING;
+    c.channel = resp.channel_;
+    c.maxQueued = resp.maxQueued_;
+    c.queue.clear();
+  }
+}
+
+// Streaming: moves the oldest queued chunk into the write position.
+bool HttpEventServer::nextChunk(Conn& c) {
+  if (c.queue.empty()) return false;
+  c.keep = c.queue.front();
+  c.queue.erase(c.queue.begin());
+  c.body = c.keep->data();
+  c.bodyPos = 0;
+  c.bodyEnd = c.keep->size();
+  return true;
+}
+
+// sendReader() bodies: refills the chunk buffer at the write position.
+bool HttpEventServer::readChunk(Conn& c) {
+  if (!c.reader || c.readerPos >= c.readerEnd) return false;
+  size_t want = c.readerEnd - c.readerPos;
+  if (want > HTTP_READER_CHUNK) want = HTTP_READER_CHUNK;
+  c.chunk.resize(HTTP_READER_CHUNK);
+  size_t got = c.reader(c.readerPos, c.chunk.data(), want);
+  if (got == 0 || got > want) {
+    close(c);  // the length is already promised; cut the response short
+    return false;
+  }
+  c.readerPos += got;
+  c.body = c.chunk.data();
+  c.bodyPos = 0;
+  c.bodyEnd = got;
+  return true;
+}
+
+bool HttpEventServer::writeSome(Conn& c, uint32_t nowMs) {
+  size_t budget = HTTP_POLL_BUDGET;
+  bool moved = false;
+  while (budget > 0) {
+    const uint8_t* p;
+    size_t n;
+    if (c.outPos < c.out.size()) {
+      p = (const uint8_t*)c.out.data() + c.outPos;
+      n = c.out.size() - c.outPos;
+    } else if (c.bodyPos < c.bodyEnd) {
+      p = c.body + c.bodyPos;
+      n = c.bodyEnd - c.bodyPos;
+    } else if (c.state == STREAMING) {
+      if (!nextChunk(c)) return moved;  // wait for the next publish()
+      continue;
+    } else if (c.reader && c.readerPos < c.readerEnd) {
+      if (!readChunk(c)) return moved;
+      continue;
+    } else {
+      finish(c, nowMs);
+      return moved;
+    }
+    if (n > budget) n = budget;
+    int w = c.sock->sendSome(p, n);
+    if (w < 0) {
+      close(c);
+      return moved;
+    }
+    if (w == 0) return moved;
+    if (c.outPos < c.out.size()) {
+      c.outPos += (size_t)w;
+    } else {
+      c.bodyPos += (size_t)w;
+    }
+    budget -= (size_t)w;
+    c.lastMs = nowMs;
+    moved = true;
+  }
+  if (c.state == WRITING && c.outPos >= c.out.size() && c.bodyPos >= c.bodyEnd &&
+      c.readerPos >= c.readerEnd) {
+    finish(c, nowMs);
+  }
+  return moved;
+}
+
+void HttpEventServer::finish(Conn& c, uint32_t nowMs) {
+  if (!c.keepAlive) {
+    close(c);
+    return;
+  }
+  c.state = READING;
+  c.out.clear();
+  c.outPos = 0;
+  c.body = nullptr;
+  c.bodyPos = c.bodyEnd = 0;
+  c.keep.reset();  // the frame may be freed now
+  c.reader = nullptr;
+  c.readerPos = c.readerEnd = 0;
+  c.lastMs = nowMs;
+}
+
+void HttpEventServer::close(Conn& c) {
+  c.sock.reset();
+  c.keep.reset();
+  c.reader = nullptr;
+  c.readerPos = c.readerEnd = 0;
+  c.queue.clear();
+  c.channel = 0;
+  c.in.clear();
+  c.out.clear();
+  c.req = HttpRequest();
+  c.state = READING;
+}
+
+const char* httpStatusText(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 406: return "Not Acceptable";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
+}
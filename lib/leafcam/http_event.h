@@ -0,0 +1,198 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ====== Event-driven HTTP/1.1 server ======
+// Serves several connections from one polling loop. Nothing here blocks:
+// sockets are read and written only as far as they accept without waiting,
+// and one poll() moves at most HTTP_POLL_BUDGET bytes per connection, so a
+// slow client downloading a JPEG cannot hold up the others or the caller.
+// Keep-alive is supported; request bodies are limited to HTTP_MAX_BODY.
+// Long-lived responses (MJPEG, server-sent events) subscribe to a channel
+// and receive whatever another task publish()es to it.
+//
+// The core knows nothing about the network stack. A binding accepts
+// connections and hands them over as HttpSocket objects (see
+// http_socket.h for BSD sockets, which covers both lwIP and Linux).
+
+static const size_t HTTP_MAX_HEAD = 2048;      // request line + headers
+static const size_t HTTP_MAX_BODY = 1024;
+static const size_t HTTP_POLL_BUDGET = 8192;   // bytes written per connection per poll
+static const uint32_t HTTP_IDLE_TIMEOUT_MS = 10000;
+static const uint32_t HTTP_DEFER_TIMEOUT_MS = 30000;  // default for defer()
+static const uint8_t HTTP_MAX_CHANNELS = 8;    // stream channels 1..7
+
+// Non-blocking byte pipe to one client.
+class HttpSocket {
+ public:
+  virtual ~HttpSocket() {}
+  // >0 bytes read, 0 nothing available yet, <0 peer closed or error
+  virtual int recvSome(uint8_t* buf, size_t n) = 0;
+  // bytes accepted (0 when the send buffer is full), <0 on error
+  virtual int sendSome(const uint8_t* buf, size_t n) = 0;
+  // descriptor to wait on with poll()/select(), -1 if there is none
+  virtual int fd() const { return -1; }
+};
+
+typedef std::shared_ptr<const std::vector<uint8_t> > SharedBytes;
+
+// Copies up to n body bytes starting at offset into buf and returns how
+// many; 0 means the source went away and the connection is dropped. Called
+// from the task that polls the server.
+typedef std::function<size_t(size_t offset, uint8_t* buf, size_t n)> HttpBodyReader;
+static const size_t HTTP_READER_CHUNK = 1024;  // bytes per reader call
+
+struct HttpRequest {
+  std::string method;
+  std::string path;   // without query
+  std::string query;  // text after '?', may be empty
+  std::vector<std::pair<std::string, std::string> > headers;  // lower-case names
+  std::string body;
+
+  std::string header(const char* name) const;  // "" if absent
+  bool hasHeader(const char* name) const;
+  bool hasArg(const char* name) const;
+  std::string arg(const char* name) const;     // %-decoded query parameter
+};
+
+class HttpResponse {
+ public:
+  void setHeader(const char* name, const std::string& value);
+
+  // Body copied into the response.
+  void send(int status, const char* contentType, const std::string& body);
+  // Body in static memory or flash (PROGMEM is memory-mapped on the ESP32).
+  void sendStatic(int status, const char* contentType, const uint8_t* data, size_t len);
+  // Body owned elsewhere; the reference keeps it alive until the last byte
+  // is written, even if the owner has moved on to a newer frame.
+  void sendShared(int status, const char* contentType, const SharedBytes& data,
+                  size_t offset, size_t len);
+  // Body pulled from reader a chunk at a time as the socket takes it, so a
+  // large body in flash or a file never has to be in RAM at once.
+  void sendReader(int status, const char* contentType, HttpBodyReader reader, size_t len);
+  // Status and headers only (304, 416 ...).
+  void sendEmpty(int status);
+  // 200 with no length: the body is every chunk later published to channel
+  // (1..HTTP_MAX_CHANNELS-1) until the client goes away. A client that falls
+  // behind by more than maxQueued chunks loses the oldest unsent ones.
+  void stream(uint8_t channel, const char* contentType, size_t maxQueued = 2);
+
+  // Answer later, from any task, with HttpEventServer::complete(token()).
+  // Without an answer within timeoutMs the client gets a 503; 0 waits for
+  // as long as it takes.
+  void defer(uint32_t timeoutMs = HTTP_DEFER_TIMEOUT_MS) {
+    deferred_ = true;
+    deferTimeoutMs_ = timeoutMs;
+  }
+  bool deferred() const { return deferred_; }
+  uint32_t token() const { return token_; }
+  bool sent() const { return status_ != 0; }
+
+ private:
+  friend class HttpEventServer;
+  int status_ = 0;
+  std::string contentType_;
+  std::string headers_;  // extra "Name: value\r\n" lines
+  std::string text_;
+  const uint8_t* data_ = nullptr;
+  size_t len_ = 0;
+  SharedBytes shared_;
+  HttpBodyReader reader_;
+  bool deferred_ = false;
+  uint32_t deferTimeoutMs_ = 0;
+  uint32_t token_ = 0;
+  uint8_t channel_ = 0;
+  size_t maxQueued_ = 0;
+};
+
+class HttpEventServer {
+ public:
+  typedef std::function<void(const HttpRequest& req, HttpResponse& resp)> Handler;
+
+  HttpEventServer(size_t maxClients, Handler handler);
+
+  // Takes a freshly accepted connection. Returns false (and drops it) when
+  // every slot is busy; bindings check hasFreeSlot() first so surplus
+  // clients wait in the listen backlog instead.
+  bool adopt(HttpSocket* sock, uint32_t nowMs);
+  bool hasFreeSlot() const;
+
+  // Reads, dispatches and writes whatever each connection allows right now.
+  // Returns true if any byte moved, so callers can decide whether to sleep.
+  bool poll(uint32_t nowMs);
+
+  // Finishes a deferred response. Thread-safe; the response is written by
+  // the next poll(). Unknown or expired tokens are ignored.
+  void complete(uint32_t token, const HttpResponse& resp);
+
+  // Queues chunk for every client streaming channel. Thread-safe; the chunk
+  // is shared, not copied, between clients.
+  void publish(uint8_t channel, const SharedBytes& chunk);
+  // Clients currently streaming channel, as of the last poll(). Thread-safe.
+  uint8_t subscribers(uint8_t channel) const;
+
+  // (fd, wants write) for every open connection, for poll()/select().
+  void watchList(std::vector<std::pair<int, bool> >& out) const;
+
+  size_t clients() const;
+  uint32_t requests() const { return requests_; }
+  uint32_t rejected() const { return rejected_; }
+
+ private:
+  enum State { READING, WAITING, WRITING, STREAMING };
+  struct Conn {
+    std::unique_ptr<HttpSocket> sock;
+    State state = READING;
+    std::string in;           // unparsed request bytes
+    size_t headLen = 0;       // request head length once parsed
+    size_t bodyLen = 0;
+    HttpRequest req;
+    std::string out;          // status line, headers and copied body
+    size_t outPos = 0;
+    const uint8_t* body = nullptr;
+    size_t bodyPos = 0;
+    size_t bodyEnd = 0;
+    SharedBytes keep;
+    HttpBodyReader reader;    // sendReader() bodies
+    size_t readerPos = 0;     // body bytes taken from reader
+    size_t readerEnd = 0;
+    std::vector<uint8_t> chunk;
+    bool keepAlive = true;
+    bool headOnly = false;
+    uint8_t channel = 0;
+    size_t maxQueued = 0;
+    std::vector<SharedBytes> queue;  // published chunks not yet started
+    uint32_t token = 0;
+    uint32_t deferTimeoutMs = 0;  // WAITING: 503 after this long, 0 never
+    uint32_t lastMs = 0;
+  };
+
+  bool readRequest(Conn& c, uint32_t nowMs);
+  bool parseHead(Conn& c);
+  void dispatch(Conn& c, uint32_t nowMs);
+  void startResponse(Conn& c, const HttpResponse& resp, uint32_t nowMs);
+  bool writeSome(Conn& c, uint32_t nowMs);
+  bool nextChunk(Conn& c);
+  bool readChunk(Conn& c);
+  void finish(Conn& c, uint32_t nowMs);
+  void close(Conn& c);
+
+  std::vector<Conn> conns_;
+  Handler handler_;
+  uint32_t nextToken_ = 1;
+  uint32_t requests_ = 0;
+  uint32_t rejected_ = 0;
+
+  mutable std::mutex lock_;  // guards done_, published_ and subscribers_
+  std::vector<std::pair<uint32_t, HttpResponse> > done_;
+  std::vector<std::pair<uint8_t, SharedBytes> > published_;
+  uint8_t subscribers_[HTTP_MAX_CHANNELS] = {0};
+};
+
+const char* httpStatusText(int status);
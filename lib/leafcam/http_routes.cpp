@@ -0,0 +1,285 @@
+#include "http_routes.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "http_cache.h"
+
+void serveFrame(const HttpRequest& req, HttpResponse& resp, const SharedBytes& frame,
+                const FrameKey& key) {
+  if (!frame || frame->empty()) {
+    resp.send(404, "text/plain", "No image");
+    return;
+  }
+  char etag[FRAME_ETAG_LEN];
+  frameEtag(key, etag, sizeof(etag));
+  std::string version(etag + 1, strlen(etag) - 2);
+  resp.setHeader("ETag", etag);
+  resp.setHeader("Accept-Ranges", "bytes");
+  if (req.hasArg("v") && req.arg("v") == version) {
+    resp.setHeader("Cache-Control", "public, max-age=31536000, immutable");
+  } else {
+    resp.setHeader("Cache-Control", "no-cache");
+  }
+  if (etagMatches(req.header("if-none-match").c_str(), etag)) {
+    resp.sendEmpty(304);
+    return;
+  }
+
+  size_t total = frame->size();
+  size_t start = 0;
+  size_t n = total;
+  RangeResult range = RANGE_NONE;
+  std::string ifRange = req.header("if-range");
+  if (ifRange.empty() || ifRange == etag) {
+    range = parseByteRange(req.header("range").c_str(), total, start, n);
+  }
+  char cr[64];
+  if (range == RANGE_UNSATISFIABLE) {
+    snprintf(cr, sizeof(cr), "bytes */%lu", (unsigned long)total);
+    resp.setHeader("Content-Range", cr);
+    resp.send(416, "text/plain", "Range not satisfiable");
+    return;
+  }
+  if (range == RANGE_OK) {
+    snprintf(cr, sizeof(cr), "bytes %lu-%lu/%lu", (unsigned long)start,
+             (unsigned long)(start + n - 1), (unsigned long)total);
+    resp.setHeader("Content-Range", cr);
+    resp.sendShared(206, "image/jpeg", frame, start, n);
+    return;
+  }
+  resp.sendShared(200, "image/jpeg", frame, 0, total);
+}
+
+void serveGzipAsset(const HttpRequest& req, HttpResponse& resp, const char* contentType,
+                    const uint8_t* gz, size_t gzLen, const char* version, bool versioned) {
+  std::string etag = std::string("\"") + version + "\"";
+  resp.setHeader("ETag", etag);
+  if (versioned && req.arg("v") == version) {
+    resp.setHeader("Cache-Control", "public, max-age=31536000, immutable");
+  } else {
+    resp.setHeader("Cache-Control", "no-cache");
+  }
+  if (etagMatches(req.header("if-none-match").c_str(), etag.c_str())) {
+    resp.sendEmpty(304);
+    return;
+  }
+  // There is no plain copy in flash: a client that refuses gzip gets 406
+  resp.setHeader("Vary", "Accept-Encoding");
+  bool hasAccept = req.hasHeader("accept-encoding");
+  if (!acceptsCoding(hasAccept ? req.header("accept-encoding").c_str() : nullptr, "gzip")) {
+    resp.send(406, "text/plain", "This asset is only available gzip-encoded");
+    return;
+  }
+  resp.setHeader("Content-Encoding", "gzip");
+  resp.sendStatic(200, contentType, gz, gzLen);
+}
+
+static void appendJsonString(std::string& out, const char* s, size_t n) {
+  out += '"';
+  for (size_t i = 0; i < n; ++i) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += (char)c;
+    } else if (c < 0x20) {
+      char esc[8];
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      out += esc;
+    } else {
+      out += (char)c;
+    }
+  }
+  out += '"';
+}
+
+static void appendStageMs(std::string& out, const char* name, uint16_t ms) {
+  char buf[32];
+  if (ms == HISTORY_NO_TIME) {
+    snprintf(buf, sizeof(buf), "\"%s\":null", name);
+  } else {
+    snprintf(buf, sizeof(buf), "\"%s\":%u", name, (unsigned)ms);
+  }
+  out += buf;
+}
+
+static void appendHistoryEntry(std::string& out, const HistoryStore& store, const HistoryEntry& e) {
+  static const char* const RESULT_FIELDS[] = { "leaf_name", "disease", "solution" };
+  char buf[160];
+  snprintf(buf, sizeof(buf),
+           "{\"id\":%lu,\"capture_id\":\"%08lx\",\"t\":%lu,\"bytes\":%lu,\"crc\":\"%04x\","
+           "\"image\":\"/history/%lu.jpg\",\"stages\":{",
+           (unsigned long)e.id, (unsigned long)e.captureId, (unsigned long)e.timeMs,
+           (unsigned long)e.len, (unsigned)e.crc, (unsigned long)e.id);
+  out += buf;
+  appendStageMs(out, "cam_ms", e.stageMs[HISTORY_CAM]);
+  out += ',';
+  appendStageMs(out, "link_ms", e.stageMs[HISTORY_LINK]);
+  out += ',';
+  appendStageMs(out, "upload_ms", e.stageMs[HISTORY_UPLOAD]);
+  out += ',';
+  appendStageMs(out, "total_ms", e.stageMs[HISTORY_TOTAL]);
+  out += "},\"result\":";
+  char text[HISTORY_RESULT_MAX + 1];
+  if (!(e.flags & HISTORY_HAS_RESULT) || !store.result(e.id, text, sizeof(text))) {
+    out += "null}";
+    return;
+  }
+  out += '{';
+  const char* p = text;
+  for (size_t f = 0; f < sizeof(RESULT_FIELDS) / sizeof(RESULT_FIELDS[0]); ++f) {
+    const char* nl = strchr(p, '\n');
+    size_t n = nl ? (size_t)(nl - p) : strlen(p);
+    if (f) out += ',';
+    out += '"';
+    out += RESULT_FIELDS[f];
+    out += "\":";
+    appendJsonString(out, p, n);
+    p += n;
+    if (*p) ++p;
+  }
+  out += "}}";
+}
+
+static void serveHistoryFrame(const HttpRequest& req, HttpResponse& resp, HistoryStore& store,
+                              const HistoryEntry& e) {
+  char etag[40];
+  snprintf(etag, sizeof(etag), "\"h%lu-%04x-%lx\"", (unsigned long)e.id, (unsigned)e.crc,
+           (unsigned long)e.len);
+  resp.setHeader("ETag", etag);
+  resp.setHeader("Accept-Ranges", "bytes");
+  resp.setHeader("Cache-Control", "no-cache");
+  if (etagMatches(req.header("if-none-match").c_str(), etag)) {
+    resp.sendEmpty(304);
+    return;
+  }
+  size_t start = 0;
+  size_t n = e.len;
+  RangeResult range = RANGE_NONE;
+  std::string ifRange = req.header("if-range");
+  if (ifRange.empty() || ifRange == etag) {
+    range = parseByteRange(req.header("range").c_str(), e.len, start, n);
+  }
+  char cr[64];
+  if (range == RANGE_UNSATISFIABLE) {
+    snprintf(cr, sizeof(cr), "bytes */%lu", (unsigned long)e.len);
+    resp.setHeader("Content-Range", cr);
+    resp.send(416, "text/plain", "Range not satisfiable");
+    return;
+  }
+  if (range == RANGE_OK) {
+    snprintf(cr, sizeof(cr), "bytes %lu-%lu/%lu", (unsigned long)start,
+             (unsigned long)(start + n - 1), (unsigned long)e.len);
+    resp.setHeader("Content-Range", cr);
+  }
+  // Evicted mid-download: the reader returns 0 and the connection is cut
+  uint32_t id = e.id;
+  HistoryStore* s = &store;
+  resp.sendReader(range == RANGE_OK ? 206 : 200, "image/jpeg",
+                  [s, id, start](size_t offset, uint8_t* buf, size_t len) {
+                    return s->readFrame(id, start + offset, buf, len);
+                  },
+                  n);
+}
+
+void serveHistory(const HttpRequest& req, HttpResponse& resp, HistoryStore& store) {
+  static const char PREFIX[] = "/history/";
+  const std::string& path = req.path;
+  if (path.compare(0, sizeof(PREFIX) - 1, PREFIX) == 0) {
+    const char* idText = path.c_str() + sizeof(PREFIX) - 1;
+    char* end = nullptr;
+    unsigned long id = strtoul(idText, &end, 10);
+    HistoryEntry e;
+    if (end == idText || !store.get((uint32_t)id, e)) {
+      resp.send(404, "text/plain", "Not in history");
+      return;
+    }
+    if (strcmp(end, ".jpg") == 0) {
+      serveHistoryFrame(req, resp, store, e);
+      return;
+    }
+    if (strcmp(end, ".json") == 0) {
+      std::string body;
+      appendHistoryEntry(body, store, e);
+      resp.setHeader("Cache-Control", "no-cache");
+      resp.send(200, "application/json", body);
+      return;
+    }
+    resp.send(404, "text/plain", "Not found");
+    return;
+  }
+
+  size_t limit = HISTORY_PAGE_DEFAULT;
+  if (req.hasArg("limit")) {
+    limit = strtoul(req.arg("limit").c_str(), nullptr, 10);
+    if (limit < 1) limit = 1;
+    if (limit > HISTORY_PAGE_MAX) limit = HISTORY_PAGE_MAX;
+  }
+  uint32_t before = (uint32_t)strtoul(req.arg("before").c_str(), nullptr, 10);
+  HistoryEntry page[HISTORY_PAGE_MAX];
+  size_t n = store.list(before, page, limit);
+  // A further page exists while the last entry is not the oldest
+  uint32_t next = n && page[n - 1].id != store.oldestId() ? page[n - 1].id : 0;
+
+  std::string body;
+  body.reserve(64 + n * 300);
+  char head[160];
+  snprintf(head, sizeof(head),
+           "{\"count\":%lu,\"capacity\":%lu,\"newest\":%lu,\"oldest\":%lu,\"next_before\":%lu,"
+           "\"entries\":[",
+           (unsigned long)store.count(), (unsigned long)store.capacity(),
+           (unsigned long)store.newestId(), (unsigned long)store.oldestId(), (unsigned long)next);
+  body += head;
+  for (size_t i = 0; i < n; ++i) {
+    if (i) body += ',';
+    appendHistoryEntry(body, store, page[i]);
+  }
+  body += "]}";
+  resp.setHeader("Cache-Control", "no-store");
+  resp.send(200, "application/json", body);
+}
+
+SharedBytes mjpegPart(const uint8_t* jpg, size_t len) {
+  char head[96];
+  int h = snprintf(head, sizeof(head),
+                   "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %lu\r\n\r\n",
+                   (unsigned long)len);
+  std::shared_ptr<std::vector<uint8_t> > part = std::make_shared<std::vector<uint8_t> >();
+  part->reserve((size_t)h + len + 2);
+  part->insert(part->end(), (const uint8_t*)head, (const uint8_t*)head + h);
+  part->insert(part->end(), jpg, jpg + len);
+  part->push_back('\r');
+  part->push_back('\n');
+  return part;
+}
+
+static void appendText(std::vector<uint8_t>& out, const char* s) {
+  out.insert(out.end(), (const uint8_t*)s, (const uint8_t*)s + strlen(s));
+}
+
+SharedBytes sseEvent(const char* event, const char* data) {
+  std::shared_ptr<std::vector<uint8_t> > msg = std::make_shared<std::vector<uint8_t> >();
+  msg->reserve(strlen(event) + strlen(data) + 16);
+  appendText(*msg, "event: ");
+  appendText(*msg, event);
+  appendText(*msg, "\ndata: ");
+  for (const char* p = data; *p; ++p) {
+    if (*p == '\r') continue;
+    if (*p == '\n') {
+      appendText(*msg, "\ndata: ");
+    } else {
+      msg->push_back((uint8_t)*p);
+    }
+  }
+  appendText(*msg, "\n\n");
+  return msg;
+}
+
+SharedBytes sseComment(const char* text) {
+  std::shared_ptr<std::vector<uint8_t> > msg = std::make_shared<std::vector<uint8_t> >();
+  appendText(*msg, ": ");
+  appendText(*msg, text);
+  appendText(*msg, "\n\n");
+  return msg;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "history_store.h"
+#include "http_event.h"
+#include "result_cache.h"
+
+// Handlers shared by the hub and its host build, on top of HttpEventServer.
+
+// Serves a frame with its strong ETag: If-None-Match gives 304, a single
+// Range gives 206 (honouring If-Range), and ?v=<etag without quotes> is
+// marked immutable. The response holds a reference to the frame.
+void serveFrame(const HttpRequest& req, HttpResponse& resp, const SharedBytes& frame,
+                const FrameKey& key);
+
+// Serves a build-time gzipped asset (tools/gen_web_assets.py). Versioned
+// assets requested as path?v=version are cached for a year; everything else
+// is revalidated with the ETag.
+void serveGzipAsset(const HttpRequest& req, HttpResponse& resp, const char* contentType,
+                    const uint8_t* gz, size_t gzLen, const char* version, bool versioned);
+
+// Capture history, for any path under /history:
+//   /history?before=<id>&limit=<n>  newest-first page of entries as JSON
+//   /history/<id>.json              one entry
+//   /history/<id>.jpg               its frame, read from the store as the
+//                                   socket takes it (ETag, single Range)
+// A result is stored as leaf, disease and solution separated by '\n'.
+void serveHistory(const HttpRequest& req, HttpResponse& resp, HistoryStore& store);
+static const size_t HISTORY_PAGE_DEFAULT = 20;
+static const size_t HISTORY_PAGE_MAX = 50;
+
+// Live preview as multipart/x-mixed-replace: publish one mjpegPart() per
+// frame to the channel a HttpResponse::stream(..., MJPEG_CONTENT_TYPE) is on.
+static const char MJPEG_CONTENT_TYPE[] = "multipart/x-mixed-replace; boundary=frame";
+SharedBytes mjpegPart(const uint8_t* jpg, size_t len);
+
+// Server-sent events: publish one sseEvent() per event to the channel a
+// HttpResponse::stream(..., SSE_CONTENT_TYPE) is on. data may span lines.
+// sseComment() is ignored by EventSource; publish one now and then so idle
+// connections stay open through proxies and dead ones are noticed.
+static const char SSE_CONTENT_TYPE[] = "text/event-stream";
+SharedBytes sseEvent(const char* event, const char* data);
+SharedBytes sseComment(const char* text);
@@ -0,0 +1,88 @@
+#include "http_socket.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include "lwip/sockets.h"
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static bool wouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static void setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+SocketHttpConn::~SocketHttpConn() {
+  if (fd_ >= 0) close(fd_);
+}
+
+int SocketHttpConn::recvSome(uint8_t* buf, size_t n) {
+  int r = (int)recv(fd_, buf, n, MSG_DONTWAIT);
+  if (r > 0) return r;
+  if (r < 0 && wouldBlock()) return 0;
+  return -1;  // 0 is an orderly shutdown
+}
+
+int SocketHttpConn::sendSome(const uint8_t* buf, size_t n) {
+  int w = (int)send(fd_, buf, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (w >= 0) return w;
+  return wouldBlock() ? 0 : -1;
+}
+
+bool SocketHttpListener::begin(uint16_t port, bool loopbackOnly) {
+  end();
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0) return false;
+  int one = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+  if (bind(fd_, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd_, 8) != 0) {
+    end();
+    return false;
+  }
+  socklen_t alen = sizeof(addr);
+  getsockname(fd_, (sockaddr*)&addr, &alen);
+  port_ = ntohs(addr.sin_port);
+  setNonBlocking(fd_);
+  return true;
+}
+
+void SocketHttpListener::end() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  port_ = 0;
+}
+
+int SocketHttpListener::acceptInto(HttpEventServer& server, uint32_t nowMs) {
+  int adopted = 0;
+  while (fd_ >= 0 && server.hasFreeSlot()) {
+    int c = accept(fd_, nullptr, nullptr);
+    if (c < 0) break;
+    setNonBlocking(c);
+    int one = 1;
+    setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (sndBuf_ > 0) setsockopt(c, SOL_SOCKET, SO_SNDBUF, &sndBuf_, sizeof(sndBuf_));
+    server.adopt(new SocketHttpConn(c), nowMs);
+    ++adopted;
+  }
+  return adopted;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+
+#include "http_event.h"
+
+// ====== BSD socket binding for HttpEventServer ======
+// lwIP on the ESP32 and Linux share the BSD socket API, so the same
+// non-blocking listener serves the hub and the host load test.
+
+class SocketHttpConn : public HttpSocket {
+ public:
+  explicit SocketHttpConn(int fd) : fd_(fd) {}
+  ~SocketHttpConn();
+  int recvSome(uint8_t* buf, size_t n);
+  int sendSome(const uint8_t* buf, size_t n);
+  int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+class SocketHttpListener {
+ public:
+  ~SocketHttpListener() { end(); }
+
+  // port 0 picks a free port; see port().
+  bool begin(uint16_t port, bool loopbackOnly = false);
+  void end();
+  uint16_t port() const { return port_; }
+  int fd() const { return fd_; }
+  // SO_SNDBUF for accepted connections (0 keeps the stack default)
+  void setSendBuffer(int bytes) { sndBuf_ = bytes; }
+
+  // Moves pending connections into free server slots without blocking.
+  // Returns the number adopted.
+  int acceptInto(HttpEventServer& server, uint32_t nowMs);
+
+ private:
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  int sndBuf_ = 0;
+};
@@ -0,0 +1,352 @@
+#include "jpeg_dc.h"
+
+#include <string.h>
+
+namespace {
+
+// Canonical Huffman table with a 9-bit lookahead for the common short codes.
+struct HuffTable {
+  bool present = false;
+  uint8_t lookLen[512];     // code length for a 9-bit prefix, 0 = slow path
+  uint8_t lookVal[512];
+  int32_t maxcode[18];      // largest code of each length, -1 if none
+  int32_t valptr[17];
+  uint16_t mincode[17];
+  uint8_t vals[256];
+};
+
+struct Component {
+  uint8_t id = 0;
+  uint8_t hs = 1, vs = 1;
+  uint8_t tq = 0;
+  uint8_t td = 0, ta = 0;   // from SOS
+  int pred = 0;
+};
+
+bool buildHuff(HuffTable& t, const uint8_t* counts, const uint8_t* vals, int nvals) {
+  memset(t.lookLen, 0, sizeof(t.lookLen));
+  memcpy(t.vals, vals, (size_t)nvals);
+  uint16_t code = 0;
+  int k = 0;
+  for (int len = 1; len <= 16; ++len) {
+    t.valptr[len] = k;
+    t.mincode[len] = code;
+    int n = counts[len - 1];
+    if (n) {
+      for (int i = 0; i < n; ++i, ++k, ++code) {
+        if (len <= 9) {
+          int shift = 9 - len;
+          for (int f = 0; f < (1 << shift); ++f) {
+            int idx = (code << shift) | f;
+            t.lookLen[idx] = (uint8_t)len;
+            t.lookVal[idx] = vals[k];
+          }
+        }
+      }
+      t.maxcode[len] = code - 1;
+    } else {
+      t.maxcode[len] = -1;
+    }
+    if (code > (1u << len)) return false;  // over-subscribed
+    code <<= 1;
+  }
+  t.maxcode[17] = 0x7FFFFFFF;
+  t.present = true;
+  return true;
+}
+
+// Bit reader over the entropy-coded segment. Stops at any marker other than
+// stuffed 0xFF00 and feeds zero bits from there; consuming those zeros means
+// the scan was truncated.
+struct BitReader {
+  const uint8_t* p;
+  const uint8_t* end;
+  uint32_t acc = 0;
+  int bits = 0;
+  int padBytes = 0;
+  bool hitMarker = false;
+
+  void fill() {
+    while (bits <= 24) {
+      uint32_t byte = 0;
+      if (!hitMarker && p < end) {
+        byte = *p;
+        if (byte == 0xFF) {
+          if (p + 1 < end && p[1] == 0x00) {
+            p += 2;
+          } else {
+            hitMarker = true;  // leave p on the marker
+            byte = 0;
+            ++padBytes;
+          }
+        } else {
+          ++p;
+        }
+      } else {
+        ++padBytes;
+      }
+      acc |= byte << (24 - bits);
+      bits += 8;
+    }
+  }
+
+  uint32_t peek(int n) {
+    if (bits < n) fill();
+    return acc >> (32 - n);
+  }
+
+  void skip(int n) {
+    if (bits < n) fill();
+    acc <<= n;
+    bits -= n;
+  }
+
+  int get(int n) {
+    if (n == 0) return 0;
+    uint32_t v = peek(n);
+    skip(n);
+    return (int)v;
+  }
+
+  bool overran() const { return padBytes * 8 > bits; }
+
+  void reset() {
+    acc = 0;
+    bits = 0;
+    padBytes = 0;
+    hitMarker = false;
+  }
+};
+
+int decodeHuff(BitReader& br, const HuffTable& t) {
+  uint32_t look = br.peek(9);
+  int len = t.lookLen[look];
+  if (len) {
+    br.skip(len);
+    return t.lookVal[look];
+  }
+  uint32_t code = br.peek(16);
+  for (len = 10; len <= 16; ++len) {
+    int32_t c = (int32_t)(code >> (16 - len));
+    if (c <= t.maxcode[len]) {
+      br.skip(len);
+      return t.vals[t.valptr[len] + c - t.mincode[len]];
+    }
+  }
+  return -1;
+}
+
+inline int extend(int v, int s) {
+  return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+}
+
+inline uint16_t be16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+inline uint8_t clamp8(int v) { return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v); }
+
+}  // namespace
+
+uint8_t DcImage::at(int c, int bx, int by) const {
+  const DcPlane& p = plane[c];
+  if (p.mean.empty()) return 128;
+  int x = bx * p.hs / hmax;
+  int y = by * p.vs / vmax;
+  if (x >= p.w) x = p.w - 1;
+  if (y >= p.h) y = p.h - 1;
+  return p.mean[(size_t)y * p.w + x];
+}
+
+void DcImage::rgbAt(int bx, int by, uint8_t& r, uint8_t& g, uint8_t& b) const {
+  int y = at(0, bx, by);
+  if (components < 3 || plane[1].mean.empty()) {
+    r = g = b = (uint8_t)y;
+    return;
+  }
+  int cb = at(1, bx, by) - 128;
+  int cr = at(2, bx, by) - 128;
+  // JFIF: R = Y + 1.402 Cr, G = Y - 0.344136 Cb - 0.714136 Cr, B = Y + 1.772 Cb
+  r = clamp8(y + ((91881 * cr + 32768) >> 16));
+  g = clamp8(y - ((22554 * cb + 46802 * cr - 32768) >> 16));
+  b = clamp8(y + ((116130 * cb + 32768) >> 16));
+}
+
+bool decodeJpegDc(const uint8_t* data, size_t len, DcImage& out, std::string& err, bool lumaOnly) {
+  out = DcImage();
+  if (len < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+    err = "no SOI";
+    return false;
+  }
+
+  HuffTable* dc = new HuffTable[4];
+  HuffTable* ac = new HuffTable[4];
+  uint16_t qdc[4] = {1, 1, 1, 1};  // only the DC quantiser matters here
+  Component comp[3];
+  int ncomp = 0;
+  uint16_t restartInterval = 0;
+  bool ok = false;
+  size_t pos = 2;
+
+  while (pos + 4 <= len) {
+    if (data[pos] != 0xFF) { err = "bad marker"; break; }
+    uint8_t m = data[pos + 1];
+    if (m == 0xFF) { ++pos; continue; }  // fill byte
+    if (m == 0xD9) { err = "EOI before scan"; break; }
+    uint16_t seglen = be16(data + pos + 2);
+    const uint8_t* seg = data + pos + 4;
+    if (seglen < 2 || pos + 2 + seglen > len) { err = "truncated segment"; break; }
+    size_t n = seglen - 2;
+
+    if (m == 0xDB) {  // DQT
+      size_t i = 0;
+      while (i < n) {
+        uint8_t pq = seg[i] >> 4, tq = seg[i] & 15;
+        size_t sz = pq ? 128 : 64;
+        if (tq > 3 || i + 1 + sz > n) { err = "bad DQT"; break; }
+        qdc[tq] = pq ? be16(seg + i + 1) : seg[i + 1];
+        i += 1 + sz;
+      }
+      if (!err.empty()) break;
+    } else if (m == 0xC4) {  // DHT
+      size_t i = 0;
+      while (i + 17 <= n) {
+        uint8_t tc = seg[i] >> 4, th = seg[i] & 15;
+        int total = 0;
+        for (int k = 0; k < 16; ++k) total += seg[i + 1 + k];
+        if (th > 3 || tc > 1 || total > 256 || i + 17 + total > n) { err = "bad DHT"; break; }
+        if (!buildHuff(tc ? ac[th] : dc[th], seg + i + 1, seg + i + 17, total)) { err = "bad DHT"; break; }
+        i += 17 + total;
+      }
+      if (!err.empty()) break;
+    } else if (m == 0xDD) {  // DRI
+      if (n < 2) { err = "bad DRI"; break; }
+      restartInterval = be16(seg);
+    } else if (m == 0xC0 || m == 0xC1) {  // SOF0 / SOF1
+      if (n < 6 || seg[0] != 8) { err = "unsupported precision"; break; }
+      out.height = be16(seg + 1);
+      out.width = be16(seg + 3);
+      ncomp = seg[5];
+      if ((ncomp != 1 && ncomp != 3) || n < 6 + 3 * (size_t)ncomp || !out.width || !out.height) {
+        err = "bad SOF";
+        break;
+      }
+      for (int c = 0; c < ncomp; ++c) {
+        comp[c].id = seg[6 + 3 * c];
+        comp[c].hs = seg[7 + 3 * c] >> 4;
+        comp[c].vs = seg[7 + 3 * c] & 15;
+        comp[c].tq = seg[8 + 3 * c] & 3;
+        if (!comp[c].hs || !comp[c].vs || comp[c].hs > 4 || comp[c].vs > 4) { err = "bad sampling"; break; }
+        if (comp[c].hs > out.hmax) out.hmax = comp[c].hs;
+        if (comp[c].vs > out.vmax) out.vmax = comp[c].vs;
+      }
+      if (!err.empty()) break;
+      out.components = (uint8_t)ncomp;
+    } else if ((m >= 0xC2 && m <= 0xCF) && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+      err = "not baseline";
+      break;
+    } else if (m == 0xDA) {  // SOS
+      if (!ncomp) { err = "SOS before SOF"; break; }
+      int ns = seg[0];
+      if (ns != ncomp || n < 1 + 2 * (size_t)ns + 3) { err = "non-interleaved scan"; break; }
+      for (int i = 0; i < ns; ++i) {
+        uint8_t cid = seg[1 + 2 * i];
+        int c = 0;
+        while (c < ncomp && comp[c].id != cid) ++c;
+        if (c == ncomp) { err = "bad SOS"; break; }
+        comp[c].td = seg[2 + 2 * i] >> 4;
+        comp[c].ta = seg[2 + 2 * i] & 15;
+        if (comp[c].td > 3 || comp[c].ta > 3 || !dc[comp[c].td].present || !ac[comp[c].ta].present) {
+          err = "missing DHT";
+          break;
+        }
+      }
+      if (!err.empty()) break;
+
+      // Block grid of each plane. A single-component scan is not MCU-padded.
+      int mcuW = 8 * out.hmax, mcuH = 8 * out.vmax;
+      int mcusX = (out.width + mcuW - 1) / mcuW;
+      int mcusY = (out.height + mcuH - 1) / mcuH;
+      if (ncomp == 1) {
+        comp[0].hs = comp[0].vs = 1;
+        out.hmax = out.vmax = 1;
+        mcusX = (out.width + 7) / 8;
+        mcusY = (out.height + 7) / 8;
+      }
+      for (int c = 0; c < ncomp; ++c) {
+        DcPlane& p = out.plane[c];
+        p.hs = comp[c].hs;
+        p.vs = comp[c].vs;
+        p.w = (uint16_t)(mcusX * comp[c].hs);
+        p.h = (uint16_t)(mcusY * comp[c].vs);
+        if (c == 0 || !lumaOnly) p.mean.assign((size_t)p.w * p.h, 128);
+      }
+
+      BitReader br;
+      br.p = seg + n;
+      br.end = data + len;
+      int mcusLeft = restartInterval;
+      bool scanOk = true;
+      for (int my = 0; my < mcusY && scanOk; ++my) {
+        for (int mx = 0; mx < mcusX && scanOk; ++mx) {
+          if (restartInterval) {
+            if (mcusLeft == 0) {
+              // Expect RSTn: skip to it, reset predictors and the bit buffer.
+              while (br.p + 1 < br.end && !(br.p[0] == 0xFF && br.p[1] >= 0xD0 && br.p[1] <= 0xD7)) ++br.p;
+              if (br.p + 1 >= br.end) { scanOk = false; break; }
+              br.p += 2;
+              br.reset();
+              for (int c = 0; c < ncomp; ++c) comp[c].pred = 0;
+              mcusLeft = restartInterval;
+            }
+            --mcusLeft;
+          }
+          for (int c = 0; c < ncomp && scanOk; ++c) {
+            Component& cc = comp[c];
+            DcPlane& p = out.plane[c];
+            for (int v = 0; v < cc.vs && scanOk; ++v) {
+              for (int h = 0; h < cc.hs; ++h) {
+                int s = decodeHuff(br, dc[cc.td]);
+                if (s < 0 || s > 11) { scanOk = false; break; }
+                cc.pred += s ? extend(br.get(s), s) : 0;
+                // Skip the 63 AC coefficients.
+                for (int k = 1; k < 64;) {
+                  int rs = decodeHuff(br, ac[cc.ta]);
+                  if (rs < 0) { scanOk = false; break; }
+                  int r = rs >> 4, sz = rs & 15;
+                  if (sz) {
+                    k += r + 1;
+                    br.skip(sz);
+                  } else if (r == 15) {
+                    k += 16;
+                  } else {
+                    break;  // EOB
+                  }
+                }
+                if (!scanOk) break;
+                if (!p.mean.empty()) {
+                  // DC = 8 * (mean - 128) after dequantisation
+                  int mean = 128 + ((cc.pred * (int)qdc[cc.tq] + (cc.pred >= 0 ? 4 : -4)) / 8);
+                  size_t bx = (size_t)mx * cc.hs + h, by = (size_t)my * cc.vs + v;
+                  p.mean[by * p.w + bx] = clamp8(mean);
+                }
+              }
+            }
+          }
+          if (br.overran()) scanOk = false;
+        }
+      }
+      if (!scanOk) {
+        err = br.overran() ? "truncated scan" : "corrupt scan";
+        break;
+      }
+      ok = true;
+      break;
+    }
+    pos += 2 + seglen;
+  }
+
+  delete[] dc;
+  delete[] ac;
+  if (!ok && err.empty()) err = "no scan";
+  if (!ok) out = DcImage();
+  return ok;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// ====== DC-only JPEG decoding ======
+// Entropy-decodes a baseline Huffman JPEG (what the ESP32-CAM produces) but
+// keeps only the DC coefficient of every 8x8 block, i.e. the block's mean
+// sample value. AC symbols are decoded just far enough to be skipped; no
+// IDCT, no upsampling, no colour conversion. The result is a 1/8-scale
+// image, which is all a fingerprint or colour statistics need.
+
+struct DcPlane {
+  uint16_t w = 0;   // blocks per row (including MCU padding)
+  uint16_t h = 0;   // block rows
+  uint8_t hs = 1;   // sampling factors from SOF
+  uint8_t vs = 1;
+  std::vector<uint8_t> mean;  // per block, 0..255
+};
+
+struct DcImage {
+  uint16_t width = 0;    // picture size in pixels
+  uint16_t height = 0;
+  uint8_t components = 0;
+  uint8_t hmax = 1;
+  uint8_t vmax = 1;
+  DcPlane plane[3];      // Y, Cb, Cr (only Y for grayscale)
+
+  // Pixel-block grid: one entry per 8x8 block of the full-resolution picture.
+  uint16_t blocksW() const { return (uint16_t)((width + 7) / 8); }
+  uint16_t blocksH() const { return (uint16_t)((height + 7) / 8); }
+
+  // Mean of component c over pixel-block (bx, by).
+  uint8_t at(int c, int bx, int by) const;
+  // Mean RGB of pixel-block (bx, by) via the JFIF YCbCr transform.
+  void rgbAt(int bx, int by, uint8_t& r, uint8_t& g, uint8_t& b) const;
+};
+
+// Decodes the DC image. With lumaOnly the chroma planes are decoded but not
+// stored, which keeps memory to one byte per luma block (4.8 KB for VGA).
+bool decodeJpegDc(const uint8_t* data, size_t len, DcImage& out, std::string& err,
+                  bool lumaOnly = false);
@@ -0,0 +1,237 @@
+#include "jpeg_scan.h"
+
+#include <string.h>
+
+// libjpeg's std_luminance_quant_tbl (ITU T.81 Annex K)
+static const uint8_t STD_LUMA[64] = {
+  16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+  14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+  18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+  49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+};
+
+// Table sum libjpeg produces for quality q (baseline, entries 1..255)
+static uint32_t scaledLumaSum(int q) {
+  int scale = q < 50 ? 5000 / q : 200 - q * 2;
+  uint32_t sum = 0;
+  for (int i = 0; i < 64; ++i) {
+    long t = ((long)STD_LUMA[i] * scale + 50) / 100;
+    sum += t < 1 ? 1 : t > 255 ? 255 : (uint32_t)t;
+  }
+  return sum;
+}
+
+// The sum falls as quality rises: bisect for the closest one
+static uint8_t estimateQuality(uint32_t sum) {
+  int lo = 1, hi = 100;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (scaledLumaSum(mid) > sum) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  // lo is the first quality at or below sum; the one before may be closer
+  uint32_t atLo = scaledLumaSum(lo);
+  if (lo > 1 && atLo <= sum && scaledLumaSum(lo - 1) - sum < sum - atLo) --lo;
+  return (uint8_t)lo;
+}
+
+void JpegScanner::reset() {
+  state_ = SOI0;
+  err_ = "";
+  info_ = JpegInfo();
+  marker_ = 0;
+  segLen_ = 0;
+  segPos_ = 0;
+  dqtHead_ = 0;
+  dqtLeft_ = 0;
+  dqtHi_ = false;
+  dqtEntry_ = 0;
+  lumaSum_ = 0;
+  haveLuma_ = false;
+  sawSof_ = false;
+  sawDqt_ = false;
+}
+
+bool JpegScanner::fail(const char* why) {
+  state_ = FAILED;
+  err_ = why;
+  return false;
+}
+
+bool JpegScanner::beginMarker(uint8_t m) {
+  if (m == 0xD8) return fail("second SOI");
+  if (m == 0xD9) {
+    if (!info_.scans) return fail("EOI before scan");
+    if (!info_.scanBytes) return fail("empty scan");
+    state_ = DONE;
+    return true;
+  }
+  if (m >= 0xD0 && m <= 0xD7) return fail("RST outside scan");
+  if (m == 0x01) {  // TEM, no length
+    state_ = MARKER;
+    return true;
+  }
+  if (m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+    if (m > 0xC2) return fail("unsupported SOF");
+    if (sawSof_) return fail("second SOF");
+    info_.progressive = m == 0xC2;
+  }
+  if (m == 0xDA) {
+    if (!sawSof_) return fail("SOS before SOF");
+    if (!sawDqt_) return fail("no DQT");
+  }
+  marker_ = m;
+  state_ = LEN_HI;
+  return true;
+}
+
+bool JpegScanner::segmentByte(uint8_t b) {
+  if (marker_ >= 0xC0 && marker_ <= 0xC2) {
+    if (segPos_ < sizeof(sof_)) sof_[segPos_] = b;
+    return true;
+  }
+  // DQT: tables of a header byte (precision << 4 | id) and 64 entries
+  if (!dqtLeft_) {
+    dqtHead_ = b;
+    if ((b >> 4) > 1 || (b & 15) > 3) return fail("bad DQT");
+    dqtLeft_ = 64;
+    dqtHi_ = false;
+    if ((b & 15) == 0) {
+      haveLuma_ = true;
+      lumaSum_ = 0;
+    }
+    return true;
+  }
+  if (dqtHead_ >> 4) {
+    if (!dqtHi_) {
+      dqtEntry_ = (uint16_t)(b << 8);
+      dqtHi_ = true;
+      return true;
+    }
+    dqtEntry_ |= b;
+    dqtHi_ = false;
+  } else {
+    dqtEntry_ = b;
+  }
+  if (!dqtEntry_) return fail("bad DQT");
+  if ((dqtHead_ & 15) == 0) lumaSum_ += dqtEntry_;
+  --dqtLeft_;
+  return true;
+}
+
+bool JpegScanner::endSegment() {
+  state_ = MARKER;
+  if (marker_ == 0xDB) {
+    if (dqtLeft_) return fail("bad DQT");
+    sawDqt_ = true;
+    if (haveLuma_) info_.quality = estimateQuality(lumaSum_);
+  } else if (marker_ >= 0xC0 && marker_ <= 0xC2) {
+    if (segLen_ < 6 || sof_[0] != 8) return fail("unsupported precision");
+    info_.height = (uint16_t)(sof_[1] << 8 | sof_[2]);
+    info_.width = (uint16_t)(sof_[3] << 8 | sof_[4]);
+    info_.components = sof_[5];
+    if (!info_.width || !info_.height) return fail("bad SOF size");
+    if ((info_.components != 1 && info_.components != 3) || segLen_ != 6 + 3 * info_.components) {
+      return fail("bad SOF");
+    }
+    sawSof_ = true;
+  } else if (marker_ == 0xDA) {
+    ++info_.scans;
+    state_ = ENTROPY;
+  }
+  return true;
+}
+
+bool JpegScanner::feed(const uint8_t* data, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    switch (state_) {
+      case SOI0:
+        if (data[i++] != 0xFF) return fail("no SOI");
+        state_ = SOI1;
+        break;
+      case SOI1:
+        if (data[i++] != 0xD8) return fail("no SOI");
+        state_ = MARKER;
+        break;
+      case MARKER:
+        if (data[i++] != 0xFF) return fail("bad marker");
+        state_ = MARKER_ID;
+        break;
+      case MARKER_ID: {
+        uint8_t m = data[i++];
+        if (m != 0xFF && !beginMarker(m)) return false;  // 0xFF is fill
+        break;
+      }
+      case LEN_HI:
+        segLen_ = (uint16_t)(data[i++] << 8);
+        state_ = LEN_LO;
+        break;
+      case LEN_LO:
+        segLen_ |= data[i++];
+        if (segLen_ < 2) return fail("bad segment length");
+        segLen_ -= 2;
+        segPos_ = 0;
+        state_ = SEGMENT;
+        if (!segLen_ && !endSegment()) return false;
+        break;
+      case SEGMENT:
+        if (marker_ == 0xDB || (marker_ >= 0xC0 && marker_ <= 0xC2)) {
+          if (!segmentByte(data[i++])) return false;
+          ++segPos_;
+        } else {
+          size_t take = segLen_ - segPos_;
+          if (take > n - i) take = n - i;
+          i += take;
+          segPos_ += (uint16_t)take;
+        }
+        if (segPos_ == segLen_ && !endSegment()) return false;
+        break;
+      case ENTROPY: {
+        const uint8_t* ff = (const uint8_t*)memchr(data + i, 0xFF, n - i);
+        size_t stop = ff ? (size_t)(ff - data) : n;
+        info_.scanBytes += (uint32_t)(stop - i);
+        i = stop;
+        if (ff) {
+          ++i;
+          state_ = ENTROPY_FF;
+        }
+        break;
+      }
+      case ENTROPY_FF: {
+        uint8_t m = data[i++];
+        if (m == 0x00 || (m >= 0xD0 && m <= 0xD7)) {
+          info_.scanBytes += 2;  // stuffed 0xFF or restart marker
+          state_ = ENTROPY;
+        } else if (m != 0xFF && !beginMarker(m)) {  // end of this scan
+          return false;
+        }
+        break;
+      }
+      case DONE:
+        info_.trailing += (uint32_t)(n - i);
+        i = n;
+        break;
+      case FAILED:
+        return false;
+    }
+  }
+  return state_ != FAILED;
+}
+
+bool JpegScanner::finish() {
+  if (state_ == FAILED) return false;
+  if (state_ == DONE) return true;
+  return fail(state_ == ENTROPY || state_ == ENTROPY_FF ? "truncated scan" : "truncated header");
+}
+
+bool scanJpeg(const uint8_t* data, size_t len, JpegInfo& info, const char** err) {
+  JpegScanner s;
+  bool ok = s.feed(data, len) && s.finish();
+  info = s.info();
+  if (err) *err = s.error();
+  return ok;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ====== JPEG pre-validation ======
+// Walks the marker structure of a JPEG as its bytes arrive, so a frame can
+// be checked while it is still coming over the camera link, before it costs
+// an upload and an inference: SOI first, well-formed segments, a supported
+// SOF before the scan, quantisation tables, entropy data and a closing EOI.
+// Nothing is decoded and nothing is allocated; the entropy-coded data is
+// only searched for markers (memchr for 0xFF), so the cost is a pass over
+// the bytes the CRC makes anyway.
+//
+// On the way it picks up what the headers say about the picture. quality
+// is the libjpeg quality (1..100) whose scaled standard luminance table
+// comes closest to the frame's table 0 in sum: the sensor's encoder scales
+// its own tables, so this is a scale to compare frames on (and to spot a
+// camera whose setting drifted), not its jpeg_quality register.
+
+struct JpegInfo {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint8_t components = 0;
+  bool progressive = false;
+  uint8_t quality = 0;      // 0 if there was no table 0
+  uint8_t scans = 0;
+  uint32_t scanBytes = 0;   // entropy-coded bytes, all scans
+  uint32_t trailing = 0;    // bytes after EOI (allowed, the driver pads)
+};
+
+class JpegScanner {
+ public:
+  JpegScanner() { reset(); }
+  void reset();
+
+  // Next bytes of the file. False once it is known to be bad; the rest may
+  // still be fed (and is ignored).
+  bool feed(const uint8_t* data, size_t n);
+  // After the last byte: true for a complete JPEG
+  bool finish();
+
+  bool failed() const { return state_ == FAILED; }
+  // Why it failed, or "" while all is well
+  const char* error() const { return err_; }
+  const JpegInfo& info() const { return info_; }
+
+ private:
+  enum State { SOI0, SOI1, MARKER, MARKER_ID, LEN_HI, LEN_LO, SEGMENT, ENTROPY, ENTROPY_FF, DONE, FAILED };
+
+  bool fail(const char* why);
+  bool beginMarker(uint8_t m);
+  bool segmentByte(uint8_t b);
+  bool endSegment();
+
+  State state_;
+  const char* err_;
+  JpegInfo info_;
+  uint8_t marker_;
+  uint16_t segLen_;      // payload bytes of the current segment
+  uint16_t segPos_;
+  uint8_t sof_[16];      // start of the SOF payload: precision, size, components
+  // DQT parsing: table header, entry byte count and luma table sum
+  uint8_t dqtHead_;
+  uint16_t dqtLeft_;
+  bool dqtHi_;
+  uint16_t dqtEntry_;
+  uint32_t lumaSum_;
+  bool haveLuma_;
+  bool sawSof_;
+  bool sawDqt_;
+};
+
+// One-shot check of a complete buffer
+bool scanJpeg(const uint8_t* data, size_t len, JpegInfo& info, const char** err = nullptr);
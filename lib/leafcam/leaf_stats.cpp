@@ -0,0 +1,72 @@
+#include "leaf_stats.h"
+
+#include <stdio.h>
+#include <string>
+
+bool leafStatsFromDc(const DcImage& img, LeafStats& out) {
+  out = LeafStats();
+  int bw = img.blocksW(), bh = img.blocksH();
+  if (!bw || !bh || img.plane[0].mean.empty()) return false;
+  uint64_t sum[3] = {0, 0, 0};
+  uint64_t pixels = 0;
+  for (int by = 0; by < bh; ++by) {
+    // Edge blocks only partly cover the picture
+    uint32_t rows = img.height - by * 8 < 8 ? img.height - by * 8 : 8;
+    for (int bx = 0; bx < bw; ++bx) {
+      uint32_t cols = img.width - bx * 8 < 8 ? img.width - bx * 8 : 8;
+      uint32_t n = rows * cols;
+      uint8_t r, g, b;
+      img.rgbAt(bx, by, r, g, b);
+      sum[0] += (uint64_t)r * n;
+      sum[1] += (uint64_t)g * n;
+      sum[2] += (uint64_t)b * n;
+      pixels += n;
+    }
+  }
+  out.red = (float)((double)sum[0] / pixels / 255.0);
+  out.green = (float)((double)sum[1] / pixels / 255.0);
+  out.blue = (float)((double)sum[2] / pixels / 255.0);
+  out.brightness = (out.red + out.green + out.blue) / 3;
+  out.chlorophyll = out.green - 0.5f * (out.red + out.blue);
+  out.dryness = out.red - out.green;
+  return true;
+}
+
+bool jpegLeafStats(const uint8_t* jpg, size_t len, LeafStats& out) {
+  DcImage img;
+  std::string err;
+  if (!decodeJpegDc(jpg, len, img, err)) return false;
+  return leafStatsFromDc(img, out);
+}
+
+LeafVerdict leafVerdict(const LeafStats& s) {
+  LeafVerdict v;
+  if (s.brightness < 0.2f) {
+    v.leaf = "Underexposed Leaf";
+  } else if (s.chlorophyll > 0.05f) {
+    v.leaf = "Healthy Leaf";
+  } else {
+    v.leaf = "Stressed Leaf";
+  }
+  if (s.dryness > 0.08f) {
+    v.disease = "Possible Leaf Scorch";
+    v.solution = "Increase watering and check for pests.";
+  } else if (s.green < 0.3f) {
+    v.disease = "Nutrient Deficiency Suspected";
+    v.solution = "Apply balanced fertilizer and monitor.";
+  } else {
+    v.disease = "No obvious disease";
+    v.solution = "Continue regular care.";
+  }
+  return v;
+}
+
+size_t formatLeafStats(const LeafStats& s, char* out, size_t n) {
+  if (!n) return 0;
+  int w = snprintf(out, n, "r=%.3f;g=%.3f;b=%.3f", s.red, s.green, s.blue);
+  if (w < 0) {
+    out[0] = '\0';
+    return 0;
+  }
+  return (size_t)w < n ? (size_t)w : n - 1;
+}
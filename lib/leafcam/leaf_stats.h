@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jpeg_dc.h"
+
+// ====== Colour statistics ======
+// The numbers behind the Pi's heuristic verdict (_heuristic_analysis in
+// pi5_server.py), taken from the DC image instead of a full decode: a
+// block's DC coefficient is the mean of its 64 samples, and the picture's
+// mean colour is the pixel-weighted mean of the block colours. All values
+// are 0..1 like the Pi's.
+
+struct LeafStats {
+  float red = 0;
+  float green = 0;
+  float blue = 0;
+  float brightness = 0;   // mean of the three channels
+  float chlorophyll = 0;  // green - (red + blue) / 2
+  float dryness = 0;      // red - green
+};
+
+// Same thresholds and wording as the Pi, so the hub's quick verdict is what
+// the Pi would say without its model.
+struct LeafVerdict {
+  const char* leaf;
+  const char* disease;
+  const char* solution;
+};
+
+// Mean colours need the chroma planes: decode with lumaOnly = false.
+bool leafStatsFromDc(const DcImage& img, LeafStats& out);
+bool jpegLeafStats(const uint8_t* jpg, size_t len, LeafStats& out);
+LeafVerdict leafVerdict(const LeafStats& s);
+
+// X-Leaf-Stats header value, "r=0.412;g=0.530;b=0.301"; the Pi derives the
+// rest. Returns the length written (truncated to n - 1).
+size_t formatLeafStats(const LeafStats& s, char* out, size_t n);
@@ -0,0 +1,232 @@
+#include "leaf_triage.h"
+
+#include <math.h>
+#include <string>
+
+// ---- LEAF_TRIAGE_MODEL ----
+// conv1 works on sample - 128; a colour excess comes out in sample levels.
+static const int8_t TRIAGE_CONV1_W[] = {
+  // 0: leaf mask: 4*(g-(r+b)/2-8), full at 40 levels
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, -1, 2, -1, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 1: red excess r-g
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 1, -1, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 2: brightness/2
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 1, 1, 1, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 3: not-leaf mask: 4*(16-(g-(r+b)/2)), full below -16
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 1, -2, 1, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 4: green detail +
+  0, 0, 0, 0, -1, 0, 0, 0, 0,
+  0, -1, 0, 0, 4, 0, 0, -1, 0,
+  0, 0, 0, 0, -1, 0, 0, 0, 0,
+  // 5: green detail -
+  0, 0, 0, 0, 1, 0, 0, 0, 0,
+  0, 1, 0, 0, -4, 0, 0, 1, 0,
+  0, 0, 0, 0, 1, 0, 0, 0, 0,
+  // 6: warm excess r-(g+b)/2
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 2, -1, -1, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 7: blue excess b-(r+g)/2
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, -1, -1, 2, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+static const int32_t TRIAGE_CONV1_BIAS[] = {-16, 0, 381, 32, 0, 0, 0, 0};
+static const int32_t TRIAGE_CONV1_MULT[] = {512, 256, 43, 512, 256, 256, 128, 128};
+static const int8_t TRIAGE_CONV2_W[] = {
+  // 0: leaf: mean9(mask) - 24
+  1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0,
+  1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0,
+  1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0,
+  // 1: lesion: red excess over 16 where all 8 neighbours are wholly leaf
+  1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0,
+  1, 0, 0, -2, 0, 0, 0, 0, 0, 8, 0, 0, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0,
+  1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0,
+  // 2: spot: warm excess over 16 where all 8 neighbours are wholly leaf
+  1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0,
+  1, 0, 0, -2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 0, 1, 0, 0, -2, 0, 0, 0, 0,
+  1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0, 1, 0, 0, -2, 0, 0, 0, 0,
+  // 3: dark: 127 - brightness/2
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 4: detail
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 5: bright
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 6: blue
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // 7: red, not leaf
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, -2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+static const int32_t TRIAGE_CONV2_BIAS[] = {-216, -1144, -1144, 127, 0, 0, 0, 0};
+static const int32_t TRIAGE_CONV2_MULT[] = {28, 32, 32, 256, 256, 256, 256, 256};
+
+// Features: mean of conv2 channels 0..7, then max of channels 0..7
+static const int8_t TRIAGE_DENSE_W[] = {
+  // no leaf: little leaf coverage
+  -8, 0, 0, 0, 0, 0, 0, 0,   0, 0, 0, 0, 0, 0, 0, 0,
+  // healthy: coverage, and no spot anywhere
+  5, 0, 0, 0, 0, 0, 0, 0,    0, -10, -10, 0, 0, 0, 0, 0,
+  // needs analysis: the worst spot
+  1, 0, 0, 0, 0, 0, 0, 0,    0, 6, 6, 0, 0, 0, 0, 0,
+};
+static const int32_t TRIAGE_DENSE_BIAS[] = {192, 0, 32};
+
+const TriageModel LEAF_TRIAGE_MODEL = {
+  {TRIAGE_CONV1_W, TRIAGE_CONV1_BIAS, TRIAGE_CONV1_MULT, 8},
+  {TRIAGE_CONV2_W, TRIAGE_CONV2_BIAS, TRIAGE_CONV2_MULT, 8},
+  TRIAGE_DENSE_W,
+  TRIAGE_DENSE_BIAS,
+  1.0f / 64,
+};
+
+const char* triageClassName(int c) {
+  switch (c) {
+    case TRIAGE_NO_LEAF: return "no_leaf";
+    case TRIAGE_HEALTHY: return "healthy";
+    default: return "analyse";
+  }
+}
+
+// 3x3 convolution over an h x w x cin map, ReLU and requantisation fused
+static void conv3x3(const int8_t* in, int h, int w, int cin, const TriageConv& l, int cout, int8_t* out) {
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      const int8_t* taps[9];
+      for (int ky = 0; ky < 3; ++ky) {
+        int yy = y + ky - 1;
+        yy = yy < 0 ? 0 : yy >= h ? h - 1 : yy;
+        for (int kx = 0; kx < 3; ++kx) {
+          int xx = x + kx - 1;
+          xx = xx < 0 ? 0 : xx >= w ? w - 1 : xx;
+          taps[ky * 3 + kx] = in + ((size_t)yy * w + xx) * cin;
+        }
+      }
+      int8_t* o = out + ((size_t)y * w + x) * cout;
+      for (int co = 0; co < cout; ++co) {
+        const int8_t* k = l.w + (size_t)co * 9 * cin;
+        int32_t acc = l.bias[co];
+        for (int t = 0; t < 9; ++t, k += cin) {
+          const int8_t* p = taps[t];
+          for (int ci = 0; ci < cin; ++ci) acc += (int32_t)p[ci] * k[ci];
+        }
+        int32_t v = (int32_t)(((int64_t)acc * l.mult[co]) >> l.shift);
+        o[co] = (int8_t)(v < 0 ? 0 : v > 127 ? 127 : v);
+      }
+    }
+  }
+}
+
+static void maxPool2(const int8_t* in, int h, int w, int c, int8_t* out) {
+  for (int y = 0; y < h / 2; ++y) {
+    for (int x = 0; x < w / 2; ++x) {
+      for (int ch = 0; ch < c; ++ch) {
+        int8_t m = in[((size_t)(2 * y) * w + 2 * x) * c + ch];
+        int8_t v;
+        if ((v = in[((size_t)(2 * y) * w + 2 * x + 1) * c + ch]) > m) m = v;
+        if ((v = in[((size_t)(2 * y + 1) * w + 2 * x) * c + ch]) > m) m = v;
+        if ((v = in[((size_t)(2 * y + 1) * w + 2 * x + 1) * c + ch]) > m) m = v;
+        out[((size_t)y * (w / 2) + x) * c + ch] = m;
+      }
+    }
+  }
+}
+
+bool LeafTriage::setInput(const DcImage& img) {
+  int bw = img.blocksW(), bh = img.blocksH();
+  if (!bw || !bh || img.plane[0].mean.empty()) return false;
+  for (int gy = 0; gy < TRIAGE_H; ++gy) {
+    int y0 = gy * bh / TRIAGE_H, y1 = (gy + 1) * bh / TRIAGE_H;
+    if (y1 <= y0) y1 = y0 + 1;
+    for (int gx = 0; gx < TRIAGE_W; ++gx) {
+      int x0 = gx * bw / TRIAGE_W, x1 = (gx + 1) * bw / TRIAGE_W;
+      if (x1 <= x0) x1 = x0 + 1;
+      uint32_t sum[3] = {0, 0, 0}, n = 0;
+      for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+          uint8_t r, g, b;
+          img.rgbAt(x, y, r, g, b);
+          sum[0] += r;
+          sum[1] += g;
+          sum[2] += b;
+          ++n;
+        }
+      }
+      int8_t* px = in_ + ((size_t)gy * TRIAGE_W + gx) * 3;
+      for (int c = 0; c < 3; ++c) px[c] = (int8_t)((int)(sum[c] / n) - 128);
+    }
+  }
+  return true;
+}
+
+TriageResult LeafTriage::run() {
+  const int h2 = TRIAGE_H / 2, w2 = TRIAGE_W / 2;
+  conv3x3(in_, TRIAGE_H, TRIAGE_W, 3, model_.conv1, TRIAGE_C1, a1_);
+  maxPool2(a1_, TRIAGE_H, TRIAGE_W, TRIAGE_C1, p1_);
+  conv3x3(p1_, h2, w2, TRIAGE_C1, model_.conv2, TRIAGE_C2, a2_);
+
+  int32_t feat[2 * TRIAGE_C2];
+  for (int c = 0; c < TRIAGE_C2; ++c) {
+    int32_t sum = 0, mx = 0;
+    for (int i = 0; i < h2 * w2; ++i) {
+      int8_t v = a2_[(size_t)i * TRIAGE_C2 + c];
+      sum += v;
+      if (v > mx) mx = v;
+    }
+    feat[c] = sum / (h2 * w2);
+    feat[TRIAGE_C2 + c] = mx;
+  }
+
+  TriageResult r;
+  float logit[TRIAGE_CLASSES], top = -1e30f;
+  for (int k = 0; k < TRIAGE_CLASSES; ++k) {
+    int32_t acc = model_.denseBias[k];
+    const int8_t* w = model_.dense + (size_t)k * 2 * TRIAGE_C2;
+    for (int i = 0; i < 2 * TRIAGE_C2; ++i) acc += w[i] * feat[i];
+    logit[k] = acc * model_.logitScale;
+    if (logit[k] > top) top = logit[k];
+  }
+  float total = 0;
+  for (int k = 0; k < TRIAGE_CLASSES; ++k) {
+    r.prob[k] = expf(logit[k] - top);
+    total += r.prob[k];
+  }
+  r.cls = 0;
+  for (int k = 0; k < TRIAGE_CLASSES; ++k) {
+    r.prob[k] /= total;
+    if (r.prob[k] > r.prob[r.cls]) r.cls = k;
+  }
+  r.confidence = r.prob[r.cls];
+  return r;
+}
+
+bool LeafTriage::classifyJpeg(const uint8_t* jpg, size_t len, TriageResult& out) {
+  DcImage img;
+  std::string err;
+  if (!decodeJpegDc(jpg, len, img, err) || !setInput(img)) return false;
+  out = run();
+  return true;
+}
+
+uint32_t LeafTriage::macs() {
+  return (uint32_t)TRIAGE_H * TRIAGE_W * TRIAGE_C1 * 9 * 3 +
+         (uint32_t)(TRIAGE_H / 2) * (TRIAGE_W / 2) * TRIAGE_C2 * 9 * TRIAGE_C1 +
+         (uint32_t)TRIAGE_CLASSES * 2 * TRIAGE_C2;
+}
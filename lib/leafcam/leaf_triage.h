@@ -0,0 +1,88 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jpeg_dc.h"
+
+// ====== Frame triage ======
+// A small int8 CNN that sorts a frame into "no leaf", "healthy" or "needs
+// analysis" from a TRIAGE_W x TRIAGE_H colour thumbnail of its DC image,
+// cheap enough for the ESP32-CAM: a camera built with CAM_TRIAGE answers a
+// 'Q' capture with just the verdict when it is confident the frame needs
+// no analysis, and with the full JPEG otherwise.
+//
+//   input  TRIAGE_H x TRIAGE_W x 3, int8 (sample - 128)
+//   conv1  3x3, 3 -> TRIAGE_C1, ReLU, 2x2 max pool
+//   conv2  3x3, TRIAGE_C1 -> TRIAGE_C2, ReLU
+//   pool   mean and max of every channel
+//   dense  2 * TRIAGE_C2 -> TRIAGE_CLASSES, softmax
+//
+// Activations are int8 (0..127 after ReLU); a conv output is
+// (acc * mult[c]) >> shift with a 32-bit accumulator, so one table of
+// per-channel multipliers replaces float rescaling. Borders repeat the edge
+// pixel. Buffers live in the LeafTriage object, nothing is allocated.
+//
+// LEAF_TRIAGE_MODEL holds hand-set weights: conv1 computes leaf and
+// not-leaf masks, colour excesses (red, warm, blue), brightness and green
+// detail; conv2 turns them into leaf coverage and into red or discoloured
+// spots whose every neighbour is leaf; the dense layer weighs coverage
+// against the worst spot. That is the Pi's colour heuristic plus a local lesion detector.
+// Trained weights of the same shape can replace it.
+
+static const int TRIAGE_W = 32;
+static const int TRIAGE_H = 24;
+static const int TRIAGE_C1 = 8;
+static const int TRIAGE_C2 = 8;
+static const int TRIAGE_CLASSES = 3;
+
+enum TriageClass {
+  TRIAGE_NO_LEAF = 0,
+  TRIAGE_HEALTHY = 1,
+  TRIAGE_ANALYSE = 2,  // diseased or unsure: send the frame in full
+};
+const char* triageClassName(int c);
+
+struct TriageConv {
+  const int8_t* w;       // [out][ky][kx][in]
+  const int32_t* bias;   // [out], in accumulator units
+  const int32_t* mult;   // [out]
+  uint8_t shift;
+};
+
+struct TriageModel {
+  TriageConv conv1;
+  TriageConv conv2;
+  const int8_t* dense;       // [class][mean c0.., max c0..]
+  const int32_t* denseBias;  // [class]
+  float logitScale;          // logit = accumulator * logitScale
+};
+
+extern const TriageModel LEAF_TRIAGE_MODEL;
+
+struct TriageResult {
+  int cls = TRIAGE_ANALYSE;
+  float confidence = 0;  // probability of cls
+  float prob[TRIAGE_CLASSES] = {0, 0, 0};
+};
+
+class LeafTriage {
+ public:
+  explicit LeafTriage(const TriageModel& model = LEAF_TRIAGE_MODEL) : model_(model) {}
+
+  // Box-averages the DC image's block colours into the input. Needs the
+  // chroma planes (decodeJpegDc with lumaOnly = false).
+  bool setInput(const DcImage& img);
+  TriageResult run();
+  // DC decode, setInput() and run() in one
+  bool classifyJpeg(const uint8_t* jpg, size_t len, TriageResult& out);
+
+  // Multiply-accumulates per run()
+  static uint32_t macs();
+
+ private:
+  const TriageModel& model_;
+  int8_t in_[TRIAGE_H * TRIAGE_W * 3];
+  int8_t a1_[TRIAGE_H * TRIAGE_W * TRIAGE_C1];
+  int8_t p1_[(TRIAGE_H / 2) * (TRIAGE_W / 2) * TRIAGE_C1];
+  int8_t a2_[(TRIAGE_H / 2) * (TRIAGE_W / 2) * TRIAGE_C2];
+};
@@ -0,0 +1,107 @@
+#include "log_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+LogRing::LogRing(size_t capacity, const char* const* formats, size_t formatCount)
+    : slots_(capacity ? capacity : 1), head_(0), formats_(formats), formatCount_(formatCount) {}
+
+void LogRing::log(uint32_t nowMs, uint16_t fmt, uint32_t a0, uint32_t a1, uint32_t a2,
+                  const char* text) {
+  uint32_t ticket = head_.fetch_add(1, std::memory_order_relaxed);
+  Slot& s = slots_[ticket % slots_.size()];
+  s.seq.store(2 * ticket + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.rec.ms = nowMs;
+  s.rec.fmt = fmt;
+  s.rec.args[0] = a0;
+  s.rec.args[1] = a1;
+  s.rec.args[2] = a2;
+  size_t i = 0;
+  if (text) {
+    for (; i + 1 < LOG_TEXT_MAX && text[i]; ++i) s.rec.text[i] = text[i];
+  }
+  s.rec.text[i] = 0;
+  s.seq.store(2 * ticket + 2, std::memory_order_release);
+}
+
+uint32_t LogRing::start() const {
+  uint32_t head = end();
+  return head > slots_.size() ? head - (uint32_t)slots_.size() : 0;
+}
+
+bool LogRing::read(uint32_t& cursor, LogRecord& out, uint32_t* missed) const {
+  for (;;) {
+    uint32_t head = end();
+    if (cursor == head) return false;
+    if (head - cursor > slots_.size()) {
+      uint32_t oldest = head - (uint32_t)slots_.size();
+      if (missed) *missed += oldest - cursor;
+      cursor = oldest;
+    }
+    const Slot& s = slots_[cursor % slots_.size()];
+    uint32_t want = 2 * cursor + 2;
+    uint32_t before = s.seq.load(std::memory_order_acquire);
+    if ((int32_t)(before - want) < 0) return false;  // still being written
+    if (before == want) {
+      out = s.rec;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s.seq.load(std::memory_order_relaxed) == want) {
+        ++cursor;
+        return true;
+      }
+    }
+    // Recycled by a newer record before or while it was copied
+    if (missed) ++*missed;
+    ++cursor;
+  }
+}
+
+size_t LogRing::format(const LogRecord& rec, char* buf, size_t n) const {
+  if (!n) return 0;
+  const char* f = rec.fmt < formatCount_ ? formats_[rec.fmt] : "?";
+  size_t len = 0;
+  size_t arg = 0;
+  char num[16];
+  while (*f && len + 1 < n) {
+    if (*f != '%') {
+      buf[len++] = *f++;
+      continue;
+    }
+    ++f;
+    bool zero = *f == '0';
+    int width = 0;
+    while (*f >= '0' && *f <= '9') width = width * 10 + (*f++ - '0');
+    while (*f == 'l') ++f;
+    const char* piece = num;
+    uint32_t v = arg < 3 ? rec.args[arg] : 0;
+    char conv = *f ? *f++ : 0;
+    switch (conv) {
+      case 'u': snprintf(num, sizeof(num), zero ? "%0*u" : "%*u", width, (unsigned)v); ++arg; break;
+      case 'd': snprintf(num, sizeof(num), zero ? "%0*d" : "%*d", width, (int)(int32_t)v); ++arg; break;
+      case 'x': snprintf(num, sizeof(num), zero ? "%0*x" : "%*x", width, (unsigned)v); ++arg; break;
+      case 's': piece = rec.text; break;
+      case '%': piece = "%"; break;
+      default: piece = "?"; break;
+    }
+    while (*piece && len + 1 < n) buf[len++] = *piece++;
+  }
+  buf[len] = 0;
+  return len;
+}
+
+std::string LogRing::dump() const {
+  std::string out;
+  uint32_t cursor = start();
+  uint32_t missed = 0;
+  LogRecord rec;
+  char line[160];
+  while (read(cursor, rec, &missed)) {
+    int h = snprintf(line, sizeof(line), "[%6u.%03u] ", (unsigned)(rec.ms / 1000),
+                     (unsigned)(rec.ms % 1000));
+    format(rec, line + h, sizeof(line) - h - 1);
+    out += line;
+    out += '\n';
+  }
+  return out;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// ====== Deferred binary log ======
+// Hot paths record a format id, up to three integers and an optional short
+// string into a RAM ring instead of printing. That is a handful of stores
+// and one atomic increment: no locks, no formatting, no waiting on a UART.
+// Text is produced later by whoever reads the ring (a low-priority task
+// copying to Serial, an HTTP handler), each with its own cursor.
+//
+// When the ring is full the oldest records are overwritten; readers notice
+// and count what they missed. Records are guarded by a per-slot sequence
+// number, so a reader never returns a half-written or recycled record.
+//
+// Formats are printf-like with conversions %u %d %x (optionally with a
+// zero-pad width, e.g. %08x) taking the integers in order, %s taking the
+// string and %%.
+
+static const size_t LOG_TEXT_MAX = 24;  // string argument, truncated
+
+struct LogRecord {
+  uint32_t ms = 0;  // millis() when recorded
+  uint16_t fmt = 0;
+  uint32_t args[3] = {0, 0, 0};
+  char text[LOG_TEXT_MAX] = {0};
+};
+
+class LogRing {
+ public:
+  // formats[fmt] is the format of records logged with that id.
+  LogRing(size_t capacity, const char* const* formats, size_t formatCount);
+
+  // Safe from any task.
+  void log(uint32_t nowMs, uint16_t fmt, uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0,
+           const char* text = nullptr);
+
+  // A reader's position; start() for everything still in the ring, end()
+  // for only what is logged from now on.
+  uint32_t start() const;
+  uint32_t end() const { return head_.load(std::memory_order_acquire); }
+
+  // Copies the record at cursor and advances it. False when there is
+  // nothing (complete) to read yet. Records overwritten before they could
+  // be read are skipped and added to *missed.
+  bool read(uint32_t& cursor, LogRecord& out, uint32_t* missed = nullptr) const;
+
+  // Text of a record, without timestamp or newline. Returns its length.
+  size_t format(const LogRecord& rec, char* buf, size_t n) const;
+  // Every record still in the ring, one "[seconds.millis] text" line each.
+  std::string dump() const;
+
+  size_t capacity() const { return slots_.size(); }
+  uint32_t written() const { return end(); }
+
+ private:
+  struct Slot {
+    std::atomic<uint32_t> seq;  // 2*ticket+1 while written, 2*ticket+2 when done
+    LogRecord rec;
+    Slot() : seq(0) {}
+  };
+
+  std::vector<Slot> slots_;
+  std::atomic<uint32_t> head_;
+  const char* const* formats_;
+  size_t formatCount_;
+};
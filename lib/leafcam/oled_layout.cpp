@@ -0,0 +1,83 @@
+#include "oled_layout.h"
+
+#include <string.h>
+
+OledTextLayout::OledTextLayout(uint8_t cols, uint8_t rows)
+    : cols_(cols > OLED_LAYOUT_MAX_COLS ? OLED_LAYOUT_MAX_COLS : cols),
+      rowCount_(rows > OLED_LAYOUT_MAX_ROWS ? OLED_LAYOUT_MAX_ROWS : rows) {
+  memset(wrapped_, 0, sizeof(wrapped_));
+  memset(shown_, 0, sizeof(shown_));
+  input_[0] = 0;
+}
+
+void OledTextLayout::invalidate() {
+  valid_ = false;
+  inputValid_ = false;
+}
+
+bool OledTextLayout::sameInput(const char* const* lines, size_t n) const {
+  if (!inputValid_) return false;
+  const char* p = input_;
+  for (size_t i = 0; i < n; ++i) {
+    size_t len = strlen(lines[i]);
+    if (strncmp(p, lines[i], len) != 0 || p[len] != '\n') return false;
+    p += len + 1;
+  }
+  return *p == 0;
+}
+
+void OledTextLayout::keepInput(const char* const* lines, size_t n) {
+  size_t used = 0;
+  for (size_t i = 0; i < n; ++i) {
+    size_t len = strlen(lines[i]);
+    if (used + len + 2 > sizeof(input_)) {
+      inputValid_ = false;  // too long to cache; lay it out every time
+      return;
+    }
+    memcpy(input_ + used, lines[i], len);
+    used += len;
+    input_[used++] = '\n';
+  }
+  input_[used] = 0;
+  inputValid_ = true;
+}
+
+uint8_t OledTextLayout::update(const char* const* lines, size_t n) {
+  if (valid_ && sameInput(lines, n)) return 0;
+  keepInput(lines, n);
+
+  memset(wrapped_, 0, sizeof(wrapped_));
+  uint8_t r = 0;
+  for (size_t i = 0; i < n && r < OLED_LAYOUT_MAX_WRAPPED; ++i) {
+    const char* p = lines[i];
+    size_t len = strlen(p);
+    for (size_t pos = 0; pos < len && r < OLED_LAYOUT_MAX_WRAPPED; pos += cols_) {
+      size_t take = len - pos < cols_ ? len - pos : cols_;
+      memcpy(wrapped_[r++], p + pos, take);
+    }
+  }
+  wrappedCount_ = r;
+  offset_ = 0;
+  return showWindow();
+}
+
+uint8_t OledTextLayout::scroll() {
+  if (!valid_ || !scrollable()) return 0;
+  offset_ = atEnd() ? 0 : offset_ + 1;
+  return showWindow();
+}
+
+// Copies the window into shown_, returning the rows that changed
+uint8_t OledTextLayout::showWindow() {
+  uint8_t dirty = 0;
+  for (uint8_t i = 0; i < rowCount_; ++i) {
+    uint8_t w = offset_ + i;
+    const char* next = w < OLED_LAYOUT_MAX_WRAPPED ? wrapped_[w] : "";
+    if (!valid_ || strcmp(next, shown_[i]) != 0) {
+      dirty |= (uint8_t)(1u << i);
+      strcpy(shown_[i], next);
+    }
+  }
+  valid_ = true;
+  return dirty;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ====== OLED text layout ======
+// The hub shows up to three messages on a 6x8-pixel text grid, hard-wrapped
+// at the display width. Every text row is exactly one 8-pixel controller
+// page, so comparing rows with what is on screen tells which pages have to
+// be redrawn and sent over I2C. Identical input is recognised before any
+// wrapping is done.
+//
+// Text that wraps to more rows than fit is kept in full; the visible
+// window is moved one row at a time with scroll(), which again reports
+// only the rows whose text changed.
+
+static const uint8_t OLED_LAYOUT_MAX_ROWS = 8;      // visible rows (pages)
+static const uint8_t OLED_LAYOUT_MAX_COLS = 32;
+static const uint8_t OLED_LAYOUT_MAX_WRAPPED = 24;  // rows kept for scrolling
+static const size_t OLED_LAYOUT_INPUT_MAX = 384;    // cached input, bytes
+
+class OledTextLayout {
+ public:
+  OledTextLayout(uint8_t cols, uint8_t rows);
+
+  // Lays out lines[0..n) (empty ones are skipped) with the window at the
+  // top. Returns a bit per visible row whose text differs from what was
+  // shown before; 0 if the input is unchanged (the window stays put).
+  uint8_t update(const char* const* lines, size_t n);
+  // Moves the window down one row, or back to the top after the last one.
+  // Returns the changed visible rows; 0 if everything fits.
+  uint8_t scroll();
+  // Forgets what is shown, so the next update() marks every row.
+  void invalidate();
+
+  const char* row(uint8_t r) const { return shown_[r]; }  // visible row r
+  uint8_t rows() const { return rowCount_; }
+  uint8_t cols() const { return cols_; }
+  uint8_t wrapped() const { return wrappedCount_; }  // rows of laid-out text
+  uint8_t offset() const { return offset_; }         // first visible wrapped row
+  bool scrollable() const { return wrappedCount_ > rowCount_; }
+  bool atEnd() const { return offset_ + rowCount_ >= wrappedCount_; }
+
+ private:
+  bool sameInput(const char* const* lines, size_t n) const;
+  void keepInput(const char* const* lines, size_t n);
+  uint8_t showWindow();
+
+  uint8_t cols_;
+  uint8_t rowCount_;
+  uint8_t wrappedCount_ = 0;
+  uint8_t offset_ = 0;
+  char wrapped_[OLED_LAYOUT_MAX_WRAPPED][OLED_LAYOUT_MAX_COLS + 1];
+  char shown_[OLED_LAYOUT_MAX_ROWS][OLED_LAYOUT_MAX_COLS + 1];
+  char input_[OLED_LAYOUT_INPUT_MAX];  // lines joined by '\n', for sameInput()
+  bool inputValid_ = false;
+  bool valid_ = false;
+};
@@ -0,0 +1,62 @@
+#include "phash.h"
+
+#include <string>
+
+// Box-average the luma block grid down to gw x gh cells.
+static void downscaleLuma(const DcImage& img, int gw, int gh, uint32_t* cells) {
+  int bw = img.blocksW(), bh = img.blocksH();
+  for (int gy = 0; gy < gh; ++gy) {
+    int y0 = gy * bh / gh, y1 = (gy + 1) * bh / gh;
+    if (y1 <= y0) y1 = y0 + 1;
+    for (int gx = 0; gx < gw; ++gx) {
+      int x0 = gx * bw / gw, x1 = (gx + 1) * bw / gw;
+      if (x1 <= x0) x1 = x0 + 1;
+      uint32_t sum = 0, n = 0;
+      for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+          sum += img.at(0, x, y);
+          ++n;
+        }
+      }
+      // x256 keeps precision for the comparisons below
+      cells[gy * gw + gx] = (sum << 8) / n;
+    }
+  }
+}
+
+uint64_t averageHash(const DcImage& img) {
+  uint32_t cells[64];
+  downscaleLuma(img, 8, 8, cells);
+  uint64_t sum = 0;
+  for (int i = 0; i < 64; ++i) sum += cells[i];
+  uint32_t mean = (uint32_t)(sum / 64);
+  uint64_t h = 0;
+  for (int i = 0; i < 64; ++i) {
+    if (cells[i] > mean) h |= 1ULL << i;
+  }
+  return h;
+}
+
+uint64_t differenceHash(const DcImage& img) {
+  uint32_t cells[72];
+  downscaleLuma(img, 9, 8, cells);
+  uint64_t h = 0;
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 8; ++x) {
+      if (cells[y * 9 + x + 1] > cells[y * 9 + x]) h |= 1ULL << (y * 8 + x);
+    }
+  }
+  return h;
+}
+
+int hammingDistance64(uint64_t a, uint64_t b) {
+  return __builtin_popcountll(a ^ b);
+}
+
+bool jpegFingerprint(const uint8_t* jpg, size_t len, uint64_t& out) {
+  DcImage img;
+  std::string err;
+  if (!decodeJpegDc(jpg, len, img, err, true)) return false;
+  out = differenceHash(img);
+  return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jpeg_dc.h"
+
+// ====== Perceptual fingerprints ======
+// 64-bit hashes of the luma DC image: small changes in exposure, noise or JPEG
+// quantisation flip few bits, a different scene flips many. Compare with
+// hammingDistance64(); 0 means "looks identical".
+
+// 8x8 box-averaged luma, each bit set when the cell is above the mean.
+uint64_t averageHash(const DcImage& img);
+// 9x8 box-averaged luma, each bit set when a cell is brighter than its left
+// neighbour. Insensitive to global brightness shifts; the default fingerprint.
+uint64_t differenceHash(const DcImage& img);
+
+int hammingDistance64(uint64_t a, uint64_t b);
+
+// Decodes the luma DC image of a JPEG and returns its difference hash.
+bool jpegFingerprint(const uint8_t* jpg, size_t len, uint64_t& out);
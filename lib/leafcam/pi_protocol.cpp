@@ -0,0 +1,55 @@
+#include "pi_protocol.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void formatCaptureId(uint32_t id, char out[9]) {
+  snprintf(out, 9, "%08x", (unsigned)id);
+}
+
+void piUploadHeaders(const PiFrameMeta* frames, size_t n, PiHeaderList& out) {
+  char id[9];
+  if (n == 1 && frames[0].captureId) {
+    formatCaptureId(frames[0].captureId, id);
+    out.push_back(std::make_pair("X-Capture-Id", std::string(id)));
+    out.push_back(std::make_pair("X-Cam-Ms", std::to_string(frames[0].camMs)));
+    out.push_back(std::make_pair("X-Link-Ms", std::to_string(frames[0].linkMs)));
+  } else if (n > 1) {
+    std::string ids;
+    for (size_t i = 0; i < n; ++i) {
+      if (i) ids += ',';
+      formatCaptureId(frames[i].captureId, id);
+      ids += id;
+    }
+    out.push_back(std::make_pair("X-Capture-Ids", ids));
+  }
+  // Colour statistics per frame in body order, empty for a frame without
+  std::string stats;
+  bool anyStats = false;
+  for (size_t i = 0; i < n; ++i) {
+    if (i) stats += ',';
+    if (frames[i].stats) {
+      char s[48];
+      formatLeafStats(*frames[i].stats, s, sizeof(s));
+      stats += s;
+      anyStats = true;
+    }
+  }
+  if (anyStats) out.push_back(std::make_pair("X-Leaf-Stats", stats));
+}
+
+bool piResultIsNew(const PiResultWait& w, const char* captureId, const char* timestamp) {
+  if (!w.waiting) {
+    return *timestamp && strcmp(timestamp, w.displayedTimestamp) != 0;
+  }
+  if (w.pendingCaptureId && *captureId) {
+    char id[9];
+    formatCaptureId(w.pendingCaptureId, id);
+    return strcmp(captureId, id) == 0;
+  }
+  if (*w.pendingTimestamp) {
+    return strcmp(timestamp, w.pendingTimestamp) == 0 &&
+           (!w.displayed || strcmp(timestamp, w.displayedTimestamp) != 0);
+  }
+  return !w.displayed;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "leaf_stats.h"
+
+// ====== Hub <-> Pi upload protocol ======
+// What the hub puts next to a POST /upload or /upload_batch body, and how
+// it decides whether a GET /result answer is the result it is waiting for.
+// Kept free of Arduino types so the host fleet simulator (fleet-sim) speaks
+// exactly what the hub speaks.
+
+// One frame of a request body, in body order
+struct PiFrameMeta {
+  uint32_t captureId = 0;        // 0: none
+  uint32_t camMs = 0;            // camera time, command to first byte
+  uint32_t linkMs = 0;           // trigger to CRC-verified frame
+  const LeafStats* stats = nullptr;  // X-Leaf-Stats entry, if computed
+};
+
+typedef std::vector<std::pair<std::string, std::string> > PiHeaderList;
+
+// "%08x", as the Pi echoes it in "capture_id"
+void formatCaptureId(uint32_t id, char out[9]);
+
+// Appends the headers for frames[0..n) (not Content-Type): one frame sends
+// X-Capture-Id with its hop times, several send X-Capture-Ids; X-Leaf-Stats
+// goes along when any frame has statistics.
+void piUploadHeaders(const PiFrameMeta* frames, size_t n, PiHeaderList& out);
+
+// The hub's result wait, borrowed for one decision. Timestamps are the
+// Pi's "timestamp" strings ("" when unknown).
+struct PiResultWait {
+  bool waiting = false;            // an upload's result has not been shown
+  uint32_t pendingCaptureId = 0;   // that upload's capture ID, 0 if none
+  const char* pendingTimestamp = "";
+  bool displayed = false;          // a result for it is already shown
+  const char* displayedTimestamp = "";
+};
+
+// Whether a /result answer with these fields should be shown. A capture ID
+// match is exact; without IDs the one-second timestamps have to do.
+bool piResultIsNew(const PiResultWait& w, const char* captureId, const char* timestamp);
@@ -0,0 +1,57 @@
+#include "result_cache.h"
+
+uint64_t fnv1a64(const uint8_t* data, size_t n) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= data[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+FrameKey makeFrameKey(const uint8_t* data, size_t len, uint16_t crc) {
+  FrameKey k;
+  k.len = (uint32_t)len;
+  k.crc = crc;
+  k.hash = fnv1a64(data, len);
+  return k;
+}
+
+ResultCache::ResultCache(size_t capacity) : entries_(capacity) {}
+
+const CachedResult* ResultCache::lookup(const FrameKey& key) {
+  if (!key.empty()) {
+    for (auto& e : entries_) {
+      if (!e.key.empty() && e.key == key) {
+        e.lastUse = ++tick_;
+        ++hits_;
+        return &e.result;
+      }
+    }
+  }
+  ++misses_;
+  return nullptr;
+}
+
+void ResultCache::store(const FrameKey& key, const CachedResult& result) {
+  if (key.empty() || entries_.empty()) return;
+  Entry* slot = nullptr;
+  for (auto& e : entries_) {
+    if (e.key == key) { slot = &e; break; }
+    if (!slot || e.key.empty() || (!slot->key.empty() && e.lastUse < slot->lastUse)) slot = &e;
+  }
+  slot->key = key;
+  slot->result = result;
+  slot->lastUse = ++tick_;
+}
+
+void ResultCache::clear() {
+  for (auto& e : entries_) e = Entry();
+  tick_ = 0;
+}
+
+size_t ResultCache::size() const {
+  size_t n = 0;
+  for (auto& e : entries_) n += e.key.empty() ? 0 : 1;
+  return n;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Identity of a frame: length and link CRC16 are free (the hub already has
+// them), the 64-bit FNV-1a guards against CRC16 collisions.
+struct FrameKey {
+  uint32_t len = 0;
+  uint16_t crc = 0;
+  uint64_t hash = 0;
+
+  bool operator==(const FrameKey& o) const { return len == o.len && crc == o.crc && hash == o.hash; }
+  bool operator!=(const FrameKey& o) const { return !(*this == o); }
+  bool empty() const { return len == 0; }
+};
+
+uint64_t fnv1a64(const uint8_t* data, size_t n);
+FrameKey makeFrameKey(const uint8_t* data, size_t len, uint16_t crc);
+
+struct CachedResult {
+  std::string leaf;
+  std::string disease;
+  std::string solution;
+  std::string timestamp;
+};
+
+// Small LRU of recent Pi results. Capacity is a handful of entries, so a
+// linear scan beats any hashed structure and never allocates on lookup.
+class ResultCache {
+ public:
+  explicit ResultCache(size_t capacity);
+
+  // Returns the cached result and marks it most recently used, or nullptr.
+  // Counts a hit or a miss.
+  const CachedResult* lookup(const FrameKey& key);
+  void store(const FrameKey& key, const CachedResult& result);
+  void clear();
+
+  uint32_t hits() const { return hits_; }
+  uint32_t misses() const { return misses_; }
+  size_t size() const;
+  size_t capacity() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    FrameKey key;
+    CachedResult result;
+    uint32_t lastUse = 0;
+  };
+  std::vector<Entry> entries_;
+  uint32_t tick_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+};
@@ -0,0 +1,171 @@
+#include "stage_metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const uint32_t LatencyHistogram::BOUNDS_US[LatencyHistogram::BUCKETS] = {
+  1000, 2500, 5000, 10000, 25000, 50000, 100000,
+  250000, 500000, 1000000, 2500000, 5000000, 10000000,
+};
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+  "trigger", "header_found", "body_complete", "crc_verified",
+  "upload_connect", "upload_sent", "response_received", "result_displayed",
+};
+
+const char* traceStageName(TraceStage stage) {
+  return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
+
+void LatencyHistogram::observe(uint32_t us) {
+  size_t i = 0;
+  while (i < BUCKETS && us > BOUNDS_US[i]) ++i;
+  ++counts_[i];
+  ++count_;
+  sumUs_ += us;
+}
+
+void StageMetrics::begin(uint32_t nowUs) {
+  std::lock_guard<std::mutex> g(lock_);
+  open_ = true;
+  startUs_ = lastUs_ = nowUs;
+  for (size_t i = 0; i < STAGE_COUNT; ++i) current_[i] = NOT_REACHED;
+  current_[STAGE_TRIGGER] = 0;
+  ++traces_;
+}
+
+void StageMetrics::mark(TraceStage stage, uint32_t nowUs) {
+  std::lock_guard<std::mutex> g(lock_);
+  if (!open_ || stage <= STAGE_TRIGGER || stage >= STAGE_COUNT || current_[stage] != NOT_REACHED) {
+    return;
+  }
+  stages_[stage].observe(nowUs - lastUs_);
+  current_[stage] = nowUs - startUs_;
+  lastUs_ = nowUs;
+  if (stage == STAGE_RESULT_DISPLAYED) {
+    total_.observe(nowUs - startUs_);
+    memcpy(lastTrace_, current_, sizeof(lastTrace_));
+    haveLastTrace_ = true;
+    ++completed_;
+    open_ = false;
+  }
+}
+
+void StageMetrics::abort() {
+  std::lock_guard<std::mutex> g(lock_);
+  open_ = false;
+}
+
+bool StageMetrics::tracing() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return open_;
+}
+
+void StageMetrics::countError(const char* err) {
+  if (!err || !*err) return;
+  std::lock_guard<std::mutex> g(lock_);
+  for (size_t i = 0; i < errors_.size(); ++i) {
+    if (errors_[i].first == err) {
+      ++errors_[i].second;
+      return;
+    }
+  }
+  if (errors_.size() < STAGE_MAX_ERRORS) {
+    errors_.push_back(std::make_pair(std::string(err), 1u));
+  } else {
+    ++otherErrors_;
+  }
+}
+
+// Label values may contain any byte; escape what the text format requires
+static void appendLabelValue(std::string& out, const std::string& v) {
+  for (size_t i = 0; i < v.size(); ++i) {
+    char c = v[i];
+    if (c == '\\' || c == '"') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+}
+
+void appendLatencyHistogram(std::string& out, const char* name, const char* labels,
+                            const LatencyHistogram& h) {
+  char line[160];
+  const char* sep = *labels ? "," : "";
+  uint32_t cumulative = 0;
+  for (size_t b = 0; b <= LatencyHistogram::BUCKETS; ++b) {
+    cumulative += h.bucket(b);
+    if (b < LatencyHistogram::BUCKETS) {
+      snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%g\"} %u\n", name, labels, sep,
+               LatencyHistogram::BOUNDS_US[b] / 1e6, (unsigned)cumulative);
+    } else {
+      snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, sep,
+               (unsigned)cumulative);
+    }
+    out += line;
+  }
+  const char* open = *labels ? "{" : "";
+  const char* close = *labels ? "}" : "";
+  snprintf(line, sizeof(line), "%s_sum%s%s%s %.6f\n%s_count%s%s%s %u\n",
+           name, open, labels, close, h.sumUs() / 1e6,
+           name, open, labels, close, (unsigned)h.count());
+  out += line;
+}
+
+std::string StageMetrics::render(const char* prefix) const {
+  std::lock_guard<std::mutex> g(lock_);
+  std::string out;
+  out.reserve(6144);
+  char name[64];
+  char line[160];
+
+  snprintf(name, sizeof(name), "%s_stage_seconds", prefix);
+  out += "# HELP "; out += name; out += " Time from the previous tracepoint to this one.\n";
+  out += "# TYPE "; out += name; out += " histogram\n";
+  for (size_t s = STAGE_TRIGGER + 1; s < STAGE_COUNT; ++s) {
+    char labels[48];
+    snprintf(labels, sizeof(labels), "stage=\"%s\"", STAGE_NAMES[s]);
+    appendLatencyHistogram(out, name, labels, stages_[s]);
+  }
+
+  snprintf(name, sizeof(name), "%s_end_to_end_seconds", prefix);
+  out += "# HELP "; out += name; out += " Trigger to result displayed.\n";
+  out += "# TYPE "; out += name; out += " histogram\n";
+  appendLatencyHistogram(out, name, "", total_);
+
+  snprintf(name, sizeof(name), "%s_last_trace_seconds", prefix);
+  out += "# HELP "; out += name; out += " Tracepoints of the last completed trace, from the trigger.\n";
+  out += "# TYPE "; out += name; out += " gauge\n";
+  if (haveLastTrace_) {
+    for (size_t s = 0; s < STAGE_COUNT; ++s) {
+      if (lastTrace_[s] == NOT_REACHED) continue;
+      snprintf(line, sizeof(line), "%s{stage=\"%s\"} %.6f\n", name, STAGE_NAMES[s], lastTrace_[s] / 1e6);
+      out += line;
+    }
+  }
+
+  snprintf(line, sizeof(line),
+           "# TYPE %s_traces_total counter\n%s_traces_total %u\n"
+           "# TYPE %s_traces_completed_total counter\n%s_traces_completed_total %u\n",
+           prefix, prefix, (unsigned)traces_, prefix, prefix, (unsigned)completed_);
+  out += line;
+
+  snprintf(name, sizeof(name), "%s_errors_total", prefix);
+  out += "# TYPE "; out += name; out += " counter\n";
+  for (size_t i = 0; i < errors_.size(); ++i) {
+    out += name;
+    out += "{error=\"";
+    appendLabelValue(out, errors_[i].first);
+    snprintf(line, sizeof(line), "\"} %u\n", (unsigned)errors_[i].second);
+    out += line;
+  }
+  if (otherErrors_) {
+    snprintf(line, sizeof(line), "%s{error=\"other\"} %u\n", name, (unsigned)otherErrors_);
+    out += line;
+  }
+  return out;
+}
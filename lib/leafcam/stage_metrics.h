@@ -0,0 +1,91 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ====== Per-stage latency metrics ======
+// One trace follows a frame from the capture trigger to the result on the
+// OLED. Each tracepoint records the time since the previous one into a
+// fixed-bucket histogram for its stage; the trace as a whole goes into an
+// end-to-end histogram. Stages a frame skips (a cached result never
+// uploads) are simply absent from that trace. Error strings are counted
+// as they are, up to STAGE_MAX_ERRORS distinct ones.
+//
+// Recording is a few additions under a mutex, so the capture task can call
+// it freely while the web task renders /metrics.
+
+enum TraceStage {
+  STAGE_TRIGGER = 0,
+  STAGE_HEADER_FOUND,
+  STAGE_BODY_COMPLETE,
+  STAGE_CRC_VERIFIED,
+  STAGE_UPLOAD_CONNECT,
+  STAGE_UPLOAD_SENT,
+  STAGE_RESPONSE_RECEIVED,
+  STAGE_RESULT_DISPLAYED,
+  STAGE_COUNT
+};
+
+const char* traceStageName(TraceStage stage);
+
+static const size_t STAGE_MAX_ERRORS = 16;
+
+// Latency histogram with fixed bounds from 1 ms to 10 s
+class LatencyHistogram {
+ public:
+  static const size_t BUCKETS = 13;  // plus +Inf
+  static const uint32_t BOUNDS_US[BUCKETS];
+
+  void observe(uint32_t us);
+  uint32_t count() const { return count_; }
+  uint64_t sumUs() const { return sumUs_; }
+  uint32_t bucket(size_t i) const { return counts_[i]; }  // not cumulative; i == BUCKETS is +Inf
+
+ private:
+  uint32_t counts_[BUCKETS + 1] = {0};
+  uint32_t count_ = 0;
+  uint64_t sumUs_ = 0;
+};
+
+// Appends h in Prometheus text format as metric name; labels is empty or
+// a label list without braces (stage="x"). The HELP/TYPE lines are the
+// caller's.
+void appendLatencyHistogram(std::string& out, const char* name, const char* labels,
+                            const LatencyHistogram& h);
+
+class StageMetrics {
+ public:
+  // Starts a trace at the trigger. An unfinished previous trace is dropped.
+  void begin(uint32_t nowUs);
+  // Records a tracepoint of the open trace; ignored without one and for a
+  // stage the trace already passed. STAGE_RESULT_DISPLAYED ends the trace.
+  void mark(TraceStage stage, uint32_t nowUs);
+  // Ends the open trace without a result (capture or upload failed).
+  void abort();
+  bool tracing() const;
+
+  void countError(const char* err);
+
+  // Prometheus text exposition, every metric name starting with prefix
+  std::string render(const char* prefix) const;
+
+ private:
+  static const uint32_t NOT_REACHED = 0xFFFFFFFFu;
+
+  mutable std::mutex lock_;
+  bool open_ = false;
+  uint32_t startUs_ = 0;
+  uint32_t lastUs_ = 0;
+  uint32_t current_[STAGE_COUNT];   // offsets from the trigger, open trace
+  uint32_t lastTrace_[STAGE_COUNT]; // same, last finished trace
+  bool haveLastTrace_ = false;
+  LatencyHistogram stages_[STAGE_COUNT];
+  LatencyHistogram total_;
+  uint32_t traces_ = 0;
+  uint32_t completed_ = 0;
+  std::vector<std::pair<std::string, uint32_t> > errors_;
+  uint32_t otherErrors_ = 0;
+};
@@ -0,0 +1,116 @@
+#include "uart_frame.h"
+
+#include <string.h>
+
+#include "crc16.h"
+
+static bool knownType(uint8_t t) {
+  return t == FRAME_TYPE_STILL || t == FRAME_TYPE_PREVIEW || t == FRAME_TYPE_ERROR ||
+         t == FRAME_TYPE_TRACED || t == FRAME_TYPE_ADDRESSED || t == FRAME_TYPE_VERDICT;
+}
+
+static size_t headerLen(uint8_t t) {
+  if (t == FRAME_TYPE_TRACED || t == FRAME_TYPE_VERDICT) return 6 + FRAME_TRACE_EXT_LEN;
+  if (t == FRAME_TYPE_ADDRESSED) return 6 + FRAME_ADDR_EXT_LEN;
+  return 6;
+}
+
+size_t encodeFrameHeader(uint8_t type, uint32_t len, uint16_t crc, uint32_t captureId,
+                         uint16_t camMs, uint8_t address, uint8_t* out) {
+  const uint8_t head[FRAME_HEADER_MAX] = {
+    'P', 'V', 'I', type,
+    (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len,
+    (uint8_t)(crc >> 8), (uint8_t)crc,
+    (uint8_t)(captureId >> 24), (uint8_t)(captureId >> 16), (uint8_t)(captureId >> 8),
+    (uint8_t)captureId, (uint8_t)(camMs >> 8), (uint8_t)camMs, address};
+  size_t n = 4 + headerLen(type);
+  memcpy(out, head, n);
+  return n;
+}
+
+void UartFrameReader::reset() {
+  state_ = HUNT;
+  memset(window_, 0, sizeof(window_));
+  got_ = 0;
+  payload_.reset();
+}
+
+std::shared_ptr<std::vector<uint8_t> > UartFrameReader::take() {
+  std::shared_ptr<std::vector<uint8_t> > p = payload_;
+  payload_.reset();
+  return p;
+}
+
+UartFrameReader::Event UartFrameReader::feed(const uint8_t* data, size_t n, size_t& consumed) {
+  size_t i = 0;
+  while (i < n) {
+    if (state_ == HUNT) {
+      window_[0] = window_[1];
+      window_[1] = window_[2];
+      window_[2] = window_[3];
+      window_[3] = data[i++];
+      if (window_[0] == 'P' && window_[1] == 'V' && window_[2] == 'I' && knownType(window_[3])) {
+        type_ = window_[3];
+        state_ = HEADER;
+        got_ = 0;
+      }
+    } else if (state_ == HEADER) {
+      header_[got_++] = data[i++];
+      if (got_ < headerLen(type_)) continue;
+      len_ = (uint32_t)header_[0] << 24 | (uint32_t)header_[1] << 16 | (uint32_t)header_[2] << 8 | header_[3];
+      crc_ = (uint16_t)(header_[4] << 8 | header_[5]);
+      if (type_ == FRAME_TYPE_TRACED || type_ == FRAME_TYPE_VERDICT || type_ == FRAME_TYPE_ADDRESSED) {
+        captureId_ = (uint32_t)header_[6] << 24 | (uint32_t)header_[7] << 16 |
+                     (uint32_t)header_[8] << 8 | header_[9];
+        camMs_ = (uint16_t)(header_[10] << 8 | header_[11]);
+      } else {
+        captureId_ = 0;
+        camMs_ = 0;
+      }
+      address_ = type_ == FRAME_TYPE_ADDRESSED ? header_[12] : 0;
+      memset(window_, 0, sizeof(window_));
+      if (type_ == FRAME_TYPE_ERROR || (type_ == FRAME_TYPE_ADDRESSED && len_ == 0)) {
+        state_ = HUNT;
+        payload_.reset();
+        consumed = i;
+        return FRAME;
+      }
+      if (len_ == 0 || len_ > maxLen_) {
+        state_ = HUNT;
+        ++framesBad_;
+        consumed = i;
+        return TOO_LARGE;
+      }
+      payload_ = std::make_shared<std::vector<uint8_t> >(len_);
+      got_ = 0;
+      calc_ = 0xFFFF;
+      jpeg_.reset();
+      state_ = BODY;
+    } else {
+      size_t take = len_ - got_;
+      if (take > n - i) take = n - i;
+      memcpy(payload_->data() + got_, data + i, take);
+      calc_ = crc16Update(calc_, data + i, take);  // spread over the transfer
+      if (checkJpeg_ && type_ != FRAME_TYPE_VERDICT) jpeg_.feed(data + i, take);
+      got_ += take;
+      i += take;
+      if (got_ < len_) continue;
+      state_ = HUNT;
+      consumed = i;
+      if (calc_ != crc_) {
+        payload_.reset();
+        ++framesBad_;
+        return BAD_CRC;
+      }
+      if (checkJpeg_ && type_ != FRAME_TYPE_VERDICT && !jpeg_.finish()) {
+        payload_.reset();
+        ++framesBad_;
+        return BAD_JPEG;
+      }
+      ++framesOk_;
+      return FRAME;
+    }
+  }
+  consumed = i;
+  return NONE;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "jpeg_scan.h"
+
+// ====== Camera link frames ======
+// Everything the camera sends on the UART link is framed as
+//   'P''V''I'<type> + 4-byte BE length + 2-byte BE CRC16 + payload
+// with type 'C' (still), 'S' (preview stream frame) or 'E' (error, no
+// payload). A 'T' frame is a still taken for command 'T' + 4-byte capture
+// ID; its header carries a FRAME_TRACE_EXT_LEN extension before the payload:
+//   4-byte BE capture ID + 2-byte BE camera milliseconds (command to send)
+// Cameras sharing an RS-485 bus answer with 'A' frames instead, whose
+// extension adds the camera's 1-byte bus address; an 'A' frame without
+// payload is that camera's error.
+// A camera built with CAM_TRIAGE answers command 'Q' + 4-byte capture ID
+// like 'T', or, when its triage model is confident the frame needs no
+// analysis, with a 'V' frame: trace extension as for 'T' and a
+// FRAME_VERDICT_LEN payload of class (TriageClass), confidence * 255 and
+// 2-byte BE triage milliseconds.
+// UartFrameReader parses that incrementally from whatever bytes
+// happen to be available, so a caller can service the link from a loop
+// without blocking. It resynchronises on the magic after garbage, overruns
+// or a bad CRC. With checkJpeg the payload also goes through a JpegScanner
+// as it arrives, and a frame that is not a complete JPEG is dropped like
+// one with a bad CRC ('V' frames are not checked).
+static const uint8_t FRAME_TYPE_STILL = 'C';
+static const uint8_t FRAME_TYPE_PREVIEW = 'S';
+static const uint8_t FRAME_TYPE_ERROR = 'E';
+static const uint8_t FRAME_TYPE_TRACED = 'T';
+static const uint8_t FRAME_TYPE_ADDRESSED = 'A';
+static const uint8_t FRAME_TYPE_VERDICT = 'V';
+static const size_t FRAME_HEADER_LEN = 10;
+static const size_t FRAME_TRACE_EXT_LEN = 6;
+static const size_t FRAME_ADDR_EXT_LEN = 7;
+static const size_t FRAME_VERDICT_LEN = 4;
+static const size_t FRAME_HEADER_MAX = FRAME_HEADER_LEN + FRAME_ADDR_EXT_LEN;
+
+// Header of a frame as the camera writes it, into out (FRAME_HEADER_MAX
+// bytes). captureId and camMs go into 'T', 'V' and 'A' headers, address into 'A'
+// ones. Returns the header length; the payload follows it.
+size_t encodeFrameHeader(uint8_t type, uint32_t len, uint16_t crc, uint32_t captureId,
+                         uint16_t camMs, uint8_t address, uint8_t* out);
+
+class UartFrameReader {
+ public:
+  enum Event {
+    NONE,       // need more bytes
+    FRAME,      // a frame with a valid CRC is ready: type(), take()
+    BAD_CRC,    // frame dropped
+    TOO_LARGE,  // header announced more than maxLen; dropped
+    BAD_JPEG,   // CRC fine, JPEG not (checkJpeg, see jpeg()); dropped
+  };
+
+  explicit UartFrameReader(size_t maxLen, bool checkJpeg = false)
+      : maxLen_(maxLen), checkJpeg_(checkJpeg) {}
+
+  // Consumes bytes until an event or the end of data; consumed says how many.
+  Event feed(const uint8_t* data, size_t n, size_t& consumed);
+  void reset();
+
+  uint8_t type() const { return type_; }
+  // Header extension of the last 'T', 'V' or 'A' frame
+  uint32_t captureId() const { return captureId_; }
+  uint16_t camMs() const { return camMs_; }
+  uint8_t address() const { return address_; }  // 'A' frames only, else 0
+  uint16_t crc() const { return crc_; }
+  // Scanner state of the last payload (checkJpeg only)
+  const JpegScanner& jpeg() const { return jpeg_; }
+  // Payload of the last FRAME. The reader starts a fresh buffer afterwards,
+  // so the caller may keep or share it.
+  std::shared_ptr<std::vector<uint8_t> > take();
+
+  bool inFrame() const { return state_ != HUNT; }
+  uint32_t framesOk() const { return framesOk_; }
+  uint32_t framesBad() const { return framesBad_; }
+
+ private:
+  enum State { HUNT, HEADER, BODY };
+  size_t maxLen_;
+  bool checkJpeg_;
+  JpegScanner jpeg_;
+  State state_ = HUNT;
+  uint8_t window_[4] = {0, 0, 0, 0};
+  uint8_t header_[6 + FRAME_ADDR_EXT_LEN];
+  size_t got_ = 0;
+  uint32_t len_ = 0;
+  uint16_t crc_ = 0;
+  uint16_t calc_ = 0;
+  uint8_t type_ = 0;
+  uint32_t captureId_ = 0;
+  uint16_t camMs_ = 0;
+  uint8_t address_ = 0;
+  std::shared_ptr<std::vector<uint8_t> > payload_;
+  uint32_t framesOk_ = 0;
+  uint32_t framesBad_ = 0;
+};
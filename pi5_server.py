@@ -1,16 +1,27 @@
+import asyncio
 import io
 import json
 import os
+import re
 import threading
+import time
 from datetime import datetime
 from typing import Dict, Optional, Tuple
 
 import numpy as np
 import requests
 from fastapi import FastAPI, Request
+from fastapi.concurrency import run_in_threadpool
 from fastapi.responses import JSONResponse
 from PIL import Image
 
+try:
+    # Native preprocessing (pi_ext/): scaled JPEG decode straight into the
+    # model input, colour means in the same pass. PIL is the fallback.
+    import leafprep
+except ImportError:
+    leafprep = None
+
 app = FastAPI()
 
 BASE_DIR = os.path.dirname(__file__)
@@ -221,6 +232,17 @@ _LABEL_TXT_PATH = os.path.join(BASE_DIR, "leaf_labels.txt")
 _LABEL_JSON_PATH = os.path.join(BASE_DIR, "leaf_labels.json")
 _CLOUD_POST_URL = "https://plant-disease-detection-server-one.vercel.app/diseases"
 
+# Micro-batching (leafprep.BatchWorker, pi_ext/): uploads arriving within
+# _BATCH_WINDOW_MS of each other share one inference, as long as the oldest
+# still gets its result within _BATCH_BUDGET_MS. Needs libtensorflowlite_c;
+# without it every frame runs alone behind _tflite_lock. Tune with
+# pi_ext/loadtest.py; _BATCH_MAX = 0 turns it off.
+_BATCH_WINDOW_MS = 10.0
+_BATCH_BUDGET_MS = 400.0
+_BATCH_MAX = 8
+_BATCH_THREADS = 4
+_batch_worker = None
+
 _tflite_interpreter = None
 _tflite_input_details = None
 _tflite_output_details = None
@@ -232,6 +254,13 @@ _label_metadata: Optional[Dict[str, Dict[str, str]]] = None
 _latest_result: Optional[Dict[str, object]] = None
 _cloud_lock = threading.Lock()
 
+# Upper bound on frames per /upload_batch request; matches BATCH_MAX_FRAMES on the hub.
+_BATCH_MAX_FRAMES = 64
+
+# Capture IDs from the hub (X-Capture-Id header or ?capture_id=): hex, used in
+# file names, so anything else is ignored.
+_CAPTURE_ID_RE = re.compile(r"^[0-9a-f]{1,16}$")
+
 
 def _kaggle_env_labels() -> Optional[list[str]]:
     raw_path = os.path.join(BASE_DIR, "leaf_labels.json")
@@ -277,10 +306,28 @@ def _load_label_metadata() -> None:
     if _label_metadata is None and _DEFAULT_METADATA:
         _label_metadata = dict(_DEFAULT_METADATA)
 
+def _load_batch_worker() -> None:
+    """Load the model into leafprep's batching worker if it can run it."""
+    global _batch_worker
+    if leafprep is None or _BATCH_MAX < 1 or not os.path.exists(_TFLITE_MODEL_PATH):
+        return
+    try:
+        _batch_worker = leafprep.BatchWorker(
+            model=_TFLITE_MODEL_PATH,
+            window_ms=_BATCH_WINDOW_MS,
+            budget_ms=_BATCH_BUDGET_MS,
+            max_batch=_BATCH_MAX,
+            threads=_BATCH_THREADS,
+        )
+        print(f"[pi5_server] Batching inference, window {_BATCH_WINDOW_MS:g} ms, up to {_BATCH_MAX} frames.")
+    except (RuntimeError, ValueError) as exc:
+        print(f"[pi5_server] No batching inference ({exc}); one frame at a time.")
+
+
 def _load_tflite_interpreter() -> None:
     """Load the TFLite model if available."""
     global _tflite_interpreter, _tflite_input_details, _tflite_output_details
-    if not os.path.exists(_TFLITE_MODEL_PATH):
+    if _batch_worker is not None or not os.path.exists(_TFLITE_MODEL_PATH):
         return
     try:
         try:
@@ -327,7 +374,30 @@ def _heuristic_analysis(pil_img: Image.Image) -> Dict[str, object]:
     red = float(np.mean(np_img[..., 0]))
     green = float(np.mean(np_img[..., 1]))
     blue = float(np.mean(np_img[..., 2]))
-    brightness = float(np.mean(np_img))
+    return _heuristic_from_means(red, green, blue, "heuristic")
+
+
+def _parse_leaf_stats(value: Optional[str]) -> Optional[Tuple[float, float, float]]:
+    """Mean red, green, blue from one X-Leaf-Stats entry ("r=0.41;g=0.53;b=0.30")."""
+    if not value:
+        return None
+    fields: Dict[str, float] = {}
+    for part in value.split(";"):
+        key, _, raw = part.strip().partition("=")
+        try:
+            fields[key] = float(raw)
+        except ValueError:
+            return None
+    try:
+        means = (fields["r"], fields["g"], fields["b"])
+    except KeyError:
+        return None
+    return means if all(0.0 <= v <= 1.0 for v in means) else None
+
+
+def _heuristic_from_means(red: float, green: float, blue: float, source: str) -> Dict[str, object]:
+    """Heuristic verdict from mean colours (0..1); lib/leafcam/leaf_stats.cpp mirrors it."""
+    brightness = (red + green + blue) / 3.0
     chlorophyll_score = green - 0.5 * (red + blue)
     dryness_score = red - green
 
@@ -359,7 +429,7 @@ def _heuristic_analysis(pil_img: Image.Image) -> Dict[str, object]:
             "mean_blue": round(blue, 3),
             "chlorophyll_score": round(chlorophyll_score, 3),
             "dryness_score": round(dryness_score, 3),
-            "analysis_source": "heuristic",
+            "analysis_source": source,
         },
     }
 
@@ -391,6 +461,36 @@ def _analyze_with_model(pil_img: Image.Image, heuristics: Dict[str, object]) ->
         print(f"[pi5_server] TFLite inference failed: {exc}")
         return None
 
+    return _model_result(output_data, heuristics)
+
+
+def _analyze_native(img_bytes: bytes, hub_heuristics: Optional[Dict[str, object]]) -> Optional[Dict[str, object]]:
+    """_analyze_image() through leafprep; None to fall back to PIL."""
+    try:
+        if _batch_worker is not None:
+            probs, means = _batch_worker.infer(img_bytes)
+            heuristics = hub_heuristics or _heuristic_from_means(*means, "heuristic")
+            return _model_result(np.asarray(probs, dtype=np.float32), heuristics)
+        if _tflite_interpreter is None:
+            return _heuristic_from_means(*leafprep.color_means(img_bytes), "heuristic")
+        with _tflite_lock:
+            input_detail = _tflite_input_details[0]
+            if input_detail["dtype"] not in (np.float32, np.uint8):
+                return None
+            # Filled in place: the view must be gone before invoke()
+            tensor = _tflite_interpreter.tensor(input_detail["index"])()
+            means = leafprep.prepare(img_bytes, tensor)
+            del tensor
+            _tflite_interpreter.invoke()
+            output_data = _tflite_interpreter.get_tensor(_tflite_output_details[0]["index"])
+    except Exception as exc:  # noqa: BLE001
+        print(f"[pi5_server] Native preprocessing failed, using PIL: {exc}")
+        return None
+    heuristics = hub_heuristics or _heuristic_from_means(*means, "heuristic")
+    return _model_result(output_data, heuristics)
+
+
+def _model_result(output_data, heuristics: Dict[str, object]) -> Dict[str, object]:
     probabilities = np.squeeze(output_data)
     if probabilities.ndim == 0:
         probabilities = np.array([probabilities])
@@ -428,10 +528,19 @@ def _analyze_with_model(pil_img: Image.Image, heuristics: Dict[str, object]) ->
     return result
 
 
-def _analyze_image(img_bytes: bytes) -> Dict[str, object]:
+def _analyze_image(img_bytes: bytes, hub_stats: Optional[Tuple[float, float, float]] = None) -> Dict[str, object]:
+    # With the hub's colour statistics (X-Leaf-Stats) the heuristic needs no
+    # pixels, and without a model the JPEG is not decoded at all.
+    hub_heuristics = _heuristic_from_means(*hub_stats, "hub_dc_stats") if hub_stats else None
+    if hub_heuristics and _tflite_interpreter is None and _batch_worker is None:
+        return hub_heuristics
+    if leafprep is not None:
+        native_result = _analyze_native(img_bytes, hub_heuristics)
+        if native_result is not None:
+            return native_result
     with Image.open(io.BytesIO(img_bytes)) as pil_img:
         pil_img = pil_img.convert("RGB")
-        heuristics = _heuristic_analysis(pil_img)
+        heuristics = hub_heuristics or _heuristic_analysis(pil_img)
         model_result = _analyze_with_model(pil_img, heuristics)
         return model_result or heuristics
 
@@ -483,27 +592,41 @@ def _kaggle_credentials() -> Tuple[Optional[str], Optional[str]]:
 
 _kaggle_credentials()
 _load_label_metadata()
+_load_batch_worker()
 _load_tflite_interpreter()
 
 
-@app.post("/upload")
-async def upload(request: Request) -> JSONResponse:
-    global _latest_result
+def _capture_id(value: Optional[str]) -> Optional[str]:
+    if not value:
+        return None
+    value = value.strip().lower()
+    return value if _CAPTURE_ID_RE.match(value) else None
 
-    img_bytes = await request.body()
-    if not img_bytes:
-        return JSONResponse({"status": "error", "message": "No image payload received"}, status_code=400)
 
+def _header_ms(request: Request, name: str) -> Optional[int]:
+    try:
+        return int(request.headers[name])
+    except (KeyError, ValueError):
+        return None
+
+
+def _store_and_analyze(
+    img_bytes: bytes,
+    suffix: str = "",
+    capture_id: Optional[str] = None,
+    hub_stats: Optional[Tuple[float, float, float]] = None,
+) -> Dict[str, object]:
     timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
-    filename = f"image_{timestamp}.jpg"
+    # The capture ID keeps two uploads within the same second apart.
+    tag = f"_{capture_id}" if capture_id else ""
+    filename = f"image_{timestamp}{tag}{suffix}.jpg"
     filepath = os.path.join(UPLOAD_DIR, filename)
     with open(filepath, "wb") as file_obj:
         file_obj.write(img_bytes)
 
-    analysis = _analyze_image(img_bytes)
+    analysis = _analyze_image(img_bytes, hub_stats)
 
-    # Persist latest result for the polling endpoint and OLED display.
-    _latest_result = {
+    result: Dict[str, object] = {
         "timestamp": timestamp,
         "filename": filename,
         "path": filepath,
@@ -515,19 +638,147 @@ async def upload(request: Request) -> JSONResponse:
         "recommendation": analysis["solution"],
     }
     if metrics := analysis.get("metrics"):
-        _latest_result["metrics"] = metrics
+        result["metrics"] = metrics
+    if capture_id:
+        result["capture_id"] = capture_id
+    return result
+
+
+def _parse_batch(body: bytes) -> list[bytes]:
+    """Split a PVIB batch body (see lib/leafcam/batch_frame.h) into JPEG frames."""
+    if len(body) < 6 or body[:4] != b"PVIB":
+        raise ValueError("bad magic")
+    count = int.from_bytes(body[4:6], "big")
+    if count == 0 or count > _BATCH_MAX_FRAMES:
+        raise ValueError("bad count")
+    frames: list[bytes] = []
+    pos = 6
+    for _ in range(count):
+        if len(body) - pos < 6:
+            raise ValueError("truncated header")
+        length = int.from_bytes(body[pos:pos + 4], "big")
+        crc = int.from_bytes(body[pos + 4:pos + 6], "big")
+        pos += 6
+        if length == 0 or length > len(body) - pos:
+            raise ValueError("truncated frame")
+        frame = body[pos:pos + length]
+        if _crc16(frame) != crc:
+            raise ValueError("crc mismatch")
+        frames.append(frame)
+        pos += length
+    if pos != len(body):
+        raise ValueError("trailing bytes")
+    return frames
+
+
+def _crc16_table() -> list[int]:
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+_CRC16_TABLE = _crc16_table()
+
+
+def _crc16(data: bytes) -> int:
+    """CRC16 of lib/leafcam/crc16.h; leafprep's C version when it is built."""
+    if leafprep is not None:
+        return leafprep.crc16(data)
+    crc = 0xFFFF
+    table = _CRC16_TABLE
+    for byte in data:
+        crc = (crc >> 8) ^ table[(crc ^ byte) & 0xFF]
+    return crc
+
+
+@app.post("/upload")
+async def upload(request: Request) -> JSONResponse:
+    global _latest_result
+
+    started = time.monotonic()
+    img_bytes = await request.body()
+    if not img_bytes:
+        return JSONResponse({"status": "error", "message": "No image payload received"}, status_code=400)
+    read_done = time.monotonic()
+    capture_id = _capture_id(request.headers.get("x-capture-id") or request.query_params.get("capture_id"))
+
+    # Persist latest result for the polling endpoint and OLED display. The
+    # analysis runs off the event loop so concurrent uploads can batch.
+    hub_stats = _parse_leaf_stats(request.headers.get("x-leaf-stats"))
+    result = await run_in_threadpool(_store_and_analyze, img_bytes, capture_id=capture_id, hub_stats=hub_stats)
+    finished = time.monotonic()
+
+    # Per-hop durations for this capture: the camera's and the hub's as sent
+    # in the request, the Pi's measured here. The hub adds the network time.
+    hops: Dict[str, int] = {
+        "pi_read_ms": round((read_done - started) * 1000),
+        "pi_analyze_ms": round((finished - read_done) * 1000),
+        "pi_ms": round((finished - started) * 1000),
+    }
+    for header, key in (("x-cam-ms", "cam_ms"), ("x-link-ms", "link_ms")):
+        value = _header_ms(request, header)
+        if value is not None:
+            hops[key] = value
+    result["hops"] = hops
+    if capture_id:
+        print(f"[pi5_server] capture {capture_id}: {hops}")
+
+    _latest_result = result
     snapshot = dict(_latest_result)
     threading.Thread(target=_post_result_to_cloud, args=(snapshot,), daemon=True).start()
 
     response_payload = {
         "status": "success",
-        "message": f"Image saved as {filename}",
+        "message": f"Image saved as {_latest_result['filename']}",
         "size_bytes": len(img_bytes),
         **_latest_result,
     }
     return JSONResponse(response_payload)
 
 
+@app.post("/upload_batch")
+async def upload_batch(request: Request) -> JSONResponse:
+    """Several frames in one request, framed by the hub's BatchWriter."""
+    global _latest_result
+
+    body = await request.body()
+    try:
+        # CRC checks over every frame: off the event loop, like the analysis
+        frames = await run_in_threadpool(_parse_batch, body)
+    except ValueError as exc:
+        return JSONResponse({"status": "error", "message": str(exc)}, status_code=400)
+
+    # One capture ID per frame, in batch order; ignored if the count is off.
+    ids = [_capture_id(v) for v in request.headers.get("x-capture-ids", "").split(",") if v]
+    if len(ids) != len(frames):
+        ids = [None] * len(frames)
+    # Colour statistics per frame, same order; empty entries for frames without.
+    stats = [_parse_leaf_stats(v) for v in request.headers.get("x-leaf-stats", "").split(",")]
+    if len(stats) != len(frames):
+        stats = [None] * len(frames)
+
+    # All frames at once, so the batching worker can run them together
+    analysed = await asyncio.gather(
+        *(
+            run_in_threadpool(
+                _store_and_analyze, img_bytes, suffix=f"_b{index}", capture_id=ids[index], hub_stats=stats[index]
+            )
+            for index, img_bytes in enumerate(frames)
+        )
+    )
+    results = [{**result, "size_bytes": len(img_bytes)} for result, img_bytes in zip(analysed, frames)]
+
+    _latest_result = {k: v for k, v in results[-1].items() if k != "size_bytes"}
+    snapshot = dict(_latest_result)
+    threading.Thread(target=_post_result_to_cloud, args=(snapshot,), daemon=True).start()
+
+    return JSONResponse({"status": "success", "count": len(results), "results": results})
+
+
 @app.get("/result")
 async def latest_result() -> JSONResponse:
     if _latest_result is None:
@@ -0,0 +1,248 @@
+#include "batch_worker.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+static uint64_t nowUs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// ---- TfLiteBackend ----
+
+TfLiteBackend::~TfLiteBackend() {
+  if (!api_) return;
+  if (interp_) api_->InterpreterDelete(interp_);
+  if (options_) api_->InterpreterOptionsDelete(options_);
+  if (model_) api_->ModelDelete(model_);
+}
+
+std::unique_ptr<TfLiteBackend> TfLiteBackend::open(const std::string& modelPath, const std::string& libPath,
+                                                   int threads, std::string& err) {
+  const TfLiteApi* api = loadTfLite(libPath, err);
+  if (!api) return nullptr;
+  std::unique_ptr<TfLiteBackend> b(new TfLiteBackend());
+  b->api_ = api;
+  b->model_ = api->ModelCreateFromFile(modelPath.c_str());
+  if (!b->model_) {
+    err = "cannot load model " + modelPath;
+    return nullptr;
+  }
+  b->options_ = api->InterpreterOptionsCreate();
+  if (threads > 0) api->InterpreterOptionsSetNumThreads(b->options_, threads);
+  b->interp_ = api->InterpreterCreate(b->model_, b->options_);
+  if (!b->interp_ || api->InterpreterAllocateTensors(b->interp_) != kTfLiteOk) {
+    err = "cannot create interpreter";
+    return nullptr;
+  }
+  const TfLiteTensor* in = api->InterpreterGetInputTensor(b->interp_, 0);
+  const TfLiteTensor* out = api->InterpreterGetOutputTensor(b->interp_, 0);
+  int inType = api->TensorType(in), outType = api->TensorType(out);
+  if (api->TensorNumDims(in) != 4 || api->TensorDim(in, 3) != 3 ||
+      (inType != kTfLiteFloat32 && inType != kTfLiteUInt8)) {
+    err = "model input is not [batch, height, width, 3] float32 or uint8";
+    return nullptr;
+  }
+  if (api->TensorNumDims(out) < 1 || (outType != kTfLiteFloat32 && outType != kTfLiteUInt8)) {
+    err = "model output is not float32 or uint8 scores";
+    return nullptr;
+  }
+  b->height_ = api->TensorDim(in, 1);
+  b->width_ = api->TensorDim(in, 2);
+  b->float_ = inType == kTfLiteFloat32;
+  b->classes_ = api->TensorDim(out, api->TensorNumDims(out) - 1);
+  b->batch_ = api->TensorDim(in, 0);
+  if (b->batch_ != 1 && !b->resize(1, err)) return nullptr;
+  return b;
+}
+
+bool TfLiteBackend::resize(int n, std::string& err) {
+  const int dims[4] = {n, height_, width_, 3};
+  if (api_->InterpreterResizeInputTensor(interp_, 0, dims, 4) != kTfLiteOk ||
+      api_->InterpreterAllocateTensors(interp_) != kTfLiteOk) {
+    err = "cannot resize the input to a batch of " + std::to_string(n);
+    return false;
+  }
+  batch_ = n;
+  return true;
+}
+
+bool TfLiteBackend::invoke(const uint8_t* const* items, int n, float* out, std::string& err) {
+  TfLiteTensor* in = api_->InterpreterGetInputTensor(interp_, 0);
+  uint8_t* dst = static_cast<uint8_t*>(api_->TensorData(in));
+  size_t item = inputBytes();
+  if (!dst || api_->TensorByteSize(in) != item * n) {
+    err = "input tensor size mismatch";
+    return false;
+  }
+  for (int i = 0; i < n; ++i) memcpy(dst + item * i, items[i], item);
+  if (api_->InterpreterInvoke(interp_) != kTfLiteOk) {
+    err = "invoke failed";
+    return false;
+  }
+  const TfLiteTensor* o = api_->InterpreterGetOutputTensor(interp_, 0);
+  size_t values = (size_t)n * classes_;
+  if (api_->TensorType(o) == kTfLiteFloat32) {
+    if (api_->TensorByteSize(o) != values * sizeof(float)) {
+      err = "output tensor size mismatch";
+      return false;
+    }
+    memcpy(out, api_->TensorData(o), values * sizeof(float));
+  } else {
+    if (api_->TensorByteSize(o) != values) {
+      err = "output tensor size mismatch";
+      return false;
+    }
+    TfLiteQuantizationParams q = api_->TensorQuantizationParams(o);
+    const uint8_t* src = static_cast<const uint8_t*>(api_->TensorData(o));
+    for (size_t i = 0; i < values; ++i) out[i] = q.scale * ((int32_t)src[i] - q.zero_point);
+  }
+  return true;
+}
+
+bool TfLiteBackend::run(const uint8_t* const* items, int n, float* out, std::string& err) {
+  // Resizing re-plans the tensor arena, which is cheap next to an invoke
+  if (n > 1 && resizable_ && batch_ != n && !resize(n, err)) {
+    resizable_ = false;  // fixed batch dimension: one at a time from now on
+  }
+  if (n > 1 && resizable_) return invoke(items, n, out, err);
+  if (batch_ != 1 && !resize(1, err)) return false;
+  for (int i = 0; i < n; ++i) {
+    if (!invoke(items + i, 1, out + (size_t)i * classes_, err)) return false;
+  }
+  return true;
+}
+
+// ---- SimulatedBackend ----
+
+bool SimulatedBackend::run(const uint8_t* const*, int n, float* out, std::string&) {
+  std::this_thread::sleep_for(std::chrono::microseconds(fixedUs_ + (uint64_t)n * perItemUs_));
+  std::fill(out, out + (size_t)n * classes_, 1.0f / classes_);
+  return true;
+}
+
+// ---- BatchWorker ----
+
+BatchWorker::BatchWorker(std::unique_ptr<InferenceBackend> backend, uint32_t windowUs, uint32_t budgetUs,
+                         int maxBatch)
+    : backend_(std::move(backend)), windowUs_(windowUs), budgetUs_(budgetUs),
+      maxBatch_(maxBatch < 1 ? 1 : maxBatch) {
+  stats_.sizes.assign(maxBatch_ + 1, 0);
+  stats_.costUs.assign(maxBatch_ + 1, 0);
+  thread_ = std::thread(&BatchWorker::loop, this);
+}
+
+BatchWorker::~BatchWorker() {
+  {
+    std::lock_guard<std::mutex> g(lock_);
+    stop_ = true;
+  }
+  queued_.notify_all();
+  thread_.join();
+}
+
+bool BatchWorker::infer(const uint8_t* input, std::vector<float>& probs, std::string& err) {
+  probs.assign(backend_->classes(), 0.0f);
+  Request r;
+  r.input = input;
+  r.out = probs.data();
+  r.queuedUs = nowUs();
+  std::unique_lock<std::mutex> l(lock_);
+  if (stop_) {
+    err = "worker stopped";
+    return false;
+  }
+  queue_.push_back(&r);
+  queued_.notify_one();
+  finished_.wait(l, [&]() { return r.done; });
+  if (!r.err.empty()) {
+    err = r.err;
+    return false;
+  }
+  return true;
+}
+
+BatchStats BatchWorker::stats() {
+  std::lock_guard<std::mutex> g(lock_);
+  return stats_;
+}
+
+double BatchWorker::expectedUs(int n) const {
+  const std::vector<double>& c = stats_.costUs;
+  if (c[n] > 0) return c[n];
+  for (int k = n - 1; k >= 1; --k) {
+    if (c[k] > 0) return c[k] * n / k;
+  }
+  for (int k = n + 1; k <= maxBatch_; ++k) {
+    if (c[k] > 0) return c[k];
+  }
+  return 0;  // nothing run yet
+}
+
+int BatchWorker::batchSize(uint64_t now, uint64_t oldestUs) const {
+  int n = std::min((int)queue_.size(), maxBatch_);
+  double waited = (double)(now - oldestUs);
+  // Already late even alone: a smaller batch would only leave more behind
+  if (waited + expectedUs(1) > budgetUs_) return n;
+  while (n > 1 && waited + expectedUs(n) > budgetUs_) --n;
+  return n;
+}
+
+void BatchWorker::loop() {
+  std::unique_lock<std::mutex> l(lock_);
+  std::vector<Request*> batch;
+  std::vector<const uint8_t*> items;
+  std::vector<float> out;
+  for (;;) {
+    queued_.wait(l, [&]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;  // stopping, nothing left
+
+    // Wait out the window for company, unless one more item would no
+    // longer fit the oldest request's budget
+    while (!stop_ && (int)queue_.size() < maxBatch_) {
+      uint64_t now = nowUs();
+      uint64_t oldest = queue_.front()->queuedUs;
+      if (now >= oldest + windowUs_) break;
+      if (now - oldest + expectedUs((int)queue_.size() + 1) > budgetUs_) break;
+      queued_.wait_for(l, std::chrono::microseconds(oldest + windowUs_ - now));
+    }
+
+    uint64_t start = nowUs();
+    int n = batchSize(start, queue_.front()->queuedUs);
+    batch.assign(queue_.begin(), queue_.begin() + n);
+    queue_.erase(queue_.begin(), queue_.begin() + n);
+    items.resize(n);
+    for (int i = 0; i < n; ++i) {
+      items[i] = batch[i]->input;
+      stats_.queueUs += start - batch[i]->queuedUs;
+    }
+    out.resize((size_t)n * backend_->classes());
+
+    l.unlock();
+    std::string err;
+    bool ok = backend_->run(items.data(), n, out.data(), err);
+    uint64_t us = nowUs() - start;
+    l.lock();
+
+    double& cost = stats_.costUs[n];
+    cost = cost > 0 ? 0.8 * cost + 0.2 * us : (double)us;
+    ++stats_.batches;
+    ++stats_.sizes[n];
+    stats_.requests += n;
+    stats_.inferUs += us;
+    if (!ok) ++stats_.errors;
+    size_t classes = backend_->classes();
+    for (int i = 0; i < n; ++i) {
+      if (ok) {
+        memcpy(batch[i]->out, out.data() + classes * i, classes * sizeof(float));
+      } else {
+        batch[i]->err = err;
+      }
+      batch[i]->done = true;
+    }
+    finished_.notify_all();
+  }
+}
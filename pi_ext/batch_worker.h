@@ -0,0 +1,139 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tflite_c.h"
+
+// ====== Micro-batching inference ======
+// One worker thread owns the model. Callers (the server's request threads)
+// preprocess their own frame into an input buffer and block in infer();
+// the worker groups what is queued into one batch, runs it and hands each
+// caller its row of the output.
+//
+// Batching: when a request arrives at an idle queue the worker waits up to
+// windowUs for company, then runs up to maxBatch items. It stops waiting
+// early, and shrinks the batch, so the oldest request's queue time plus the
+// batch's expected inference time stays within budgetUs. A request that
+// would miss the budget even alone gets a full batch: under overload,
+// shrinking only grows the queue. Expected times come from an average per
+// batch size, measured as batches run; a size not seen yet is scaled
+// linearly from the nearest one below it, which overestimates once
+// batching pays off.
+
+// What the worker runs: an input is H x W x 3 of float32 (0..1) or uint8
+class InferenceBackend {
+ public:
+  virtual ~InferenceBackend() {}
+  virtual int width() const = 0;
+  virtual int height() const = 0;
+  virtual bool floatInput() const = 0;
+  virtual int classes() const = 0;
+  // items[i] is one input; out receives n rows of classes() probabilities
+  virtual bool run(const uint8_t* const* items, int n, float* out, std::string& err) = 0;
+
+  size_t inputBytes() const { return (size_t)width() * height() * 3 * (floatInput() ? 4 : 1); }
+};
+
+// A .tflite model through the TFLite C API. Batches resize the input's
+// first dimension; a model that refuses gets its items one at a time.
+class TfLiteBackend : public InferenceBackend {
+ public:
+  ~TfLiteBackend();
+  // Null (and err) when the library, model or tensors do not fit
+  static std::unique_ptr<TfLiteBackend> open(const std::string& modelPath, const std::string& libPath,
+                                             int threads, std::string& err);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  bool floatInput() const { return float_; }
+  int classes() const { return classes_; }
+  bool run(const uint8_t* const* items, int n, float* out, std::string& err);
+
+ private:
+  TfLiteBackend() {}
+  bool resize(int n, std::string& err);
+  bool invoke(const uint8_t* const* items, int n, float* out, std::string& err);
+
+  const TfLiteApi* api_ = nullptr;
+  TfLiteModel* model_ = nullptr;
+  TfLiteInterpreterOptions* options_ = nullptr;
+  TfLiteInterpreter* interp_ = nullptr;
+  int width_ = 0;
+  int height_ = 0;
+  bool float_ = true;
+  int classes_ = 0;
+  int batch_ = 1;           // current first dimension of the input
+  bool resizable_ = true;
+};
+
+// Stand-in for load tests without a model: a batch of n takes
+// fixedUs + n * perItemUs (sleeping, as a model on other cores or an
+// accelerator would leave this thread idle) and returns uniform rows.
+class SimulatedBackend : public InferenceBackend {
+ public:
+  SimulatedBackend(int width, int height, int classes, uint32_t fixedUs, uint32_t perItemUs)
+      : width_(width), height_(height), classes_(classes), fixedUs_(fixedUs), perItemUs_(perItemUs) {}
+  int width() const { return width_; }
+  int height() const { return height_; }
+  bool floatInput() const { return true; }
+  int classes() const { return classes_; }
+  bool run(const uint8_t* const* items, int n, float* out, std::string& err);
+
+ private:
+  int width_, height_, classes_;
+  uint32_t fixedUs_, perItemUs_;
+};
+
+struct BatchStats {
+  uint64_t requests = 0;
+  uint64_t batches = 0;
+  uint64_t errors = 0;
+  uint64_t queueUs = 0;      // sum over requests: queued until their batch started
+  uint64_t inferUs = 0;      // sum over batches
+  std::vector<uint64_t> sizes;  // batches run per size, index = size
+  std::vector<double> costUs;   // average inference time per size, 0 = not seen
+};
+
+class BatchWorker {
+ public:
+  BatchWorker(std::unique_ptr<InferenceBackend> backend, uint32_t windowUs, uint32_t budgetUs, int maxBatch);
+  ~BatchWorker();
+
+  InferenceBackend& backend() { return *backend_; }
+  // Blocks until input's batch has run; probs gets classes() values
+  bool infer(const uint8_t* input, std::vector<float>& probs, std::string& err);
+  BatchStats stats();
+
+ private:
+  struct Request {
+    const uint8_t* input;
+    float* out;
+    uint64_t queuedUs;
+    bool done = false;
+    std::string err;
+  };
+
+  void loop();
+  double expectedUs(int n) const;  // under lock_
+  int batchSize(uint64_t now, uint64_t oldestUs) const;  // under lock_
+
+  std::unique_ptr<InferenceBackend> backend_;
+  uint32_t windowUs_;
+  uint32_t budgetUs_;
+  int maxBatch_;
+  std::mutex lock_;
+  std::condition_variable queued_;
+  std::condition_variable finished_;
+  std::deque<Request*> queue_;
+  bool stop_ = false;
+  BatchStats stats_;
+  std::thread thread_;
+};
@@ -0,0 +1,160 @@
+"""Preprocessing cost per upload: pi5_server.py's PIL path against leafprep.
+
+    python pi_ext/bench.py [--images upload] [--size 224] [--dtype float32] [--repeat 20]
+    python pi_ext/bench.py --check [--tolerance 2.0]
+
+For every JPEG it times, best of --repeat:
+  pil       what _analyze_image() did: PIL decode + RGB, NumPy float32
+            means for the heuristic, resize() and normalise for the model
+  prepare   leafprep.prepare() into a model-sized buffer, means included
+  means     leafprep.color_means(), the path without a model
+and prints the mean colours each path found. The PIL column is skipped
+when PIL or NumPy is missing.
+
+--check times nothing: it compares the uint8 model input of both paths
+pixel by pixel and exits 1 if any image's mean difference exceeds
+--tolerance levels (0..255). The resampling is Pillow's own, so what is
+left is the scaled decode. Where PIL's draft() mode (1/2, 1/4, 1/8 only)
+picks the same scale as leafprep, the two must match exactly.
+"""
+
+import argparse
+import array
+import io
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import leafprep  # noqa: E402
+
+try:
+    import numpy as np
+    from PIL import Image
+except ImportError:
+    np = None
+    Image = None
+
+
+def best_ms(repeat, fn):
+    best = None
+    result = None
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        result = fn()
+        ms = (time.perf_counter() - t0) * 1000.0
+        best = ms if best is None or ms < best else best
+    return best, result
+
+
+def pil_path(data, size, dtype):
+    with Image.open(io.BytesIO(data)) as img:
+        img = img.convert("RGB")
+        pixels = np.asarray(img, dtype=np.float32) / 255.0
+        means = tuple(float(np.mean(pixels[..., c])) for c in range(3))
+        resized = np.asarray(img.resize((size, size)))
+        if dtype == "float32":
+            resized = resized.astype(np.float32) / 255.0
+        np.expand_dims(resized, axis=0)
+        return means
+
+
+def scaled_size(size, width, height):
+    """The n/8 decode size leafprep picks for a size x size input."""
+    for num in range(1, 9):
+        w, h = -(-width * num // 8), -(-height * num // 8)
+        if w >= size and h >= size:
+            return w, h
+    return width, height
+
+
+def check(names, args):
+    print(f"input {args.size}x{args.size} uint8, levels differing from PIL (0..255)")
+    print(f"{'image':32} {'max':>5} {'mean':>7} {'p99':>5} {'draft':>6}")
+    out = np.zeros((args.size, args.size, 3), dtype=np.uint8)
+    failed = 0
+    for name in names:
+        with open(os.path.join(args.images, name), "rb") as fh:
+            data = fh.read()
+        leafprep.prepare(data, out)
+        ours = out.astype(np.int16)
+        with Image.open(io.BytesIO(data)) as img:
+            ref = np.asarray(img.convert("RGB").resize((args.size, args.size)), dtype=np.int16)
+        with Image.open(io.BytesIO(data)) as img:
+            ours_size = scaled_size(args.size, *img.size)
+            img.draft("RGB", (args.size, args.size))
+            draft_max = None
+            if img.size == ours_size:
+                draft = np.asarray(img.convert("RGB").resize((args.size, args.size)), dtype=np.int16)
+                draft_max = int(np.abs(ours - draft).max())
+        diff = np.abs(ours - ref)
+        bad = diff.mean() > args.tolerance or bool(draft_max)
+        failed += bad
+        print(
+            f"{name:32} {int(diff.max()):5} {diff.mean():7.3f} {int(np.percentile(diff, 99)):5} "
+            f"{'-' if draft_max is None else draft_max:>6}{'  FAIL' if bad else ''}"
+        )
+    print(f"\n{len(names) - failed}/{len(names)} within {args.tolerance} levels of PIL")
+    return 1 if failed else 0
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--images", default=os.path.join(here, "..", "upload"))
+    parser.add_argument("--size", type=int, default=224, help="model input width and height")
+    parser.add_argument("--dtype", choices=("float32", "uint8"), default="float32")
+    parser.add_argument("--repeat", type=int, default=20)
+    parser.add_argument("--check", action="store_true", help="compare the model input with PIL's instead of timing")
+    parser.add_argument("--tolerance", type=float, default=2.0, help="--check: max mean difference, in levels")
+    args = parser.parse_args()
+
+    names = sorted(n for n in os.listdir(args.images) if n.lower().endswith((".jpg", ".jpeg")))
+    if not names:
+        print(f"bench: no JPEGs in '{args.images}'")
+        return 1
+    if args.check:
+        if np is None:
+            print("bench: --check needs PIL and NumPy")
+            return 1
+        return check(names, args)
+    values = args.size * args.size * 3
+    if np is not None:
+        out = np.zeros((1, args.size, args.size, 3), dtype=np.float32 if args.dtype == "float32" else np.uint8)
+    else:
+        out = array.array("f" if args.dtype == "float32" else "B", bytes(values * (4 if args.dtype == "float32" else 1)))
+
+    print(f"input {args.size}x{args.size} {args.dtype}, best of {args.repeat}")
+    print(f"{'image':32} {'bytes':>7} {'pil':>9} {'prepare':>9} {'means':>9}  mean r,g,b (pil / prepare / means)")
+    totals = [0.0, 0.0, 0.0]
+    for name in names:
+        with open(os.path.join(args.images, name), "rb") as fh:
+            data = fh.read()
+        if np is not None:
+            pil_ms, pil_means = best_ms(args.repeat, lambda: pil_path(data, args.size, args.dtype))
+        else:
+            pil_ms, pil_means = None, None
+        prep_ms, prep_means = best_ms(
+            args.repeat, lambda: leafprep.prepare(data, out, width=args.size, height=args.size)
+        )
+        means_ms, dc_means = best_ms(args.repeat, lambda: leafprep.color_means(data))
+
+        def fmt(m):
+            return "-" if m is None else ",".join(f"{v:.3f}" for v in m)
+
+        pil_col = "-" if pil_ms is None else f"{pil_ms:.2f}ms"
+        print(
+            f"{name:32} {len(data):7} {pil_col:>9} {prep_ms:7.2f}ms {means_ms:7.2f}ms  "
+            f"{fmt(pil_means)} / {fmt(prep_means)} / {fmt(dc_means)}"
+        )
+        totals[0] += pil_ms or 0.0
+        totals[1] += prep_ms
+        totals[2] += means_ms
+    n = len(names)
+    pil_mean = f"{totals[0] / n:.2f} ms" if np is not None else "n/a (no PIL/NumPy)"
+    print(f"\nmean per image: pil {pil_mean}, prepare {totals[1] / n:.2f} ms, means {totals[2] / n:.2f} ms")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,517 @@
+// ====== leafprep: JPEG to model input for pi5_server.py ======
+// The Pi's preprocessing in one native pass: libjpeg decodes the upload with
+// DCT-domain scaling (scale_num/8) to the smallest size that still covers
+// the model input, so a VGA frame for a 224x224 model is decoded at 320x240
+// and never exists at full size. The scaled rows are summed for the
+// heuristic's mean colours on the way and resampled into the caller's
+// buffer, which for TFLite is the interpreter's input tensor
+// (interpreter.tensor(index)()), so no NumPy array is made. Resampling is
+// Pillow's Image.resize() default (antialiased bicubic) with Pillow's
+// fixed-point arithmetic, so the model sees what the PIL path gave it up to
+// the decode: scaled IDCT output differs from a full decode by a level or
+// two on average (pi_ext/bench.py --check measures it).
+//
+//   prepare(jpeg, out, width=0, height=0) -> (red, green, blue)
+//     out: writable C-contiguous buffer of float32 (filled with 0..1, as
+//     the PIL path's / 255.0) or uint8 (0..255); [1,]H,W,3 shaped buffers
+//     give the size, flat ones need width and height.
+//   color_means(jpeg) -> (red, green, blue)
+//     the means alone, from a 1/8-scale decode (only the DC coefficients)
+//   crc16(data) -> int
+//     the link and batch CRC16 (lib/leafcam/crc16.h), for /upload_batch
+//
+//   BatchWorker(model=None, window_ms=5, budget_ms=250, max_batch=8,
+//               threads=0, tflite_lib="", simulate=None)
+//     micro-batching inference (batch_worker.h) over a .tflite model, or
+//     with simulate=(fixed_ms, per_item_ms, size, classes) a stand-in of
+//     that cost for load tests. infer(jpeg) -> (probs, (red, green, blue))
+//     prepares the frame in the calling thread like prepare() and blocks
+//     until its batch has run; input_size() -> (width, height); stats().
+//
+// Means are 0..1 over the decoded image, within a few thousandths of the
+// full-size decode. Everything releases the GIL while decoding or waiting.
+// A JPEG that libjpeg cannot read raises ValueError.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <jpeglib.h>
+
+#include "batch_worker.h"
+#include "crc16.h"
+
+namespace {
+
+struct ErrorMgr {
+  jpeg_error_mgr pub;
+  jmp_buf jump;
+  char msg[JMSG_LENGTH_MAX];
+};
+
+void onJpegError(j_common_ptr cinfo) {
+  ErrorMgr* err = reinterpret_cast<ErrorMgr*>(cinfo->err);
+  (*cinfo->err->format_message)(cinfo, err->msg);
+  longjmp(err->jump, 1);
+}
+
+void onJpegWarning(j_common_ptr, int) {}  // corrupt-data warnings: keep decoding, like PIL
+
+// Source pixels and weights of one output pixel along an axis
+struct Tap {
+  int first;
+  int count;
+  int weights;  // offset into the weight table
+};
+
+// Pillow's bicubic kernel (a = -0.5)
+double bicubic(double x) {
+  const double a = -0.5;
+  if (x < 0) x = -x;
+  if (x < 1) return ((a + 2) * x - (a + 3)) * x * x + 1;
+  if (x < 2) return (((x - 5) * x + 8) * x - 4) * a;
+  return 0;
+}
+
+// Fixed-point weights for 8-bit images, as in Pillow's Resample.c
+const int kPrecisionBits = 32 - 8 - 2;
+
+uint8_t clip8(int32_t v) {
+  v >>= kPrecisionBits;
+  return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+// Taps from n source pixels to m, computed like Pillow's precompute_coeffs
+// and normalize_coeffs_8bpc: when shrinking, the kernel is widened by the
+// scale factor, which is what antialiases.
+void bicubicTaps(int n, int m, std::vector<Tap>& taps, std::vector<int32_t>& w) {
+  taps.resize(m);
+  w.clear();
+  double scale = (double)n / m;
+  double filterscale = scale < 1 ? 1 : scale;
+  double support = 2.0 * filterscale;
+  double ss = 1.0 / filterscale;
+  std::vector<double> k;
+  for (int i = 0; i < m; ++i) {
+    double center = (i + 0.5) * scale;
+    int first = (int)(center - support + 0.5);
+    if (first < 0) first = 0;
+    int last = (int)(center + support + 0.5);
+    if (last > n) last = n;
+    int count = last - first;
+    k.assign(count, 0.0);
+    double sum = 0;
+    for (int x = 0; x < count; ++x) {
+      k[x] = bicubic((x + first - center + 0.5) * ss);
+      sum += k[x];
+    }
+    taps[i].first = first;
+    taps[i].count = count;
+    taps[i].weights = (int)w.size();
+    for (int x = 0; x < count; ++x) {
+      double v = (sum != 0 ? k[x] / sum : k[x]) * (1 << kPrecisionBits);
+      w.push_back((int32_t)(v < 0 ? v - 0.5 : v + 0.5));
+    }
+  }
+}
+
+struct Output {
+  float* f = nullptr;      // float32 target (0..1)
+  uint8_t* u8 = nullptr;   // or uint8 target (0..255)
+  int width = 0;
+  int height = 0;
+};
+
+// Decodes jpeg at the smallest scale covering out (or at 1/8 with no out),
+// summing colours and, with out, resampling into it. Returns "" or an error.
+std::string decode(const uint8_t* jpeg, size_t len, const Output* out, double means[3]) {
+  jpeg_decompress_struct cinfo;
+  ErrorMgr err;
+  cinfo.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = onJpegError;
+  err.pub.emit_message = onJpegWarning;
+  err.msg[0] = 0;
+
+  // Declared before setjmp so a longjmp never skips their construction
+  std::vector<uint8_t> image, wide;
+  std::vector<Tap> xTaps, yTaps;
+  std::vector<int32_t> xW, yW;
+  if (setjmp(err.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return err.msg[0] ? err.msg : "corrupt JPEG";
+  }
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<unsigned char*>(jpeg), (unsigned long)len);
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = JCS_RGB;
+  cinfo.dct_method = JDCT_IFAST;
+  cinfo.scale_denom = 8;
+  cinfo.scale_num = 1;
+  if (out) {
+    // Smallest n/8 that is at least the output size on both axes
+    for (unsigned num = 1; num <= 8; ++num) {
+      cinfo.scale_num = num;
+      jpeg_calc_output_dimensions(&cinfo);
+      if ((int)cinfo.output_width >= out->width && (int)cinfo.output_height >= out->height) break;
+    }
+  }
+  jpeg_start_decompress(&cinfo);
+  const int w = (int)cinfo.output_width, h = (int)cinfo.output_height;
+  const size_t stride = (size_t)w * 3;
+  image.resize(stride * h);
+
+  uint64_t sum[3] = {0, 0, 0};
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW rows[4];
+    int y0 = (int)cinfo.output_scanline;
+    for (int k = 0; k < 4; ++k) rows[k] = image.data() + stride * (y0 + k < h ? y0 + k : h - 1);
+    int got = (int)jpeg_read_scanlines(&cinfo, rows, 4);
+    for (int k = 0; k < got; ++k) {
+      // Three independent strided sums; the compiler unrolls and vectorises
+      const uint8_t* p = rows[k];
+      uint32_t r = 0, g = 0, b = 0;
+      for (int x = 0; x < w; ++x) {
+        r += p[3 * x];
+        g += p[3 * x + 1];
+        b += p[3 * x + 2];
+      }
+      sum[0] += r;
+      sum[1] += g;
+      sum[2] += b;
+    }
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  for (int c = 0; c < 3; ++c) means[c] = (double)sum[c] / ((double)w * h * 255.0);
+  if (!out) return "";
+
+  // Separable, horizontal pass first, each rounded to 8 bits: Pillow's order
+  bicubicTaps(w, out->width, xTaps, xW);
+  bicubicTaps(h, out->height, yTaps, yW);
+  const size_t outStride = (size_t)out->width * 3;
+  const int32_t half = 1 << (kPrecisionBits - 1);
+  wide.resize(outStride * h);
+  for (int y = 0; y < h; ++y) {
+    const uint8_t* src = image.data() + stride * y;
+    uint8_t* dst = wide.data() + outStride * y;
+    for (int ox = 0; ox < out->width; ++ox) {
+      const Tap& tx = xTaps[ox];
+      const int32_t* wx = xW.data() + tx.weights;
+      const uint8_t* p = src + 3 * tx.first;
+      int32_t r = half, g = half, b = half;
+      for (int j = 0; j < tx.count; ++j, p += 3) {
+        r += wx[j] * p[0];
+        g += wx[j] * p[1];
+        b += wx[j] * p[2];
+      }
+      dst[3 * ox] = clip8(r);
+      dst[3 * ox + 1] = clip8(g);
+      dst[3 * ox + 2] = clip8(b);
+    }
+  }
+  std::vector<int32_t> acc(outStride);
+  for (int oy = 0; oy < out->height; ++oy) {
+    const Tap& ty = yTaps[oy];
+    const int32_t* wy = yW.data() + ty.weights;
+    std::fill(acc.begin(), acc.end(), half);
+    for (int k = 0; k < ty.count; ++k) {
+      const uint8_t* src = wide.data() + outStride * (ty.first + k);
+      for (size_t i = 0; i < outStride; ++i) acc[i] += wy[k] * src[i];
+    }
+    if (out->f) {
+      float* dst = out->f + outStride * oy;
+      for (size_t i = 0; i < outStride; ++i) dst[i] = clip8(acc[i]) / 255.0f;
+    } else {
+      uint8_t* dst = out->u8 + outStride * oy;
+      for (size_t i = 0; i < outStride; ++i) dst[i] = clip8(acc[i]);
+    }
+  }
+  return "";
+}
+
+PyObject* meansTuple(const double means[3]) {
+  return Py_BuildValue("(ddd)", means[0], means[1], means[2]);
+}
+
+PyObject* prepare(PyObject*, PyObject* args, PyObject* kwargs) {
+  static const char* kwlist[] = {"jpeg", "out", "width", "height", nullptr};
+  Py_buffer jpeg, out;
+  PyObject* target;
+  int width = 0, height = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*O|ii", const_cast<char**>(kwlist), &jpeg,
+                                   &target, &width, &height)) {
+    return nullptr;
+  }
+  if (PyObject_GetBuffer(target, &out, PyBUF_WRITABLE | PyBUF_FORMAT | PyBUF_ND | PyBUF_C_CONTIGUOUS) < 0) {
+    PyBuffer_Release(&jpeg);
+    return nullptr;
+  }
+
+  Output o;
+  const char* fmt = out.format ? out.format : "B";
+  if (*fmt == '<' || *fmt == '=' || *fmt == '@') ++fmt;
+  if (strcmp(fmt, "f") == 0 && out.itemsize == 4) {
+    o.f = static_cast<float*>(out.buf);
+  } else if (strcmp(fmt, "B") == 0 && out.itemsize == 1) {
+    o.u8 = static_cast<uint8_t*>(out.buf);
+  }
+  if (out.ndim >= 3 && out.shape[out.ndim - 1] == 3) {
+    o.height = (int)out.shape[out.ndim - 3];
+    o.width = (int)out.shape[out.ndim - 2];
+  }
+  if (width > 0 && height > 0) {
+    o.width = width;
+    o.height = height;
+  }
+  const char* bad = nullptr;
+  if (!o.f && !o.u8) {
+    bad = "out must hold float32 or uint8";
+  } else if (o.width <= 0 || o.height <= 0) {
+    bad = "out is not [1,]H,W,3 shaped; pass width and height";
+  } else if ((Py_ssize_t)o.width * o.height * 3 * out.itemsize != out.len) {
+    bad = "out does not hold width * height * 3 values";
+  }
+  if (bad) {
+    PyBuffer_Release(&out);
+    PyBuffer_Release(&jpeg);
+    PyErr_SetString(PyExc_ValueError, bad);
+    return nullptr;
+  }
+
+  double means[3];
+  std::string err;
+  Py_BEGIN_ALLOW_THREADS
+  err = decode(static_cast<const uint8_t*>(jpeg.buf), (size_t)jpeg.len, &o, means);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&out);
+  PyBuffer_Release(&jpeg);
+  if (!err.empty()) {
+    PyErr_SetString(PyExc_ValueError, err.c_str());
+    return nullptr;
+  }
+  return meansTuple(means);
+}
+
+PyObject* colorMeans(PyObject*, PyObject* args) {
+  Py_buffer jpeg;
+  if (!PyArg_ParseTuple(args, "y*", &jpeg)) return nullptr;
+  double means[3];
+  std::string err;
+  Py_BEGIN_ALLOW_THREADS
+  err = decode(static_cast<const uint8_t*>(jpeg.buf), (size_t)jpeg.len, nullptr, means);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&jpeg);
+  if (!err.empty()) {
+    PyErr_SetString(PyExc_ValueError, err.c_str());
+    return nullptr;
+  }
+  return meansTuple(means);
+}
+
+PyObject* crc16Py(PyObject*, PyObject* args) {
+  Py_buffer data;
+  if (!PyArg_ParseTuple(args, "y*", &data)) return nullptr;
+  uint16_t crc;
+  Py_BEGIN_ALLOW_THREADS
+  crc = crc16(static_cast<const uint8_t*>(data.buf), (size_t)data.len);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&data);
+  return PyLong_FromLong(crc);
+}
+
+// ---- BatchWorker ----
+
+struct PyBatchWorker {
+  PyObject_HEAD
+  BatchWorker* worker;
+};
+
+int batchWorkerInit(PyObject* pyself, PyObject* args, PyObject* kwargs) {
+  PyBatchWorker* self = reinterpret_cast<PyBatchWorker*>(pyself);
+  static const char* kwlist[] = {"model", "window_ms", "budget_ms", "max_batch", "threads",
+                                 "tflite_lib", "simulate", nullptr};
+  const char* model = nullptr;
+  double windowMs = 5, budgetMs = 250;
+  int maxBatch = 8, threads = 0;
+  const char* lib = "";
+  PyObject* simulate = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|zddiisO", const_cast<char**>(kwlist), &model, &windowMs,
+                                   &budgetMs, &maxBatch, &threads, &lib, &simulate)) {
+    return -1;
+  }
+  if (windowMs < 0 || budgetMs <= 0 || maxBatch < 1) {
+    PyErr_SetString(PyExc_ValueError, "window_ms >= 0, budget_ms > 0 and max_batch >= 1 please");
+    return -1;
+  }
+  std::unique_ptr<InferenceBackend> backend;
+  if (simulate != Py_None) {
+    double fixedMs, perItemMs;
+    int size, classes;
+    if (!PyArg_ParseTuple(simulate, "ddii", &fixedMs, &perItemMs, &size, &classes)) return -1;
+    if (fixedMs < 0 || perItemMs < 0 || size < 1 || classes < 1) {
+      PyErr_SetString(PyExc_ValueError, "simulate=(fixed_ms, per_item_ms, size, classes), none negative");
+      return -1;
+    }
+    backend.reset(new SimulatedBackend(size, size, classes, (uint32_t)(fixedMs * 1000),
+                                       (uint32_t)(perItemMs * 1000)));
+  } else if (model) {
+    std::string err;
+    std::string modelPath = model, libPath = lib;
+    Py_BEGIN_ALLOW_THREADS
+    backend = TfLiteBackend::open(modelPath, libPath, threads, err);
+    Py_END_ALLOW_THREADS
+    if (!backend) {
+      PyErr_SetString(PyExc_RuntimeError, err.c_str());
+      return -1;
+    }
+  } else {
+    PyErr_SetString(PyExc_ValueError, "BatchWorker needs model or simulate");
+    return -1;
+  }
+  delete self->worker;
+  self->worker = new BatchWorker(std::move(backend), (uint32_t)(windowMs * 1000), (uint32_t)(budgetMs * 1000),
+                                 maxBatch);
+  return 0;
+}
+
+void batchWorkerDealloc(PyObject* pyself) {
+  PyBatchWorker* self = reinterpret_cast<PyBatchWorker*>(pyself);
+  BatchWorker* w = self->worker;
+  self->worker = nullptr;
+  Py_BEGIN_ALLOW_THREADS
+  delete w;  // runs what is still queued, then joins
+  Py_END_ALLOW_THREADS
+  PyTypeObject* type = Py_TYPE(pyself);
+  type->tp_free(pyself);
+  Py_DECREF(type);  // instances of a heap type hold a reference to it
+}
+
+BatchWorker* workerOf(PyObject* pyself) {
+  BatchWorker* w = reinterpret_cast<PyBatchWorker*>(pyself)->worker;
+  if (!w) PyErr_SetString(PyExc_RuntimeError, "BatchWorker not initialised");
+  return w;
+}
+
+PyObject* batchWorkerInfer(PyObject* pyself, PyObject* args) {
+  BatchWorker* w = workerOf(pyself);
+  if (!w) return nullptr;
+  Py_buffer jpeg;
+  if (!PyArg_ParseTuple(args, "y*", &jpeg)) return nullptr;
+  InferenceBackend& b = w->backend();
+  std::vector<uint8_t> input(b.inputBytes());
+  Output o;
+  o.width = b.width();
+  o.height = b.height();
+  if (b.floatInput()) {
+    o.f = reinterpret_cast<float*>(input.data());
+  } else {
+    o.u8 = input.data();
+  }
+  double means[3];
+  std::vector<float> probs;
+  std::string err;
+  bool decoded = false, ok = false;
+  Py_BEGIN_ALLOW_THREADS
+  err = decode(static_cast<const uint8_t*>(jpeg.buf), (size_t)jpeg.len, &o, means);
+  decoded = err.empty();
+  if (decoded) ok = w->infer(input.data(), probs, err);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&jpeg);
+  if (!ok) {
+    PyErr_SetString(decoded ? PyExc_RuntimeError : PyExc_ValueError, err.c_str());
+    return nullptr;
+  }
+  PyObject* p = PyTuple_New((Py_ssize_t)probs.size());
+  if (!p) return nullptr;
+  for (size_t i = 0; i < probs.size(); ++i) PyTuple_SET_ITEM(p, (Py_ssize_t)i, PyFloat_FromDouble(probs[i]));
+  PyObject* m = meansTuple(means);
+  return Py_BuildValue("(NN)", p, m);
+}
+
+PyObject* batchWorkerInputSize(PyObject* pyself, PyObject*) {
+  BatchWorker* w = workerOf(pyself);
+  if (!w) return nullptr;
+  return Py_BuildValue("(ii)", w->backend().width(), w->backend().height());
+}
+
+PyObject* batchWorkerStats(PyObject* pyself, PyObject*) {
+  BatchWorker* w = workerOf(pyself);
+  if (!w) return nullptr;
+  BatchStats st = w->stats();
+  PyObject* sizes = PyDict_New();
+  PyObject* cost = PyDict_New();
+  for (size_t n = 1; n < st.sizes.size(); ++n) {
+    if (!st.sizes[n]) continue;
+    PyObject* key = PyLong_FromSize_t(n);
+    PyObject* count = PyLong_FromUnsignedLongLong(st.sizes[n]);
+    PyObject* ms = PyFloat_FromDouble(st.costUs[n] / 1000.0);
+    PyDict_SetItem(sizes, key, count);
+    PyDict_SetItem(cost, key, ms);
+    Py_DECREF(key);
+    Py_DECREF(count);
+    Py_DECREF(ms);
+  }
+  double requests = st.requests ? (double)st.requests : 1.0, batches = st.batches ? (double)st.batches : 1.0;
+  return Py_BuildValue("{s:K,s:K,s:K,s:d,s:d,s:d,s:N,s:N}", "requests", (unsigned long long)st.requests,
+                       "batches", (unsigned long long)st.batches, "errors", (unsigned long long)st.errors,
+                       "mean_batch", st.requests / batches, "mean_queue_ms", st.queueUs / requests / 1000.0,
+                       "mean_infer_ms", st.inferUs / batches / 1000.0, "batch_sizes", sizes, "cost_ms", cost);
+}
+
+PyMethodDef kBatchWorkerMethods[] = {
+  {"infer", batchWorkerInfer, METH_VARARGS,
+   "infer(jpeg) -> (probs, (red, green, blue))\nPrepare jpeg and run it in the next batch."},
+  {"input_size", batchWorkerInputSize, METH_NOARGS, "input_size() -> (width, height)"},
+  {"stats", batchWorkerStats, METH_NOARGS, "stats() -> dict of request, batch and timing counters"},
+  {nullptr, nullptr, 0, nullptr},
+};
+
+PyType_Slot kBatchWorkerSlots[] = {
+  {Py_tp_doc, const_cast<char*>("Micro-batching inference worker; see the module notes")},
+  {Py_tp_new, reinterpret_cast<void*>(PyType_GenericNew)},
+  {Py_tp_init, reinterpret_cast<void*>(batchWorkerInit)},
+  {Py_tp_dealloc, reinterpret_cast<void*>(batchWorkerDealloc)},
+  {Py_tp_methods, kBatchWorkerMethods},
+  {0, nullptr},
+};
+
+PyType_Spec kBatchWorkerSpec = {
+  "leafprep.BatchWorker", sizeof(PyBatchWorker), 0, Py_TPFLAGS_DEFAULT, kBatchWorkerSlots,
+};
+
+PyMethodDef kMethods[] = {
+  {"prepare", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(prepare)), METH_VARARGS | METH_KEYWORDS,
+   "prepare(jpeg, out, width=0, height=0) -> (red, green, blue)\n"
+   "Decode jpeg scaled to out's size into out (float32 0..1 or uint8) and return its mean colours."},
+  {"color_means", colorMeans, METH_VARARGS,
+   "color_means(jpeg) -> (red, green, blue)\nMean colours (0..1) from a 1/8-scale decode."},
+  {"crc16", crc16Py, METH_VARARGS, "crc16(data) -> int\nCRC16 of a batch frame, as lib/leafcam/crc16.h."},
+  {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef kModule = {
+  PyModuleDef_HEAD_INIT, "leafprep", "Native JPEG preprocessing for pi5_server.py", -1, kMethods,
+  nullptr, nullptr, nullptr, nullptr,
+};
+
+}  // namespace
+
+PyMODINIT_FUNC PyInit_leafprep(void) {
+  PyObject* m = PyModule_Create(&kModule);
+  if (!m) return nullptr;
+  PyObject* type = PyType_FromSpec(&kBatchWorkerSpec);
+  if (!type || PyModule_AddObject(m, "BatchWorker", type) < 0) {
+    Py_XDECREF(type);
+    Py_DECREF(m);
+    return nullptr;
+  }
+  return m;
+}
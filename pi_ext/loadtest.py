@@ -0,0 +1,137 @@
+"""Throughput and latency of leafprep.BatchWorker against batch window.
+
+    python pi_ext/loadtest.py [--cameras 8] [--rate 1.0] [--duration 20]
+                              [--windows 0,2,5,10,20,40] [--budget 250] [--max-batch 8]
+                              [--model leaf_resnet50_float.tflite | --simulate 30,20]
+
+--cameras hubs each upload --rate frames per second, at random (Poisson)
+times, cycling through the JPEGs in --images. Every upload runs in its own
+thread, as pi5_server.py's request threads do, and its latency is the time
+from its arrival to its result: preprocessing, queueing and inference.
+One run per batch window, plus the server's old behaviour (one frame at a
+time behind a lock) as "serial". Without --model the worker runs a
+stand-in whose batch of n takes fixed + n * per_item milliseconds
+(--simulate); measure those on the Pi with --model first.
+"""
+
+import argparse
+import os
+import random
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import leafprep  # noqa: E402
+
+
+def percentile(values, q):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, max(0, int(round(q / 100.0 * (len(ordered) - 1)))))
+    return ordered[index]
+
+
+def run(worker, frames, args, serial=False):
+    """Offered load for args.duration seconds; returns (latencies in ms, errors, seconds)."""
+    latencies = []
+    errors = [0]
+    lock = threading.Lock()
+    serial_lock = threading.Lock()
+
+    def upload(data, arrival):
+        try:
+            if serial:
+                with serial_lock:
+                    worker.infer(data)
+            else:
+                worker.infer(data)
+        except (RuntimeError, ValueError):
+            with lock:
+                errors[0] += 1
+            return
+        with lock:
+            latencies.append((time.perf_counter() - arrival) * 1000.0)
+
+    rng = random.Random(1)
+    start = time.perf_counter()
+    arrivals = []
+    for camera in range(args.cameras):
+        t = rng.expovariate(args.rate)
+        while t < args.duration:
+            arrivals.append((t, camera))
+            t += rng.expovariate(args.rate)
+    arrivals.sort()
+    with ThreadPoolExecutor(max_workers=max(4, args.cameras * 4)) as pool:
+        for index, (offset, camera) in enumerate(arrivals):
+            delay = start + offset - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            pool.submit(upload, frames[(index + camera) % len(frames)], start + offset)
+    return latencies, errors[0], time.perf_counter() - start
+
+
+def make_worker(args, window_ms, max_batch):
+    if args.model:
+        return leafprep.BatchWorker(
+            model=args.model, window_ms=window_ms, budget_ms=args.budget, max_batch=max_batch, threads=args.threads
+        )
+    fixed_ms, per_item_ms = (float(v) for v in args.simulate.split(","))
+    return leafprep.BatchWorker(
+        window_ms=window_ms,
+        budget_ms=args.budget,
+        max_batch=max_batch,
+        simulate=(fixed_ms, per_item_ms, args.size, args.classes),
+    )
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--images", default=os.path.join(here, "..", "upload"))
+    parser.add_argument("--cameras", type=int, default=8)
+    parser.add_argument("--rate", type=float, default=1.0, help="uploads per second per camera")
+    parser.add_argument("--duration", type=float, default=20.0, help="seconds per run")
+    parser.add_argument("--windows", default="0,2,5,10,20,40", help="batch windows to try, ms")
+    parser.add_argument("--budget", type=float, default=250.0, help="latency budget, ms")
+    parser.add_argument("--max-batch", type=int, default=8)
+    parser.add_argument("--model", help=".tflite model (needs libtensorflowlite_c)")
+    parser.add_argument("--threads", type=int, default=4, help="TFLite threads with --model")
+    parser.add_argument("--simulate", default="30,20", help="fixed_ms,per_item_ms without --model")
+    parser.add_argument("--size", type=int, default=224, help="model input size without --model")
+    parser.add_argument("--classes", type=int, default=38, help="model classes without --model")
+    args = parser.parse_args()
+
+    names = sorted(n for n in os.listdir(args.images) if n.lower().endswith((".jpg", ".jpeg")))
+    if not names:
+        print(f"loadtest: no JPEGs in '{args.images}'")
+        return 1
+    frames = []
+    for name in names:
+        with open(os.path.join(args.images, name), "rb") as fh:
+            frames.append(fh.read())
+
+    backend = f"model {args.model}" if args.model else f"simulated {args.simulate} ms (fixed,per item)"
+    print(
+        f"{args.cameras} cameras x {args.rate:g}/s = {args.cameras * args.rate:g} uploads/s offered, "
+        f"{args.duration:g} s per run, {backend}, budget {args.budget:g} ms"
+    )
+    print(f"{'window':>8} {'done/s':>7} {'p50 ms':>8} {'p99 ms':>8} {'max ms':>8} {'batch':>6} {'errors':>6}")
+    runs = [("serial", 0.0, 1)] + [(f"{w:g} ms", w, args.max_batch) for w in map(float, args.windows.split(","))]
+    for label, window_ms, max_batch in runs:
+        worker = make_worker(args, window_ms, max_batch)
+        latencies, errors, seconds = run(worker, frames, args, serial=label == "serial")
+        stats = worker.stats()
+        print(
+            f"{label:>8} {len(latencies) / seconds:7.2f} {percentile(latencies, 50):8.1f} "
+            f"{percentile(latencies, 99):8.1f} {max(latencies, default=0):8.1f} "
+            f"{stats['mean_batch']:6.2f} {errors:6d}"
+        )
+        del worker
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
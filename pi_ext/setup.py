@@ -0,0 +1,34 @@
+"""Build the leafprep extension for pi5_server.py.
+
+    sudo apt install libjpeg-dev        # libjpeg-turbo on Raspberry Pi OS
+    pip install ./pi_ext                # or: cd pi_ext && python setup.py build_ext --inplace
+
+pi5_server.py uses it when `import leafprep` works and falls back to PIL
+otherwise. pi_ext/bench.py compares the two over upload/.
+
+BatchWorker needs the TFLite C library at run time only (dlopen):
+libtensorflowlite_c.so on the library path or in $LEAFPREP_TFLITE_LIB.
+pi_ext/loadtest.py measures batching windows, with or without it.
+"""
+
+import os
+
+from setuptools import Extension, setup
+
+# crc16.h is shared with the hub and camera firmware
+LEAFCAM = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lib", "leafcam")
+
+setup(
+    name="leafprep",
+    version="1.0",
+    description="Native JPEG preprocessing for pi5_server.py",
+    ext_modules=[
+        Extension(
+            "leafprep",
+            sources=["leafprep.cpp", "batch_worker.cpp", "tflite_c.cpp"],
+            include_dirs=[LEAFCAM],
+            libraries=["jpeg", "dl"],
+            extra_compile_args=["-O3", "-std=c++17", "-pthread"],
+        )
+    ],
+)
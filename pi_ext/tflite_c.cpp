@@ -0,0 +1,63 @@
+#include "tflite_c.h"
+
+#include <dlfcn.h>
+#include <stdlib.h>
+
+#include <mutex>
+
+namespace {
+
+std::mutex gLoadLock;
+TfLiteApi gApi;
+bool gLoaded = false;
+
+template <typename Fn>
+bool resolve(void* lib, const char* name, Fn& fn, std::string& err) {
+  fn = reinterpret_cast<Fn>(dlsym(lib, name));
+  if (!fn) err = std::string("TFLite C API has no ") + name;
+  return fn != nullptr;
+}
+
+}  // namespace
+
+const TfLiteApi* loadTfLite(const std::string& path, std::string& err) {
+  std::lock_guard<std::mutex> g(gLoadLock);
+  if (gLoaded) return &gApi;
+  std::string lib = path;
+  if (lib.empty()) {
+    const char* env = getenv("LEAFPREP_TFLITE_LIB");
+    lib = env && *env ? env : "libtensorflowlite_c.so";
+  }
+  void* h = dlopen(lib.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!h) {
+    const char* why = dlerror();
+    err = why ? why : "cannot load " + lib;
+    return nullptr;
+  }
+  TfLiteApi a;
+  bool ok = resolve(h, "TfLiteModelCreateFromFile", a.ModelCreateFromFile, err) &&
+            resolve(h, "TfLiteModelDelete", a.ModelDelete, err) &&
+            resolve(h, "TfLiteInterpreterOptionsCreate", a.InterpreterOptionsCreate, err) &&
+            resolve(h, "TfLiteInterpreterOptionsDelete", a.InterpreterOptionsDelete, err) &&
+            resolve(h, "TfLiteInterpreterOptionsSetNumThreads", a.InterpreterOptionsSetNumThreads, err) &&
+            resolve(h, "TfLiteInterpreterCreate", a.InterpreterCreate, err) &&
+            resolve(h, "TfLiteInterpreterDelete", a.InterpreterDelete, err) &&
+            resolve(h, "TfLiteInterpreterGetInputTensor", a.InterpreterGetInputTensor, err) &&
+            resolve(h, "TfLiteInterpreterGetOutputTensor", a.InterpreterGetOutputTensor, err) &&
+            resolve(h, "TfLiteInterpreterResizeInputTensor", a.InterpreterResizeInputTensor, err) &&
+            resolve(h, "TfLiteInterpreterAllocateTensors", a.InterpreterAllocateTensors, err) &&
+            resolve(h, "TfLiteInterpreterInvoke", a.InterpreterInvoke, err) &&
+            resolve(h, "TfLiteTensorType", a.TensorType, err) &&
+            resolve(h, "TfLiteTensorNumDims", a.TensorNumDims, err) &&
+            resolve(h, "TfLiteTensorDim", a.TensorDim, err) &&
+            resolve(h, "TfLiteTensorByteSize", a.TensorByteSize, err) &&
+            resolve(h, "TfLiteTensorData", a.TensorData, err) &&
+            resolve(h, "TfLiteTensorQuantizationParams", a.TensorQuantizationParams, err);
+  if (!ok) {
+    dlclose(h);
+    return nullptr;
+  }
+  gApi = a;
+  gLoaded = true;  // the library stays loaded for the life of the process
+  return &gApi;
+}
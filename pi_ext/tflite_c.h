@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// ====== TFLite C API, loaded at run time ======
+// The few TFLite C API calls the batch worker needs, resolved with dlopen
+// from libtensorflowlite_c.so (or the path given), so leafprep builds and
+// imports without TFLite and only the worker needs it. Declarations follow
+// tensorflow/lite/c/c_api.h; the structs stay opaque.
+
+struct TfLiteModel;
+struct TfLiteInterpreterOptions;
+struct TfLiteInterpreter;
+struct TfLiteTensor;
+
+enum { kTfLiteOk = 0 };
+enum { kTfLiteFloat32 = 1, kTfLiteUInt8 = 3 };
+
+struct TfLiteQuantizationParams {
+  float scale;
+  int32_t zero_point;
+};
+
+struct TfLiteApi {
+  TfLiteModel* (*ModelCreateFromFile)(const char*);
+  void (*ModelDelete)(TfLiteModel*);
+  TfLiteInterpreterOptions* (*InterpreterOptionsCreate)();
+  void (*InterpreterOptionsDelete)(TfLiteInterpreterOptions*);
+  void (*InterpreterOptionsSetNumThreads)(TfLiteInterpreterOptions*, int32_t);
+  TfLiteInterpreter* (*InterpreterCreate)(const TfLiteModel*, const TfLiteInterpreterOptions*);
+  void (*InterpreterDelete)(TfLiteInterpreter*);
+  TfLiteTensor* (*InterpreterGetInputTensor)(const TfLiteInterpreter*, int32_t);
+  const TfLiteTensor* (*InterpreterGetOutputTensor)(const TfLiteInterpreter*, int32_t);
+  int (*InterpreterResizeInputTensor)(TfLiteInterpreter*, int32_t, const int*, int32_t);
+  int (*InterpreterAllocateTensors)(TfLiteInterpreter*);
+  int (*InterpreterInvoke)(TfLiteInterpreter*);
+  int (*TensorType)(const TfLiteTensor*);
+  int32_t (*TensorNumDims)(const TfLiteTensor*);
+  int32_t (*TensorDim)(const TfLiteTensor*, int32_t);
+  size_t (*TensorByteSize)(const TfLiteTensor*);
+  void* (*TensorData)(const TfLiteTensor*);
+  TfLiteQuantizationParams (*TensorQuantizationParams)(const TfLiteTensor*);
+};
+
+// Loads the library once; later calls return the same table. Null (and
+// err) when it or one of the symbols is missing. path "" means
+// $LEAFPREP_TFLITE_LIB, else libtensorflowlite_c.so.
+const TfLiteApi* loadTfLite(const std::string& path, std::string& err);
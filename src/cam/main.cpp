@@ -29,6 +29,75 @@
 #define CAM_UART_RX        3       // U0RXD
 #define CAM_UART_TX        1       // U0TXD
 
+// RS-485 bus with other cameras (hub built with HUB_CAM_BUS=1): a unique
+// address 1..8 here, 0 for a point-to-point UART. On the bus, commands are
+// '@' + address + ~address + 'T' or 'G' + 4-byte capture ID; 'T' takes the
+// picture and keeps it, 'G' sends it as an addressed 'A' frame, an empty
+// 'A' frame if the capture failed. Everything else (other cameras' frames,
+// preview commands) is ignored.
+#ifndef CAM_BUS_ADDR
+#define CAM_BUS_ADDR 0
+#endif
+#ifndef CAM_RS485_DE_PIN
+#define CAM_RS485_DE_PIN -1   // driver enable, e.g. 13; -1 for auto-direction transceivers
+#endif
+#define CAM_BUS_HOLD_MS 10000  // a frame nobody asked for is dropped after this
+
+// Link to the hub: the UART above or, with CAM_LINK_TCP=1, a TCP connection
+// over WiFi to the hub's camera port (hub built with HUB_CAM_TRANSPORT=1).
+// Commands and frames are the same. The defaults join the hub's fallback AP.
+#ifndef CAM_LINK_TCP
+#define CAM_LINK_TCP 0
+#endif
+#ifndef CAM_WIFI_SSID
+#define CAM_WIFI_SSID "cam-hub"
+#endif
+#ifndef CAM_WIFI_PASS
+#define CAM_WIFI_PASS "12345678"
+#endif
+#ifndef CAM_HUB_HOST
+#define CAM_HUB_HOST "192.168.4.1"
+#endif
+#ifndef CAM_HUB_PORT
+#define CAM_HUB_PORT 5000     // HUB_CAM_TCP_PORT
+#endif
+#if CAM_LINK_TCP && CAM_BUS_ADDR
+#error "A bus camera talks over the RS-485 UART (CAM_LINK_TCP=0)"
+#endif
+#if CAM_LINK_TCP
+#include <WiFi.h>
+static WiFiClient gHubClient;
+#endif
+static Stream* gLink = &Serial;  // where commands come from and frames go
+
+// On-camera triage (hub built with HUB_CAM_TRIAGE=1): command 'Q' + 4-byte
+// capture ID takes a still like 'T' and runs the triage model on it. When
+// the frame shows no leaf or a healthy one with at least
+// CAM_TRIAGE_MIN_CONFIDENCE, only the verdict goes back (a 'V' frame of
+// four bytes instead of ~40 KB); otherwise the still is sent as for 'T'.
+#ifndef CAM_TRIAGE
+#define CAM_TRIAGE 0
+#endif
+#ifndef CAM_TRIAGE_MIN_CONFIDENCE
+#define CAM_TRIAGE_MIN_CONFIDENCE 0.8f
+#endif
+#if CAM_TRIAGE
+#include "leaf_triage.h"
+static LeafTriage gTriage;  // ~11 KB of activations, kept out of the stack
+#endif
+
+// Still frames (command 'C')
+#define CAM_STILL_FRAMESIZE  FRAMESIZE_VGA
+#define CAM_STILL_QUALITY    12
+
+// Live preview (command 'S' + fps byte starts it or keeps it going, 'X'
+// stops it). Small, low-quality frames so several per second fit the link;
+// without a fresh 'S' the camera stops by itself, e.g. after a hub reset.
+#define CAM_PREVIEW_FRAMESIZE  FRAMESIZE_QVGA   // 320x240
+#define CAM_PREVIEW_QUALITY    30
+#define CAM_PREVIEW_MAX_FPS    15
+#define CAM_PREVIEW_TIMEOUT_MS 3000
+
 // simple CRC16 (Modbus-ish)
 static uint16_t crc16(const uint8_t* data, size_t n) {
   uint16_t crc = 0xFFFF;
@@ -45,6 +114,10 @@ static uint16_t crc16(const uint8_t* data, size_t n) {
 void setup() {
   pinMode(FLASH_GPIO, OUTPUT);
   digitalWrite(FLASH_GPIO, LOW);
+#if CAM_RS485_DE_PIN >= 0
+  pinMode(CAM_RS485_DE_PIN, OUTPUT);
+  digitalWrite(CAM_RS485_DE_PIN, LOW);  // listen
+#endif
 
   Serial.begin(115200);
   delay(200);
@@ -54,6 +127,7 @@ void setup() {
   Serial.end();
   delay(50);
   Serial.begin(CAM_UART_BAUD);
+  Serial.setTimeout(50);  // command arguments follow the command byte directly
   delay(100);
 
   camera_config_t config;
@@ -76,11 +150,11 @@ void setup() {
   config.pin_pwdn     = PWDN_GPIO_NUM;
   config.pin_reset    = RESET_GPIO_NUM;
   config.xclk_freq_hz = 20000000;
-  config.frame_size   = FRAMESIZE_VGA;    // 640x480
+  config.frame_size   = CAM_STILL_FRAMESIZE;  // 640x480
   config.pixel_format = PIXFORMAT_JPEG;
   config.grab_mode    = CAMERA_GRAB_WHEN_EMPTY;
   config.fb_location  = CAMERA_FB_IN_PSRAM;
-  config.jpeg_quality = 12;               // ~good JPG size
+  config.jpeg_quality = CAM_STILL_QUALITY;    // ~good JPG size
   config.fb_count     = 1;
 
   esp_err_t err = esp_camera_init(&config);
@@ -92,6 +166,12 @@ void setup() {
     }
   }
 
+#if CAM_LINK_TCP
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(CAM_WIFI_SSID, CAM_WIFI_PASS);
+  gLink = &gHubClient;
+#endif
+
   // Warm-up: capture and discard one frame to stabilize sensor
   for (int i = 0; i < 1; ++i) {
     camera_fb_t* fb = esp_camera_fb_get();
@@ -100,59 +180,241 @@ void setup() {
   }
 }
 
-void loop() {
-  // Wait for a single-byte command 'C'
-  if (Serial.available()) {
-    int c = Serial.read();
-    if (c == 'C') {
-      // small pre-flash
-      digitalWrite(FLASH_GPIO, HIGH);
-      delay(80);
-
-      camera_fb_t* fb = nullptr;
-      for (int i = 0; i < 2; ++i) {
-        fb = esp_camera_fb_get();
-        if (!fb) break;
-        // Drop the first buffered frame so the second fetch is the freshest
-        if (i == 0) {
-          esp_camera_fb_return(fb);
-          fb = nullptr;
-          delay(40);
-        }
-      }
-      digitalWrite(FLASH_GPIO, LOW);
-
-      if (!fb || fb->len < 8) {
-        const char errSig[4] = {'P','V','I','E'};
-        Serial.write((const uint8_t*)errSig, 4);
-        uint32_t zero = 0;
-        Serial.write((uint8_t*)&zero, 4);
-        uint16_t zcrc = 0;
-        Serial.write((uint8_t*)&zcrc, 2);
-        if (fb) esp_camera_fb_return(fb);
-        return;
-      }
+static bool gPreview = false;
+static uint32_t gPreviewIntervalMs = 200;
+static uint32_t gPreviewLastFrameMs = 0;
+static uint32_t gPreviewLastRequestMs = 0;
 
-      // header
-      const char magic[4] = {'P','V','I','C'};
-      Serial.write((const uint8_t*)magic, 4);
-      // big-endian length
-      uint32_t L = fb->len;
-      uint8_t lenBE[4] = { (uint8_t)(L>>24), (uint8_t)(L>>16), (uint8_t)(L>>8), (uint8_t)L };
-      Serial.write(lenBE, 4);
+// 'P''V''I'<type> + 4-byte BE length + 2-byte BE CRC16 [+ ext] + payload
+static void sendFrame(char type, const uint8_t* buf, size_t len,
+                      const uint8_t* ext = nullptr, size_t extLen = 0) {
+  const char magic[4] = {'P','V','I',type};
+  gLink->write((const uint8_t*)magic, 4);
+  // big-endian length
+  uint32_t L = len;
+  uint8_t lenBE[4] = { (uint8_t)(L>>24), (uint8_t)(L>>16), (uint8_t)(L>>8), (uint8_t)L };
+  gLink->write(lenBE, 4);
 
-      // crc16
-      uint16_t crc = crc16(fb->buf, fb->len);
-      uint8_t crcBE[2] = { (uint8_t)(crc>>8), (uint8_t)crc };
-      Serial.write(crcBE, 2);
+  // crc16
+  uint16_t crc = len ? crc16(buf, len) : 0;
+  uint8_t crcBE[2] = { (uint8_t)(crc>>8), (uint8_t)crc };
+  gLink->write(crcBE, 2);
 
-      // body
-      Serial.write(fb->buf, fb->len);
+  // header extension ('T' and 'V' frames: capture ID + camera time)
+  if (extLen) gLink->write(ext, extLen);
 
+  // body
+  if (len) gLink->write(buf, len);
+}
+
+// Switch the sensor between still and preview output. The change applies
+// from the next exposure, so the frame already in flight is dropped.
+static void setPreviewMode(bool on) {
+  sensor_t* s = esp_camera_sensor_get();
+  if (!s) return;
+  s->set_framesize(s, on ? CAM_PREVIEW_FRAMESIZE : CAM_STILL_FRAMESIZE);
+  s->set_quality(s, on ? CAM_PREVIEW_QUALITY : CAM_STILL_QUALITY);
+  camera_fb_t* fb = esp_camera_fb_get();
+  if (fb) esp_camera_fb_return(fb);
+}
+
+// Flash, drop the stale buffered frame and take a fresh one (null on failure)
+static camera_fb_t* takeStill() {
+  // small pre-flash
+  digitalWrite(FLASH_GPIO, HIGH);
+  delay(80);
+
+  camera_fb_t* fb = nullptr;
+  for (int i = 0; i < 2; ++i) {
+    fb = esp_camera_fb_get();
+    if (!fb) break;
+    // Drop the first buffered frame so the second fetch is the freshest
+    if (i == 0) {
       esp_camera_fb_return(fb);
+      fb = nullptr;
+      delay(40);
+    }
+  }
+  digitalWrite(FLASH_GPIO, LOW);
+  if (fb && fb->len < 8) {
+    esp_camera_fb_return(fb);
+    fb = nullptr;
+  }
+  return fb;
+}
+
+#if CAM_TRIAGE
+// Triage of a still: true (and the verdict payload) when the frame needs
+// no analysis with enough confidence
+static bool triageStill(const camera_fb_t* fb, uint8_t verdict[4]) {
+  uint32_t t0 = millis();
+  TriageResult r;
+  if (!gTriage.classifyJpeg(fb->buf, fb->len, r)) return false;
+  if (r.cls == TRIAGE_ANALYSE || r.confidence < CAM_TRIAGE_MIN_CONFIDENCE) return false;
+  uint32_t ms = millis() - t0;
+  if (ms > 0xFFFF) ms = 0xFFFF;
+  verdict[0] = (uint8_t)r.cls;
+  verdict[1] = (uint8_t)(r.confidence * 255 + 0.5f);
+  verdict[2] = (uint8_t)(ms >> 8);
+  verdict[3] = (uint8_t)ms;
+  return true;
+}
+#endif
+
+// Still capture. With traceId (command 'T') the frame is sent as 'T' with
+// the hub's capture ID and the milliseconds spent here, from the command to
+// the first byte on the wire, appended to the header. With triage (command
+// 'Q') a confident verdict goes out as a 'V' frame in its place.
+static void sendStill(const uint8_t* traceId = nullptr, bool triage = false) {
+  uint32_t t0 = millis();
+  if (gPreview) setPreviewMode(false);
+
+  camera_fb_t* fb = takeStill();
+  if (!fb) {
+    sendFrame('E', nullptr, 0);
+  } else if (traceId) {
+    uint8_t verdict[4];
+    bool decided = false;
+#if CAM_TRIAGE
+    decided = triage && triageStill(fb, verdict);
+#else
+    (void)triage;
+#endif
+    uint32_t ms = millis() - t0;
+    if (ms > 0xFFFF) ms = 0xFFFF;
+    uint8_t ext[6] = { traceId[0], traceId[1], traceId[2], traceId[3],
+                       (uint8_t)(ms >> 8), (uint8_t)ms };
+    if (decided) {
+      sendFrame('V', verdict, sizeof(verdict), ext, sizeof(ext));
+    } else {
+      sendFrame('T', fb->buf, fb->len, ext, sizeof(ext));
+    }
+  } else {
+    sendFrame('C', fb->buf, fb->len);
+  }
+  if (fb) esp_camera_fb_return(fb);
+
+  // Viewers keep their preview across a capture
+  if (gPreview) setPreviewMode(true);
+}
+
+#if CAM_BUS_ADDR
+// Bus camera: the picture taken on 'T', kept until its grant
+static camera_fb_t* gHeldFb = nullptr;
+static bool gHeld = false;        // a 'T' was answered with a picture or a failure
+static uint8_t gHeldId[4];
+static uint16_t gHeldMs = 0;
+static uint32_t gHeldAtMs = 0;
+
+static void dropHeld() {
+  if (gHeldFb) esp_camera_fb_return(gHeldFb);
+  gHeldFb = nullptr;
+  gHeld = false;
+}
+
+// '@' was read: the rest of the command, if it is for this camera
+static void busCommand() {
+  uint8_t cmd[7];
+  if (gLink->readBytes(cmd, sizeof(cmd)) != sizeof(cmd)) return;
+  if (cmd[0] != CAM_BUS_ADDR || cmd[1] != (uint8_t)~CAM_BUS_ADDR) return;
+  const uint8_t* id = cmd + 3;
+  if (cmd[2] == 'T') {
+    dropHeld();
+    uint32_t t0 = millis();
+    gHeldFb = takeStill();
+    uint32_t ms = millis() - t0;
+    gHeldMs = ms > 0xFFFF ? 0xFFFF : (uint16_t)ms;
+    memcpy(gHeldId, id, sizeof(gHeldId));
+    gHeld = true;
+    gHeldAtMs = millis();
+  } else if (cmd[2] == 'G' && gHeld && memcmp(id, gHeldId, sizeof(gHeldId)) == 0) {
+    uint8_t ext[7] = { gHeldId[0], gHeldId[1], gHeldId[2], gHeldId[3],
+                       (uint8_t)(gHeldMs >> 8), (uint8_t)gHeldMs, (uint8_t)CAM_BUS_ADDR };
+#if CAM_RS485_DE_PIN >= 0
+    digitalWrite(CAM_RS485_DE_PIN, HIGH);
+#endif
+    if (gHeldFb) {
+      sendFrame('A', gHeldFb->buf, gHeldFb->len, ext, sizeof(ext));
+    } else {
+      sendFrame('A', nullptr, 0, ext, sizeof(ext));
+    }
+    gLink->flush();  // last byte out before the bus is released
+#if CAM_RS485_DE_PIN >= 0
+    digitalWrite(CAM_RS485_DE_PIN, LOW);
+#endif
+    dropHeld();
+  }
+}
+#endif
+
+static void sendPreviewFrame() {
+  camera_fb_t* fb = esp_camera_fb_get();
+  if (!fb) return;
+  sendFrame('S', fb->buf, fb->len);
+  esp_camera_fb_return(fb);
+}
+
+void loop() {
+#if CAM_LINK_TCP
+  // (Re)connect to the hub; nothing to do until it answers
+  static uint32_t lastConnectMs = 0;
+  if (!gHubClient.connected()) {
+    if (WiFi.status() == WL_CONNECTED && millis() - lastConnectMs > 1000) {
+      lastConnectMs = millis();
+      if (gHubClient.connect(CAM_HUB_HOST, CAM_HUB_PORT)) gHubClient.setNoDelay(true);
+    }
+    return;
+  }
+#endif
+#if CAM_BUS_ADDR
+  if (gLink->available() && gLink->read() == '@') busCommand();
+  if (gHeld && millis() - gHeldAtMs > CAM_BUS_HOLD_MS) dropHeld();
+  return;
+#endif
+  if (gLink->available()) {
+    int c = gLink->read();
+    if (c == 'C') {
+      sendStill();
+    } else if (c == 'T' || c == 'Q') {
+      // 4-byte capture ID follows the command
+      uint8_t id[4];
+      if (gLink->readBytes(id, sizeof(id)) == sizeof(id)) {
+        sendStill(id, c == 'Q');
+      } else {
+        sendFrame('E', nullptr, 0);
+      }
+    } else if (c == 'S') {
+      // fps byte follows the command
+      uint32_t t0 = millis();
+      while (!gLink->available() && millis() - t0 < 20) {}
+      int fps = gLink->available() ? gLink->read() : 5;
+      if (fps < 1) fps = 1;
+      if (fps > CAM_PREVIEW_MAX_FPS) fps = CAM_PREVIEW_MAX_FPS;
+      gPreviewIntervalMs = 1000 / fps;
+      gPreviewLastRequestMs = millis();
+      if (!gPreview) {
+        setPreviewMode(true);
+        gPreview = true;
+      }
+    } else if (c == 'X') {
+      if (gPreview) {
+        gPreview = false;
+        setPreviewMode(false);
+      }
     } else {
       // drain unexpected
-      while (Serial.available()) Serial.read();
+      while (gLink->available()) gLink->read();
+    }
+  }
+
+  if (gPreview) {
+    uint32_t now = millis();
+    if (now - gPreviewLastRequestMs > CAM_PREVIEW_TIMEOUT_MS) {
+      gPreview = false;
+      setPreviewMode(false);
+    } else if (now - gPreviewLastFrameMs >= gPreviewIntervalMs) {
+      gPreviewLastFrameMs = now;
+      sendPreviewFrame();
     }
   }
 }
@@ -2,24 +2,43 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include "batch_frame.h"
+#include "camera_scheduler.h"
+#include "camera_transport.h"
+#include "crc16.h"
+#include "history_store.h"
+#include "http_cache.h"
+#include "http_event.h"
+#include "http_routes.h"
+#include "http_socket.h"
+#include "jpeg_dc.h"
+#include "jpeg_scan.h"
+#include "leaf_stats.h"
+#include "leaf_triage.h"
+#include "log_ring.h"
+#include "oled_layout.h"
+#include "phash.h"
+#include "pi_protocol.h"
+#include "result_cache.h"
+#include "stage_metrics.h"
+#include "uart_frame.h"
+#include "web_assets.h"
 // Forward declaration for OLED message function
 void oledMsg(const String& l1, const String& l2 = "", const String& l3 = "");
 // Pi 5 server endpoints (set your Pi 5 IP)
 #define PI5_UPLOAD_URL "http://10.141.5.128:8000/upload"
 // Optional polling endpoint if you implement it on Pi:
 #define PI5_RESULT_URL "http://10.141.5.128:8000/result"
+// Batched uploads (HUB_BATCH_UPLOAD=1): several frames per request, see batch_frame.h
+#define PI5_BATCH_URL "http://10.141.5.128:8000/upload_batch"
+#define PI5_TIMEOUT_MS 10000
 // LED and buzzer pins
 #define GREEN_LED_PIN 27
 #define RED_LED_PIN 26
 #define BUZZER_PIN 25
 
-static bool gProcessingActive = false;
-static unsigned long gLastRedBlinkMs = 0;
-static bool gRedBlinkState = false;
-static bool gGreenPulseActive = false;
-static unsigned long gGreenPulseEndMs = 0;
-static bool gBuzzerActive = false;
-static unsigned long gBuzzerEndMs = 0;
 static bool gWaitingForResult = false;
 static bool gResultDisplayed = false;
 static String gPendingTimestamp;
@@ -28,10 +47,225 @@ static String gPendingDisease;
 static String gPendingSolution;
 static String gDisplayedTimestamp;
 
-void updateIndicators();
+// Identity of a captured frame: exact key for the result cache plus its
+// perceptual fingerprint for near-duplicate suppression
+struct FrameTag {
+  FrameKey key;
+  uint64_t phash = 0;
+  bool hasPhash = false;
+  // Capture ID sent to the camera and the Pi, with the time the camera took
+  // (command to first byte) and the whole trigger-to-CRC-verified transfer
+  uint32_t captureId = 0;
+  uint16_t camMs = 0;
+  uint32_t linkMs = 0;
+  uint8_t cam = 0;  // index of the camera that took it (HUB_CAMERAS > 1)
+  // Mean colours from the same DC decode as the fingerprint (HUB_LEAF_STATS)
+  LeafStats stats;
+  bool hasStats = false;
+  JpegInfo jpeg;  // size and estimated quality from the headers
+};
+static FrameTag gPendingTag;  // frame whose result is still expected via /result
+static uint32_t gPendingCaptureId = 0;  // last uploaded capture, matched against /result
+
 void clearProcessingState();
-void startGreenPulse(unsigned long durationMs = 1500);
-void startBuzzerPulse(unsigned long durationMs = 5000);
+static void pushEvent(const char* event, JsonDocument& doc);
+
+// Button-to-OLED tracepoints and error counts, served at /metrics
+static StageMetrics gMetrics;
+
+// ====== Capture history ======
+// Every verified frame goes to the "history" flash partition
+// (partitions_hub.csv) with its stage timings and, once it arrives, its
+// result; /history pages through the last HUB_HISTORY_ENTRIES of them (see
+// history_store.h). 0 disables it. HUB_HISTORY_RESERVE is kept erased ahead
+// from loop() so storing a frame costs no erase.
+#ifndef HUB_HISTORY_ENTRIES
+#define HUB_HISTORY_ENTRIES 128
+#endif
+#ifndef HUB_HISTORY_RESERVE
+#define HUB_HISTORY_RESERVE (64 * 1024)
+#endif
+
+class FlashHistoryStorage : public HistoryStorage {
+ public:
+  bool begin(const char* label) {
+    part_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    return part_ != nullptr;
+  }
+  uint32_t size() const override { return part_ ? part_->size : 0; }
+  uint32_t blockSize() const override { return SPI_FLASH_SEC_SIZE; }
+  bool erase(uint32_t offset, uint32_t len) override {
+    return esp_partition_erase_range(part_, offset, len) == ESP_OK;
+  }
+  bool write(uint32_t offset, const void* data, uint32_t len) override {
+    return esp_partition_write(part_, offset, data, len) == ESP_OK;
+  }
+  bool read(uint32_t offset, void* data, uint32_t len) override {
+    return esp_partition_read(part_, offset, data, len) == ESP_OK;
+  }
+
+ private:
+  const esp_partition_t* part_ = nullptr;
+};
+
+static FlashHistoryStorage gHistoryFlash;
+static std::unique_ptr<HistoryStore> gHistory;  // null without the partition
+static uint32_t gHistoryId = 0;         // newest frame, until its result is stored
+static uint32_t gHistoryTriggerMs = 0;  // its capture trigger
+static uint32_t gHistoryFrameMs = 0;    // its CRC check
+
+static uint16_t historyMs(uint32_t ms) {
+  return ms < HISTORY_NO_TIME ? (uint16_t)ms : (uint16_t)(HISTORY_NO_TIME - 1);
+}
+
+static void initHistory() {
+  if (!HUB_HISTORY_ENTRIES || !gHistoryFlash.begin("history")) return;
+  gHistory.reset(new HistoryStore(gHistoryFlash, HUB_HISTORY_ENTRIES));
+  gHistory->open();
+  gHistory->setReserve(HUB_HISTORY_RESERVE);
+}
+
+static void recordHistoryResult(const String& leaf, const String& disease,
+                                const String& solution) {
+  if (!gHistory || !gHistoryId) return;
+  uint32_t now = millis();
+  String text = leaf + "\n" + disease + "\n" + solution;
+  gHistory->setResult(gHistoryId, text.c_str(), historyMs(now - gHistoryFrameMs),
+                      historyMs(now - gHistoryTriggerMs));
+  gHistoryId = 0;
+}
+
+// ====== Indicators ======
+// LED and buzzer patterns are played by esp_timer one-shot callbacks, so
+// their timing is exact however long loop() or a UART read blocks, and the
+// receive loops do no indicator bookkeeping. A pattern is a list of
+// (level, ms) steps; ms 0 holds the level until the next pattern, and a
+// repeating pattern starts over after its last step.
+struct IndicatorStep {
+  uint8_t level;
+  uint16_t ms;
+};
+struct IndicatorPattern {
+  const IndicatorStep* steps;
+  uint8_t count;
+  bool repeat;
+};
+enum IndicatorId : uint8_t { IND_RED, IND_GREEN, IND_BUZZER, IND_COUNT };
+enum IndicatorPatternId : uint8_t {
+  PATTERN_OFF,
+  PATTERN_ON,
+  PATTERN_PROCESSING,  // red while capturing/uploading
+  PATTERN_RESULT_LED,  // green when a result is shown
+  PATTERN_RESULT_BEEP,
+};
+
+static const IndicatorStep STEPS_OFF[] = { {LOW, 0} };
+static const IndicatorStep STEPS_ON[] = { {HIGH, 0} };
+static const IndicatorStep STEPS_BLINK_250[] = { {HIGH, 250}, {LOW, 250} };
+static const IndicatorStep STEPS_PULSE_1500[] = { {HIGH, 1500}, {LOW, 0} };
+static const IndicatorStep STEPS_PULSE_400[] = { {HIGH, 400}, {LOW, 0} };
+static const IndicatorPattern INDICATOR_PATTERNS[] = {
+  { STEPS_OFF, 1, false },
+  { STEPS_ON, 1, false },
+  { STEPS_BLINK_250, 2, true },
+  { STEPS_PULSE_1500, 2, false },
+  { STEPS_PULSE_400, 2, false },
+};
+
+struct Indicator {
+  uint8_t pin;
+  esp_timer_handle_t timer;
+  const IndicatorPattern* pattern;
+  uint8_t step;
+  int64_t dueUs;  // when the armed step ends
+  uint32_t gen;   // bumped per step entered, so a late applyStep() is ignored
+};
+static Indicator gIndicators[IND_COUNT] = {
+  { RED_LED_PIN, nullptr, nullptr, 0, 0, 0 },
+  { GREEN_LED_PIN, nullptr, nullptr, 0, 0, 0 },
+  { BUZZER_PIN, nullptr, nullptr, 0, 0, 0 },
+};
+static portMUX_TYPE gIndicatorMux = portMUX_INITIALIZER_UNLOCKED;
+
+// A step decided under the mux and carried out after it is released: the
+// esp_timer calls take locks of their own and must not run with interrupts
+// masked
+struct IndicatorAction {
+  bool due = false;
+  uint8_t level = LOW;
+  uint16_t ms = 0;  // 0 holds the level
+  uint32_t gen = 0;
+};
+
+// Makes the current step the one due and notes when it ends (mux held)
+static IndicatorAction enterStep(Indicator& ind) {
+  const IndicatorStep& st = ind.pattern->steps[ind.step];
+  ind.dueUs = st.ms ? esp_timer_get_time() + (int64_t)st.ms * 1000 : INT64_MAX;
+  IndicatorAction a;
+  a.due = true;
+  a.level = st.level;
+  a.ms = st.ms;
+  a.gen = ++ind.gen;
+  return a;
+}
+
+// Outputs a step and arms the timer for its end (mux released), unless a
+// newer step was entered meanwhile
+static void applyStep(Indicator& ind, const IndicatorAction& a) {
+  if (!a.due) return;
+  portENTER_CRITICAL(&gIndicatorMux);
+  bool current = a.gen == ind.gen;
+  portEXIT_CRITICAL(&gIndicatorMux);
+  if (!current) return;
+  esp_timer_stop(ind.timer);
+  digitalWrite(ind.pin, a.level);
+  if (a.ms) esp_timer_start_once(ind.timer, (uint64_t)a.ms * 1000);
+}
+
+static void indicatorTimer(void* arg) {
+  Indicator& ind = *static_cast<Indicator*>(arg);
+  IndicatorAction a;
+  portENTER_CRITICAL(&gIndicatorMux);
+  // A callback already dispatched when the pattern was replaced is stale
+  if (ind.pattern && esp_timer_get_time() >= ind.dueUs) {
+    bool wrapped = ++ind.step >= ind.pattern->count;
+    if (wrapped) ind.step = ind.pattern->repeat ? 0 : ind.pattern->count - 1;
+    if (!wrapped || ind.pattern->repeat) a = enterStep(ind);
+  }
+  portEXIT_CRITICAL(&gIndicatorMux);
+  applyStep(ind, a);
+}
+
+// Replaces whatever id is playing; callable from any task
+static void playIndicator(IndicatorId id, IndicatorPatternId pattern) {
+  Indicator& ind = gIndicators[id];
+  if (!ind.timer) return;
+  portENTER_CRITICAL(&gIndicatorMux);
+  ind.pattern = &INDICATOR_PATTERNS[pattern];
+  ind.step = 0;
+  IndicatorAction a = enterStep(ind);
+  portEXIT_CRITICAL(&gIndicatorMux);
+  applyStep(ind, a);
+}
+
+static void initIndicators() {
+  for (uint8_t i = 0; i < IND_COUNT; ++i) {
+    pinMode(gIndicators[i].pin, OUTPUT);
+    esp_timer_create_args_t args = {};
+    args.callback = indicatorTimer;
+    args.arg = &gIndicators[i];
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "indicator";
+    esp_timer_create(&args, &gIndicators[i].timer);
+    playIndicator((IndicatorId)i, PATTERN_OFF);
+  }
+}
+
+// Steady red after a failed capture or upload
+static void indicateFailure() {
+  playIndicator(IND_RED, PATTERN_ON);
+  playIndicator(IND_GREEN, PATTERN_OFF);
+}
 
 void showResultOnOLED(const String& leaf, const String& disease, const String& solution) {
   clearProcessingState();
@@ -42,86 +276,69 @@ void showResultOnOLED(const String& leaf, const String& disease, const String& s
   gResultDisplayed = true;
   gWaitingForResult = false;
   gPendingTimestamp = "";
+  gPendingCaptureId = 0;
   gPendingLeaf = safeLeaf;
   gPendingDisease = safeDisease;
   gPendingSolution = safeSolution;
-  startGreenPulse(1500);
-  startBuzzerPulse(400);
+  recordHistoryResult(safeLeaf, safeDisease, safeSolution);
+  playIndicator(IND_GREEN, PATTERN_RESULT_LED);
+  playIndicator(IND_BUZZER, PATTERN_RESULT_BEEP);
+  gMetrics.mark(STAGE_RESULT_DISPLAYED, micros());
+
+  DynamicJsonDocument ev(512);
+  ev["leaf_name"] = safeLeaf;
+  ev["disease"] = safeDisease;
+  ev["solution"] = safeSolution;
+  pushEvent("result", ev);
 }
 
 void setProcessingState() {
-  gProcessingActive = true;
-  gLastRedBlinkMs = millis();
-  gRedBlinkState = true;
-  digitalWrite(RED_LED_PIN, HIGH);
-  gGreenPulseActive = false;
-  gGreenPulseEndMs = 0;
+  playIndicator(IND_RED, PATTERN_PROCESSING);
+  playIndicator(IND_GREEN, PATTERN_OFF);
+  playIndicator(IND_BUZZER, PATTERN_OFF);
   gWaitingForResult = false;
   gResultDisplayed = false;
   gPendingTimestamp = "";
   gPendingLeaf = "";
   gPendingDisease = "";
   gPendingSolution = "";
-  digitalWrite(GREEN_LED_PIN, LOW);
-  gBuzzerActive = false;
-  gBuzzerEndMs = 0;
-  digitalWrite(BUZZER_PIN, LOW);
+  gPendingTag = FrameTag();
+  gPendingCaptureId = 0;
 }
 
 void clearProcessingState() {
-  gProcessingActive = false;
-  gRedBlinkState = false;
-  digitalWrite(RED_LED_PIN, LOW);
+  playIndicator(IND_RED, PATTERN_OFF);
   gWaitingForResult = false;
 }
-
-void startGreenPulse(unsigned long durationMs) {
-  gGreenPulseActive = true;
-  gGreenPulseEndMs = millis() + durationMs;
-  digitalWrite(GREEN_LED_PIN, HIGH);
-}
-
-void startBuzzerPulse(unsigned long durationMs) {
-  gBuzzerActive = true;
-  gBuzzerEndMs = millis() + durationMs;
-  digitalWrite(BUZZER_PIN, HIGH);
-}
-
-void updateIndicators() {
-  unsigned long now = millis();
-
-  if (gProcessingActive) {
-    if (now - gLastRedBlinkMs >= 250) {
-      gRedBlinkState = !gRedBlinkState;
-      digitalWrite(RED_LED_PIN, gRedBlinkState ? HIGH : LOW);
-      gLastRedBlinkMs = now;
-    }
-  } else if (gRedBlinkState) {
-    gRedBlinkState = false;
-    digitalWrite(RED_LED_PIN, LOW);
-  }
-
-  if (gGreenPulseActive && (long)(now - gGreenPulseEndMs) >= 0) {
-    gGreenPulseActive = false;
-    digitalWrite(GREEN_LED_PIN, LOW);
-  }
-
-  if (gBuzzerActive && (long)(now - gBuzzerEndMs) >= 0) {
-    gBuzzerActive = false;
-    digitalWrite(BUZZER_PIN, LOW);
-  }
-}
 #include <WiFi.h>
-#include <WebServer.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <Adafruit_SH110X.h>
+#include <atomic>
 #include <vector>
 #include <cstring>
+#include <memory>
+#include <mutex>
 
 // ====== User wiring/config ======
 // Button on ESP32 GPIO14 to GND (uses INPUT_PULLUP)
 static const int PIN_BUTTON = 14; // per request
+// Presses are timestamped by a GPIO interrupt into a bounded queue that
+// loop() drains (serviceButton), so none are lost while it is busy.
+#ifndef HUB_BUTTON_DEBOUNCE_MS
+#define HUB_BUTTON_DEBOUNCE_MS 40 // line must be quiet this long before a press counts
+#endif
+#ifndef HUB_BUTTON_QUEUE
+#define HUB_BUTTON_QUEUE 8 // presses held until the loop gets to them
+#endif
+#ifndef HUB_BUTTON_COALESCE_MS
+#define HUB_BUTTON_COALESCE_MS 600 // later presses this close merge into one capture
+#endif
+#ifndef HUB_BUTTON_BUSY_POLICY
+// Presses made during a capture, upload or batch send:
+// 0 = drop them, 1 = one follow-up capture for all of them, 2 = one capture each
+#define HUB_BUTTON_BUSY_POLICY 1
+#endif
 
 // UART2 pins between ESP32 hub and ESP32-CAM (UART0 on ESP32-CAM = GPIO1 TX, GPIO3 RX)
 // Connect: HUB TX (GPIO17) -> CAM RX0 (GPIO3), HUB RX (GPIO16) <- CAM TX0 (GPIO1), common GND
@@ -147,284 +364,2180 @@ static const uint32_t CAM_BAUD = 921600; // must match ESP32-CAM sketch baud rat
 #define OLED_HEIGHT 64
 #endif
 static const int OLED_RESET = -1; // set to RST pin if available
+
+// Batched uploads: frames accumulate on the hub and are sent together once the
+// batch reaches HUB_BATCH_MAX_FRAMES, HUB_BATCH_MAX_BYTES or HUB_BATCH_MAX_AGE_MS.
+// Off by default so a single capture still gets its result immediately.
+#ifndef HUB_BATCH_UPLOAD
+#define HUB_BATCH_UPLOAD 0
+#endif
+#ifndef HUB_BATCH_MAX_FRAMES
+#define HUB_BATCH_MAX_FRAMES 4
+#endif
+#ifndef HUB_BATCH_MAX_BYTES
+#define HUB_BATCH_MAX_BYTES (96 * 1024)
+#endif
+#ifndef HUB_BATCH_MAX_AGE_MS
+#define HUB_BATCH_MAX_AGE_MS 3000
+#endif
+// A batch the Pi did not take stays queued and is sent again after
+// HUB_BATCH_RETRY_MS (or with the next capture); after HUB_BATCH_RETRIES
+// failed retries its frames are dropped and each capture is reported failed.
+#ifndef HUB_BATCH_RETRIES
+#define HUB_BATCH_RETRIES 3
+#endif
+#ifndef HUB_BATCH_RETRY_MS
+#define HUB_BATCH_RETRY_MS 5000
+#endif
+
+// Recent Pi results keyed by frame identity; a byte-identical frame is answered
+// locally without uploading. 0 disables the cache.
+#ifndef HUB_RESULT_CACHE_SIZE
+#define HUB_RESULT_CACHE_SIZE 8
+#endif
+
+// Near-duplicate suppression: a frame whose difference hash is within
+// HUB_PHASH_MAX_DISTANCE bits of the last analysed frame reuses that result
+// instead of uploading (-1 disables). Tune with `program phash` on the host.
+// The reference expires after HUB_PHASH_MAX_AGE_MS so slow changes are seen.
+#ifndef HUB_PHASH_MAX_DISTANCE
+#define HUB_PHASH_MAX_DISTANCE 4
+#endif
+#ifndef HUB_PHASH_MAX_AGE_MS
+#define HUB_PHASH_MAX_AGE_MS (10UL * 60UL * 1000UL)
+#endif
+
+// Colour statistics from the JPEG's DC coefficients (leaf_stats.h): they go
+// with each upload as X-Leaf-Stats, so the Pi skips its own pass over the
+// pixels, and give a quick verdict on the OLED while the Pi works. A frame
+// with mean brightness (0..1) below HUB_DARK_FRAME_BRIGHTNESS is not
+// uploaded at all; 0 uploads everything. The Pi calls < 0.2 underexposed.
+#ifndef HUB_LEAF_STATS
+#define HUB_LEAF_STATS 1
+#endif
+#ifndef HUB_DARK_FRAME_BRIGHTNESS
+#define HUB_DARK_FRAME_BRIGHTNESS 0.08f
+#endif
+
+// JPEG pre-validation (jpeg_scan.h) while a frame comes in over the camera
+// link: a frame that is truncated or not a well-formed JPEG is dropped and
+// requested again, up to HUB_JPEG_RETRIES times, instead of failing on the
+// Pi. The check costs a memchr pass over the bytes already being CRC'd.
+#ifndef HUB_JPEG_CHECK
+#define HUB_JPEG_CHECK 1
+#endif
+#ifndef HUB_JPEG_RETRIES
+#define HUB_JPEG_RETRIES 1
+#endif
+
+// Camera link timeouts of one capture: finding the header, each header
+// field after it, and the frame body (restarted by every byte received)
+#define CAPTURE_HEADER_TIMEOUT_MS 8000
+#define CAPTURE_FIELD_TIMEOUT_MS 3000
+#define CAPTURE_BODY_TIMEOUT_MS 12000
+// Longest a deferred /capture can take: every attempt running into each
+// link timeout, then the upload into PI5_TIMEOUT_MS. Its HTTP response
+// waits that long per capture queued ahead of it, plus this one.
+#define CAPTURE_WORST_MS ((HUB_JPEG_RETRIES + 1) * \
+    (CAPTURE_HEADER_TIMEOUT_MS + 2 * CAPTURE_FIELD_TIMEOUT_MS + CAPTURE_BODY_TIMEOUT_MS) + PI5_TIMEOUT_MS)
+
+// On-camera triage (camera built with CAM_TRIAGE=1, see leaf_triage.h):
+// captures for /capture and the button are asked for with 'Q', and a camera
+// confident that the frame shows no leaf or a healthy one answers with its
+// verdict instead of the JPEG. Nothing is uploaded then; the verdict goes to
+// the OLED and the /capture reply. /capture.jpg still asks for the picture,
+// and several cameras (HUB_CAMERAS > 1) always send theirs.
+#ifndef HUB_CAM_TRIAGE
+#define HUB_CAM_TRIAGE 0
+#endif
+
+// Web server: its own task on core 0 serving up to HUB_HTTP_MAX_CLIENTS
+// connections at once (see http_event.h). Each slot holds one lwIP socket;
+// the Arduino core allows 10 in total.
+#ifndef HUB_HTTP_PORT
+#define HUB_HTTP_PORT 80
+#endif
+#ifndef HUB_HTTP_MAX_CLIENTS
+#define HUB_HTTP_MAX_CLIENTS 6
+#endif
+
+// Live preview (/stream): while at least one viewer is connected the camera
+// sends small preview frames at HUB_STREAM_FPS, relayed as MJPEG. The hub
+// repeats the start command every HUB_STREAM_KEEPALIVE_MS; the camera stops
+// on its own when that stops, and the hub stops it when the last viewer
+// leaves. HUB_CAM_RX_BUFFER absorbs frames while loop() is busy elsewhere.
+#ifndef HUB_STREAM_FPS
+#define HUB_STREAM_FPS 5
+#endif
+#ifndef HUB_STREAM_KEEPALIVE_MS
+#define HUB_STREAM_KEEPALIVE_MS 1000
+#endif
+#ifndef HUB_STREAM_MAX_FRAME
+#define HUB_STREAM_MAX_FRAME (48 * 1024)
+#endif
+#ifndef HUB_CAM_RX_BUFFER
+#define HUB_CAM_RX_BUFFER 16384
+#endif
+
+// Several cameras (HUB_CAMERAS > 1, see camera_scheduler.h): one per UART
+// (UART2 on CAM_RX/TX_PIN, UART1 on HUB_CAM1_RX/TX_PIN, so at most two), or
+// with HUB_CAM_BUS=1 up to CAM_MAX on one RS-485 bus on UART2, each camera
+// built with its own CAM_BUS_ADDR (1..HUB_CAMERAS). A link task triggers
+// cameras and collects their frames while loop() uploads the queued frames
+// one at a time, so exposures and transfers overlap the uploads. Each
+// camera holds at most HUB_CAM_QUEUE frames, counting the one in flight.
+// Frames go up one per request (no HUB_BATCH_UPLOAD), and the preview
+// stream needs a single camera, so both are off in this mode. Dark, cached
+// and near-duplicate frames are handled as with one camera; near duplicates
+// are judged against the same camera's last analysed frame.
+#ifndef HUB_CAMERAS
+#define HUB_CAMERAS 1
+#endif
+#ifndef HUB_CAM_BUS
+#define HUB_CAM_BUS 0
+#endif
+#ifndef HUB_CAM_BUS_DE_PIN
+#define HUB_CAM_BUS_DE_PIN -1 // RS-485 driver enable; -1 for auto-direction transceivers
+#endif
+#ifndef HUB_CAM1_RX_PIN
+#define HUB_CAM1_RX_PIN 32
+#endif
+#ifndef HUB_CAM1_TX_PIN
+#define HUB_CAM1_TX_PIN 33
+#endif
+#ifndef HUB_CAM_QUEUE
+#define HUB_CAM_QUEUE 2
+#endif
+#ifndef HUB_CAM_TIMEOUT_MS
+#define HUB_CAM_TIMEOUT_MS 8000 // trigger (or grant) to complete frame
+#endif
+#if HUB_CAMERAS > 2 && !HUB_CAM_BUS
+#error "More than two cameras need the RS-485 bus (HUB_CAM_BUS=1)"
+#endif
+#if HUB_CAMERAS > 8
+#error "HUB_CAMERAS is limited to CAM_MAX (8)"
+#endif
+#if HUB_CAMERAS > 1 && HUB_BATCH_UPLOAD
+#error "Several cameras upload one frame per request (HUB_BATCH_UPLOAD=0)"
+#endif
+
+// Camera link (camera_transport.h): 0 = UART2, 1 = TCP, the camera (built
+// with CAM_LINK_TCP) connecting to HUB_CAM_TCP_PORT over WiFi. Commands and
+// frames are the same on both; 2 is kept for ESP-NOW.
+#ifndef HUB_CAM_TRANSPORT
+#define HUB_CAM_TRANSPORT 0
+#endif
+#ifndef HUB_CAM_TCP_PORT
+#define HUB_CAM_TCP_PORT 5000
+#endif
+#if HUB_CAM_TRANSPORT == 2
+#error "ESP-NOW camera transport is not implemented yet"
+#endif
+#if HUB_CAM_TRANSPORT != 0 && HUB_CAMERAS > 1
+#error "Several cameras need UART links (HUB_CAM_TRANSPORT=0)"
+#endif
+
+// Capture IDs: each capture gets an ID (16-bit boot tag + 16-bit sequence)
+// that the camera echoes in a 'T' frame header, the upload carries as
+// X-Capture-Id and the Pi returns with its result, so results are matched
+// exactly and every hop's timing can be joined per capture. Set to 0 for
+// camera firmware that only knows 'C'.
+#ifndef HUB_CAPTURE_TRACE_IDS
+#define HUB_CAPTURE_TRACE_IDS 1
+#endif
+#if HUB_CAM_TRIAGE && !HUB_CAPTURE_TRACE_IDS
+#error "HUB_CAM_TRIAGE needs HUB_CAPTURE_TRACE_IDS ('Q' carries the capture ID)"
+#endif
+
+// Dashboard events (/events, text/event-stream): capture, upload and result
+// stages are pushed as they happen. Each open dashboard holds one HTTP slot.
+// A comment goes out every HUB_EVENTS_KEEPALIVE_MS so closed tabs are noticed.
+#ifndef HUB_EVENTS_KEEPALIVE_MS
+#define HUB_EVENTS_KEEPALIVE_MS 15000
+#endif
+
+// Deferred log: capture and upload paths record binary entries in a RAM ring
+// (log_ring.h) instead of printing at 115200 baud mid-transfer. A task at idle
+// priority copies them to Serial; GET /log shows what is still in the ring.
+#ifndef HUB_LOG_ENTRIES
+#define HUB_LOG_ENTRIES 256
+#endif
+
+enum HubLogFmt {
+  LOG_WIFI_DOWN,
+  LOG_HTTP_BEGIN_FAILED,
+  LOG_POST_FAILED,
+  LOG_POST_STATUS,
+  LOG_UPLOADED,
+  LOG_TRACE_CAMERA,
+  LOG_TRACE_UPLOAD,
+  LOG_BATCH_SENT,
+  LOG_BATCH_FLUSH_FAILED,
+  LOG_BATCH_DROPPED,
+  LOG_CACHE_HIT,
+  LOG_NEAR_DUPLICATE,
+  LOG_TRIGGER,
+  LOG_STALE_FRAME,
+  LOG_HEADER_FAILED,
+  LOG_STREAM_STARTED,
+  LOG_STREAM_STOPPED,
+  LOG_BUTTON_PRESS,
+  LOG_CAMERA_FAILED,
+  LOG_DARK_FRAME,
+  LOG_BAD_JPEG,
+  LOG_CAM_VERDICT,
+  LOG_FMT_COUNT
+};
+
+static const char* const HUB_LOG_FORMATS[LOG_FMT_COUNT] = {
+  "[uploadToPi] WiFi not connected",
+  "[uploadToPi] http.begin failed",
+  "[uploadToPi] POST failed: %s",
+  "[uploadToPi] Non-OK response code %d",
+  "[uploadToPi] Uploaded %u bytes -> %d",
+  "[trace] %08x cam %u ms, uart %u ms",
+  "[trace] %08x upload %u ms (network %u ms)",
+  "[uploadToPi] Batch of %u frames sent",
+  "[uploadToPi] Batch flush failed: %s",
+  "[uploadToPi] %08x dropped with its batch: %s",
+  "[uploadToPi] Result cache hit, upload skipped",
+  "[uploadToPi] Near-duplicate (distance %d), upload skipped",
+  "[captureFromCam] Triggering camera, capture %08x",
+  "[captureFromCam] Skipping stale frame %08x",
+  "[captureFromCam] Header failure: %s",
+  "[stream] started for %u viewer(s)",
+  "[stream] stopped, no viewers",
+  "[button] press, %u ms to trigger, %u merged",
+  "[cameras] camera %u: error frame or bad transfer (event %u)",
+  "[uploadToPi] Frame too dark (brightness %u/1000), upload skipped",
+  "[jpeg] camera %u frame rejected, attempt %u: %s",
+  "[triage] %08x camera verdict %s (%u%%, %u ms), upload skipped",
+};
+
+static LogRing gLog(HUB_LOG_ENTRIES, HUB_LOG_FORMATS, LOG_FMT_COUNT);
+
+static void logEvent(HubLogFmt fmt, uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0,
+                     const char* text = nullptr) {
+  gLog.log(millis(), (uint16_t)fmt, a0, a1, a2, text);
+}
 #if USE_SH1106
 Adafruit_SH1106G display(OLED_WIDTH, OLED_HEIGHT, &Wire, OLED_RESET);
 #else
 Adafruit_SSD1306 display(OLED_WIDTH, OLED_HEIGHT, &Wire, OLED_RESET);
 #endif
 
-// WiFi credentials (fill in your network)
-const char* WIFI_SSID = "PK";
-const char* WIFI_PASS = "provat07";
-
-// ====== Protocol with camera ======
-// Camera sends: 'P''V''I''C' + 4-byte BE length + 2-byte BE CRC16 + JPEG bytes
-// Command: single byte 'C' from hub to camera
+// ====== OLED rendering ======
+// oledMsg() only lays text out and draws the changed rows into the
+// framebuffer; oledTask (core 0) sends the changed pages over I2C, at most
+// OLED_PAGES_PER_TICK per tick, and pages through text too long for the
+// screen. The loop and the UART receive path never wait on I2C, where a
+// full display.display() is 1 KB, about 25 ms at 400 kHz.
+#ifndef OLED_I2C_CHUNK
+#define OLED_I2C_CHUNK 32 // data bytes per I2C transaction (Wire buffer is 128)
+#endif
+#ifndef OLED_TICK_MS
+#define OLED_TICK_MS 20 // display task period
+#endif
+#ifndef OLED_PAGES_PER_TICK
+#define OLED_PAGES_PER_TICK 2 // I2C budget per tick, ~3 ms per page at 400 kHz
+#endif
+#ifndef OLED_SCROLL_STEP_MS
+#define OLED_SCROLL_STEP_MS 800 // long text: time each row position is shown
+#endif
+#ifndef OLED_SCROLL_HOLD_MS
+#define OLED_SCROLL_HOLD_MS 2500 // long text: pause on the first and last page
+#endif
+
+struct OledStats {
+  uint32_t renders = 0;  // oledMsg() calls that changed the screen
+  uint32_t unchanged = 0;  // calls with the same text, nothing redrawn
+  uint32_t scrolls = 0;  // one-row steps through long text
+  uint32_t pages = 0;  // pages sent over I2C
+  uint32_t lastUs = 0;  // last tick that sent pages
+  uint32_t maxUs = 0;
+};
+// Layout, framebuffer and pending pages, shared by oledMsg() and oledTask
+static std::mutex gOledLock;
+static OledTextLayout gOledLayout(OLED_WIDTH / 6, OLED_HEIGHT / 8);
+static uint8_t gOledPending = 0; // pages drawn but not sent yet
+static uint32_t gOledNextScrollMs = 0;
+static OledStats gOledStats;
+static uint8_t gOledAddr = 0; // 0 until the display answered begin()
+
+// WiFi credentials (fill in your network)
+const char* WIFI_SSID = "PK";
+const char* WIFI_PASS = "provat07";
+
+// ====== Protocol with camera ======
+// Camera sends: 'P''V''I''C' + 4-byte BE length + 2-byte BE CRC16 + JPEG bytes
+// Command: single byte 'C' from hub to camera, or 'T' + 4-byte BE capture ID
+// for a 'P''V''I''T' frame carrying the ID and camera time (uart_frame.h)
+// Preview: 'S' + fps byte starts/keeps alive 'P''V''I''S' frames, 'X' stops
+// RS-485 bus (HUB_CAM_BUS): '@' + address + ~address + 'T' or 'G' + 4-byte
+// BE capture ID. 'T' takes the picture, 'G' (grant) lets the camera send it
+// as an addressed 'P''V''I''A' frame; an 'A' frame without payload is its
+// error answer. Every camera hears every frame on the bus, so commands are
+// long enough not to be matched inside JPEG data by accident.
+
+HardwareSerial CamSerial(2); // UART2
+#if HUB_CAMERAS > 1 && !HUB_CAM_BUS
+HardwareSerial Cam1Serial(1); // UART1, second point-to-point camera
+#endif
+
+class UartCameraTransport : public CameraTransport {
+ public:
+  explicit UartCameraTransport(HardwareSerial& serial) : serial_(serial) {}
+  const char* name() const { return "uart"; }
+  size_t read(uint8_t* buf, size_t n) {
+    int avail = serial_.available();
+    if (avail <= 0) return 0;
+    return serial_.readBytes(buf, n < (size_t)avail ? n : (size_t)avail);
+  }
+  bool write(const uint8_t* data, size_t n) { return serial_.write(data, n) == n; }
+  void flush() { serial_.flush(); }
+
+ private:
+  HardwareSerial& serial_;
+};
+
+#if HUB_CAM_TRANSPORT == 1
+static SocketCameraTransport gCamTcp;
+static CameraTransport& gCamLink = gCamTcp;
+#else
+static UartCameraTransport gCamUart(CamSerial);
+static CameraTransport& gCamLink = gCamUart;
+#endif
+#if HUB_CAMERAS > 1 && !HUB_CAM_BUS
+static UartCameraTransport gCam1Uart(Cam1Serial);
+#endif
+
+static uint16_t gBootTag = 0;   // random per boot, so IDs differ across restarts
+static uint16_t gCaptureSeq = 0;
+
+static uint32_t newCaptureId() {
+  return (uint32_t)gBootTag << 16 | ++gCaptureSeq;
+}
+
+static String captureIdHex(uint32_t id) {
+  char buf[9];
+  formatCaptureId(id, buf);
+  return String(buf);
+}
+
+// Store last image in RAM. Replaced (never modified) on capture, so web
+// clients still streaming the previous frame keep their own reference.
+static SharedBytes lastImage = std::make_shared<std::vector<uint8_t>>();
+static uint32_t lastImageCrc = 0;
+static FrameTag lastImageTag;
+
+static ResultCache gResultCache(HUB_RESULT_CACHE_SIZE);
+
+// Last frame the Pi analysed per camera, for near-duplicate suppression
+struct PhashRef {
+  uint64_t phash = 0;
+  bool valid = false;
+  uint32_t ms = 0;
+  CachedResult result;
+};
+static PhashRef gRefs[HUB_CAMERAS];
+static uint32_t gNearDupSkips = 0;
+static int gLastPhashDistance = -1;
+static uint32_t gDarkSkips = 0;
+static std::atomic<uint32_t> gJpegRejects(0);  // loop and camera link task
+static uint32_t gCamVerdicts = 0;  // captures the camera's triage settled
+
+#if HUB_BATCH_UPLOAD
+static BatchWriter gBatch(HUB_BATCH_MAX_BYTES, HUB_BATCH_MAX_FRAMES, HUB_BATCH_MAX_AGE_MS);
+static std::vector<FrameTag> gBatchTags;  // one per queued frame, in batch order
+static uint8_t gBatchFailures = 0;  // failed sends of the queued batch
+static uint32_t gBatchFailedMs = 0;
+#endif
+
+// What the web task may read. The loop task owns the originals and copies
+// them here under gWebLock after each change, so handlers never race the
+// capture and upload code.
+struct ButtonStats {
+  uint32_t presses = 0;  // accepted by the interrupt
+  uint32_t bounces = 0;  // edges rejected by the debounce
+  uint32_t overflows = 0;  // presses lost to a full queue
+  uint32_t coalesced = 0;  // merged into another press
+  uint32_t droppedBusy = 0;  // discarded by HUB_BUTTON_BUSY_POLICY 0
+  uint32_t lastLatencyUs = 0;  // press to camera trigger
+  LatencyHistogram latency;
+};
+
+struct WebState {
+  SharedBytes image;
+  FrameKey imageKey;
+  uint32_t cacheHits = 0;
+  uint32_t cacheMisses = 0;
+  uint32_t cacheEntries = 0;
+  uint32_t cacheCapacity = 0;
+  uint32_t nearDupSkips = 0;
+  int phashDistance = -1;
+  uint32_t darkSkips = 0;
+  uint32_t jpegRejects = 0;
+  uint32_t camVerdicts = 0;
+  JpegInfo jpeg;  // of image
+  LeafStats stats;  // of image
+  bool hasStats = false;
+  uint16_t batchQueued = 0;
+  uint32_t streamFrames = 0;
+  OledStats oled;
+  ButtonStats button;
+};
+static std::mutex gWebLock;
+static WebState gWebState;
+// Deferred /capture (false) and /capture.jpg (true) requests for the loop task
+static std::vector<std::pair<uint32_t, bool>> gWebCaptures;
+#if HUB_CAMERAS > 1
+static CaptureScheduler gCams(HUB_CAMERAS, HUB_CAM_QUEUE, HUB_CAM_TIMEOUT_MS);
+// Last uploaded frame and result of each camera, for /cameras
+struct CameraView {
+  SharedBytes image;
+  FrameKey key;
+  uint32_t captureId = 0;
+  String leaf;
+  String disease;
+  String err;  // last upload error
+};
+static CameraView gCamViews[HUB_CAMERAS];
+#endif
+static const uint8_t HTTP_CHANNEL_MJPEG = 1;
+static const uint8_t HTTP_CHANNEL_EVENTS = 2;
+
+// Preview stream state (loop task)
+static UartFrameReader gPreviewReader(HUB_STREAM_MAX_FRAME);
+static bool gStreamActive = false;
+static uint32_t gStreamKeepaliveMs = 0;
+static uint32_t gStreamFrames = 0;
+
+// Button queue (filled by buttonIsr) and loop-side statistics
+static QueueHandle_t gButtonQueue = nullptr; // ButtonPress entries
+static volatile uint32_t gButtonLastEdgeUs = 0;
+static volatile uint32_t gButtonPresses = 0;
+static volatile uint32_t gButtonBounces = 0;
+static volatile uint32_t gButtonOverflows = 0;
+static ButtonStats gButtonStats;
+// Loop work a press may have to wait for (BusyScope, may nest). The ISR
+// records with each press whether one was running and which stretch it
+// was, so the loop judges a press by the moment it was made.
+static volatile uint32_t gBusyDepth = 0;
+static volatile uint32_t gBusyStretch = 0;
+
+struct BusyScope {
+  BusyScope() {
+    if (gBusyDepth == 0) gBusyStretch = gBusyStretch + 1;
+    gBusyDepth = gBusyDepth + 1;
+  }
+  ~BusyScope() { gBusyDepth = gBusyDepth - 1; }
+};
+
+struct ButtonPress {
+  uint32_t us;       // micros() at the press
+  uint32_t stretch;  // gBusyStretch while busy, 0 when the loop was idle
+};
+
+static void routeRequest(const HttpRequest& req, HttpResponse& resp);
+static HttpEventServer gHttp(HUB_HTTP_MAX_CLIENTS, routeRequest);
+static SocketHttpListener gHttpListener;
+static void publishWebState();
+
+// Send one dashboard event; doc gets the hub time "t" (ms) added
+static void pushEvent(const char* event, JsonDocument& doc) {
+  if (!gHttp.subscribers(HTTP_CHANNEL_EVENTS)) {
+    return;
+  }
+  doc["t"] = millis();
+  String data;
+  serializeJson(doc, data);
+  gHttp.publish(HTTP_CHANNEL_EVENTS, sseEvent(event, data.c_str()));
+}
+
+// Remember a Pi result for the frame it belongs to
+static void cacheResult(const FrameTag& tag,
+                        const String& leaf,
+                        const String& disease,
+                        const String& solution,
+                        const String& timestamp) {
+  CachedResult r;
+  r.leaf = leaf.c_str();
+  r.disease = disease.c_str();
+  r.solution = solution.c_str();
+  r.timestamp = timestamp.c_str();
+  gResultCache.store(tag.key, r);
+  if (tag.hasPhash && tag.cam < HUB_CAMERAS) {
+    PhashRef& ref = gRefs[tag.cam];
+    ref.phash = tag.phash;
+    ref.result = r;
+    ref.ms = millis();
+    ref.valid = true;
+  }
+}
+
+// Result of the same camera's last analysed frame if this one looks the same
+static const CachedResult* nearDuplicateResult(const FrameTag& tag) {
+#if HUB_PHASH_MAX_DISTANCE >= 0
+  if (!tag.hasPhash || tag.cam >= HUB_CAMERAS || !gRefs[tag.cam].valid) {
+    return nullptr;
+  }
+  const PhashRef& ref = gRefs[tag.cam];
+  gLastPhashDistance = hammingDistance64(tag.phash, ref.phash);
+  if (gLastPhashDistance > HUB_PHASH_MAX_DISTANCE || millis() - ref.ms > HUB_PHASH_MAX_AGE_MS) {
+    return nullptr;
+  }
+  ++gNearDupSkips;
+  return &ref.result;
+#else
+  return nullptr;
+#endif
+}
+
+// Key, fingerprint and colour statistics of a verified frame, all from one
+// DC decode (chroma only when the statistics are wanted)
+static void tagFrame(FrameTag& tag, const std::vector<uint8_t>& jpg, uint16_t crc) {
+  tag.key = makeFrameKey(jpg.data(), jpg.size(), crc);
+  DcImage dc;
+  std::string err;
+  tag.hasPhash = decodeJpegDc(jpg.data(), jpg.size(), dc, err, !HUB_LEAF_STATS);
+  tag.phash = tag.hasPhash ? differenceHash(dc) : 0;
+  tag.hasStats = HUB_LEAF_STATS && tag.hasPhash && leafStatsFromDc(dc, tag.stats);
+  scanJpeg(jpg.data(), jpg.size(), tag.jpeg);
+}
+
+// True (and counted) when the frame is too dark to be worth an upload
+static bool rejectDarkFrame(const FrameTag& tag, String& outErr) {
+  if (!tag.hasStats || tag.stats.brightness >= HUB_DARK_FRAME_BRIGHTNESS) {
+    return false;
+  }
+  ++gDarkSkips;
+  logEvent(LOG_DARK_FRAME, (uint32_t)(tag.stats.brightness * 1000));
+  DynamicJsonDocument ev(128);
+  ev["stage"] = "skipped";
+  ev["reason"] = "dark";
+  pushEvent("upload", ev);
+  outErr = "too dark, check light";
+  return true;
+}
+
+// Quick verdict from the frame's colour statistics while the Pi's is pending;
+// status goes on the last line
+static void showPreliminaryOnOLED(const FrameTag& tag, const String& status = "Waiting for Pi") {
+  if (!tag.hasStats) {
+    oledMsg("Processing...", status);
+    return;
+  }
+  LeafVerdict v = leafVerdict(tag.stats);
+  oledMsg(String("~") + v.leaf, v.disease, status);
+}
+
+// Request body for HTTPClient that marks the upload tracepoints: it is first
+// read once the connection is up and the headers are out, and runs dry when
+// the last byte has been handed to the TCP stack.
+class TracedBody : public Stream {
+ public:
+  TracedBody(const uint8_t* data, size_t len) : data_(data), len_(len) {}
+  int available() { return (int)(len_ - pos_); }
+  int read() {
+    uint8_t c;
+    return readBytes((char*)&c, 1) ? c : -1;
+  }
+  int peek() { return pos_ < len_ ? data_[pos_] : -1; }
+  size_t readBytes(char* buf, size_t n) {
+    if (pos_ == 0) gMetrics.mark(STAGE_UPLOAD_CONNECT, micros());
+    if (n > len_ - pos_) n = len_ - pos_;
+    memcpy(buf, data_ + pos_, n);
+    pos_ += n;
+    if (n && pos_ == len_) gMetrics.mark(STAGE_UPLOAD_SENT, micros());
+    return n;
+  }
+  size_t write(uint8_t) { return 0; }
+
+ private:
+  const uint8_t* data_;
+  size_t len_;
+  size_t pos_ = 0;
+};
+
+// POST a body to the Pi and return the response body on HTTP 200. tags are
+// the frames in the body, in order; their capture IDs and hop timings go
+// along as headers.
+static bool postToPi(const char* url,
+                     const char* contentType,
+                     const uint8_t* body,
+                     size_t len,
+                     const FrameTag* tags,
+                     size_t tagCount,
+                     String& outErr,
+                     String& outBody) {
+  if (WiFi.status() != WL_CONNECTED) {
+    outErr = "WiFi not connected";
+    logEvent(LOG_WIFI_DOWN);
+    gMetrics.countError(outErr.c_str());
+    return false;
+  }
+  HTTPClient http;
+  http.setTimeout(PI5_TIMEOUT_MS);
+  WiFiClient wifiClient;
+  if (!http.begin(wifiClient, url)) {
+    outErr = "HTTP begin failed";
+    logEvent(LOG_HTTP_BEGIN_FAILED);
+    gMetrics.countError(outErr.c_str());
+    return false;
+  }
+  uint32_t t0 = millis();
+  DynamicJsonDocument ev(192);
+  ev["stage"] = "start";
+  ev["bytes"] = len;
+  pushEvent("upload", ev);
+
+  http.addHeader("Content-Type", contentType);
+  std::vector<PiFrameMeta> meta(tagCount);
+  for (size_t i = 0; i < tagCount; ++i) {
+    meta[i].captureId = tags[i].captureId;
+    meta[i].camMs = tags[i].camMs;
+    meta[i].linkMs = tags[i].linkMs;
+    meta[i].stats = tags[i].hasStats ? &tags[i].stats : nullptr;
+  }
+  PiHeaderList headers;
+  piUploadHeaders(meta.data(), tagCount, headers);
+  for (const auto& h : headers) {
+    http.addHeader(h.first.c_str(), h.second.c_str());
+  }
+  TracedBody traced(body, len);
+  int code = http.sendRequest("POST", &traced, len);
+  if (code > 0) {
+    gMetrics.mark(STAGE_RESPONSE_RECEIVED, micros());
+  }
+  bool ok = code == 200;
+  if (code <= 0) {
+    outErr = String("HTTP error ") + http.errorToString(code);
+    logEvent(LOG_POST_FAILED, 0, 0, 0, outErr.c_str());
+  } else if (!ok) {
+    outErr = String("Upload failed ") + code;
+    logEvent(LOG_POST_STATUS, (uint32_t)code);
+  } else {
+    logEvent(LOG_UPLOADED, (uint32_t)len, (uint32_t)code);
+    outBody = http.getString();
+  }
+  http.end();
+  if (!ok) {
+    gMetrics.countError(outErr.c_str());
+    gMetrics.abort();
+  }
+
+  ev.clear();
+  ev["stage"] = ok ? "done" : "error";
+  ev["bytes"] = len;
+  ev["ms"] = millis() - t0;
+  if (!ok) {
+    ev["err"] = outErr;
+  }
+  pushEvent("upload", ev);
+  return ok;
+}
+
+// Read the optional result fields of one Pi result object
+static bool readPiResult(JsonVariantConst doc,
+                         String* outLeaf,
+                         String* outDisease,
+                         String* outSolution,
+                         String* outTimestamp) {
+  String leaf = doc["leaf_name"] | doc["species"] | "";
+  String diseaseVal = doc["disease"] | doc["condition"] | "";
+  String solutionVal = doc["solution"] | doc["recommendation"] | "";
+  if (outLeaf) {
+    *outLeaf = leaf;
+  }
+  if (outDisease) {
+    *outDisease = diseaseVal;
+  }
+  if (outSolution) {
+    *outSolution = solutionVal;
+  }
+  if (outTimestamp) {
+    const char* tsVal = doc["timestamp"] | "";
+    *outTimestamp = tsVal;
+  }
+  return leaf.length() || diseaseVal.length() || solutionVal.length();
+}
+
+// Per-capture latency across camera, link, network and Pi. The Pi echoes
+// the capture ID with its own times in "hops"; the devices share no clock,
+// so every hop is a duration measured where it happened.
+static void logCaptureHops(const FrameTag& tag, uint32_t uploadMs, JsonVariantConst reply) {
+  String id = reply["capture_id"] | "";
+  if (!tag.captureId || id != captureIdHex(tag.captureId)) {
+    return;
+  }
+  uint32_t piMs = reply["hops"]["pi_ms"] | 0;
+  uint32_t netMs = uploadMs > piMs ? uploadMs - piMs : 0;
+  logEvent(LOG_TRACE_CAMERA, tag.captureId, tag.camMs, tag.linkMs - tag.camMs);
+  logEvent(LOG_TRACE_UPLOAD, tag.captureId, uploadMs, netMs);
+  DynamicJsonDocument ev(256);
+  ev["capture_id"] = id;
+  ev["cam_ms"] = tag.camMs;
+  ev["uart_ms"] = tag.linkMs - tag.camMs;
+  ev["network_ms"] = netMs;
+  ev["pi_ms"] = piMs;
+  ev["pi_analyze_ms"] = reply["hops"]["pi_analyze_ms"] | 0;
+  pushEvent("trace", ev);
+}
+
+// Upload one JPEG (the frame described by tag) to Pi 5
+static bool uploadToPi(const uint8_t* jpg,
+                       size_t len,
+                       const FrameTag& tag,
+                       String& outErr,
+                       String* outLeaf = nullptr,
+                       String* outDisease = nullptr,
+                       String* outSolution = nullptr,
+                       String* outTimestamp = nullptr,
+                       bool* outHasResult = nullptr) {
+  String body;
+  uint32_t t0 = millis();
+  if (!postToPi(PI5_UPLOAD_URL, "image/jpeg", jpg, len, &tag, 1, outErr, body)) {
+    return false;
+  }
+  uint32_t uploadMs = millis() - t0;
+  gPendingCaptureId = tag.captureId;
+
+  // Try parse JSON response for optional fields
+  DynamicJsonDocument doc(2048);
+  DeserializationError jerr = deserializeJson(doc, body);
+  bool hasResult = false;
+  if (!jerr) {
+    hasResult = readPiResult(doc.as<JsonVariantConst>(), outLeaf, outDisease, outSolution, outTimestamp);
+    logCaptureHops(tag, uploadMs, doc.as<JsonVariantConst>());
+  }
+  if (outHasResult) {
+    *outHasResult = hasResult;
+  }
+  return true;
+}
+
+#if HUB_BATCH_UPLOAD
+// True when the queued batch should go: a limit is hit and no retry delay runs
+static bool batchDue(uint32_t nowMs) {
+  return gBatch.shouldFlush(nowMs) &&
+         (!gBatchFailures || nowMs - gBatchFailedMs >= HUB_BATCH_RETRY_MS);
+}
+
+// Give up on the queued frames; every capture in the batch gets an error event
+static void dropBatch(const String& err) {
+  for (const FrameTag& tag : gBatchTags) {
+    logEvent(LOG_BATCH_DROPPED, tag.captureId, 0, 0, err.c_str());
+    DynamicJsonDocument ev(256);
+    ev["stage"] = "error";
+    ev["capture_id"] = captureIdHex(tag.captureId);
+    ev["err"] = String("batch dropped: ") + err;
+    pushEvent("upload", ev);
+  }
+  gBatch.clear();
+  gBatchTags.clear();
+  gBatchFailures = 0;
+}
+
+// Send every queued frame in one request; the outputs describe the newest
+// frame. Results are cached, and the newest frame becomes gPendingTag when
+// its result is left to /result. A failed batch stays queued for a retry
+// until HUB_BATCH_RETRIES is used up.
+static bool uploadBatchToPi(String& outErr,
+                            String* outLeaf = nullptr,
+                            String* outDisease = nullptr,
+                            String* outSolution = nullptr,
+                            String* outTimestamp = nullptr,
+                            bool* outHasResult = nullptr) {
+  uint16_t frames = gBatch.count();
+  String body;
+  if (!postToPi(PI5_BATCH_URL, BATCH_CONTENT_TYPE, gBatch.body().data(), gBatch.bytes(),
+                gBatchTags.data(), gBatchTags.size(), outErr, body)) {
+    gBatchFailedMs = millis();
+    if (gBatchFailures++ >= HUB_BATCH_RETRIES) {
+      dropBatch(outErr);
+    }
+    return false;
+  }
+  std::vector<FrameTag> tags;
+  tags.swap(gBatchTags);
+  gBatch.clear();
+  gBatchFailures = 0;
+  if (!tags.empty()) {
+    gPendingCaptureId = tags.back().captureId;
+  }
+  logEvent(LOG_BATCH_SENT, frames);
+
+  DynamicJsonDocument doc(1024 + 768 * frames);
+  DeserializationError jerr = deserializeJson(doc, body);
+  bool hasResult = false;
+  if (!jerr) {
+    JsonArrayConst results = doc["results"].as<JsonArrayConst>();
+    for (size_t i = 0; i < results.size(); ++i) {
+      String leaf, disease, solution, timestamp;
+      hasResult = readPiResult(results[i], &leaf, &disease, &solution, &timestamp);
+      if (hasResult && i < tags.size()) {
+        cacheResult(tags[i], leaf, disease, solution, timestamp);
+      }
+      if (i + 1 == results.size()) {
+        if (outLeaf) *outLeaf = leaf;
+        if (outDisease) *outDisease = disease;
+        if (outSolution) *outSolution = solution;
+        if (outTimestamp) *outTimestamp = timestamp;
+      }
+    }
+  }
+  if (!hasResult && !tags.empty()) {
+    gPendingTag = tags.back();
+  }
+  if (outHasResult) {
+    *outHasResult = hasResult;
+  }
+  return true;
+}
+#endif
+
+// Every capture path's way from a verified frame to its result: a dark frame
+// is refused, a byte-identical or near-identical one is answered from earlier
+// results (outCached), anything else is uploaded, directly or through the
+// batch queue (outQueued while it waits there). An uploaded frame's result is
+// cached, or the frame becomes gPendingTag until /result brings it.
+static bool uploadFrame(const SharedBytes& jpg,
+                        const FrameTag& tag,
+                        String& outErr,
+                        String* outLeaf,
+                        String* outDisease,
+                        String* outSolution,
+                        String* outTimestamp,
+                        bool* outHasResult,
+                        bool* outQueued,
+                        bool* outCached) {
+  *outQueued = false;
+  *outCached = false;
+  if (rejectDarkFrame(tag, outErr)) {
+    return false;
+  }
+  const CachedResult* hit = gResultCache.lookup(tag.key);
+  const char* reason = "cache";
+  if (hit) {
+    logEvent(LOG_CACHE_HIT);
+  } else if ((hit = nearDuplicateResult(tag)) != nullptr) {
+    logEvent(LOG_NEAR_DUPLICATE, (uint32_t)gLastPhashDistance);
+    reason = "near_dup";
+  }
+  if (hit) {
+    DynamicJsonDocument ev(128);
+    ev["stage"] = "skipped";
+    ev["reason"] = reason;
+    pushEvent("upload", ev);
+    if (outLeaf) *outLeaf = hit->leaf.c_str();
+    if (outDisease) *outDisease = hit->disease.c_str();
+    if (outSolution) *outSolution = hit->solution.c_str();
+    if (outTimestamp) *outTimestamp = hit->timestamp.c_str();
+    *outHasResult = true;
+    *outCached = true;
+    return true;
+  }
+#if HUB_BATCH_UPLOAD
+  if (!gBatch.add(jpg->data(), jpg->size(), millis())) {
+    // Batch is full: send what is queued, then start a new one with this
+    // frame. A batch the Pi refused is still queued, so this frame fails.
+    String flushErr;
+    if (!uploadBatchToPi(flushErr)) {
+      logEvent(LOG_BATCH_FLUSH_FAILED, 0, 0, 0, flushErr.c_str());
+      if (!gBatch.empty()) {
+        outErr = flushErr;
+        return false;
+      }
+    }
+    gBatch.add(jpg->data(), jpg->size(), millis());
+  }
+  gBatchTags.push_back(tag);
+  if (!gBatch.shouldFlush(millis())) {
+    *outQueued = true;
+    showPreliminaryOnOLED(tag, String(gBatch.count()) + " in batch");
+    DynamicJsonDocument ev(128);
+    ev["stage"] = "queued";
+    ev["batch_queued"] = gBatch.count();
+    pushEvent("upload", ev);
+    return true;
+  }
+  showPreliminaryOnOLED(tag);
+  return uploadBatchToPi(outErr, outLeaf, outDisease, outSolution, outTimestamp, outHasResult);
+#else
+  showPreliminaryOnOLED(tag);
+  bool up = uploadToPi(jpg->data(), jpg->size(), tag, outErr,
+                       outLeaf, outDisease, outSolution, outTimestamp, outHasResult);
+  if (up && *outHasResult && outLeaf && outDisease && outSolution && outTimestamp) {
+    cacheResult(tag, *outLeaf, *outDisease, *outSolution, *outTimestamp);
+  } else if (up) {
+    gPendingTag = tag;
+  }
+  return up;
+#endif
+}
+
+static uint16_t queuedFrameCount() {
+#if HUB_BATCH_UPLOAD
+  return gBatch.count();
+#else
+  return 0;
+#endif
+}
+
+static void publishWebState() {
+  std::lock_guard<std::mutex> g(gWebLock);
+  gWebState.image = lastImage;
+  gWebState.imageKey = lastImageTag.key;
+  gWebState.cacheHits = gResultCache.hits();
+  gWebState.cacheMisses = gResultCache.misses();
+  gWebState.cacheEntries = gResultCache.size();
+  gWebState.cacheCapacity = gResultCache.capacity();
+  gWebState.nearDupSkips = gNearDupSkips;
+  gWebState.phashDistance = gLastPhashDistance;
+  gWebState.darkSkips = gDarkSkips;
+  gWebState.jpegRejects = gJpegRejects.load();
+  gWebState.camVerdicts = gCamVerdicts;
+  gWebState.jpeg = lastImageTag.jpeg;
+  gWebState.stats = lastImageTag.stats;
+  gWebState.hasStats = lastImageTag.hasStats;
+  gWebState.batchQueued = queuedFrameCount();
+  gWebState.streamFrames = gStreamFrames;
+  gWebState.button = gButtonStats;
+  gWebState.button.presses = gButtonPresses;
+  gWebState.button.bounces = gButtonBounces;
+  gWebState.button.overflows = gButtonOverflows;
+  std::lock_guard<std::mutex> o(gOledLock);
+  gWebState.oled = gOledStats;
+}
+
+static void oledCommands(const uint8_t* cmds, size_t n) {
+  Wire.beginTransmission(gOledAddr);
+  Wire.write((uint8_t)0x00); // control byte: command stream
+  Wire.write(cmds, n);
+  Wire.endTransmission();
+}
+
+// Writes one 8-pixel page, bypassing display.display()
+static void oledSendPage(uint8_t p, const uint8_t* data) {
+#if USE_SH1106
+  // Page addressing; SH1106 RAM is 132 columns with the panel at 2..129
+  const uint8_t col = 2;
+  uint8_t cmds[] = { (uint8_t)(0xB0 | p), (uint8_t)(0x10 | (col >> 4)), (uint8_t)(col & 0x0F) };
+#else
+  // Horizontal addressing (set by begin()); limit the window to this page
+  uint8_t cmds[] = { 0x22, p, p, 0x21, 0, (uint8_t)(OLED_WIDTH - 1) };
+#endif
+  oledCommands(cmds, sizeof(cmds));
+  for (size_t off = 0; off < OLED_WIDTH; off += OLED_I2C_CHUNK) {
+    size_t n = OLED_WIDTH - off < OLED_I2C_CHUNK ? OLED_WIDTH - off : OLED_I2C_CHUNK;
+    Wire.beginTransmission(gOledAddr);
+    Wire.write((uint8_t)0x40); // control byte: data stream
+    Wire.write(data + off, n);
+    Wire.endTransmission();
+  }
+}
+
+// Draws the visible rows set in dirty into the framebuffer (gOledLock held)
+static void oledDrawRows(uint8_t dirty) {
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  for (uint8_t r = 0; r < gOledLayout.rows(); ++r) {
+    if (!(dirty & (1u << r))) continue;
+    display.fillRect(0, r * 8, OLED_WIDTH, 8, SSD1306_BLACK);
+    display.setCursor(0, r * 8);
+    display.print(gOledLayout.row(r));
+  }
+  gOledPending |= dirty;
+}
+
+void oledMsg(const String& l1, const String& l2, const String& l3) {
+  if (!gOledAddr) return;
+  const char* lines[3];
+  size_t n = 0;
+  if (l1.length()) lines[n++] = l1.c_str();
+  if (l2.length()) lines[n++] = l2.c_str();
+  if (l3.length()) lines[n++] = l3.c_str();
+  std::lock_guard<std::mutex> g(gOledLock);
+  uint8_t dirty = gOledLayout.update(lines, n);
+  if (!dirty) {
+    ++gOledStats.unchanged;
+    return;
+  }
+  oledDrawRows(dirty);
+  gOledNextScrollMs = millis() + OLED_SCROLL_HOLD_MS;
+  ++gOledStats.renders;
+}
+
+// Sends pending pages within the per-tick budget and steps through long
+// text once the previous step is fully on screen.
+static void oledTask(void*) {
+  uint8_t pages[OLED_PAGES_PER_TICK][OLED_WIDTH];
+  uint8_t index[OLED_PAGES_PER_TICK];
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(OLED_TICK_MS));
+    uint32_t t0 = micros();
+    size_t n = 0;
+    {
+      std::lock_guard<std::mutex> g(gOledLock);
+      uint32_t now = millis();
+      if (!gOledPending && gOledLayout.scrollable() && (int32_t)(now - gOledNextScrollMs) >= 0) {
+        oledDrawRows(gOledLayout.scroll());
+        bool hold = gOledLayout.offset() == 0 || gOledLayout.atEnd();
+        gOledNextScrollMs = now + (hold ? OLED_SCROLL_HOLD_MS : OLED_SCROLL_STEP_MS);
+        ++gOledStats.scrolls;
+      }
+      // Copy out under the lock, send without it
+      const uint8_t* fb = display.getBuffer();
+      for (uint8_t p = 0; p < OLED_HEIGHT / 8 && n < OLED_PAGES_PER_TICK; ++p) {
+        if (!(gOledPending & (1u << p))) continue;
+        memcpy(pages[n], fb + (size_t)p * OLED_WIDTH, OLED_WIDTH);
+        index[n++] = p;
+        gOledPending &= (uint8_t)~(1u << p);
+      }
+    }
+    if (!n) continue;
+    for (size_t i = 0; i < n; ++i) oledSendPage(index[i], pages[i]);
+    uint32_t us = micros() - t0;
+    std::lock_guard<std::mutex> g(gOledLock);
+    gOledStats.pages += n;
+    gOledStats.lastUs = us;
+    if (us > gOledStats.maxUs) gOledStats.maxUs = us;
+  }
+}
+
+// With jpeg, bytes are checked as they arrive; a bad JPEG ends the read early
+static bool readExact(uint8_t* buf, size_t n, uint32_t timeoutMs, JpegScanner* jpeg = nullptr,
+                      size_t* outGot = nullptr) {
+  uint32_t start = millis();
+  size_t got = 0;
+  while (got < n) {
+    size_t r = gCamLink.read(buf + got, n - got);
+    if (r) {
+      got += r;
+      if (outGot) *outGot = got;
+      if (jpeg && !jpeg->feed(buf + got - r, r)) {
+        return false;
+      }
+      start = millis(); // activity resets timeout
+    } else if (millis() - start > timeoutMs) {
+      return false;
+    }
+    delay(0);
+  }
+  return true;
+}
+
+// Reads and drops n bytes, e.g. the payload of a frame nobody waits for
+static bool skipExact(size_t n, uint32_t timeoutMs) {
+  uint8_t scratch[256];
+  while (n) {
+    size_t chunk = n < sizeof(scratch) ? n : sizeof(scratch);
+    if (!readExact(scratch, chunk, timeoutMs)) {
+      return false;
+    }
+    n -= chunk;
+  }
+  return true;
+}
+
+// expectId != 0 waits for the 'T' frame of that capture; a 'T' frame left
+// over from an earlier, timed-out capture is skipped. With allowVerdict a
+// 'V' frame of the capture is taken too; outType says which came.
+static bool readHeader(uint32_t headerTimeoutMs, uint32_t expectId, uint32_t& outLen, uint16_t& outCrc,
+                       uint16_t& outCamMs, String& outErr, bool allowVerdict = false,
+                       uint8_t* outType = nullptr) {
+  const uint8_t MAGIC[4] = {'P','V','I',(uint8_t)(expectId ? FRAME_TYPE_TRACED : FRAME_TYPE_STILL)};
+  const uint8_t VERDICT[4] = {'P','V','I',FRAME_TYPE_VERDICT};
+  const uint8_t ERRMG[4] = {'P','V','I','E'};
+  uint8_t window[4] = {0};
+  uint32_t start = millis();
+  size_t filled = 0;
+  while (millis() - start <= headerTimeoutMs) {
+    uint8_t b;
+    if (gCamLink.read(&b, 1)) {
+      if (filled < 4) {
+        window[filled++] = b;
+      } else {
+        window[0] = window[1];
+        window[1] = window[2];
+        window[2] = window[3];
+        window[3] = b;
+      }
+      bool verdict = allowVerdict && expectId && filled == 4 && std::memcmp(window, VERDICT, 4) == 0;
+      if (filled == 4 && (verdict || std::memcmp(window, MAGIC, 4) == 0)) {
+        // Read len + crc
+        uint8_t rest[6];
+        if (!readExact(rest, sizeof(rest), CAPTURE_FIELD_TIMEOUT_MS)) { outErr = "timeout len+crc"; return false; }
+        uint32_t len = (uint32_t)rest[0]<<24 | (uint32_t)rest[1]<<16 | (uint32_t)rest[2]<<8 | (uint32_t)rest[3];
+        uint16_t crc = (uint16_t)rest[4]<<8 | (uint16_t)rest[5];
+        if (len == 0 || len > 400000) { outErr = "bad length"; return false; }
+        outCamMs = 0;
+        if (expectId) {
+          uint8_t ext[FRAME_TRACE_EXT_LEN];
+          if (!readExact(ext, sizeof(ext), CAPTURE_FIELD_TIMEOUT_MS)) { outErr = "timeout trace ext"; return false; }
+          uint32_t id = (uint32_t)ext[0]<<24 | (uint32_t)ext[1]<<16 | (uint32_t)ext[2]<<8 | (uint32_t)ext[3];
+          if (id != expectId) {
+            // Drop its payload too, so the search resumes at the next frame
+            // instead of scanning JPEG data for a magic
+            logEvent(LOG_STALE_FRAME, id);
+            if (!skipExact(len, CAPTURE_BODY_TIMEOUT_MS)) { outErr = "timeout stale frame"; return false; }
+            filled = 0;
+            continue;
+          }
+          outCamMs = (uint16_t)(ext[4] << 8 | ext[5]);
+        }
+        if (outType) *outType = window[3];
+        outLen = len; outCrc = crc; return true;
+      }
+      if (filled == 4 && std::memcmp(window, ERRMG, 4) == 0) {
+        // Camera reported error
+        uint8_t rest[6];
+        if (!readExact(rest, sizeof(rest), 2000)) { outErr = "timeout len+crc (err)"; return false; }
+        outErr = "camera error";
+        return false;
+      }
+    } else {
+      delay(1);
+    }
+  }
+  outErr = "timeout header";
+  return false;
+}
+
+// The camera's triage of a capture it did not send ('V' frame)
+struct CamVerdict {
+  bool valid = false;
+  uint8_t cls = TRIAGE_ANALYSE;
+  float confidence = 0;
+  uint16_t triageMs = 0;
+};
+
+// Reads and checks the payload of a 'V' frame whose header was just read
+static bool readVerdict(uint32_t len, uint16_t crc, CamVerdict& out, String& outErr) {
+  uint8_t v[FRAME_VERDICT_LEN];
+  if (len != sizeof(v)) { outErr = "bad verdict length"; return false; }
+  if (!readExact(v, sizeof(v), CAPTURE_FIELD_TIMEOUT_MS)) { outErr = "timeout verdict"; return false; }
+  if (crc16(v, sizeof(v)) != crc) { outErr = "crc mismatch"; return false; }
+  out.valid = true;
+  out.cls = v[0] < TRIAGE_CLASSES ? v[0] : TRIAGE_ANALYSE;
+  out.confidence = v[1] / 255.0f;
+  out.triageMs = (uint16_t)(v[2] << 8 | v[3]);
+  return true;
+}
+
+// One trigger and transfer; badJpeg says a frame arrived but failed the check.
+// With verdict the camera is asked to triage ('Q'); when it answers with
+// its verdict, that is filled in and there is no new frame (outLen 0).
+static bool captureAttempt(uint32_t& outLen, uint16_t& outCrc, String& outErr, bool& badJpeg,
+                           CamVerdict* verdict = nullptr) {
+  badJpeg = false;
+  if (verdict) *verdict = CamVerdict();
+  if (!gCamLink.connected()) {
+    outErr = "camera not connected";
+    gMetrics.countError(outErr.c_str());
+    return false;
+  }
+  // Send trigger (a running preview continues afterwards; its frames are
+  // skipped by the header search below)
+  gCamLink.discard();
+  gPreviewReader.reset();
+  uint32_t t0 = millis();
+  DynamicJsonDocument ev(256);
+  ev["stage"] = "start";
+  pushEvent("capture", ev);
+  gMetrics.begin(micros());
+#if HUB_CAPTURE_TRACE_IDS
+  uint32_t captureId = newCaptureId();
+  logEvent(LOG_TRIGGER, captureId);
+  const uint8_t cmd[5] = { (uint8_t)(verdict ? 'Q' : 'T'), (uint8_t)(captureId >> 24), (uint8_t)(captureId >> 16),
+                           (uint8_t)(captureId >> 8), (uint8_t)captureId };
+  gCamLink.write(cmd, sizeof(cmd));
+#else
+  uint32_t captureId = 0;
+  logEvent(LOG_TRIGGER, captureId);
+  const uint8_t cmd = 'C';
+  gCamLink.write(&cmd, 1);
+#endif
+  gCamLink.flush();
+
+  ev.clear();
+  ev["stage"] = "error";
+  if (captureId) {
+    ev["capture_id"] = captureIdHex(captureId);
+  }
+  // Wait and read header with sliding window
+  uint32_t len = 0; uint16_t crc = 0; uint16_t camMs = 0;
+  uint8_t type = 0;
+  bool headerOk = readHeader(CAPTURE_HEADER_TIMEOUT_MS, captureId, len, crc, camMs, outErr, verdict != nullptr, &type);
+  if (headerOk && type == FRAME_TYPE_VERDICT) {
+    // No frame to time or keep; lastImage stays the previous one
+    gMetrics.abort();
+    if (!readVerdict(len, crc, *verdict, outErr)) {
+      gMetrics.countError(outErr.c_str());
+      ev["err"] = outErr;
+      ev["ms"] = millis() - t0;
+      pushEvent("capture", ev);
+      return false;
+    }
+    ++gCamVerdicts;
+    logEvent(LOG_CAM_VERDICT, captureId, (uint32_t)(verdict->confidence * 100 + 0.5f), verdict->triageMs,
+             triageClassName(verdict->cls));
+    outLen = 0;
+    outCrc = 0;
+    ev["stage"] = "triaged";
+    ev["verdict"] = triageClassName(verdict->cls);
+    ev["confidence"] = verdict->confidence;
+    ev["cam_ms"] = camMs;
+    ev["ms"] = millis() - t0;
+    pushEvent("capture", ev);
+    return true;
+  }
+  if (!headerOk) {
+    logEvent(LOG_HEADER_FAILED, 0, 0, 0, outErr.c_str());
+    gMetrics.countError(outErr.c_str());
+    gMetrics.abort();
+    ev["err"] = outErr;
+    ev["ms"] = millis() - t0;
+    pushEvent("capture", ev);
+    return false;
+  }
+
+  // Read body into a fresh buffer; the previous frame may still be streaming
+  std::shared_ptr<std::vector<uint8_t>> frame = std::make_shared<std::vector<uint8_t>>(len);
+  gMetrics.mark(STAGE_HEADER_FOUND, micros());
+  JpegScanner jpeg;
+  JpegScanner* check = HUB_JPEG_CHECK ? &jpeg : nullptr;
+  size_t got = 0;
+  if (!readExact(frame->data(), len, CAPTURE_BODY_TIMEOUT_MS, check, &got)) {
+    outErr = jpeg.failed() ? String("bad jpeg: ") + jpeg.error() : String("timeout body");
+    // The scanner stops early; drop the rest so the retry starts clean
+    if (jpeg.failed()) skipExact(len - got, CAPTURE_BODY_TIMEOUT_MS);
+  } else {
+    gMetrics.mark(STAGE_BODY_COMPLETE, micros());
+    // Validate CRC
+    if (crc16(frame->data(), frame->size()) != crc) {
+      outErr = "crc mismatch";
+    } else if (check && !jpeg.finish()) {
+      outErr = String("bad jpeg: ") + jpeg.error();
+    }
+  }
+  if (jpeg.failed()) {
+    badJpeg = true;
+    ++gJpegRejects;
+  }
+  if (outErr.length()) {
+    gMetrics.countError(outErr.c_str());
+    gMetrics.abort();
+    ev["err"] = outErr;
+    ev["ms"] = millis() - t0;
+    pushEvent("capture", ev);
+    return false;
+  }
+
+  gMetrics.mark(STAGE_CRC_VERIFIED, micros());
+  outLen = len;
+  outCrc = crc;
+  lastImage = frame;
+  lastImageCrc = crc;
+  tagFrame(lastImageTag, *lastImage, crc);
+  lastImageTag.captureId = captureId;
+  lastImageTag.camMs = camMs;
+  lastImageTag.linkMs = millis() - t0;
+  publishWebState();
+  if (gHistory) {
+    gHistoryId = gHistory->add(frame, crc, captureId, t0, camMs, historyMs(lastImageTag.linkMs));
+    gHistoryTriggerMs = t0;
+    gHistoryFrameMs = millis();
+  }
+
+  char etag[FRAME_ETAG_LEN];
+  frameEtag(lastImageTag.key, etag, sizeof(etag));
+  String version = etag;
+  ev["stage"] = "done";
+  ev["bytes"] = len;
+  ev["ms"] = millis() - t0;
+  ev["etag"] = version.substring(1, version.length() - 1);
+  pushEvent("capture", ev);
+  return true;
+}
+
+// Capture, asking again when the frame is not a valid JPEG. verdict as for
+// captureAttempt(): a triaged capture returns true with verdict->valid.
+static bool captureFromCam(uint32_t& outLen, uint16_t& outCrc, String& outErr,
+                           CamVerdict* verdict = nullptr) {
+  for (uint32_t attempt = 1;; ++attempt) {
+    bool badJpeg = false;
+    outErr = "";
+    if (captureAttempt(outLen, outCrc, outErr, badJpeg, verdict)) {
+      return true;
+    }
+    if (!badJpeg) {
+      return false;
+    }
+    logEvent(LOG_BAD_JPEG, 1, attempt, 0, outErr.c_str());
+    if (attempt > HUB_JPEG_RETRIES) {
+      return false;
+    }
+  }
+}
+
+// The camera's verdict in place of the Pi's, for a capture it kept back
+static void showVerdictOnOLED(const CamVerdict& v) {
+  clearProcessingState();
+  gWaitingForResult = false;
+  gResultDisplayed = false;
+  String what = v.cls == TRIAGE_NO_LEAF ? "No leaf" : "Healthy leaf";
+  oledMsg("Camera: " + what, String((int)(v.confidence * 100 + 0.5f)) + "% sure", "Not sent to Pi");
+}
+
+// Image version for dashboard URLs: the ETag without quotes, "" if no image
+static String imageVersion() {
+  if (lastImage->empty()) {
+    return "";
+  }
+  char etag[FRAME_ETAG_LEN];
+  frameEtag(lastImageTag.key, etag, sizeof(etag));
+  String v = etag;
+  return v.substring(1, v.length() - 1);
+}
+
+// Runs on the loop task for a deferred /capture request
+void handleCapture(HttpResponse& resp) {
+  setProcessingState();
+  gResultDisplayed = false;
+  gWaitingForResult = false;
+  oledMsg("Capturing...", "Please wait");
+  uint32_t len=0; uint16_t crc=0;
+  String err;
+  CamVerdict verdict;
+  bool ok = captureFromCam(len, crc, err, HUB_CAM_TRIAGE ? &verdict : nullptr);
+  if (ok && verdict.valid) {
+    showVerdictOnOLED(verdict);
+
+    DynamicJsonDocument doc(256);
+    doc["ok"] = true;
+    doc["uploaded"] = false;
+    doc["triage"] = triageClassName(verdict.cls);
+    doc["confidence"] = verdict.confidence;
+    doc["triage_ms"] = verdict.triageMs;
+    String body;
+    serializeJson(doc, body);
+    resp.send(200, "application/json", body.c_str());
+  } else if (ok) {
+    // Try uploading to Pi 5
+    String leaf, disease, solution, timestamp, uerr;
+    bool hasResult = false;
+    bool queued = false;
+    bool cached = false;
+    bool up = uploadFrame(
+      lastImage,
+      lastImageTag,
+      uerr,
+      &leaf,
+      &disease,
+      &solution,
+      &timestamp,
+      &hasResult,
+      &queued,
+      &cached
+    );
+    if (up && queued) {
+      clearProcessingState();
+
+      DynamicJsonDocument doc(256);
+      doc["ok"] = true;
+      doc["uploaded"] = false;
+      doc["queued"] = true;
+      doc["bytes"] = len;
+      String body;
+      serializeJson(doc, body);
+      resp.send(200, "application/json", body.c_str());
+    } else if (up) {
+      if (hasResult) {
+        String displayLeaf = leaf.length() ? leaf : "Unknown Leaf";
+        String displayDisease = disease.length() ? disease : "Unknown";
+        String displaySolution = solution.length() ? solution : "No advice";
+        String displayTimestamp = timestamp.length() ? timestamp : String(millis());
+        showResultOnOLED(displayLeaf, displayDisease, displaySolution);
+        gDisplayedTimestamp = displayTimestamp;
+
+        DynamicJsonDocument doc(512);
+        doc["ok"] = true;
+        doc["uploaded"] = !cached;
+        doc["cached"] = cached;
+        doc["bytes"] = len;
+        doc["leaf_name"] = displayLeaf;
+        doc["disease"] = displayDisease;
+        doc["solution"] = displaySolution;
+        doc["timestamp"] = displayTimestamp;
+        doc["etag"] = imageVersion();
+        String body;
+        serializeJson(doc, body);
+        resp.send(200, "application/json", body.c_str());
+      } else {
+        gPendingLeaf = leaf.length() ? leaf : "OK";
+        gPendingDisease = disease;
+        gPendingSolution = solution;
+        gPendingTimestamp = timestamp;
+        if (!gPendingTimestamp.length()) {
+          gPendingTimestamp = String(millis());
+        }
+        gWaitingForResult = true;
+        gResultDisplayed = false;
+        showPreliminaryOnOLED(lastImageTag);
+
+        DynamicJsonDocument doc(256);
+        doc["ok"] = true;
+        doc["uploaded"] = true;
+        doc["bytes"] = len;
+        doc["waiting"] = true;
+        String body;
+        serializeJson(doc, body);
+        resp.send(200, "application/json", body.c_str());
+      }
+    } else {
+      clearProcessingState();
+      indicateFailure();
+      oledMsg("Upload failed", uerr, String(len) + " bytes saved");
+      gWaitingForResult = false;
+      gResultDisplayed = false;
+      resp.send(200, "application/json", (String("{\"ok\":true,\"uploaded\":false,\"err\":\"") + uerr + "\"}").c_str());
+    }
+  } else {
+    clearProcessingState();
+    indicateFailure();
+    oledMsg("Capture FAILED", err);
+    gWaitingForResult = false;
+    gResultDisplayed = false;
+    resp.send(500, "text/plain", (String("FAIL: ")+err).c_str());
+  }
+}
+
+void handleStats(HttpResponse& resp) {
+  WebState st;
+  {
+    std::lock_guard<std::mutex> g(gWebLock);
+    st = gWebState;
+  }
+  char etag[FRAME_ETAG_LEN] = "";
+  if (st.image && !st.image->empty()) {
+    frameEtag(st.imageKey, etag, sizeof(etag));
+  }
+  String version = etag;
+  if (version.length() >= 2) {
+    version = version.substring(1, version.length() - 1);
+  }
+  DynamicJsonDocument doc(768);
+  doc["cache_hits"] = st.cacheHits;
+  doc["cache_misses"] = st.cacheMisses;
+  doc["cache_entries"] = st.cacheEntries;
+  doc["cache_capacity"] = st.cacheCapacity;
+  doc["near_dup_skips"] = st.nearDupSkips;
+  doc["phash_distance"] = st.phashDistance;
+  doc["phash_threshold"] = HUB_PHASH_MAX_DISTANCE;
+  doc["dark_skips"] = st.darkSkips;
+  doc["jpeg_rejects"] = st.jpegRejects;
+  doc["cam_verdicts"] = st.camVerdicts;
+  if (st.jpeg.width) {
+    JsonObject jp = doc.createNestedObject("jpeg");
+    jp["width"] = st.jpeg.width;
+    jp["height"] = st.jpeg.height;
+    jp["quality"] = st.jpeg.quality;
+    jp["progressive"] = st.jpeg.progressive;
+  }
+  if (st.hasStats) {
+    JsonObject ls = doc.createNestedObject("leaf_stats");
+    ls["brightness"] = st.stats.brightness;
+    ls["mean_red"] = st.stats.red;
+    ls["mean_green"] = st.stats.green;
+    ls["mean_blue"] = st.stats.blue;
+    ls["chlorophyll_score"] = st.stats.chlorophyll;
+    ls["dryness_score"] = st.stats.dryness;
+    ls["verdict"] = leafVerdict(st.stats).leaf;
+  }
+  doc["batch_queued"] = st.batchQueued;
+  doc["http_clients"] = gHttp.clients();
+  doc["stream_viewers"] = gHttp.subscribers(HTTP_CHANNEL_MJPEG);
+  doc["stream_frames"] = st.streamFrames;
+  doc["event_clients"] = gHttp.subscribers(HTTP_CHANNEL_EVENTS);
+  doc["button_presses"] = st.button.presses;
+  doc["button_latency_ms"] = st.button.lastLatencyUs / 1000.0;
+  doc["history_entries"] = gHistory ? gHistory->count() : 0;
+  doc["history_newest"] = gHistory ? gHistory->newestId() : 0;
+  doc["cameras"] = HUB_CAMERAS;
+  doc["camera_link"] = gCamLink.name();
+  doc["image_etag"] = version;
+  String body;
+  serializeJson(doc, body);
+  resp.setHeader("Cache-Control", "no-store");
+  resp.send(200, "application/json", body.c_str());
+}
+
+// Prometheus text format: stage latencies and error counts from gMetrics,
+// then the hub counters also shown in /stats
+void handleMetrics(HttpResponse& resp) {
+  WebState st;
+  {
+    std::lock_guard<std::mutex> g(gWebLock);
+    st = gWebState;
+  }
+  std::string body = gMetrics.render("leafcam");
+  char buf[1024];
+  snprintf(buf, sizeof(buf),
+           "# TYPE leafcam_result_cache_hits_total counter\nleafcam_result_cache_hits_total %u\n"
+           "# TYPE leafcam_result_cache_misses_total counter\nleafcam_result_cache_misses_total %u\n"
+           "# TYPE leafcam_near_dup_skips_total counter\nleafcam_near_dup_skips_total %u\n"
+           "# TYPE leafcam_http_clients gauge\nleafcam_http_clients %u\n"
+           "# TYPE leafcam_stream_frames_total counter\nleafcam_stream_frames_total %u\n"
+           "# TYPE leafcam_free_heap_bytes gauge\nleafcam_free_heap_bytes %u\n"
+           "# TYPE leafcam_oled_renders_total counter\nleafcam_oled_renders_total %u\n"
+           "# TYPE leafcam_oled_unchanged_total counter\nleafcam_oled_unchanged_total %u\n"
+           "# TYPE leafcam_oled_scrolls_total counter\nleafcam_oled_scrolls_total %u\n"
+           "# TYPE leafcam_oled_pages_total counter\nleafcam_oled_pages_total %u\n"
+           "# TYPE leafcam_oled_tick_last_seconds gauge\nleafcam_oled_tick_last_seconds %.6f\n"
+           "# TYPE leafcam_oled_tick_max_seconds gauge\nleafcam_oled_tick_max_seconds %.6f\n",
+           (unsigned)st.cacheHits, (unsigned)st.cacheMisses, (unsigned)st.nearDupSkips,
+           (unsigned)gHttp.clients(), (unsigned)st.streamFrames, (unsigned)ESP.getFreeHeap(),
+           (unsigned)st.oled.renders, (unsigned)st.oled.unchanged, (unsigned)st.oled.scrolls,
+           (unsigned)st.oled.pages,
+           st.oled.lastUs / 1e6, st.oled.maxUs / 1e6);
+  body += buf;
+  snprintf(buf, sizeof(buf),
+           "# TYPE leafcam_dark_frame_skips_total counter\nleafcam_dark_frame_skips_total %u\n"
+           "# TYPE leafcam_jpeg_rejects_total counter\nleafcam_jpeg_rejects_total %u\n"
+           "# TYPE leafcam_camera_verdicts_total counter\nleafcam_camera_verdicts_total %u\n",
+           (unsigned)st.darkSkips, (unsigned)st.jpegRejects, (unsigned)st.camVerdicts);
+  body += buf;
+  if (st.hasStats) {
+    snprintf(buf, sizeof(buf),
+             "# TYPE leafcam_frame_brightness gauge\nleafcam_frame_brightness %.3f\n",
+             st.stats.brightness);
+    body += buf;
+  }
+  const ButtonStats& b = st.button;
+  snprintf(buf, sizeof(buf),
+           "# TYPE leafcam_button_presses_total counter\nleafcam_button_presses_total %u\n"
+           "# TYPE leafcam_button_bounces_total counter\nleafcam_button_bounces_total %u\n"
+           "# TYPE leafcam_button_overflows_total counter\nleafcam_button_overflows_total %u\n"
+           "# TYPE leafcam_button_coalesced_total counter\nleafcam_button_coalesced_total %u\n"
+           "# TYPE leafcam_button_dropped_busy_total counter\nleafcam_button_dropped_busy_total %u\n"
+           "# HELP leafcam_button_latency_seconds Button press to camera trigger.\n"
+           "# TYPE leafcam_button_latency_seconds histogram\n",
+           (unsigned)b.presses, (unsigned)b.bounces, (unsigned)b.overflows,
+           (unsigned)b.coalesced, (unsigned)b.droppedBusy);
+  body += buf;
+  appendLatencyHistogram(body, "leafcam_button_latency_seconds", "", b.latency);
+  if (gHistory) {
+    HistoryStats hs = gHistory->stats();
+    snprintf(buf, sizeof(buf),
+             "# TYPE leafcam_history_entries gauge\nleafcam_history_entries %u\n"
+             "# TYPE leafcam_history_added_total counter\nleafcam_history_added_total %u\n"
+             "# TYPE leafcam_history_evicted_total counter\nleafcam_history_evicted_total %u\n"
+             "# TYPE leafcam_history_rejected_total counter\nleafcam_history_rejected_total %u\n"
+             "# TYPE leafcam_history_sync_erases_total counter\nleafcam_history_sync_erases_total %u\n",
+             (unsigned)gHistory->count(), (unsigned)hs.added, (unsigned)hs.evicted,
+             (unsigned)hs.rejected, (unsigned)hs.syncErases);
+    body += buf;
+  }
+#if HUB_CAMERAS > 1
+  static const struct {
+    const char* name;
+    uint32_t CameraStats::*field;
+  } CAMERA_COUNTERS[] = {
+    { "leafcam_camera_triggers_total", &CameraStats::triggers },
+    { "leafcam_camera_frames_total", &CameraStats::frames },
+    { "leafcam_camera_failures_total", &CameraStats::failures },
+    { "leafcam_camera_timeouts_total", &CameraStats::timeouts },
+    { "leafcam_camera_stale_total", &CameraStats::stale },
+    { "leafcam_camera_uploads_total", &CameraStats::uploads },
+    { "leafcam_camera_upload_failures_total", &CameraStats::uploadFailures },
+  };
+  CameraStats cams[HUB_CAMERAS];
+  for (uint8_t i = 0; i < HUB_CAMERAS; ++i) cams[i] = gCams.stats(i);
+  for (const auto& m : CAMERA_COUNTERS) {
+    snprintf(buf, sizeof(buf), "# TYPE %s counter\n", m.name);
+    body += buf;
+    for (uint8_t i = 0; i < HUB_CAMERAS; ++i) {
+      snprintf(buf, sizeof(buf), "%s{camera=\"%u\"} %u\n", m.name, (unsigned)(i + 1),
+               (unsigned)(cams[i].*m.field));
+      body += buf;
+    }
+  }
+#endif
+  resp.setHeader("Cache-Control", "no-store");
+  resp.send(200, "text/plain; version=0.0.4", body);
+}
+
+// Capture and immediately return JPEG (loop task, deferred)
+void handleCaptureJpg(HttpResponse& resp) {
+  setProcessingState();
+  oledMsg("Capturing...", "Please wait");
+  uint32_t len=0; uint16_t crc=0; String err;
+  if (!captureFromCam(len, crc, err)) {
+    clearProcessingState();
+    indicateFailure();
+    oledMsg("Capture FAILED", err);
+    resp.send(500, "text/plain", (String("FAIL: ")+err).c_str());
+    return;
+  }
+  clearProcessingState();
+  char etag[FRAME_ETAG_LEN];
+  frameEtag(lastImageTag.key, etag, sizeof(etag));
+  resp.setHeader("ETag", etag);
+  resp.setHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+  resp.setHeader("Pragma", "no-cache");
+  resp.setHeader("Expires", "0");
+  resp.sendShared(200, "image/jpeg", lastImage, 0, lastImage->size());
+}
 
-HardwareSerial CamSerial(2); // UART2
-WebServer server(80);
+#if HUB_CAMERAS > 1
+// ====== Several cameras ======
+static CameraTransport& camLink(uint8_t link) {
+#if HUB_CAM_BUS
+  (void)link;
+  return gCamLink;
+#else
+  return link ? (CameraTransport&)gCam1Uart : gCamLink;
+#endif
+}
 
-// Store last image in RAM
-static std::vector<uint8_t> lastImage;
-static uint32_t lastImageCrc = 0;
+static void sendCameraCommand(const CameraAction& a) {
+  uint8_t cmd[8];
+  size_t n = 0;
+#if HUB_CAM_BUS
+  uint8_t addr = (uint8_t)(a.cam + 1);
+  cmd[n++] = '@';
+  cmd[n++] = addr;
+  cmd[n++] = (uint8_t)~addr;
+  cmd[n++] = a.kind == CameraAction::GRANT ? 'G' : 'T';
+#else
+  cmd[n++] = 'T';
+#endif
+  cmd[n++] = (uint8_t)(a.captureId >> 24);
+  cmd[n++] = (uint8_t)(a.captureId >> 16);
+  cmd[n++] = (uint8_t)(a.captureId >> 8);
+  cmd[n++] = (uint8_t)a.captureId;
+  CameraTransport& link = camLink(a.link);
+#if HUB_CAM_BUS && HUB_CAM_BUS_DE_PIN >= 0
+  digitalWrite(HUB_CAM_BUS_DE_PIN, HIGH);
+#endif
+  link.write(cmd, n);
+  link.flush();  // last bit out before the bus is released
+#if HUB_CAM_BUS && HUB_CAM_BUS_DE_PIN >= 0
+  digitalWrite(HUB_CAM_BUS_DE_PIN, LOW);
+#endif
+}
 
-// simple CRC16 (Modbus-ish), must match camera
-static uint16_t crc16(const uint8_t* data, size_t n) {
-  uint16_t crc = 0xFFFF;
-  for (size_t i = 0; i < n; ++i) {
-    crc ^= data[i];
-    for (int b = 0; b < 8; ++b) {
-      if (crc & 1) crc = (crc >> 1) ^ 0xA001;
-      else crc >>= 1;
+// Link task (core 0): sends the scheduler's triggers and grants and turns
+// received bytes into frames for its queues. Uploads stay on the loop task.
+static void cameraTask(void*) {
+  std::vector<std::unique_ptr<UartFrameReader>> readers;
+  for (size_t l = 0; l < gCams.links(); ++l) {
+    readers.emplace_back(new UartFrameReader(400000, HUB_JPEG_CHECK));  // readHeader's limit
+  }
+  // Bad JPEGs in each camera's current capture, and the re-requests for
+  // them not triggered yet; any other trigger starts a new capture
+  uint8_t jpegRetries[HUB_CAMERAS] = {0};
+  uint8_t retryTriggers[HUB_CAMERAS] = {0};
+  uint8_t buf[256];
+  for (;;) {
+    CameraAction a;
+    while (gCams.next(millis(), a)) {
+      sendCameraCommand(a);
+      if (a.kind == CameraAction::TRIGGER) {
+        logEvent(LOG_TRIGGER, a.captureId);
+        if (retryTriggers[a.cam]) {
+          --retryTriggers[a.cam];
+        } else {
+          jpegRetries[a.cam] = 0;
+        }
+      }
+    }
+    for (uint8_t l = 0; l < readers.size(); ++l) {
+      CameraTransport& link = camLink(l);
+      UartFrameReader& r = *readers[l];
+      size_t budget = 8192;  // then the other link and the next command
+      size_t n;
+      while (budget && (n = link.read(buf, sizeof(buf))) > 0) {
+        budget = n < budget ? budget - n : 0;
+        size_t off = 0;
+        while (off < n) {
+          size_t used = 0;
+          UartFrameReader::Event ev = r.feed(buf + off, n - off, used);
+          off += used;
+          if (ev == UartFrameReader::NONE) {
+            continue;
+          }
+          uint8_t cam = HUB_CAM_BUS ? gCams.cameraAt(l, r.address()) : gCams.cameraOn(l);
+          SharedBytes jpg = ev == UartFrameReader::FRAME ? r.take() : nullptr;
+          if (ev == UartFrameReader::BAD_JPEG && cam < HUB_CAMERAS) {
+            ++gJpegRejects;
+            logEvent(LOG_BAD_JPEG, cam + 1, jpegRetries[cam] + 1, 0, r.jpeg().error());
+            gCams.onFailure(cam, millis());
+            if (jpegRetries[cam] < HUB_JPEG_RETRIES) {
+              ++jpegRetries[cam];
+              ++retryTriggers[cam];
+              gCams.request(cam);
+            } else {
+              jpegRetries[cam] = 0;  // capture given up
+            }
+            continue;
+          }
+          if (!jpg) {
+            // Error frame ('E', or 'A' without payload), bad CRC or length
+            logEvent(LOG_CAMERA_FAILED, cam + 1, (uint32_t)ev);
+            gCams.onFailure(cam, millis());
+          } else if (!gCams.onFrame(cam, r.captureId(), jpg, r.crc(), r.camMs(), millis())) {
+            logEvent(LOG_STALE_FRAME, r.captureId());
+          }
+        }
+      }
     }
+    vTaskDelay(1);
   }
-  return crc;
 }
 
-// Upload current JPEG in memory to Pi 5
-static bool uploadToPi(const uint8_t* jpg,
-                       size_t len,
-                       String& outErr,
-                       String* outLeaf = nullptr,
-                       String* outDisease = nullptr,
-                       String* outSolution = nullptr,
-                       String* outTimestamp = nullptr,
-                       bool* outHasResult = nullptr) {
-  if (WiFi.status() != WL_CONNECTED) {
-    outErr = "WiFi not connected";
-    Serial.println(F("[uploadToPi] WiFi not connected"));
-    return false;
+static void startCameras() {
+#if HUB_CAM_BUS
+  for (uint8_t i = 0; i < HUB_CAMERAS; ++i) gCams.setLink(i, 0, true);
+#if HUB_CAM_BUS_DE_PIN >= 0
+  pinMode(HUB_CAM_BUS_DE_PIN, OUTPUT);
+  digitalWrite(HUB_CAM_BUS_DE_PIN, LOW);
+#endif
+#else
+  Cam1Serial.setRxBufferSize(HUB_CAM_RX_BUFFER);
+  Cam1Serial.begin(CAM_BAUD, SERIAL_8N1, HUB_CAM1_RX_PIN, HUB_CAM1_TX_PIN);
+#endif
+  gCams.setCaptureIdBase((uint32_t)gBootTag << 16);
+  xTaskCreatePinnedToCore(cameraTask, "cams", 4096, nullptr, 2, nullptr, 0);
+}
+
+// Loop task: upload the next queued frame (round robin over the cameras)
+// and show its result. The camera's next frame is taken meanwhile.
+static void serviceCameraUploads() {
+  QueuedFrame f;
+  if (!gCams.takeUpload(f)) {
+    return;
   }
-  HTTPClient http;
-  http.setTimeout(10000);
-  WiFiClient wifiClient;
-  if (!http.begin(wifiClient, PI5_UPLOAD_URL)) {
-    outErr = "HTTP begin failed";
-    Serial.println(F("[uploadToPi] http.begin failed"));
-    return false;
+  BusyScope busy;
+  FrameTag tag;
+  tagFrame(tag, *f.jpg, f.crc);
+  tag.captureId = f.captureId;
+  tag.camMs = f.camMs;
+  tag.linkMs = f.linkMs;
+  tag.cam = f.cam;
+  lastImage = f.jpg;
+  lastImageCrc = f.crc;
+  lastImageTag = tag;
+  if (gHistory) {
+    gHistoryTriggerMs = f.readyMs - f.linkMs;
+    gHistoryFrameMs = f.readyMs;
+    gHistoryId = gHistory->add(f.jpg, f.crc, f.captureId, gHistoryTriggerMs, f.camMs,
+                               historyMs(f.linkMs));
   }
-  http.addHeader("Content-Type", "image/jpeg");
-  int code = http.POST(const_cast<uint8_t*>(jpg), len);
-  if (code <= 0) {
-    outErr = String("HTTP error ") + http.errorToString(code);
-    Serial.printf("[uploadToPi] POST failed: %s\n", outErr.c_str());
-    http.end();
-    return false;
+
+  String leaf, disease, solution, timestamp, err;
+  bool hasResult = false;
+  bool queued = false;
+  bool cached = false;
+  setProcessingState();
+  bool ok = uploadFrame(f.jpg, tag, err, &leaf, &disease, &solution, &timestamp, &hasResult,
+                        &queued, &cached);
+  gCams.uploaded(f.cam, ok);
+  if (ok && hasResult) {
+    showResultOnOLED(leaf, disease, solution);
+    gDisplayedTimestamp = timestamp.length() ? timestamp : String(millis());
+  } else if (ok) {
+    // The result comes through /result (uploadFrame set gPendingTag), as
+    // with a single camera
+    gPendingTimestamp = timestamp.length() ? timestamp : String(millis());
+    gWaitingForResult = true;
+  } else {
+    clearProcessingState();
+    indicateFailure();
+    oledMsg(String("Camera ") + (f.cam + 1) + " upload", err);
   }
-  if (code != 200) {
-    outErr = String("Upload failed ") + code;
-    Serial.printf("[uploadToPi] Non-OK response code %d\n", code);
-    http.end();
-    return false;
+
+  {
+    std::lock_guard<std::mutex> g(gWebLock);
+    CameraView& v = gCamViews[f.cam];
+    v.image = f.jpg;
+    v.key = tag.key;
+    v.captureId = f.captureId;
+    v.leaf = hasResult ? leaf : String();
+    v.disease = hasResult ? disease : String();
+    v.err = err;
   }
-  Serial.printf("[uploadToPi] Uploaded %u bytes -> %d\n", (unsigned)len, code);
-  String body = http.getString();
-  http.end();
+  publishWebState();
+  DynamicJsonDocument ev(384);
+  ev["cam"] = f.cam + 1;
+  ev["capture_id"] = captureIdHex(f.captureId);
+  ev["bytes"] = f.jpg->size();
+  ev["ok"] = ok;
+  ev["cached"] = cached;
+  ev["etag"] = imageVersion();
+  if (hasResult) {
+    ev["leaf_name"] = leaf;
+    ev["disease"] = disease;
+  }
+  if (!ok) {
+    ev["err"] = err;
+  }
+  pushEvent("camera", ev);
+}
 
-  // Try parse JSON response for optional fields
-  DynamicJsonDocument doc(2048);
-  DeserializationError jerr = deserializeJson(doc, body);
-  bool hasResult = false;
-  if (!jerr) {
-    String leaf = doc["leaf_name"] | doc["species"] | "";
-    String diseaseVal = doc["disease"] | doc["condition"] | "";
-    String solutionVal = doc["solution"] | doc["recommendation"] | "";
-    if (outLeaf) {
-      *outLeaf = leaf;
+// GET /cameras: per-camera state, counters and last result.
+// GET /cameras/<n>.jpg: the last frame of camera n (1-based).
+static void handleCameras(const HttpRequest& req, HttpResponse& resp) {
+  if (req.path != "/cameras") {
+    const char* p = req.path.c_str() + 9;
+    char* end = nullptr;
+    unsigned long n = strtoul(p, &end, 10);
+    if (end == p || strcmp(end, ".jpg") != 0 || n < 1 || n > HUB_CAMERAS) {
+      resp.send(404, "text/plain", "Not found");
+      return;
+    }
+    SharedBytes image;
+    FrameKey key;
+    {
+      std::lock_guard<std::mutex> g(gWebLock);
+      image = gCamViews[n - 1].image;
+      key = gCamViews[n - 1].key;
+    }
+    serveFrame(req, resp, image, key);
+    return;
+  }
+  DynamicJsonDocument doc(384 + 640 * HUB_CAMERAS);
+  doc["bus"] = HUB_CAM_BUS != 0;
+  doc["queued"] = gCams.queuedTotal();
+  JsonArray list = doc.createNestedArray("cameras");
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < HUB_CAMERAS; ++i) {
+    CameraStats st = gCams.stats(i);
+    CameraView v;
+    {
+      std::lock_guard<std::mutex> g(gWebLock);
+      v = gCamViews[i];
     }
-    if (outDisease) {
-      *outDisease = diseaseVal;
+    JsonObject c = list.createNestedObject();
+    c["id"] = i + 1;
+    c["link"] = st.link;
+    c["state"] = cameraStateName(st.state);
+    c["pending"] = st.pending;
+    c["queued"] = st.queued;
+    c["triggers"] = st.triggers;
+    c["frames"] = st.frames;
+    c["failures"] = st.failures;
+    c["timeouts"] = st.timeouts;
+    c["stale"] = st.stale;
+    c["uploads"] = st.uploads;
+    c["upload_failures"] = st.uploadFailures;
+    c["bytes"] = (double)st.bytes;
+    c["cam_ms"] = st.lastCamMs;
+    c["link_ms"] = st.lastLinkMs;
+    if (st.frames) {
+      c["age_ms"] = now - st.lastFrameMs;
     }
-    if (outSolution) {
-      *outSolution = solutionVal;
+    if (v.image) {
+      char etag[FRAME_ETAG_LEN];
+      frameEtag(v.key, etag, sizeof(etag));
+      String version = etag;
+      c["etag"] = version.substring(1, version.length() - 1);
+      c["capture_id"] = captureIdHex(v.captureId);
     }
-    if (leaf.length() || diseaseVal.length() || solutionVal.length()) {
-      hasResult = true;
+    if (v.leaf.length()) {
+      c["leaf_name"] = v.leaf;
+      c["disease"] = v.disease;
     }
-    if (outTimestamp) {
-      const char* tsVal = doc["timestamp"] | "";
-      *outTimestamp = tsVal;
+    if (v.err.length()) {
+      c["err"] = v.err;
     }
   }
-  if (outHasResult) {
-    *outHasResult = hasResult;
+  String body;
+  serializeJson(doc, body);
+  resp.setHeader("Cache-Control", "no-store");
+  resp.send(200, "application/json", body.c_str());
+}
+
+// /capture[?cam=n]: queue a capture on camera n, or on all of them; frames
+// and results follow as "camera" events and in /cameras
+static void handleMultiCapture(const HttpRequest& req, HttpResponse& resp) {
+  if (req.path == "/capture.jpg") {
+    resp.send(404, "text/plain", "Several cameras: use /capture?cam=n and /cameras/<n>.jpg");
+    return;
   }
-  return true;
+  std::string arg = req.arg("cam");
+  long n = arg.empty() ? 0 : strtol(arg.c_str(), nullptr, 10);
+  if (!arg.empty() && (n < 1 || n > HUB_CAMERAS)) {
+    resp.send(400, "text/plain", "Unknown camera");
+    return;
+  }
+  if (n) {
+    gCams.request((uint8_t)(n - 1));
+  } else {
+    gCams.requestAll();
+  }
+  DynamicJsonDocument doc(128);
+  doc["ok"] = true;
+  doc["queued"] = n ? 1 : HUB_CAMERAS;
+  String body;
+  serializeJson(doc, body);
+  resp.send(200, "application/json", body.c_str());
 }
+#endif
 
-void oledMsg(const String& l1, const String& l2, const String& l3) {
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  int maxChars = (OLED_WIDTH / 6); // 6 pixels per char at text size 1
-  int maxLines = (OLED_HEIGHT / 8); // 8 pixels per line at text size 1
-  // Collect all input strings into one vector
-  std::vector<String> inputLines;
-  if (l1.length()) inputLines.push_back(l1);
-  if (l2.length()) inputLines.push_back(l2);
-  if (l3.length()) inputLines.push_back(l3);
-  // Split each input line into chunks that fit the display
-  std::vector<String> displayLines;
-  for (auto &line : inputLines) {
-    int pos = 0;
-    while (pos < line.length()) {
-      displayLines.push_back(line.substring(pos, pos + maxChars));
-      pos += maxChars;
-    }
-  }
-  // Print only as many lines as fit the screen
-  for (int i = 0; i < maxLines && i < displayLines.size(); ++i) {
-    display.setCursor(0, i * 8);
-    display.print(displayLines[i]);
-  }
-  display.display();
-}
-
-static bool readExact(uint8_t* buf, size_t n, uint32_t timeoutMs) {
-  uint32_t start = millis();
-  size_t got = 0;
-  while (got < n) {
-    if (CamSerial.available()) {
-      got += CamSerial.readBytes(buf + got, n - got);
-      start = millis(); // activity resets timeout
-    } else if (millis() - start > timeoutMs) {
-      return false;
+// Web task. Anything that needs the camera is queued for the loop task and
+// answered from there; the rest is served from gWebState.
+static void routeRequest(const HttpRequest& req, HttpResponse& resp) {
+  if (req.method != "GET" && req.method != "HEAD") {
+    resp.send(405, "text/plain", "Method not allowed");
+    return;
+  }
+  // Web UI (web/hub/, gzipped into web_assets.h by tools/gen_web_assets.py)
+  for (size_t i = 0; i < WEB_ASSET_COUNT; ++i) {
+    const WebAsset& a = WEB_ASSETS[i];
+    if (req.path == a.path) {
+      serveGzipAsset(req, resp, a.contentType, a.gz, a.gzLen, a.version, a.versioned);
+      return;
     }
-    updateIndicators();
-    delay(0);
   }
-  return true;
+  if (req.path == "/image.jpg") {
+    SharedBytes image;
+    FrameKey key;
+    {
+      std::lock_guard<std::mutex> g(gWebLock);
+      image = gWebState.image;
+      key = gWebState.imageKey;
+    }
+    serveFrame(req, resp, image, key);
+  } else if (req.path == "/stats") {
+    handleStats(resp);
+  } else if (req.path == "/stream") {
+#if HUB_CAMERAS > 1
+    resp.send(404, "text/plain", "Preview needs a single camera");
+#else
+    resp.setHeader("Cache-Control", "no-cache, no-store");
+    // One queued frame: a viewer on a slow link sees fewer, but current, frames
+    resp.stream(HTTP_CHANNEL_MJPEG, MJPEG_CONTENT_TYPE, 1);
+#endif
+  } else if (req.path == "/log") {
+    resp.setHeader("Cache-Control", "no-store");
+    resp.send(200, "text/plain; charset=utf-8", gLog.dump());
+  } else if (req.path == "/metrics") {
+    handleMetrics(resp);
+  } else if (req.path == "/events") {
+    resp.setHeader("Cache-Control", "no-cache, no-store");
+    resp.stream(HTTP_CHANNEL_EVENTS, SSE_CONTENT_TYPE, 16);
+  } else if (req.path == "/history" || req.path.compare(0, 9, "/history/") == 0) {
+    if (gHistory) {
+      serveHistory(req, resp, *gHistory);
+    } else {
+      resp.send(404, "text/plain", "No history partition");
+    }
+#if HUB_CAMERAS > 1
+  } else if (req.path == "/cameras" || req.path.compare(0, 9, "/cameras/") == 0) {
+    handleCameras(req, resp);
+  } else if (req.path == "/capture" || req.path == "/capture.jpg") {
+    handleMultiCapture(req, resp);
+#else
+  } else if (req.path == "/capture" || req.path == "/capture.jpg") {
+    std::lock_guard<std::mutex> g(gWebLock);
+    gWebCaptures.push_back(std::make_pair(resp.token(), req.path == "/capture.jpg"));
+    // Captures run one after another on the loop task
+    resp.defer(gWebCaptures.size() * CAPTURE_WORST_MS);
+#endif
+  } else {
+    resp.send(404, "text/plain", "Not found");
+  }
 }
 
-static bool readHeader(uint32_t headerTimeoutMs, uint32_t& outLen, uint16_t& outCrc, String& outErr) {
-  const uint8_t MAGIC[4] = {'P','V','I','C'};
-  const uint8_t ERRMG[4] = {'P','V','I','E'};
-  uint8_t window[4] = {0};
-  uint32_t start = millis();
-  size_t filled = 0;
-  while (millis() - start <= headerTimeoutMs) {
-    if (CamSerial.available()) {
-      uint8_t b = (uint8_t)CamSerial.read();
-      if (filled < 4) {
-        window[filled++] = b;
-      } else {
-        window[0] = window[1];
-        window[1] = window[2];
-        window[2] = window[3];
-        window[3] = b;
-      }
-      if (filled == 4 && std::memcmp(window, MAGIC, 4) == 0) {
-        // Read len + crc
-        uint8_t rest[6];
-        if (!readExact(rest, sizeof(rest), 3000)) { outErr = "timeout len+crc"; return false; }
-        uint32_t len = (uint32_t)rest[0]<<24 | (uint32_t)rest[1]<<16 | (uint32_t)rest[2]<<8 | (uint32_t)rest[3];
-        uint16_t crc = (uint16_t)rest[4]<<8 | (uint16_t)rest[5];
-        if (len == 0 || len > 400000) { outErr = "bad length"; return false; }
-        outLen = len; outCrc = crc; return true;
-      }
-      if (filled == 4 && std::memcmp(window, ERRMG, 4) == 0) {
-        // Camera reported error
-        uint8_t rest[6];
-        if (!readExact(rest, sizeof(rest), 2000)) { outErr = "timeout len+crc (err)"; return false; }
-        outErr = "camera error";
-        return false;
+// Copies the log ring to Serial. Runs at idle priority, so blocking on the
+// UART here never delays the capture path.
+static void logDrainTask(void*) {
+  uint32_t cursor = gLog.start();
+  LogRecord rec;
+  char line[160];
+  for (;;) {
+    uint32_t missed = 0;
+    while (gLog.read(cursor, rec, &missed)) {
+      if (missed) {
+        Serial.printf("[log] %u entries overwritten before output\n", (unsigned)missed);
+        missed = 0;
       }
-    } else {
-      delay(1);
+      gLog.format(rec, line, sizeof(line));
+      Serial.println(line);
     }
-    updateIndicators();
+    vTaskDelay(pdMS_TO_TICKS(20));
   }
-  outErr = "timeout header";
-  return false;
 }
 
-static bool captureFromCam(uint32_t& outLen, uint16_t& outCrc, String& outErr) {
-  // Send trigger
-  while (CamSerial.available()) { CamSerial.read(); updateIndicators(); }
-  Serial.println(F("[captureFromCam] Triggering camera"));
-  CamSerial.write('C');
-  CamSerial.flush();
-
-  // Wait and read header with sliding window
-  uint32_t len = 0; uint16_t crc = 0;
-  if (!readHeader(8000, len, crc, outErr)) {
-    Serial.printf("[captureFromCam] Header failure: %s\n", outErr.c_str());
-    return false;
+static void httpTask(void*) {
+  for (;;) {
+    uint32_t now = millis();
+    gHttpListener.acceptInto(gHttp, now);
+    if (!gHttp.poll(now)) {
+      vTaskDelay(1);
+    }
   }
+}
 
-  // Read body
-  lastImage.clear();
-  lastImage.resize(len);
-  if (!readExact(lastImage.data(), len, 12000)) { outErr = "timeout body"; lastImage.clear(); return false; }
+#if HUB_CAMERAS == 1
+// Loop task: start, keep alive or stop the camera preview to match the
+// number of /stream viewers, and relay whatever preview bytes have arrived.
+static void serviceStream() {
+  uint8_t viewers = gHttp.subscribers(HTTP_CHANNEL_MJPEG);
+  uint32_t now = millis();
+  if (!viewers) {
+    if (gStreamActive) {
+      const uint8_t stop = 'X';
+      gCamLink.write(&stop, 1);
+      gStreamActive = false;
+      logEvent(LOG_STREAM_STOPPED);
+    }
+    return;
+  }
+  if (!gStreamActive || now - gStreamKeepaliveMs >= HUB_STREAM_KEEPALIVE_MS) {
+    if (!gStreamActive) {
+      gPreviewReader.reset();
+      logEvent(LOG_STREAM_STARTED, viewers);
+    }
+    const uint8_t cmd[2] = { 'S', (uint8_t)HUB_STREAM_FPS };
+    gCamLink.write(cmd, sizeof(cmd));
+    gStreamActive = true;
+    gStreamKeepaliveMs = now;
+  }
 
-  // Validate CRC
-  uint16_t calc = crc16(lastImage.data(), lastImage.size());
-  if (calc != crc) { outErr = "crc mismatch"; lastImage.clear(); return false; }
+  uint8_t buf[256];
+  size_t budget = 8192;  // bounded work per loop() pass
+  size_t n;
+  while (budget && (n = gCamLink.read(buf, sizeof(buf))) > 0) {
+    budget = n < budget ? budget - n : 0;
+    size_t off = 0;
+    while (off < n) {
+      size_t used = 0;
+      UartFrameReader::Event ev = gPreviewReader.feed(buf + off, n - off, used);
+      off += used;
+      if (ev == UartFrameReader::FRAME && gPreviewReader.type() == FRAME_TYPE_PREVIEW) {
+        std::shared_ptr<std::vector<uint8_t>> jpg = gPreviewReader.take();
+        gHttp.publish(HTTP_CHANNEL_MJPEG, mjpegPart(jpg->data(), jpg->size()));
+        ++gStreamFrames;
+      }
+    }
+  }
+}
+#endif
 
-  outLen = len;
-  outCrc = crc;
-  lastImageCrc = crc;
-  return true;
+// Loop task: run one queued web capture, if any
+static void serviceWebCaptures() {
+  std::pair<uint32_t, bool> job;
+  {
+    std::lock_guard<std::mutex> g(gWebLock);
+    if (gWebCaptures.empty()) {
+      return;
+    }
+    job = gWebCaptures.front();
+    gWebCaptures.erase(gWebCaptures.begin());
+  }
+  BusyScope busy;
+  HttpResponse resp;
+  if (job.second) {
+    handleCaptureJpg(resp);
+  } else {
+    handleCapture(resp);
+  }
+  gHttp.complete(job.first, resp);
 }
 
-// Web UI
-static const char INDEX_HTML[] PROGMEM = R"HTML(
-<!doctype html>
-<html>
-  <head>
-    <meta charset="utf-8" />
-    <meta name="viewport" content="width=device-width, initial-scale=1" />
-    <title>ESP32 Camera Dashboard</title>
-    <style>
-      body { font-family: system-ui, sans-serif; margin: 20px; }
-      button { padding: 10px 16px; font-size: 16px; }
-      img { max-width: 100%; height: auto; display: block; margin-top: 16px; border: 1px solid #ddd; }
-    </style>
-  </head>
-  <body>
-    <h1>ESP32 Camera Dashboard</h1>
-    <button onclick="capture()">Capture</button>
-    <img id="img" src="/image.jpg?ts=0" alt="No image yet" />
-    <script>
-      async function capture(){
-        try {
-          await fetch('/capture');
-          const ts = Date.now();
-          document.getElementById('img').src = '/image.jpg?ts='+ts;
-        } catch(e){ alert('Capture failed'); }
-      }
-    </script>
-  </body>
-</html>
-)HTML";
+// Falling edge after the line was quiet for the debounce time is a press;
+// the edges of contact bounce and of the release are not.
+static void IRAM_ATTR buttonIsr() {
+  uint32_t now = micros();
+  uint32_t quiet = now - gButtonLastEdgeUs;
+  gButtonLastEdgeUs = now;
+  if (digitalRead(PIN_BUTTON) != LOW) return;
+  if (quiet < HUB_BUTTON_DEBOUNCE_MS * 1000UL) {
+    gButtonBounces = gButtonBounces + 1;
+    return;
+  }
+  gButtonPresses = gButtonPresses + 1;
+  ButtonPress press = {now, gBusyDepth ? gBusyStretch : 0};
+  BaseType_t woken = pdFALSE;
+  if (xQueueSendFromISR(gButtonQueue, &press, &woken) != pdTRUE) {
+    gButtonOverflows = gButtonOverflows + 1;
+  }
+  if (woken) portYIELD_FROM_ISR();
+}
 
-void handleRoot() {
-  server.send_P(200, "text/html", INDEX_HTML);
+// Next press to act on. Presses made while busy go through the busy
+// policy; presses within HUB_BUTTON_COALESCE_MS of the taken one (with
+// policy 1, any made during the same busy stretch) are merged into it.
+static bool takeButtonPress(uint32_t& pressUs, uint32_t& merged) {
+  ButtonPress p, next;
+  while (xQueueReceive(gButtonQueue, &p, 0) == pdTRUE) {
+#if HUB_BUTTON_BUSY_POLICY == 0
+    if (p.stretch) {
+      ++gButtonStats.droppedBusy;
+      continue;
+    }
+#endif
+    pressUs = p.us;
+    merged = 0;
+    while (xQueuePeek(gButtonQueue, &next, 0) == pdTRUE) {
+      bool near = next.us - pressUs < HUB_BUTTON_COALESCE_MS * 1000UL;
+#if HUB_BUTTON_BUSY_POLICY == 1
+      near = near || (p.stretch && next.stretch == p.stretch);
+#endif
+      if (!near) break;
+      xQueueReceive(gButtonQueue, &next, 0);
+      ++merged;
+    }
+    gButtonStats.coalesced += merged;
+    return true;
+  }
+  return false;
 }
 
-void handleCapture() {
+// One-shot capture and upload for a button press
+static void captureOnButton(uint32_t pressUs, uint32_t merged) {
+  BusyScope busy;
+  oledMsg("Button pressed", "Capturing...");
   setProcessingState();
   gResultDisplayed = false;
   gWaitingForResult = false;
-  oledMsg("Capturing...", "Please wait");
+  uint32_t latencyUs = micros() - pressUs;
+  gButtonStats.latency.observe(latencyUs);
+  gButtonStats.lastLatencyUs = latencyUs;
+  logEvent(LOG_BUTTON_PRESS, latencyUs / 1000, merged);
+#if HUB_CAMERAS > 1
+  // One capture per camera; the link task and serviceCameraUploads() do the rest
+  gCams.requestAll();
+#else
   uint32_t len=0; uint16_t crc=0;
   String err;
-  bool ok = captureFromCam(len, crc, err);
-  if (ok) {
-    // Try uploading to Pi 5
+  CamVerdict verdict;
+  bool ok = captureFromCam(len, crc, err, HUB_CAM_TRIAGE ? &verdict : nullptr);
+  if (ok && verdict.valid) {
+    showVerdictOnOLED(verdict);
+  } else if (ok) {
+    // Upload to Pi 5 after capture
     String leaf, disease, solution, timestamp, uerr;
     bool hasResult = false;
-    bool up = uploadToPi(
-      lastImage.data(),
-      lastImage.size(),
-      uerr,
-      &leaf,
-      &disease,
-      &solution,
-      &timestamp,
-      &hasResult
-    );
-    if (up) {
+    bool queued = false;
+    bool cached = false;
+    bool up = uploadFrame(
+          lastImage,
+          lastImageTag,
+          uerr,
+          &leaf,
+          &disease,
+          &solution,
+          &timestamp,
+          &hasResult,
+          &queued,
+          &cached);
+    if (up && queued) {
+      clearProcessingState();
+    } else if (up) {
       if (hasResult) {
         String displayLeaf = leaf.length() ? leaf : "Unknown Leaf";
         String displayDisease = disease.length() ? disease : "Unknown";
@@ -432,18 +2545,6 @@ void handleCapture() {
         String displayTimestamp = timestamp.length() ? timestamp : String(millis());
         showResultOnOLED(displayLeaf, displayDisease, displaySolution);
         gDisplayedTimestamp = displayTimestamp;
-
-        DynamicJsonDocument resp(512);
-        resp["ok"] = true;
-        resp["uploaded"] = true;
-        resp["bytes"] = len;
-        resp["leaf_name"] = displayLeaf;
-        resp["disease"] = displayDisease;
-        resp["solution"] = displaySolution;
-        resp["timestamp"] = displayTimestamp;
-        String body;
-        serializeJson(resp, body);
-        server.send(200, "application/json", body);
       } else {
         gPendingLeaf = leaf.length() ? leaf : "OK";
         gPendingDisease = disease;
@@ -454,89 +2555,42 @@ void handleCapture() {
         }
         gWaitingForResult = true;
         gResultDisplayed = false;
-        oledMsg("Processing...", "Waiting for Pi");
-
-        DynamicJsonDocument resp(256);
-        resp["ok"] = true;
-        resp["uploaded"] = true;
-        resp["bytes"] = len;
-        resp["waiting"] = true;
-        String body;
-        serializeJson(resp, body);
-        server.send(200, "application/json", body);
+        showPreliminaryOnOLED(lastImageTag);
       }
     } else {
       clearProcessingState();
-      digitalWrite(RED_LED_PIN, HIGH);
-      digitalWrite(GREEN_LED_PIN, LOW);
+      indicateFailure();
       oledMsg("Upload failed", uerr, String(len) + " bytes saved");
       gWaitingForResult = false;
       gResultDisplayed = false;
-      server.send(200, "application/json", String("{\"ok\":true,\"uploaded\":false,\"err\":\"") + uerr + "\"}");
     }
   } else {
     clearProcessingState();
-    digitalWrite(RED_LED_PIN, HIGH);
-    digitalWrite(GREEN_LED_PIN, LOW);
+    indicateFailure();
     oledMsg("Capture FAILED", err);
     gWaitingForResult = false;
     gResultDisplayed = false;
-    server.send(500, "text/plain", String("FAIL: ")+err);
-  }
-}
-
-void handleImage() {
-  if (lastImage.empty()) {
-    server.send(404, "text/plain", "No image");
-    return;
   }
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.setContentLength(lastImage.size());
-  server.send(200, "image/jpeg", "");
-  WiFiClient client = server.client();
-  client.write(lastImage.data(), lastImage.size());
+#endif
 }
 
-// Capture and immediately return JPEG
-void handleCaptureJpg() {
-  setProcessingState();
-  oledMsg("Capturing...", "Please wait");
-  uint32_t len=0; uint16_t crc=0; String err;
-  if (!captureFromCam(len, crc, err)) {
-    clearProcessingState();
-    digitalWrite(RED_LED_PIN, HIGH);
-    digitalWrite(GREEN_LED_PIN, LOW);
-    oledMsg("Capture FAILED", err);
-    server.send(500, "text/plain", String("FAIL: ")+err);
-    return;
-  }
-  clearProcessingState();
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
-  server.setContentLength(lastImage.size());
-  server.send(200, "image/jpeg", "");
-  WiFiClient client = server.client();
-  client.write(lastImage.data(), lastImage.size());
+static void serviceButton() {
+  uint32_t pressUs, merged;
+  if (takeButtonPress(pressUs, merged)) captureOnButton(pressUs, merged);
 }
 
-// Debounce
-bool lastBtn = true; // pull-up idle HIGH
-uint32_t lastChange = 0;
-
 void setup() {
-  pinMode(GREEN_LED_PIN, OUTPUT);
-  pinMode(RED_LED_PIN, OUTPUT);
-  pinMode(BUZZER_PIN, OUTPUT);
-  clearProcessingState();
-  digitalWrite(GREEN_LED_PIN, LOW);
-  digitalWrite(BUZZER_PIN, LOW);
+  initIndicators();
+  Serial.setTxBufferSize(1024);  // the log task's prints return while bytes go out
   Serial.begin(115200);
   delay(100);
+  gBootTag = (uint16_t)esp_random();
+  xTaskCreatePinnedToCore(logDrainTask, "log", 3072, nullptr, 0, nullptr, 0);
+  initHistory();
 
   pinMode(PIN_BUTTON, INPUT_PULLUP);
+  gButtonQueue = xQueueCreate(HUB_BUTTON_QUEUE, sizeof(ButtonPress));
+  attachInterrupt(digitalPinToInterrupt(PIN_BUTTON), buttonIsr, CHANGE);
 
   // OLED init with auto-detect (0x3C / 0x3D)
   Wire.begin(21, 22);
@@ -552,7 +2606,7 @@ void setup() {
     // continue without OLED
   } else {
     display.clearDisplay();
-    display.display();
+    gOledAddr = detectedAddr; // first oledMsg() sends every page
     oledMsg("Booting...");
   }
 #else
@@ -560,13 +2614,20 @@ void setup() {
     // continue without OLED
   } else {
     display.clearDisplay();
-    display.display();
+    gOledAddr = detectedAddr; // first oledMsg() sends every page
     oledMsg("Booting...");
   }
 #endif
+  if (gOledAddr) xTaskCreatePinnedToCore(oledTask, "oled", 3072, nullptr, 1, nullptr, 0);
 
   // UART to camera
+#if HUB_CAM_TRANSPORT == 0
+  CamSerial.setRxBufferSize(HUB_CAM_RX_BUFFER);
   CamSerial.begin(CAM_BAUD, SERIAL_8N1, CAM_RX_PIN, CAM_TX_PIN);
+#endif
+#if HUB_CAMERAS > 1
+  startCameras();
+#endif
 
   // WiFi
   WiFi.mode(WIFI_STA);
@@ -575,7 +2636,6 @@ void setup() {
   uint32_t t0 = millis();
   while (WiFi.status() != WL_CONNECTED && millis() - t0 < 15000) {
     delay(250);
-    updateIndicators();
   }
   if (WiFi.status() == WL_CONNECTED) {
     String ip = WiFi.localIP().toString();
@@ -586,17 +2646,63 @@ void setup() {
     WiFi.softAP("cam-hub", "12345678");
   }
 
-  // Web server routes
-  server.on("/", handleRoot);
-  server.on("/capture", HTTP_GET, handleCapture);
-  server.on("/image.jpg", HTTP_GET, handleImage);
-  server.on("/capture.jpg", HTTP_GET, handleCaptureJpg);
-  server.begin();
+#if HUB_CAM_TRANSPORT == 1
+  if (!gCamTcp.listen(HUB_CAM_TCP_PORT)) {
+    Serial.println(F("[camera] TCP listen failed"));
+  }
+#endif
+
+  // Web server task (routes in routeRequest)
+  publishWebState();
+  if (gHttpListener.begin(HUB_HTTP_PORT)) {
+    xTaskCreatePinnedToCore(httpTask, "http", 8192, nullptr, 1, nullptr, 0);
+  } else {
+    Serial.println(F("[http] listen failed"));
+  }
 }
 
 void loop() {
-  updateIndicators();
-  server.handleClient();
+  serviceWebCaptures();
+#if HUB_CAMERAS > 1
+  serviceCameraUploads();
+#else
+  serviceStream();
+#endif
+  publishWebState();
+  // One flash block per pass: the rest of a stored frame, or erasing ahead
+  if (gHistory) gHistory->service();
+  static uint32_t lastEventKeepalive = 0;
+  if (millis() - lastEventKeepalive > HUB_EVENTS_KEEPALIVE_MS) {
+    lastEventKeepalive = millis();
+    gHttp.publish(HTTP_CHANNEL_EVENTS, sseComment("keepalive"));
+  }
+#if HUB_BATCH_UPLOAD
+  // Send a partially filled batch once its oldest frame has waited long
+  // enough, or retry one the Pi refused
+  if (batchDue(millis())) {
+    BusyScope busy;
+    uint16_t frames = gBatch.count();
+    String leaf, disease, solution, timestamp, uerr;
+    bool hasResult = false;
+    setProcessingState();
+    oledMsg("Sending batch", String(frames) + " frames");
+    if (uploadBatchToPi(uerr, &leaf, &disease, &solution, &timestamp, &hasResult)) {
+      if (hasResult) {
+        showResultOnOLED(leaf, disease, solution);
+        gDisplayedTimestamp = timestamp.length() ? timestamp : String(millis());
+      } else {
+        gPendingTimestamp = timestamp.length() ? timestamp : String(millis());
+        gWaitingForResult = true;
+        showPreliminaryOnOLED(gPendingTag);
+      }
+    } else {
+      clearProcessingState();
+      indicateFailure();
+      oledMsg("Batch upload failed", uerr,
+              String(frames) + (gBatch.empty() ? " frames dropped" : " frames kept"));
+    }
+  }
+#endif
   static unsigned long lastPoll = 0;
   if (WiFi.status() == WL_CONNECTED && millis() - lastPoll > 5000) {
     lastPoll = millis();
@@ -612,26 +2718,24 @@ void loop() {
         String disease = doc["disease"] | doc["condition"] | "Unknown";
         String solution = doc["solution"] | doc["recommendation"] | "No advice";
         String timestamp = doc["timestamp"] | "";
+        String captureId = doc["capture_id"] | "";
 
-        bool shouldDisplay = false;
-        if (gWaitingForResult) {
-          if (gPendingTimestamp.length()) {
-            if (timestamp == gPendingTimestamp) {
-              if (!gResultDisplayed || timestamp != gDisplayedTimestamp) {
-                shouldDisplay = true;
-              }
-            }
-          } else if (!gResultDisplayed) {
-            shouldDisplay = true;
-          }
-        } else if (timestamp.length() && timestamp != gDisplayedTimestamp) {
-          shouldDisplay = true;
-        }
+        PiResultWait wait;
+        wait.waiting = gWaitingForResult;
+        wait.pendingCaptureId = gPendingCaptureId;
+        wait.pendingTimestamp = gPendingTimestamp.c_str();
+        wait.displayed = gResultDisplayed;
+        wait.displayedTimestamp = gDisplayedTimestamp.c_str();
+        bool shouldDisplay = piResultIsNew(wait, captureId.c_str(), timestamp.c_str());
 
         if (shouldDisplay) {
           String displayLeaf = leaf.length() ? leaf : gPendingLeaf;
           String displayDisease = disease.length() ? disease : gPendingDisease;
           String displaySolution = solution.length() ? solution : gPendingSolution;
+          if (gWaitingForResult && !gPendingTag.key.empty()) {
+            cacheResult(gPendingTag, displayLeaf, displayDisease, displaySolution, timestamp);
+            gPendingTag = FrameTag();
+          }
           showResultOnOLED(displayLeaf, displayDisease, displaySolution);
           if (timestamp.length()) {
             gDisplayedTimestamp = timestamp;
@@ -648,70 +2752,5 @@ void loop() {
     http.end();
   }
 
-  // Button handling (active LOW)
-  bool b = digitalRead(PIN_BUTTON);
-  if (b != lastBtn) {
-    lastChange = millis();
-    lastBtn = b;
-  }
-  if (!b && (millis() - lastChange) > 40) { // pressed
-    // One-shot capture on press
-    uint32_t len=0; uint16_t crc=0;
-    oledMsg("Button pressed", "Capturing...");
-    setProcessingState();
-    gResultDisplayed = false;
-    gWaitingForResult = false;
-    String err;
-    bool ok = captureFromCam(len, crc, err);
-    if (ok) {
-      // Upload to Pi 5 after capture
-      String leaf, disease, solution, timestamp, uerr;
-      bool hasResult = false;
-      if (uploadToPi(
-            lastImage.data(),
-            lastImage.size(),
-            uerr,
-            &leaf,
-            &disease,
-            &solution,
-            &timestamp,
-            &hasResult)) {
-        if (hasResult) {
-          String displayLeaf = leaf.length() ? leaf : "Unknown Leaf";
-          String displayDisease = disease.length() ? disease : "Unknown";
-          String displaySolution = solution.length() ? solution : "No advice";
-          String displayTimestamp = timestamp.length() ? timestamp : String(millis());
-          showResultOnOLED(displayLeaf, displayDisease, displaySolution);
-          gDisplayedTimestamp = displayTimestamp;
-        } else {
-          gPendingLeaf = leaf.length() ? leaf : "OK";
-          gPendingDisease = disease;
-          gPendingSolution = solution;
-          gPendingTimestamp = timestamp;
-          if (!gPendingTimestamp.length()) {
-            gPendingTimestamp = String(millis());
-          }
-          gWaitingForResult = true;
-          gResultDisplayed = false;
-          oledMsg("Processing...", "Waiting for Pi");
-        }
-      } else {
-        clearProcessingState();
-        digitalWrite(RED_LED_PIN, HIGH);
-        digitalWrite(GREEN_LED_PIN, LOW);
-        oledMsg("Upload failed", uerr, String(len) + " bytes saved");
-        gWaitingForResult = false;
-        gResultDisplayed = false;
-      }
-    } else {
-      clearProcessingState();
-      digitalWrite(RED_LED_PIN, HIGH);
-      digitalWrite(GREEN_LED_PIN, LOW);
-      oledMsg("Capture FAILED", err);
-      gWaitingForResult = false;
-      gResultDisplayed = false;
-    }
-    // wait for release to avoid repeats
-    while (digitalRead(PIN_BUTTON) == LOW) { delay(10); server.handleClient(); updateIndicators(); }
-  }
+  serviceButton();
 }
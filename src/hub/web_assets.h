@@ -0,0 +1,170 @@
+// Generated by tools/gen_web_assets.py from web/hub/ -- do not edit.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Plain const data on the ESP32 (flash is memory-mapped) and on the host
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+struct WebAsset {
+  const char* path;
+  const char* contentType;
+  const uint8_t* gz;      // gzip-compressed body
+  size_t gzLen;
+  size_t rawLen;
+  const char* version;    // content hash; the ETag is the quoted version
+  bool versioned;         // linked as path?v=version, cacheable forever
+};
+
+// index.html: 694 -> 375 bytes
+static const uint8_t INDEX_HTML_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x75, 0x52, 0xc1, 0x4e, 0xc3, 0x30,
+  0x0c, 0xbd, 0xf3, 0x15, 0x21, 0x27, 0x90, 0xd8, 0xaa, 0xad, 0x15, 0x1b, 0x52, 0x53, 0x0e, 0x83,
+  0x1b, 0x42, 0x48, 0x7c, 0x41, 0x9a, 0xb8, 0x6d, 0x58, 0xda, 0x44, 0x89, 0xdb, 0x69, 0x7f, 0x4f,
+  0xda, 0x14, 0xc6, 0x36, 0x71, 0xb2, 0xf3, 0xde, 0xb3, 0x1d, 0xe7, 0x25, 0xbf, 0x95, 0x46, 0xe0,
+  0xd1, 0x02, 0x69, 0xb0, 0xd5, 0xc5, 0x4d, 0x1e, 0x03, 0x21, 0x79, 0x03, 0x5c, 0x8e, 0x49, 0x48,
+  0x5b, 0x40, 0x4e, 0x44, 0xc3, 0x9d, 0x07, 0x64, 0xb4, 0xc7, 0x6a, 0xb1, 0xa5, 0x24, 0xf9, 0x4b,
+  0x76, 0xbc, 0x05, 0x46, 0x07, 0x05, 0x07, 0x6b, 0x1c, 0x52, 0x22, 0x4c, 0x87, 0xd0, 0x05, 0xf1,
+  0x41, 0x49, 0x6c, 0x98, 0x84, 0x41, 0x09, 0x58, 0x4c, 0x87, 0x07, 0xa2, 0x3a, 0x85, 0x8a, 0xeb,
+  0x85, 0x17, 0x5c, 0x03, 0x5b, 0x9d, 0x5a, 0xa1, 0x42, 0x0d, 0xc5, 0xeb, 0xe7, 0x47, 0xba, 0x26,
+  0xbb, 0xd0, 0xd1, 0x71, 0xf2, 0xc2, 0x7d, 0x53, 0x1a, 0xee, 0x64, 0x9e, 0x44, 0x36, 0x2a, 0xb5,
+  0xea, 0xf6, 0xc4, 0x81, 0x66, 0xd4, 0xe3, 0x51, 0x83, 0x6f, 0x00, 0xc2, 0xd4, 0xc6, 0x41, 0x35,
+  0x23, 0x4b, 0xe1, 0xfd, 0xf3, 0xc0, 0x9e, 0xd2, 0x74, 0x53, 0x65, 0xd5, 0x3a, 0x7d, 0x14, 0xd9,
+  0x3c, 0x27, 0x4f, 0x7e, 0x36, 0xcb, 0x4b, 0x23, 0x8f, 0x73, 0xc3, 0x66, 0xf5, 0xef, 0xdc, 0x40,
+  0x45, 0x4d, 0xd9, 0x23, 0x9a, 0x8e, 0x98, 0x4e, 0x68, 0x25, 0xf6, 0x8c, 0x0a, 0x6e, 0xb1, 0x77,
+  0x70, 0x77, 0x4f, 0x8b, 0x5d, 0x4c, 0xf3, 0x24, 0x6a, 0xce, 0x0b, 0x94, 0x64, 0x54, 0xab, 0x01,
+  0xe8, 0xa9, 0x14, 0x4d, 0x5d, 0x6b, 0x78, 0x0b, 0xe0, 0x58, 0x3d, 0x46, 0x62, 0x1d, 0x8c, 0xef,
+  0x77, 0xd1, 0xc2, 0x4e, 0xd5, 0xd6, 0x99, 0xda, 0x81, 0xf7, 0xb4, 0xc8, 0x13, 0x7b, 0xc6, 0x04,
+  0xb4, 0xd7, 0x78, 0x8d, 0xa3, 0xe3, 0x02, 0xae, 0x61, 0x8f, 0x1c, 0xcf, 0xba, 0x48, 0x35, 0x4c,
+  0x84, 0x98, 0xd6, 0x9e, 0xa8, 0x00, 0xcd, 0xa4, 0x6a, 0xeb, 0x89, 0x0c, 0x91, 0x12, 0xae, 0x83,
+  0x9d, 0xef, 0x86, 0xa8, 0x96, 0xd7, 0x40, 0x8e, 0xe3, 0x7b, 0x27, 0x17, 0x3a, 0x8f, 0x0e, 0x78,
+  0x3b, 0x4b, 0xff, 0x2e, 0x15, 0xac, 0x51, 0x52, 0x42, 0xf7, 0x5b, 0xe1, 0x85, 0x53, 0x16, 0x89,
+  0x77, 0x82, 0x51, 0x6e, 0xed, 0xf2, 0x6b, 0x34, 0x0b, 0xd2, 0x6c, 0x5b, 0x66, 0x62, 0xbb, 0x59,
+  0xaf, 0xc4, 0x78, 0x91, 0x28, 0x8a, 0x9e, 0x45, 0xab, 0x82, 0x19, 0xd3, 0xf7, 0xfc, 0x06, 0xbe,
+  0xa7, 0x77, 0x10, 0xb6, 0x02, 0x00, 0x00,
+};
+
+// app.js: 4435 -> 1497 bytes
+static const uint8_t APP_JS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x57, 0x4b, 0x8f, 0xdb, 0x36,
+  0x10, 0xbe, 0xfb, 0x57, 0x70, 0x73, 0x91, 0x84, 0x6c, 0xe4, 0xf6, 0xba, 0x5e, 0x6f, 0x90, 0x06,
+  0x01, 0x9a, 0x22, 0x4d, 0xd3, 0x6c, 0x72, 0x36, 0x68, 0x69, 0x6c, 0x33, 0x2b, 0x91, 0x2a, 0x49,
+  0xd9, 0x75, 0x02, 0xff, 0xf7, 0xce, 0x90, 0x94, 0x44, 0xf9, 0xd5, 0x04, 0xc8, 0x61, 0xb1, 0x16,
+  0x87, 0xf3, 0x0d, 0xf9, 0xcd, 0x93, 0xab, 0x56, 0x16, 0x56, 0x28, 0xc9, 0xcc, 0x46, 0xed, 0xde,
+  0xd6, 0x7c, 0x0d, 0xe9, 0x36, 0xfb, 0x36, 0x61, 0x4c, 0xac, 0x18, 0xfe, 0x62, 0xa5, 0x2a, 0xda,
+  0x1a, 0xa4, 0xcd, 0xd7, 0x60, 0xdf, 0x54, 0x40, 0x3f, 0x7f, 0xdb, 0xbf, 0x2d, 0xd3, 0x44, 0xd4,
+  0xeb, 0x24, 0xcb, 0x8d, 0x2e, 0xd8, 0x9c, 0x25, 0x53, 0x41, 0x9a, 0xf9, 0x97, 0x66, 0xfd, 0x72,
+  0x3b, 0x4f, 0xd8, 0x73, 0xb6, 0x9d, 0x4d, 0x0e, 0x93, 0x55, 0x8f, 0x0d, 0xf6, 0x83, 0x56, 0x6b,
+  0x0d, 0xc6, 0xa4, 0x16, 0xfe, 0xb5, 0xce, 0xc0, 0x45, 0xe4, 0x26, 0x6c, 0x45, 0x78, 0xda, 0xfc,
+  0x5a, 0x49, 0x8b, 0x32, 0x34, 0x43, 0x5f, 0x84, 0xcb, 0xcd, 0x5e, 0x16, 0x6c, 0x40, 0xb7, 0xdc,
+  0x9a, 0xd4, 0x61, 0x5a, 0xbd, 0x67, 0xf4, 0x9f, 0xb1, 0x42, 0x49, 0x63, 0x99, 0x41, 0x2d, 0xbe,
+  0xe3, 0xc2, 0xb2, 0xd4, 0xff, 0x5b, 0x81, 0x2d, 0x36, 0x69, 0x32, 0x75, 0x3a, 0x49, 0x96, 0xe5,
+  0x5f, 0x8c, 0x92, 0x69, 0x36, 0x73, 0x3a, 0x03, 0x05, 0x26, 0x77, 0x17, 0x5a, 0x80, 0xe5, 0xeb,
+  0x20, 0x24, 0x3e, 0x4c, 0x5e, 0xf0, 0x1a, 0x34, 0x37, 0xec, 0x81, 0xfd, 0x9a, 0x05, 0x4b, 0x57,
+  0x6e, 0x52, 0x89, 0x2d, 0xe0, 0x2d, 0x36, 0xa2, 0x2c, 0x41, 0xd2, 0x05, 0x74, 0x0b, 0x33, 0xc6,
+  0xa6, 0x53, 0xd6, 0x68, 0xd8, 0x0a, 0xd8, 0x31, 0x09, 0x50, 0x1a, 0xa6, 0x24, 0x30, 0x8f, 0x1c,
+  0x10, 0x83, 0x99, 0xee, 0x60, 0x87, 0xc9, 0x55, 0x33, 0xe1, 0x32, 0x63, 0xb6, 0x02, 0x52, 0xf2,
+  0x11, 0x4c, 0x5b, 0x59, 0x44, 0x2c, 0x36, 0x70, 0xc7, 0xc8, 0x37, 0x74, 0x0b, 0xfc, 0x58, 0x6c,
+  0x84, 0x35, 0xf8, 0x99, 0x30, 0xfa, 0x71, 0x3b, 0x12, 0xd5, 0xc2, 0x18, 0xf0, 0xc2, 0xf0, 0x33,
+  0x45, 0x71, 0x80, 0xec, 0x36, 0xa1, 0x19, 0x2d, 0xfc, 0xae, 0x69, 0xac, 0x5c, 0xf0, 0x86, 0x17,
+  0xc2, 0xee, 0x9d, 0x7a, 0xd8, 0x94, 0x39, 0xfc, 0x1e, 0x40, 0x02, 0xd7, 0x8b, 0xb2, 0x6d, 0x16,
+  0xe6, 0x49, 0x34, 0xde, 0x0e, 0x2d, 0xbd, 0xc0, 0xa5, 0x4a, 0x14, 0xdc, 0x22, 0x2a, 0x49, 0x1a,
+  0x28, 0x13, 0x62, 0xe0, 0x80, 0xc7, 0x27, 0xbf, 0x41, 0xf6, 0xed, 0x80, 0xfe, 0x47, 0xfe, 0x1e,
+  0x61, 0x8b, 0x04, 0x55, 0x1d, 0x51, 0x77, 0x8c, 0xb3, 0x86, 0x4b, 0xa8, 0x18, 0xe0, 0x11, 0x6e,
+  0xd9, 0x4a, 0xab, 0x9a, 0x4d, 0x83, 0x30, 0x8a, 0x43, 0x74, 0xf0, 0x6b, 0xb7, 0x98, 0x16, 0x2e,
+  0x5e, 0x2a, 0xb0, 0xac, 0x41, 0xc7, 0x5c, 0xa4, 0x16, 0x21, 0xe8, 0x6a, 0x45, 0x2e, 0x4a, 0xe7,
+  0x0b, 0x8a, 0x82, 0x9b, 0xa6, 0x73, 0xfd, 0x48, 0xb5, 0xd0, 0x80, 0x07, 0x0f, 0xda, 0x69, 0x52,
+  0x8a, 0x6d, 0x12, 0xdc, 0xd7, 0xa0, 0x36, 0x65, 0x49, 0x04, 0xd6, 0x09, 0x8a, 0x8a, 0x1b, 0xf3,
+  0x1e, 0x8f, 0xd4, 0xc9, 0x7b, 0x0d, 0x29, 0x41, 0xff, 0xfe, 0xe9, 0xcf, 0x77, 0x24, 0xb8, 0x5f,
+  0x3e, 0xf8, 0x63, 0xb3, 0x4e, 0x9f, 0x28, 0xbb, 0x9f, 0x2e, 0x1f, 0xd8, 0xfd, 0xb2, 0xb5, 0x56,
+  0x49, 0x94, 0x37, 0xb6, 0xd5, 0x80, 0x6b, 0xfe, 0xfb, 0xbe, 0x79, 0xb8, 0x9f, 0xe2, 0x1f, 0xa6,
+  0x29, 0xe3, 0x95, 0x9d, 0x3f, 0x7b, 0xaf, 0x98, 0x8b, 0x69, 0xb6, 0x07, 0xfb, 0x8c, 0x4d, 0x1f,
+  0x7a, 0x4b, 0xff, 0xb4, 0xa0, 0xf7, 0x8f, 0x50, 0x41, 0x61, 0x95, 0x4e, 0x13, 0xaf, 0x8f, 0xd1,
+  0xa4, 0x64, 0x81, 0xbe, 0x78, 0x42, 0xfb, 0x69, 0xc6, 0xe6, 0x0f, 0x7d, 0xea, 0x14, 0xde, 0xd2,
+  0x4b, 0x3c, 0xed, 0x7c, 0xc4, 0x0d, 0xbb, 0x4a, 0x23, 0x79, 0x02, 0x51, 0x39, 0x3a, 0x55, 0x96,
+  0xaf, 0x37, 0xa2, 0x2a, 0xd3, 0xc6, 0xa9, 0x1d, 0x02, 0xad, 0x45, 0xee, 0xb2, 0xed, 0xf4, 0x44,
+  0xe3, 0x4a, 0x13, 0xa0, 0xa6, 0x31, 0x13, 0x51, 0xe1, 0xf1, 0x28, 0x84, 0x7b, 0x82, 0xd3, 0x9c,
+  0x14, 0x94, 0x22, 0xa7, 0xd4, 0x01, 0x82, 0xb8, 0x0d, 0xd4, 0xae, 0x34, 0xe2, 0xfb, 0x88, 0xf4,
+  0x3f, 0x3b, 0x01, 0x46, 0xa6, 0xe2, 0x98, 0xab, 0x3e, 0x88, 0x13, 0xe6, 0xbf, 0xa1, 0xf4, 0x72,
+  0x3c, 0xfd, 0x8a, 0x8b, 0x0a, 0x79, 0x31, 0x6e, 0xb7, 0x15, 0x35, 0xa8, 0xd6, 0x9a, 0xcc, 0x23,
+  0xa1, 0x08, 0x43, 0x39, 0xe8, 0xa6, 0xbd, 0x95, 0x97, 0x28, 0x4b, 0x8b, 0xd8, 0xb3, 0xf8, 0xb1,
+  0xa8, 0x43, 0xe2, 0xa1, 0xe9, 0x4a, 0xc8, 0xa7, 0x20, 0xa1, 0x9f, 0x83, 0x28, 0x4b, 0x18, 0x26,
+  0x73, 0x92, 0x0d, 0x90, 0x15, 0xf0, 0xd5, 0x42, 0x52, 0x24, 0x11, 0xea, 0x8b, 0x4e, 0xab, 0x5f,
+  0x45, 0xbd, 0xbb, 0xb0, 0x58, 0x0a, 0x03, 0xdc, 0x40, 0x87, 0xe0, 0xa8, 0xd7, 0x7a, 0xa4, 0x47,
+  0xdf, 0x4e, 0x7c, 0xa6, 0xde, 0xf6, 0xc5, 0xe9, 0x87, 0x2a, 0x6e, 0x1f, 0x02, 0x47, 0x35, 0xb7,
+  0x2b, 0xa9, 0xf9, 0x4a, 0xe9, 0x37, 0x98, 0xbc, 0xe9, 0x90, 0xa4, 0xd9, 0x85, 0xdc, 0xb7, 0x14,
+  0xc6, 0x58, 0x00, 0x24, 0xd6, 0x2f, 0x9f, 0xe9, 0xfe, 0x63, 0xe6, 0xb2, 0x1f, 0xf7, 0x6b, 0x57,
+  0x97, 0xec, 0x06, 0xd8, 0xa6, 0x5d, 0x32, 0xf2, 0x05, 0xb3, 0x8c, 0x4b, 0xf4, 0x15, 0x06, 0x35,
+  0x60, 0xad, 0x30, 0x04, 0x41, 0x58, 0x18, 0x8b, 0x48, 0x33, 0x15, 0xc2, 0xb2, 0xd5, 0xdc, 0x5d,
+  0xaf, 0x36, 0xf9, 0x84, 0xea, 0x02, 0xee, 0xd1, 0x16, 0x28, 0x71, 0x7f, 0x99, 0x45, 0x25, 0x44,
+  0x20, 0x02, 0x1d, 0x86, 0x69, 0xc0, 0x34, 0x90, 0xfd, 0x36, 0xe7, 0xcb, 0xe7, 0x2e, 0x16, 0x20,
+  0xb7, 0x48, 0x64, 0x10, 0x64, 0x63, 0x8f, 0xcd, 0x58, 0xd4, 0x17, 0x2b, 0x61, 0x30, 0x12, 0x3d,
+  0x91, 0x9e, 0x3e, 0x20, 0xfe, 0x24, 0x36, 0x86, 0x37, 0x74, 0xa3, 0x47, 0xd5, 0x6a, 0xb4, 0x96,
+  0x84, 0xfb, 0xf9, 0x7a, 0x02, 0x26, 0xe7, 0x65, 0xe9, 0xe4, 0xef, 0x9c, 0x3e, 0x68, 0x4a, 0x30,
+  0x97, 0x94, 0x18, 0xc6, 0x69, 0xed, 0xb2, 0x35, 0xf6, 0x09, 0x15, 0x97, 0x3f, 0x1e, 0xff, 0x7a,
+  0x9f, 0x37, 0x5c, 0x1b, 0x48, 0xeb, 0xbc, 0xe4, 0x96, 0x47, 0x6d, 0x0d, 0x72, 0xc7, 0x07, 0x9b,
+  0xcf, 0x31, 0xc1, 0xdc, 0xb1, 0x93, 0xa1, 0xb9, 0x0d, 0x34, 0xe0, 0xb5, 0x66, 0xdd, 0x62, 0xd4,
+  0xd0, 0x13, 0x5f, 0x7a, 0x84, 0x5c, 0xe7, 0x79, 0xde, 0x95, 0xbc, 0x03, 0x83, 0x0a, 0x23, 0xec,
+  0x04, 0xbd, 0xc4, 0x56, 0x17, 0x83, 0xf7, 0x1d, 0x17, 0xf2, 0xa8, 0xd7, 0x9e, 0x35, 0x80, 0x67,
+  0x20, 0x76, 0x21, 0x5f, 0xee, 0x6d, 0xc8, 0x50, 0xff, 0x4b, 0xc8, 0x20, 0xe8, 0xb3, 0xe3, 0xe8,
+  0x14, 0xdf, 0xae, 0x80, 0x86, 0xdc, 0xbc, 0x0b, 0x10, 0x18, 0xf7, 0x51, 0xcf, 0x3d, 0x5c, 0x26,
+  0xdc, 0xa7, 0xff, 0x4f, 0xe4, 0x7b, 0x74, 0xb8, 0xcf, 0x0e, 0x1d, 0x29, 0x3d, 0x7f, 0x65, 0xd7,
+  0x6d, 0x43, 0x20, 0x06, 0xdc, 0xab, 0x74, 0x9f, 0xc1, 0x46, 0x36, 0x4f, 0x79, 0xbb, 0x65, 0x94,
+  0xb2, 0x64, 0x16, 0x93, 0x11, 0x03, 0x9c, 0x26, 0x87, 0xef, 0xb6, 0x85, 0xd5, 0xb6, 0xc5, 0x22,
+  0x77, 0x64, 0xed, 0x6f, 0xb7, 0x7a, 0xdb, 0xdd, 0x83, 0x52, 0x79, 0xe1, 0x77, 0x3a, 0x9b, 0x78,
+  0x06, 0xb7, 0xf6, 0xdd, 0x56, 0xba, 0xb1, 0xe0, 0xc8, 0xcc, 0x23, 0xe0, 0x80, 0xb5, 0x04, 0x3c,
+  0x36, 0xb8, 0x51, 0x05, 0x6d, 0x61, 0x3b, 0xc6, 0x3a, 0x43, 0x56, 0x70, 0xf8, 0xf0, 0xee, 0xea,
+  0x87, 0x8a, 0x0b, 0xd6, 0xce, 0xf0, 0x74, 0x1a, 0x1f, 0xa7, 0xba, 0xf1, 0x21, 0x6f, 0x46, 0x3e,
+  0xf5, 0x93, 0xe9, 0xec, 0x7a, 0x28, 0x05, 0x9e, 0x7f, 0x38, 0x94, 0x2e, 0x76, 0xdb, 0x00, 0x78,
+  0x7e, 0x20, 0x84, 0x73, 0x3d, 0x01, 0xfa, 0x9e, 0xf0, 0xbc, 0x6f, 0x02, 0x78, 0x23, 0x55, 0xb5,
+  0x54, 0xa7, 0x42, 0xa5, 0x8e, 0xc9, 0xf9, 0x78, 0x29, 0x36, 0x46, 0x55, 0x33, 0x2c, 0x7c, 0x07,
+  0x07, 0xbe, 0x09, 0xfc, 0x38, 0x07, 0x47, 0x29, 0xdd, 0x77, 0x52, 0xa0, 0xb6, 0x32, 0xdc, 0x0f,
+  0xdd, 0xa3, 0x9e, 0xb0, 0x44, 0x9f, 0x16, 0x8f, 0xae, 0x8d, 0xbb, 0xea, 0xdc, 0x5e, 0x70, 0x79,
+  0x76, 0x7a, 0xcf, 0xd1, 0x84, 0x7e, 0xe5, 0x62, 0x56, 0xf3, 0x02, 0x7e, 0xa2, 0x6f, 0x3d, 0xde,
+  0xf1, 0x20, 0xd3, 0x57, 0xb3, 0xee, 0xee, 0xee, 0x6b, 0x41, 0xd3, 0x51, 0xf7, 0x0e, 0xb8, 0x63,
+  0xc5, 0x11, 0x3d, 0xf1, 0xa0, 0xf1, 0xf9, 0xd5, 0xc7, 0x4f, 0x41, 0xd2, 0xa2, 0x03, 0x63, 0x91,
+  0x04, 0xbb, 0x53, 0xfa, 0x29, 0x9a, 0xdf, 0x21, 0x0f, 0x6b, 0xf1, 0xb6, 0x0f, 0x22, 0xe8, 0x37,
+  0x62, 0x58, 0xc6, 0x21, 0x40, 0xf2, 0x6a, 0x6f, 0x84, 0x19, 0x84, 0x6e, 0xe5, 0x2b, 0xc4, 0xb3,
+  0xcc, 0x88, 0x43, 0x25, 0x55, 0xe3, 0x5e, 0x4b, 0x2e, 0x72, 0xfc, 0x73, 0xc9, 0x8d, 0x00, 0xe8,
+  0x2b, 0xec, 0xdf, 0xd8, 0xc7, 0xf7, 0x76, 0x43, 0x35, 0xca, 0xbd, 0x4c, 0x4a, 0xb6, 0xc3, 0x59,
+  0x12, 0x18, 0xc6, 0x2f, 0xb2, 0x2a, 0x71, 0xd4, 0x83, 0x32, 0x7e, 0x7a, 0x5a, 0xb5, 0x5e, 0x57,
+  0xf0, 0x0e, 0x1f, 0x62, 0x71, 0x9b, 0xa5, 0xa9, 0x78, 0x7e, 0xed, 0x41, 0x85, 0xc5, 0xa3, 0xf6,
+  0x5d, 0xc4, 0x2b, 0x2c, 0xad, 0xbc, 0xa6, 0xe0, 0x1f, 0x7a, 0xdd, 0x03, 0x01, 0xd1, 0xc3, 0x9b,
+  0xaf, 0xeb, 0x74, 0xb4, 0xd2, 0x0d, 0xb0, 0x01, 0xdc, 0xfb, 0x19, 0x71, 0x8f, 0x5d, 0xf9, 0x68,
+  0x55, 0xd3, 0xbd, 0x0f, 0xc3, 0xeb, 0x27, 0xea, 0x62, 0x84, 0xa4, 0xa1, 0x56, 0x5b, 0x78, 0x65,
+  0xf1, 0x65, 0x85, 0xd3, 0x3a, 0xce, 0x07, 0x08, 0x8d, 0xd6, 0x3d, 0x53, 0x95, 0x32, 0x61, 0xf6,
+  0x09, 0x7c, 0x50, 0x02, 0xf7, 0xb3, 0x90, 0x41, 0xf0, 0x20, 0x1d, 0xde, 0x9b, 0x67, 0x0e, 0x41,
+  0x84, 0x8d, 0x0f, 0x31, 0xf1, 0xb6, 0xfb, 0xb7, 0xec, 0xcd, 0xf0, 0x75, 0x76, 0x46, 0x74, 0x11,
+  0x78, 0x7e, 0x46, 0xd4, 0xfd, 0x8c, 0x78, 0xf4, 0xa6, 0x48, 0xa2, 0x82, 0x7a, 0xa3, 0x31, 0x65,
+  0xb3, 0xff, 0xef, 0xd9, 0x1e, 0x48, 0xbb, 0x0b, 0xa4, 0x71, 0x45, 0xbe, 0xd9, 0x09, 0x59, 0xaa,
+  0x5d, 0x1e, 0x4d, 0x52, 0xe3, 0x8a, 0x3c, 0x0c, 0x96, 0xf8, 0x42, 0x02, 0x6d, 0x8f, 0xf1, 0x89,
+  0x52, 0x1a, 0x39, 0x09, 0xec, 0x1c, 0x56, 0x37, 0xbd, 0xcd, 0x26, 0xbe, 0x79, 0x74, 0xd0, 0xff,
+  0x01, 0x14, 0x6d, 0x5d, 0xeb, 0x53, 0x11, 0x00, 0x00,
+};
+
+// style.css: 294 -> 212 bytes
+static const uint8_t STYLE_CSS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x3d, 0x8f, 0xdd, 0x4e, 0xc3, 0x30,
+  0x0c, 0x46, 0xef, 0xf7, 0x14, 0x96, 0xd0, 0xee, 0x08, 0xea, 0x40, 0xe2, 0x22, 0x79, 0x1a, 0xb7,
+  0x4e, 0x53, 0x8b, 0xfc, 0x54, 0x89, 0x0b, 0x2b, 0x68, 0xef, 0x3e, 0x77, 0x6b, 0xb9, 0x89, 0xe4,
+  0xd8, 0x3e, 0xc7, 0x5f, 0x5f, 0x68, 0x85, 0x3f, 0x18, 0x4b, 0x16, 0x33, 0x62, 0xe2, 0xb8, 0x5a,
+  0x68, 0x6b, 0x13, 0x9f, 0xcc, 0xc2, 0xaf, 0xd0, 0x30, 0x37, 0xd3, 0x7c, 0xe5, 0xd1, 0x41, 0xc2,
+  0x1a, 0x38, 0x5b, 0x78, 0xef, 0xe6, 0xab, 0x83, 0xdb, 0xa9, 0x5f, 0x44, 0x4a, 0xd6, 0xe5, 0x19,
+  0x89, 0x38, 0x07, 0x0b, 0x17, 0xed, 0xc0, 0xe5, 0x73, 0x6b, 0x3f, 0x80, 0x8d, 0x7f, 0xbd, 0xdd,
+  0x3f, 0x6e, 0x27, 0x4e, 0x41, 0x87, 0x13, 0x5e, 0xcd, 0x0f, 0x93, 0x4c, 0xdb, 0x78, 0x77, 0x76,
+  0x30, 0x79, 0x0e, 0x93, 0x58, 0xc0, 0x45, 0x8a, 0x03, 0xe2, 0x36, 0x47, 0xd4, 0x23, 0xfa, 0x58,
+  0x86, 0xaf, 0x43, 0x6a, 0xa4, 0xcc, 0x07, 0xa8, 0x2f, 0x95, 0x7c, 0xd5, 0x4a, 0x5d, 0xad, 0x44,
+  0x26, 0x78, 0x21, 0xa2, 0x4d, 0xf0, 0x36, 0x60, 0x52, 0xc3, 0x3f, 0x82, 0x73, 0xe4, 0xec, 0xcd,
+  0x4e, 0xfa, 0xf6, 0x55, 0x78, 0xc0, 0x68, 0x30, 0x72, 0xd0, 0x18, 0x8a, 0x74, 0xb0, 0x5f, 0xf2,
+  0xf1, 0xcc, 0x74, 0x24, 0xec, 0x1e, 0xaa, 0xe7, 0xd3, 0x6d, 0xe4, 0x3b, 0x0d, 0xa8, 0x02, 0xbc,
+  0x26, 0x01, 0x00, 0x00,
+};
+
+static const WebAsset WEB_ASSETS[] = {
+  {"/", "text/html", INDEX_HTML_GZ, sizeof(INDEX_HTML_GZ), 694, "f23374f8ae7b", false},
+  {"/app.js", "application/javascript", APP_JS_GZ, sizeof(APP_JS_GZ), 4435, "e348b4c8721c", true},
+  {"/style.css", "text/css", STYLE_CSS_GZ, sizeof(STYLE_CSS_GZ), 294, "9337f4f236c4", true},
+};
+static const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);
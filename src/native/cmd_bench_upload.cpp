@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "batch_frame.h"
+#include "commands.h"
+#include "host_http.h"
+#include "host_util.h"
+#include "standin_server.h"
+
+struct UploadRun {
+  double seconds = 0;
+  size_t frames = 0;
+  size_t errors = 0;
+  std::vector<double> requestMs;
+};
+
+// Each client uploads its share of the frames back-to-back, like a hub
+// draining a queue after a burst.
+static UploadRun runUploads(const std::string& host, uint16_t port,
+                            const std::vector<ImageFile>& images, size_t frames,
+                            size_t batch, size_t clients) {
+  UploadRun run;
+  std::mutex m;
+  uint64_t t0 = nowUs();
+  std::vector<std::thread> threads;
+  for (size_t c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c]() {
+      size_t share = frames / clients + (c < frames % clients ? 1 : 0);
+      size_t next = c;
+      std::vector<double> lat;
+      size_t sent = 0, errors = 0;
+      BatchWriter writer(SIZE_MAX, (uint16_t)batch, 0xFFFFFFFFu);
+      while (sent < share) {
+        size_t n = batch <= 1 ? 1 : std::min(batch, share - sent);
+        HttpMessage resp;
+        std::string err;
+        std::string body;
+        HeaderList headers;
+        if (batch <= 1) {
+          const ImageFile& img = images[next++ % images.size()];
+          body.assign((const char*)img.data.data(), img.data.size());
+          headers.push_back(std::make_pair("Content-Type", "image/jpeg"));
+        } else {
+          writer.clear();
+          for (size_t i = 0; i < n; ++i) {
+            const ImageFile& img = images[next++ % images.size()];
+            writer.add(img.data.data(), img.data.size(), 0);
+          }
+          body.assign((const char*)writer.body().data(), writer.body().size());
+          headers.push_back(std::make_pair("Content-Type", BATCH_CONTENT_TYPE));
+        }
+        uint64_t s = nowUs();
+        bool ok = httpRequest(host, port, "POST", batch <= 1 ? "/upload" : "/upload_batch",
+                              headers, body, resp, err, 30000);
+        lat.push_back((double)(nowUs() - s) / 1000.0);
+        if (!ok || resp.status != 200) errors += n;
+        sent += n;
+      }
+      std::lock_guard<std::mutex> g(m);
+      run.requestMs.insert(run.requestMs.end(), lat.begin(), lat.end());
+      run.frames += sent;
+      run.errors += errors;
+    });
+  }
+  for (auto& t : threads) t.join();
+  run.seconds = (double)(nowUs() - t0) / 1e6;
+  return run;
+}
+
+static void report(const char* label, const UploadRun& r) {
+  LatencySummary s = summarize(r.requestMs);
+  std::printf("%-10s frames=%-5zu errors=%-4zu %8.2f frames/s   request p50=%7.1f ms p99=%7.1f ms\n",
+              label, r.frames, r.errors, r.seconds > 0 ? (double)(r.frames - r.errors) / r.seconds : 0.0,
+              s.p50Ms, s.p99Ms);
+}
+
+// bench-upload [--images=upload] [--frames=64] [--batch=4] [--clients=1]
+//              [--server=host:port]   (default: in-process stand-in server)
+//              [--request-ms=..] [--lock-ms=..] [--infer-ms=..]
+int cmdBenchUpload(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  std::vector<ImageFile> images = loadImages(args.str("images", "upload"));
+  if (images.empty()) {
+    std::fprintf(stderr, "bench-upload: no JPEGs found in '%s'\n", args.str("images", "upload").c_str());
+    return 1;
+  }
+  size_t frames = (size_t)args.num("frames", 64);
+  size_t batch = (size_t)args.num("batch", 4);
+  size_t clients = (size_t)args.num("clients", 1);
+  if (batch < 2) batch = 2;
+  if (batch > BATCH_MAX_FRAMES) batch = BATCH_MAX_FRAMES;
+  if (clients < 1) clients = 1;
+
+  std::string host = "127.0.0.1";
+  uint16_t port = 0;
+  std::unique_ptr<StandInServer> standIn;
+  if (args.has("server")) {
+    if (!splitHostPort(args.str("server"), host, port)) {
+      std::fprintf(stderr, "bench-upload: bad --server\n");
+      return 1;
+    }
+  } else {
+    StandInConfig cfg = standInConfigFromArgs(args);
+    standIn.reset(new StandInServer(cfg));
+    if (!standIn->start(0)) {
+      std::fprintf(stderr, "bench-upload: cannot start stand-in server\n");
+      return 1;
+    }
+    port = standIn->port();
+    std::printf("stand-in server: request=%.1f ms lock=%.1f ms infer=%.1f ms/frame\n",
+                cfg.requestMs, cfg.lockMs, cfg.inferMs);
+  }
+  std::printf("%zu images, %zu frames, batch=%zu, clients=%zu -> %s:%u\n", images.size(), frames,
+              batch, clients, host.c_str(), (unsigned)port);
+
+  UploadRun single = runUploads(host, port, images, frames, 1, clients);
+  report("single", single);
+  UploadRun batched = runUploads(host, port, images, frames, batch, clients);
+  char label[32];
+  std::snprintf(label, sizeof(label), "batch=%zu", batch);
+  report(label, batched);
+  if (single.seconds > 0 && batched.seconds > 0) {
+    std::printf("speed-up: %.2fx\n", single.seconds / batched.seconds);
+  }
+  if (standIn) standIn->stop();
+  return single.errors || batched.errors ? 1 : 0;
+}
@@ -0,0 +1,436 @@
+#include <stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_frame.h"
+#include "commands.h"
+#include "host_http.h"
+#include "host_util.h"
+#include "leaf_stats.h"
+#include "pi_protocol.h"
+#include "standin_server.h"
+
+// N hubs against one Pi server, in real time over loopback. Each hub is a
+// thread running the hub loop's upload and poll steps: captures at random
+// (Poisson) or fixed intervals, uploads with the hub's headers (capture
+// IDs, X-Leaf-Stats) one frame per request or through a BatchWriter, and
+// polls /result every pollMs, deciding what it would show with the hub's
+// own piResultIsNew(). Like the hub, it blocks while a request is out, so
+// a slow server delays the next capture. WiFi is modelled per request as
+// half the round trip each way, jitter, and the body's time on the uplink.
+struct FleetConfig {
+  size_t hubs = 20;
+  double rate = 0.2;          // captures per second per hub
+  bool periodic = false;      // fixed interval (random phase) instead of Poisson
+  double seconds = 30;
+  double pollMs = 5000;       // the hub's /result poll
+  double rttMs = 20;
+  double jitterMs = 5;        // added to the outbound half, uniform 0..jitter
+  double uplinkKbps = 0;      // 0: no serialisation delay
+  size_t batch = 1;           // > 1: HUB_BATCH_UPLOAD with this many frames
+  uint32_t batchAgeMs = 3000; // HUB_BATCH_MAX_AGE_MS
+  size_t batchBytes = 96 * 1024;  // HUB_BATCH_MAX_BYTES
+  int timeoutMs = 10000;      // the hub's http.setTimeout()
+  double resultWaitMs = 30000;  // give up on a result after this long
+  bool stats = true;          // send X-Leaf-Stats (HUB_LEAF_STATS)
+};
+
+struct FleetTotals {
+  size_t uploads = 0, uploadErrors = 0;
+  size_t frames = 0, framesFailed = 0;
+  size_t polls = 0, pollErrors = 0;
+  size_t inReply = 0;     // result came back with the upload
+  size_t viaPoll = 0;     // result found by a /result poll
+  size_t lost = 0;        // waited resultWaitMs without a match
+  size_t superseded = 0;  // a newer upload replaced the wait
+  size_t pending = 0;     // still waiting when the run ended
+  size_t foreign = 0;     // results of other hubs the hub would have shown
+  std::map<std::string, size_t> errors;  // by kind
+  std::vector<double> uploadMs, pollMs, resultMs;
+};
+
+// A frame captured and not yet answered
+struct FleetFrame {
+  uint64_t capturedUs;
+  uint32_t captureId;
+  size_t image;
+};
+
+// Value of the first (or last) "key": "string" in a JSON body, "" when
+// absent or not a string. Enough for the flat objects the Pi returns.
+static std::string jsonStringField(const std::string& body, const char* key, bool last = false) {
+  std::string quoted = std::string("\"") + key + "\"";
+  size_t p = last ? body.rfind(quoted) : body.find(quoted);
+  if (p == std::string::npos) return std::string();
+  p += quoted.size();
+  while (p < body.size() && (body[p] == ' ' || body[p] == ':')) ++p;
+  if (p >= body.size() || body[p] != '"') return std::string();
+  std::string out;
+  for (++p; p < body.size() && body[p] != '"'; ++p) {
+    if (body[p] == '\\' && p + 1 < body.size()) ++p;
+    out += body[p];
+  }
+  return out;
+}
+
+class FleetHub {
+ public:
+  FleetHub(const FleetConfig& cfg, size_t index, const std::vector<ImageFile>& images,
+           const std::vector<LeafStats>& stats, const std::string& host, uint16_t port)
+      : cfg_(cfg), index_(index), images_(images), stats_(stats), host_(host), port_(port),
+        rng_((uint32_t)(0x5eed + index * 7919)),
+        batch_(cfg.batchBytes, (uint16_t)std::max<size_t>(cfg.batch, 1), cfg.batchAgeMs) {
+    bootTag_ = (uint16_t)rng_();
+  }
+
+  void run(uint64_t t0);
+  const FleetTotals& totals() const { return t_; }
+
+ private:
+  double nextGapUs();
+  uint32_t msSince(uint64_t us) const { return (uint32_t)((us - t0_) / 1000); }
+  bool request(const char* method, const char* target, const HeaderList& headers, const std::string& body,
+               HttpMessage& resp, double& ms);
+  void countError(const std::string& kind) { ++t_.errors[kind]; }
+  void capture(uint64_t capturedUs);
+  void upload(const std::vector<FleetFrame>& frames, const std::string& body);
+  void flushBatch();
+  void poll();
+  void wait(const FleetFrame& f, const std::string& timestamp);
+  void show(const std::string& timestamp);
+
+  const FleetConfig& cfg_;
+  size_t index_;
+  const std::vector<ImageFile>& images_;
+  const std::vector<LeafStats>& stats_;
+  std::string host_;
+  uint16_t port_;
+  std::mt19937 rng_;
+  uint64_t t0_ = 0;
+  uint16_t bootTag_ = 0;
+  uint16_t seq_ = 0;
+  size_t next_ = 0;  // image cycle
+
+  BatchWriter batch_;
+  std::vector<FleetFrame> queued_;  // frames in batch_, in body order
+
+  // The hub's result wait (gWaitingForResult and friends)
+  bool waiting_ = false;
+  bool displayed_ = false;
+  FleetFrame pending_ = {0, 0, 0};
+  std::string pendingTimestamp_;
+  std::string displayedTimestamp_;
+
+  FleetTotals t_;
+};
+
+double FleetHub::nextGapUs() {
+  if (cfg_.periodic) return 1e6 / cfg_.rate;
+  std::exponential_distribution<double> gap(cfg_.rate);
+  return gap(rng_) * 1e6;
+}
+
+// One request as a hub on WiFi sees it: the outbound half of the round trip
+// plus jitter and the body's uplink time before the server has it, the
+// return half after. ms covers all of it.
+bool FleetHub::request(const char* method, const char* target, const HeaderList& headers,
+                       const std::string& body, HttpMessage& resp, double& ms) {
+  uint64_t start = nowUs();
+  std::uniform_real_distribution<double> jitter(0, cfg_.jitterMs);
+  double outMs = cfg_.rttMs / 2 + jitter(rng_);
+  if (cfg_.uplinkKbps > 0) outMs += (double)body.size() * 8 / cfg_.uplinkKbps;
+  sleepUs((uint64_t)(outMs * 1000));
+  std::string err;
+  bool ok = httpRequest(host_, port_, method, target, headers, body, resp, err, cfg_.timeoutMs);
+  if (ok) sleepUs((uint64_t)(cfg_.rttMs / 2 * 1000));
+  ms = (double)(nowUs() - start) / 1000.0;
+  if (!ok) countError(err);
+  return ok;
+}
+
+void FleetHub::capture(uint64_t capturedUs) {
+  FleetFrame f = {capturedUs, (uint32_t)bootTag_ << 16 | ++seq_, (index_ + next_++) % images_.size()};
+  const ImageFile& img = images_[f.image];
+  if (cfg_.batch <= 1) {
+    upload(std::vector<FleetFrame>(1, f), std::string((const char*)img.data.data(), img.data.size()));
+    return;
+  }
+  if (!batch_.add(img.data.data(), img.data.size(), msSince(nowUs()))) {
+    // Batch is full: send what is queued, then start a new one with this frame
+    flushBatch();
+    batch_.add(img.data.data(), img.data.size(), msSince(nowUs()));
+  }
+  queued_.push_back(f);
+  if (batch_.shouldFlush(msSince(nowUs()))) flushBatch();
+}
+
+void FleetHub::flushBatch() {
+  if (batch_.empty()) return;
+  std::string body((const char*)batch_.body().data(), batch_.bytes());
+  batch_.clear();
+  std::vector<FleetFrame> frames;
+  frames.swap(queued_);
+  upload(frames, body);
+}
+
+void FleetHub::upload(const std::vector<FleetFrame>& frames, const std::string& body) {
+  bool batched = cfg_.batch > 1;
+  std::vector<PiFrameMeta> meta(frames.size());
+  for (size_t i = 0; i < frames.size(); ++i) {
+    meta[i].captureId = frames[i].captureId;
+    if (cfg_.stats) meta[i].stats = &stats_[frames[i].image];
+  }
+  HeaderList headers;
+  headers.push_back(std::make_pair("Content-Type", std::string(batched ? BATCH_CONTENT_TYPE : "image/jpeg")));
+  piUploadHeaders(meta.data(), meta.size(), headers);
+
+  HttpMessage resp;
+  double ms = 0;
+  bool ok = request("POST", batched ? "/upload_batch" : "/upload", headers, body, resp, ms);
+  ++t_.uploads;
+  t_.frames += frames.size();
+  t_.uploadMs.push_back(ms);
+  if (ok && resp.status != 200) {
+    countError("HTTP " + std::to_string(resp.status));
+    ok = false;
+  }
+  if (!ok) {
+    ++t_.uploadErrors;
+    t_.framesFailed += frames.size();
+    return;
+  }
+
+  // The hub shows the result in the reply when there is one (the newest
+  // frame's for a batch, the others go to its cache) and polls otherwise
+  std::string leaf = jsonStringField(resp.body, "leaf_name", batched);
+  std::string timestamp = jsonStringField(resp.body, "timestamp", batched);
+  if (!leaf.empty()) {
+    uint64_t now = nowUs();
+    for (const FleetFrame& f : frames) t_.resultMs.push_back((double)(now - f.capturedUs) / 1000.0);
+    t_.inReply += frames.size();
+    if (waiting_) ++t_.superseded;
+    waiting_ = false;
+    show(timestamp);
+    return;
+  }
+  wait(frames.back(), timestamp);
+}
+
+void FleetHub::wait(const FleetFrame& f, const std::string& timestamp) {
+  if (waiting_) ++t_.superseded;
+  waiting_ = true;
+  displayed_ = false;
+  pending_ = f;
+  pendingTimestamp_ = timestamp.empty() ? std::to_string(msSince(nowUs())) : timestamp;
+}
+
+void FleetHub::show(const std::string& timestamp) {
+  displayed_ = true;
+  displayedTimestamp_ = timestamp.empty() ? std::to_string(msSince(nowUs())) : timestamp;
+}
+
+void FleetHub::poll() {
+  HttpMessage resp;
+  double ms = 0;
+  bool ok = request("GET", "/result", HeaderList(), std::string(), resp, ms);
+  ++t_.polls;
+  t_.pollMs.push_back(ms);
+  // 404 is the Pi's "no analysis yet", not a failure
+  if (ok && resp.status != 200 && resp.status != 404) {
+    countError("HTTP " + std::to_string(resp.status) + " (poll)");
+    ok = false;
+  }
+  if (!ok) {
+    ++t_.pollErrors;
+    return;
+  }
+  if (resp.status != 200 || !jsonStringField(resp.body, "error").empty()) return;
+
+  std::string captureId = jsonStringField(resp.body, "capture_id");
+  std::string timestamp = jsonStringField(resp.body, "timestamp");
+  PiResultWait w;
+  w.waiting = waiting_;
+  w.pendingCaptureId = pending_.captureId;
+  w.pendingTimestamp = pendingTimestamp_.c_str();
+  w.displayed = displayed_;
+  w.displayedTimestamp = displayedTimestamp_.c_str();
+  if (!piResultIsNew(w, captureId.c_str(), timestamp.c_str())) return;
+
+  char own[9];
+  formatCaptureId(pending_.captureId, own);
+  if (waiting_ && captureId == own) {
+    t_.resultMs.push_back((double)(nowUs() - pending_.capturedUs) / 1000.0);
+    ++t_.viaPoll;
+  } else {
+    ++t_.foreign;
+  }
+  waiting_ = false;
+  show(timestamp);
+}
+
+void FleetHub::run(uint64_t t0) {
+  t0_ = t0;
+  uint64_t end = t0 + (uint64_t)(cfg_.seconds * 1e6);
+  std::uniform_real_distribution<double> phase(0, 1);
+  uint64_t nextCapture = t0 + (uint64_t)(cfg_.periodic ? phase(rng_) * 1e6 / cfg_.rate : nextGapUs());
+  // Hubs booted at different times, so their polls are spread out
+  uint64_t pollUs = (uint64_t)(cfg_.pollMs * 1000);
+  uint64_t nextPoll = t0 + (uint64_t)(phase(rng_) * (double)pollUs);
+  for (;;) {
+    uint64_t now = nowUs();
+    if (now >= end) break;
+    if (now >= nextCapture) {
+      // Late captures keep their schedule, so a blocked hub shows up as latency
+      capture(nextCapture);
+      nextCapture += (uint64_t)nextGapUs();
+      continue;
+    }
+    if (!batch_.empty() && batch_.shouldFlush(msSince(now))) {
+      flushBatch();
+      continue;
+    }
+    if (now >= nextPoll) {
+      poll();
+      nextPoll = nowUs() + pollUs;
+      continue;
+    }
+    if (waiting_ && (double)(now - pending_.capturedUs) / 1000.0 > cfg_.resultWaitMs) {
+      ++t_.lost;
+      waiting_ = false;
+    }
+    uint64_t wake = std::min(std::min(nextCapture, nextPoll), end);
+    sleepUs(std::min<uint64_t>(wake - now, 5000));
+  }
+  t_.pending = (waiting_ ? 1 : 0) + queued_.size();
+}
+
+static void printLatency(const char* label, const std::vector<double>& samples) {
+  LatencySummary s = summarize(samples);
+  std::printf("  %-16s n=%-6zu p50=%8.1f p90=%8.1f p99=%8.1f max=%8.1f ms\n", label, s.count, s.p50Ms,
+              s.p90Ms, s.p99Ms, s.maxMs);
+}
+
+static double percentOf(size_t part, size_t whole) {
+  return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+// fleet-sim [--hubs=20] [--rate=0.2] [--periodic] [--seconds=30] [--images=upload]
+//           [--poll-ms=5000] [--rtt-ms=20] [--jitter-ms=5] [--uplink-kbps=0]
+//           [--batch=1] [--batch-age-ms=3000] [--timeout-ms=10000]
+//           [--result-wait-ms=30000] [--no-stats]
+//           [--server=host:port]   (default: in-process stand-in server)
+//           [--request-ms=..] [--lock-ms=..] [--infer-ms=..]
+int cmdFleetSim(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  FleetConfig cfg;
+  cfg.hubs = (size_t)std::max(1L, args.num("hubs", (long)cfg.hubs));
+  cfg.rate = args.real("rate", cfg.rate);
+  cfg.periodic = args.has("periodic");
+  cfg.seconds = args.real("seconds", cfg.seconds);
+  cfg.pollMs = args.real("poll-ms", cfg.pollMs);
+  cfg.rttMs = args.real("rtt-ms", cfg.rttMs);
+  cfg.jitterMs = args.real("jitter-ms", cfg.jitterMs);
+  cfg.uplinkKbps = args.real("uplink-kbps", cfg.uplinkKbps);
+  cfg.batch = (size_t)std::min(std::max(1L, args.num("batch", (long)cfg.batch)), (long)BATCH_MAX_FRAMES);
+  cfg.batchAgeMs = (uint32_t)args.num("batch-age-ms", cfg.batchAgeMs);
+  cfg.timeoutMs = (int)args.num("timeout-ms", cfg.timeoutMs);
+  cfg.resultWaitMs = args.real("result-wait-ms", cfg.resultWaitMs);
+  cfg.stats = !args.has("no-stats");
+  if (cfg.rate <= 0 || cfg.seconds <= 0 || cfg.pollMs <= 0) {
+    std::fprintf(stderr, "fleet-sim: --rate, --seconds and --poll-ms must be positive\n");
+    return 1;
+  }
+
+  std::vector<ImageFile> images = loadImages(args.str("images", "upload"));
+  if (images.empty()) {
+    std::fprintf(stderr, "fleet-sim: no JPEGs found in '%s'\n", args.str("images", "upload").c_str());
+    return 1;
+  }
+  // What the hub computes per capture from the DC image (HUB_LEAF_STATS)
+  std::vector<LeafStats> stats(images.size());
+  for (size_t i = 0; i < images.size(); ++i) {
+    jpegLeafStats(images[i].data.data(), images[i].data.size(), stats[i]);
+  }
+
+  std::string host = "127.0.0.1";
+  uint16_t port = 0;
+  std::unique_ptr<StandInServer> standIn;
+  if (args.has("server")) {
+    if (!splitHostPort(args.str("server"), host, port)) {
+      std::fprintf(stderr, "fleet-sim: bad --server\n");
+      return 1;
+    }
+  } else {
+    StandInConfig sc = standInConfigFromArgs(args);
+    standIn.reset(new StandInServer(sc));
+    if (!standIn->start(0)) {
+      std::fprintf(stderr, "fleet-sim: cannot start stand-in server\n");
+      return 1;
+    }
+    port = standIn->port();
+    std::printf("stand-in server: request=%.1f ms lock=%.1f ms infer=%.1f ms/frame\n", sc.requestMs,
+                sc.lockMs, sc.inferMs);
+  }
+  std::printf("%zu hubs x %.2g captures/s (%s) = %.2f/s offered, %zu images, %.0f s, batch=%zu, "
+              "poll %.0f ms, rtt %.0f+%.0f ms, uplink %s -> %s:%u\n",
+              cfg.hubs, cfg.rate, cfg.periodic ? "periodic" : "poisson", cfg.hubs * cfg.rate, images.size(),
+              cfg.seconds, cfg.batch, cfg.pollMs, cfg.rttMs, cfg.jitterMs,
+              cfg.uplinkKbps > 0 ? (std::to_string((long)cfg.uplinkKbps) + " kbit/s").c_str() : "unlimited",
+              host.c_str(), (unsigned)port);
+
+  std::vector<std::unique_ptr<FleetHub> > hubs;
+  for (size_t i = 0; i < cfg.hubs; ++i) hubs.emplace_back(new FleetHub(cfg, i, images, stats, host, port));
+  uint64_t t0 = nowUs();
+  std::vector<std::thread> threads;
+  for (auto& h : hubs) threads.emplace_back([&h, t0]() { h->run(t0); });
+  for (auto& t : threads) t.join();
+  double seconds = (double)(nowUs() - t0) / 1e6;
+
+  FleetTotals all;
+  for (auto& h : hubs) {
+    const FleetTotals& t = h->totals();
+    all.uploads += t.uploads;
+    all.uploadErrors += t.uploadErrors;
+    all.frames += t.frames;
+    all.framesFailed += t.framesFailed;
+    all.polls += t.polls;
+    all.pollErrors += t.pollErrors;
+    all.inReply += t.inReply;
+    all.viaPoll += t.viaPoll;
+    all.lost += t.lost;
+    all.superseded += t.superseded;
+    all.pending += t.pending;
+    all.foreign += t.foreign;
+    for (const auto& e : t.errors) all.errors[e.first] += e.second;
+    all.uploadMs.insert(all.uploadMs.end(), t.uploadMs.begin(), t.uploadMs.end());
+    all.pollMs.insert(all.pollMs.end(), t.pollMs.begin(), t.pollMs.end());
+    all.resultMs.insert(all.resultMs.end(), t.resultMs.begin(), t.resultMs.end());
+  }
+
+  std::printf("uploads  %zu requests, %zu frames, %.2f frames/s done, %zu failed requests (%.1f%%)\n",
+              all.uploads, all.frames, (double)(all.frames - all.framesFailed) / seconds, all.uploadErrors,
+              percentOf(all.uploadErrors, all.uploads));
+  std::printf("polls    %zu requests, %.2f/s, %zu failed (%.1f%%)\n", all.polls, (double)all.polls / seconds,
+              all.pollErrors, percentOf(all.pollErrors, all.polls));
+  std::printf("results  %zu in the reply, %zu via /result, %zu lost, %zu superseded, %zu pending at the end, "
+              "%zu shown from other hubs\n",
+              all.inReply, all.viaPoll, all.lost, all.superseded, all.pending, all.foreign);
+  std::printf("latency\n");
+  printLatency("upload request", all.uploadMs);
+  printLatency("/result poll", all.pollMs);
+  printLatency("capture->result", all.resultMs);
+  for (const auto& e : all.errors) std::printf("error    %-20s %zu\n", e.first.c_str(), e.second);
+  if (standIn) {
+    std::printf("server   %llu requests, %llu frames analysed\n", (unsigned long long)standIn->requests(),
+                (unsigned long long)standIn->framesAnalysed());
+    standIn->stop();
+  }
+  return all.uploadErrors ? 1 : 0;
+}
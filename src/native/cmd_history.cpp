@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "crc16.h"
+#include "history_store.h"
+#include "host_http.h"
+#include "host_util.h"
+#include "http_routes.h"
+#include "loopback_hub.h"
+
+struct HistoryRun {
+  const char* label;
+  size_t entries;      // frames added
+  size_t index;        // HistoryStore maxEntries
+  uint32_t bytes;      // storage size
+};
+
+static std::string resultText(uint32_t id) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "Leaf %u\nDisease %u\nSolution %u", (unsigned)id,
+                (unsigned)(id % 7), (unsigned)(id % 3));
+  return buf;
+}
+
+static void printSummary(const char* what, const std::vector<double>& samplesMs) {
+  LatencySummary s = summarize(samplesMs);
+  std::printf("  %-22s n=%-7zu mean=%8.2f p50=%8.2f p99=%8.2f max=%8.2f us\n", what, s.count,
+              s.meanMs * 1000.0, s.p50Ms * 1000.0, s.p99Ms * 1000.0, s.maxMs * 1000.0);
+}
+
+// Fills a store past its capacity, servicing it between captures as loop()
+// does, then checks what survived, what was evicted and the boot scan.
+static size_t runStore(const HistoryRun& run, const std::vector<SharedBytes>& frames,
+                       size_t lookups) {
+  std::printf("\n%s: %zu frames into %zu index slots, %.1f MB storage\n", run.label, run.entries,
+              run.index, run.bytes / 1048576.0);
+  MemoryHistoryStorage storage(run.bytes);
+  HistoryStore store(storage, run.index);
+  size_t largest = 0;
+  for (const SharedBytes& f : frames) largest = std::max(largest, f->size());
+  store.setReserve((uint32_t)largest);
+
+  std::vector<uint16_t> crcs;
+  for (const SharedBytes& f : frames) crcs.push_back(crc16(f->data(), f->size()));
+  std::vector<double> addMs, serviceMs, resultMs;
+  size_t errors = 0;
+  for (size_t i = 0; i < run.entries; ++i) {
+    size_t fi = i % frames.size();
+    uint64_t t0 = nowUs();
+    uint32_t id = store.add(frames[fi], crcs[fi], (uint32_t)i, (uint32_t)i * 1000, 400, 300);
+    addMs.push_back((double)(nowUs() - t0) / 1000.0);
+    if (id != i + 1) {
+      ++errors;
+      continue;
+    }
+    std::string text = resultText(id);
+    t0 = nowUs();
+    store.setResult(id, text.c_str(), 800, 1500);
+    resultMs.push_back((double)(nowUs() - t0) / 1000.0);
+    for (;;) {
+      t0 = nowUs();
+      bool busy = store.service();
+      if (!busy) break;
+      serviceMs.push_back((double)(nowUs() - t0) / 1000.0);
+    }
+  }
+
+  // Survivors: contiguous ids ending at the newest, every byte and result intact
+  uint32_t oldest = store.oldestId(), newest = store.newestId();
+  if (newest != run.entries || newest - oldest + 1 != store.count()) ++errors;
+  std::vector<uint8_t> buf(4096);
+  char text[HISTORY_RESULT_MAX + 1];
+  for (uint32_t id = oldest; id && id <= newest; ++id) {
+    const std::vector<uint8_t>& want = *frames[(id - 1) % frames.size()];
+    HistoryEntry e;
+    if (!store.get(id, e) || e.len != want.size() || (e.flags & HISTORY_WRITING)) {
+      ++errors;
+      continue;
+    }
+    for (size_t off = 0; off < e.len; off += buf.size()) {
+      size_t n = store.readFrame(id, off, buf.data(), buf.size());
+      if (n != std::min(buf.size(), e.len - off) || std::memcmp(buf.data(), want.data() + off, n)) {
+        ++errors;
+        break;
+      }
+    }
+    if (!store.result(id, text, sizeof(text)) || resultText(id) != text) ++errors;
+  }
+  // Evicted ids are gone, not stale
+  for (uint32_t id = 1; id < oldest; id += 1 + (oldest / 64)) {
+    HistoryEntry e;
+    if (store.get(id, e) || store.readFrame(id, 0, buf.data(), buf.size())) ++errors;
+  }
+
+  // Lookups over the whole id range, a quarter of them already evicted
+  std::mt19937 rng(7);
+  uint32_t lo = oldest > newest / 4 ? oldest - (newest - oldest + 1) / 4 : 1;
+  std::uniform_int_distribution<uint32_t> pick(lo, newest);
+  size_t hits = 0;
+  uint64_t t0 = nowUs();
+  for (size_t i = 0; i < lookups; ++i) {
+    HistoryEntry e;
+    hits += store.get(pick(rng), e) ? 1 : 0;
+  }
+  double lookupNs = lookups ? (double)(nowUs() - t0) * 1000.0 / (double)lookups : 0.0;
+
+  std::vector<double> pageMs;
+  HistoryEntry page[HISTORY_PAGE_MAX];
+  size_t listed = 0;
+  for (uint32_t before = 0;;) {
+    t0 = nowUs();
+    size_t n = store.list(before, page, HISTORY_PAGE_DEFAULT);
+    pageMs.push_back((double)(nowUs() - t0) / 1000.0);
+    listed += n;
+    if (!n || page[n - 1].id == oldest) break;
+    before = page[n - 1].id;
+  }
+  if (listed != store.count()) ++errors;
+
+  // Boot scan of the same storage rebuilds the same index
+  HistoryStore reopened(storage, run.index);
+  t0 = nowUs();
+  reopened.open();
+  double openMs = (double)(nowUs() - t0) / 1000.0;
+  if (reopened.count() != store.count() || reopened.newestId() != newest ||
+      reopened.oldestId() != oldest) {
+    ++errors;
+  }
+  if (newest && (!reopened.result(newest, text, sizeof(text)) || resultText(newest) != text)) {
+    ++errors;
+  }
+
+  HistoryStats st = store.stats();
+  std::printf("  kept %zu (ids %u..%u), evicted %u, rejected %u, sync erases %u, "
+              "%u block erases, %u writes onto unerased flash\n",
+              store.count(), (unsigned)oldest, (unsigned)newest, (unsigned)st.evicted,
+              (unsigned)st.rejected, (unsigned)st.syncErases, (unsigned)storage.erases(),
+              (unsigned)storage.badWrites());
+  printSummary("add", addMs);
+  printSummary("setResult", resultMs);
+  printSummary("service step", serviceMs);
+  printSummary("list page", pageMs);
+  std::printf("  lookup                 %.1f ns each (%zu hits / %zu)\n", lookupNs, hits, lookups);
+  std::printf("  open (boot scan)       %.2f ms\n", openMs);
+  errors += storage.badWrites();
+  std::printf("  %s\n", errors ? "FAILED" : "ok");
+  return errors;
+}
+
+static std::string jsonField(const std::string& json, const char* name) {
+  std::string key = std::string("\"") + name + "\":";
+  size_t k = json.find(key);
+  if (k == std::string::npos) return "";
+  k += key.size();
+  size_t e = json.find_first_of(",}", k);
+  return json.substr(k, e == std::string::npos ? std::string::npos : e - k);
+}
+
+// The endpoints over real sockets: page through /history and fetch frames
+static size_t runHttp(const std::vector<ImageFile>& images, size_t entries) {
+  LoopbackHubConfig cfg;
+  LoopbackHub hub(cfg, images);
+  if (!hub.start(0)) {
+    std::fprintf(stderr, "history-bench: cannot start loopback hub\n");
+    return 1;
+  }
+  for (size_t i = 0; i < entries; ++i) {
+    const ImageFile& f = images[i % images.size()];
+    SharedBytes frame = std::make_shared<const std::vector<uint8_t> >(f.data);
+    uint32_t id = hub.history().add(frame, crc16(f.data.data(), f.data.size()), (uint32_t)i,
+                                    (uint32_t)i * 1000, 400, 300);
+    if (id && i % 2 == 0) hub.history().setResult(id, resultText(id).c_str(), 800, 1500);
+    while (hub.history().service()) {
+    }
+  }
+  std::printf("\nHTTP against the loopback hub: %zu entries kept of %zu\n", hub.history().count(),
+              entries);
+
+  size_t errors = 0;
+  std::string err;
+  std::vector<double> pageMs, jsonMs, jpgMs;
+  size_t listed = 0;
+  std::string before;
+  for (;;) {
+    HttpMessage resp;
+    std::string target = "/history?limit=25" + (before.empty() ? "" : "&before=" + before);
+    uint64_t t0 = nowUs();
+    if (!httpRequest("127.0.0.1", hub.port(), "GET", target, HeaderList(), "", resp, err) ||
+        resp.status != 200) {
+      ++errors;
+      break;
+    }
+    pageMs.push_back((double)(nowUs() - t0) / 1000.0);
+    for (size_t k = 0; (k = resp.body.find("{\"id\":", k)) != std::string::npos; ++k) ++listed;
+    before = jsonField(resp.body, "next_before");
+    if (before.empty() || before == "0") break;
+  }
+  if (listed != hub.history().count()) ++errors;
+
+  uint32_t oldest = hub.history().oldestId(), newest = hub.history().newestId();
+  for (uint32_t id = oldest; id && id <= newest; ++id) {
+    const std::vector<uint8_t>& want = images[(id - 1) % images.size()].data;
+    HttpMessage resp;
+    uint64_t t0 = nowUs();
+    bool ok = httpRequest("127.0.0.1", hub.port(), "GET", "/history/" + std::to_string(id) + ".jpg",
+                          HeaderList(), "", resp, err);
+    jpgMs.push_back((double)(nowUs() - t0) / 1000.0);
+    if (!ok || resp.status != 200 || resp.body.size() != want.size() ||
+        std::memcmp(resp.body.data(), want.data(), want.size())) {
+      ++errors;
+    }
+    t0 = nowUs();
+    ok = httpRequest("127.0.0.1", hub.port(), "GET", "/history/" + std::to_string(id) + ".json",
+                     HeaderList(), "", resp, err);
+    jsonMs.push_back((double)(nowUs() - t0) / 1000.0);
+    bool hasResult = resp.body.find("\"result\":null") == std::string::npos;
+    if (!ok || resp.status != 200 || hasResult != (id % 2 == 1)) ++errors;
+  }
+
+  // Range, revalidation and an evicted id
+  HttpMessage resp;
+  std::string first = "/history/" + std::to_string(newest) + ".jpg";
+  HeaderList range;
+  range.push_back(std::make_pair("Range", "bytes=10-19"));
+  if (!httpRequest("127.0.0.1", hub.port(), "GET", first, range, "", resp, err) ||
+      resp.status != 206 || resp.body.size() != 10) {
+    ++errors;
+  }
+  httpRequest("127.0.0.1", hub.port(), "GET", first, HeaderList(), "", resp, err);
+  HeaderList inm;
+  inm.push_back(std::make_pair("If-None-Match", resp.header("etag")));
+  if (!httpRequest("127.0.0.1", hub.port(), "GET", first, inm, "", resp, err) || resp.status != 304) {
+    ++errors;
+  }
+  if (oldest > 1 &&
+      (!httpRequest("127.0.0.1", hub.port(), "GET", "/history/1.jpg", HeaderList(), "", resp, err) ||
+       resp.status != 404)) {
+    ++errors;
+  }
+  hub.stop();
+
+  printSummary("GET /history page", pageMs);
+  printSummary("GET /history/<id>.json", jsonMs);
+  printSummary("GET /history/<id>.jpg", jpgMs);
+  std::printf("  %zu entries listed\n  %s\n", listed, errors ? "FAILED" : "ok");
+  return errors;
+}
+
+// history-bench [--images=upload] [--entries=5000] [--lookups=200000]
+//               [--index=4096] [--small-bytes=3000] [--http-entries=300]
+int cmdHistoryBench(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  size_t entries = (size_t)args.num("entries", 5000);
+  size_t lookups = (size_t)args.num("lookups", 200000);
+  std::vector<ImageFile> images = loadImages(args.str("images", "upload"));
+  if (images.empty()) {
+    std::printf("no JPEGs in '%s', using synthetic 40 KB frames\n",
+                args.str("images", "upload").c_str());
+    for (uint32_t i = 0; i < 8; ++i) images.push_back(syntheticFrame(36000 + i * 1500, i));
+  }
+  std::vector<SharedBytes> frames;
+  for (const ImageFile& f : images) {
+    frames.push_back(std::make_shared<const std::vector<uint8_t> >(f.data));
+  }
+  size_t small = (size_t)args.num("small-bytes", 3000);
+  std::vector<SharedBytes> smallFrames;
+  for (uint32_t i = 0; i < 8; ++i) {
+    smallFrames.push_back(
+        std::make_shared<const std::vector<uint8_t> >(syntheticFrame(small + i * 64, 100 + i).data));
+  }
+
+  size_t errors = 0;
+  // The hub as built: the flash partition fills long before the index does
+  HistoryRun hub = { "hub partition (storage-bound)", entries, 128, 0x270000 };
+  errors += runStore(hub, frames, lookups);
+  // A large index of small frames: eviction by index slots
+  size_t index = (size_t)args.num("index", 4096);
+  uint32_t perRecord = (uint32_t)((HISTORY_RECORD_HEAD + small + 8 * 64 + 4095) / 4096 * 4096);
+  HistoryRun large = { "large index (index-bound)", std::max(entries, index * 2), index,
+                       (uint32_t)(index + index / 4 + 4) * perRecord };
+  errors += runStore(large, smallFrames, lookups);
+  errors += runHttp(images, (size_t)args.num("http-entries", 300));
+  return errors ? 1 : 0;
+}
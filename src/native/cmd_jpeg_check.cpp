@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "crc16.h"
+#include "host_util.h"
+#include "jpeg_dc.h"
+#include "jpeg_scan.h"
+
+static std::string baseName(const std::string& p) {
+  size_t slash = p.rfind('/');
+  return slash == std::string::npos ? p : p.substr(slash + 1);
+}
+
+// Best of repeat runs of fn over the image, in microseconds
+template <typename Fn>
+static double bestUs(long repeat, Fn fn) {
+  double best = 0;
+  for (long i = 0; i < repeat; ++i) {
+    uint64_t t0 = nowUs();
+    fn();
+    double us = (double)(nowUs() - t0);
+    if (i == 0 || us < best) best = us;
+  }
+  return best;
+}
+
+// Fed in link-sized chunks, as the hub does while the frame arrives
+static bool scanInChunks(const std::vector<uint8_t>& jpg, size_t chunk, JpegScanner& s) {
+  s.reset();
+  for (size_t off = 0; off < jpg.size(); off += chunk) {
+    size_t n = jpg.size() - off < chunk ? jpg.size() - off : chunk;
+    if (!s.feed(jpg.data() + off, n)) return false;
+  }
+  return s.finish();
+}
+
+// jpeg-check [--images=upload] [--repeat=50] [--chunk=256]
+// Header facts and scan cost per image next to the CRC the hub computes
+// anyway and a DC-only decode, then how many damaged copies (cut short at
+// every 1/16, a header byte or marker flipped, EOI missing) are caught.
+int cmdJpegCheck(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  std::string dir = args.str("images", "upload");
+  std::vector<ImageFile> images = loadImages(dir);
+  if (images.empty()) {
+    std::fprintf(stderr, "jpeg-check: no JPEGs found in '%s'\n", dir.c_str());
+    return 1;
+  }
+  long repeat = args.num("repeat", 50);
+  if (repeat < 1) repeat = 1;
+  size_t chunk = (size_t)args.num("chunk", 256);
+  if (chunk < 1) chunk = 1;
+
+  std::printf("%-32s %9s %7s %3s %5s %8s %8s %8s %8s\n", "image", "size", "bytes", "q", "ok",
+              "scan", "crc16", "dc", "scan MB/s");
+  size_t damaged = 0, caught = 0, invalid = 0;
+  std::vector<std::string> missed;
+  for (const ImageFile& img : images) {
+    const std::vector<uint8_t>& jpg = img.data;
+    JpegScanner s;
+    bool ok = scanInChunks(jpg, chunk, s);
+    JpegInfo info = s.info();
+    double scanUs = bestUs(repeat, [&]() { scanInChunks(jpg, chunk, s); });
+    volatile uint16_t sink = 0;
+    double crcUs = bestUs(repeat, [&]() { sink = crc16(jpg.data(), jpg.size()); });
+    DcImage dc;
+    std::string err;
+    double dcUs = bestUs(repeat, [&]() { decodeJpegDc(jpg.data(), jpg.size(), dc, err, true); });
+    (void)sink;
+    char dim[16];
+    std::snprintf(dim, sizeof(dim), "%ux%u", (unsigned)info.width, (unsigned)info.height);
+    std::printf("%-32s %9s %7zu %3u %5s %6.0fus %6.0fus %6.0fus %8.0f\n", baseName(img.path).c_str(),
+                dim, jpg.size(), (unsigned)info.quality, ok ? "yes" : s.error(), scanUs, crcUs, dcUs,
+                scanUs > 0 ? jpg.size() / scanUs : 0);
+    if (!ok) {
+      ++invalid;
+      continue;
+    }
+
+    std::vector<std::vector<uint8_t> > bad;
+    for (int k = 1; k < 16; ++k) bad.push_back(std::vector<uint8_t>(jpg.begin(), jpg.begin() + jpg.size() * k / 16));
+    bad.push_back(std::vector<uint8_t>(jpg.begin(), jpg.end() - 2));  // no EOI
+    for (size_t at : {(size_t)0, (size_t)1, (size_t)2, (size_t)4}) {
+      bad.push_back(jpg);
+      bad.back()[at] ^= 0x5A;  // SOI, first marker, its length
+    }
+    for (const std::vector<uint8_t>& b : bad) {
+      JpegScanner t;
+      ++damaged;
+      if (!scanInChunks(b, chunk, t)) {
+        ++caught;
+      } else {
+        missed.push_back(baseName(img.path));
+      }
+    }
+  }
+  std::printf("\n%zu of %zu damaged copies rejected", caught, damaged);
+  if (invalid) std::printf(", %zu input(s) invalid to begin with", invalid);
+  std::printf("\n");
+  for (const std::string& m : missed) std::printf("  missed a copy of %s\n", m.c_str());
+  return caught == damaged ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "host_util.h"
+#include "jpeg_dc.h"
+#include "leaf_stats.h"
+
+static std::string baseName(const std::string& p) {
+  size_t slash = p.rfind('/');
+  return slash == std::string::npos ? p : p.substr(slash + 1);
+}
+
+// leaf-stats [--images=upload] [--repeat=20]
+// The hub's quick verdict for each image, with the DC decode time (best of
+// --repeat runs). Compare the columns with the Pi's "metrics" for the same
+// file: they are what its heuristic computes from the fully decoded image.
+int cmdLeafStats(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  std::string dir = args.str("images", "upload");
+  std::vector<ImageFile> images = loadImages(dir);
+  if (images.empty()) {
+    std::fprintf(stderr, "leaf-stats: no JPEGs found in '%s'\n", dir.c_str());
+    return 1;
+  }
+  long repeat = args.num("repeat", 20);
+  if (repeat < 1) repeat = 1;
+
+  std::printf("%-36s %9s %8s %6s %6s %6s %6s %6s %6s  %s\n", "image", "size", "decode", "bright",
+              "red", "green", "blue", "chloro", "dry", "verdict");
+  int failed = 0;
+  for (const ImageFile& img : images) {
+    std::string name = baseName(img.path);
+    DcImage dc;
+    std::string err;
+    double bestUs = 0;
+    bool ok = true;
+    for (long i = 0; i < repeat && ok; ++i) {
+      uint64_t t0 = nowUs();
+      ok = decodeJpegDc(img.data.data(), img.data.size(), dc, err);
+      double us = (double)(nowUs() - t0);
+      if (i == 0 || us < bestUs) bestUs = us;
+    }
+    LeafStats s;
+    if (!ok || !leafStatsFromDc(dc, s)) {
+      std::printf("%-36s skipped: %s\n", name.c_str(), err.c_str());
+      ++failed;
+      continue;
+    }
+    LeafVerdict v = leafVerdict(s);
+    char dim[16];
+    std::snprintf(dim, sizeof(dim), "%ux%u", (unsigned)dc.width, (unsigned)dc.height);
+    std::printf("%-36s %9s %6.0fus %6.3f %6.3f %6.3f %6.3f %6.3f %6.3f  %s / %s\n", name.c_str(), dim,
+                bestUs, s.brightness, s.red, s.green, s.blue, s.chlorophyll, s.dryness, v.leaf,
+                v.disease);
+  }
+  return failed == (int)images.size() ? 1 : 0;
+}
@@ -0,0 +1,207 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "commands.h"
+#include "host_http.h"
+#include "host_util.h"
+#include "loopback_hub.h"
+
+struct LoadRun {
+  double seconds = 0;
+  size_t requests = 0;
+  size_t errors = 0;
+  std::vector<double> allMs;
+  std::vector<double> statsMs;   // small JSON: shows head-of-line blocking best
+  std::vector<double> imageMs;
+};
+
+static std::string extractImageEtag(const std::string& json) {
+  size_t k = json.find("\"image_etag\":\"");
+  if (k == std::string::npos) return "";
+  k += 14;
+  size_t e = json.find('"', k);
+  return e == std::string::npos ? "" : json.substr(k, e - k);
+}
+
+// A viewer on a slow phone link: downloads /image.jpg at bytesPerSec with a
+// small receive buffer, so the server sees real backpressure.
+static bool slowDownload(const std::string& host, uint16_t port, size_t bytesPerSec) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  int rcv = 4096;
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcv, sizeof(rcv));
+  timeval tv = {10, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  ::inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(), &addr.sin_addr);
+  if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    ::close(fd);
+    return false;
+  }
+  const char req[] = "GET /image.jpg HTTP/1.1\r\nHost: hub\r\nConnection: close\r\n\r\n";
+  ::send(fd, req, sizeof(req) - 1, MSG_NOSIGNAL);
+  char buf[1024];
+  bool ok = false;
+  for (;;) {
+    ssize_t r = ::recv(fd, buf, sizeof(buf), 0);
+    if (r < 0) break;
+    if (r == 0) {
+      ok = true;
+      break;
+    }
+    sleepUs((uint64_t)r * 1000000ULL / bytesPerSec);
+  }
+  ::close(fd);
+  return ok;
+}
+
+static LoadRun runLoad(const std::string& host, uint16_t port, size_t clients, size_t slow,
+                       size_t slowBps, double seconds, double captureEveryMs, double thinkMs) {
+  LoadRun run;
+  std::mutex m;
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  uint64_t t0 = nowUs();
+
+  auto timed = [&](const std::string& target, const HeaderList& headers, HttpMessage& resp,
+                   std::vector<double>* bucket, std::vector<double>& all, size_t& errors) {
+    std::string err;
+    uint64_t s = nowUs();
+    bool ok = httpRequest(host, port, "GET", target, headers, "", resp, err, 15000);
+    double ms = (double)(nowUs() - s) / 1000.0;
+    all.push_back(ms);
+    if (bucket) bucket->push_back(ms);
+    if (!ok || (resp.status != 200 && resp.status != 304)) ++errors;
+    return ok;
+  };
+
+  // Dashboard viewers: poll /stats, fetch the frame it names, reload the page
+  // now and then. Start times are spread over one think time, as real
+  // viewers are.
+  for (size_t c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c]() {
+      std::vector<double> all, stats, image;
+      size_t errors = 0;
+      std::string pageEtag;
+      sleepUs((uint64_t)(thinkMs * 1000.0 * (double)c / (double)clients));
+      for (size_t i = 0; !stop; ++i) {
+        HttpMessage resp;
+        if (i % 5 == 0) {
+          HeaderList h;
+          if (!pageEtag.empty()) h.push_back(std::make_pair("If-None-Match", pageEtag));
+          if (timed("/", h, resp, nullptr, all, errors) && resp.status == 200) {
+            pageEtag = resp.header("etag");
+          }
+        }
+        if (!timed("/stats", HeaderList(), resp, &stats, all, errors)) continue;
+        std::string v = extractImageEtag(resp.body);
+        timed(v.empty() ? "/image.jpg" : "/image.jpg?v=" + v, HeaderList(), resp, &image, all, errors);
+        sleepUs((uint64_t)(thinkMs * 1000.0));
+      }
+      std::lock_guard<std::mutex> g(m);
+      run.requests += all.size();
+      run.errors += errors;
+      run.allMs.insert(run.allMs.end(), all.begin(), all.end());
+      run.statsMs.insert(run.statsMs.end(), stats.begin(), stats.end());
+      run.imageMs.insert(run.imageMs.end(), image.begin(), image.end());
+    });
+  }
+  for (size_t c = 0; c < slow; ++c) {
+    threads.emplace_back([&]() {
+      while (!stop) slowDownload(host, port, slowBps);
+    });
+  }
+  if (captureEveryMs > 0) {
+    threads.emplace_back([&]() {
+      while (!stop) {
+        HttpMessage resp;
+        std::string err;
+        httpRequest(host, port, "GET", "/capture", HeaderList(), "", resp, err, 30000);
+        sleepUs((uint64_t)(captureEveryMs * 1000.0));
+      }
+    });
+  }
+
+  sleepUs((uint64_t)(seconds * 1e6));
+  stop = true;
+  for (auto& t : threads) t.join();
+  run.seconds = (double)(nowUs() - t0) / 1e6;
+  return run;
+}
+
+static void report(const char* label, const LoadRun& r) {
+  LatencySummary all = summarize(r.allMs);
+  LatencySummary stats = summarize(r.statsMs);
+  LatencySummary image = summarize(r.imageMs);
+  std::printf("%-10s %6.1f req/s errors=%-3zu all p50=%6.1f p99=%7.1f max=%7.1f ms | "
+              "/stats p50=%6.1f p99=%7.1f | /image.jpg p50=%6.1f p99=%7.1f\n",
+              label, r.seconds > 0 ? (double)r.requests / r.seconds : 0.0, r.errors, all.p50Ms,
+              all.p99Ms, all.maxMs, stats.p50Ms, stats.p99Ms, image.p50Ms, image.p99Ms);
+}
+
+// loadtest [--images=upload] [--clients=16] [--think-ms=250] [--seconds=5] [--slots=4]
+//          [--slow=2] [--slow-kbps=256] [--capture-every-ms=1000] [--capture-ms=300]
+//          [--server=host:port]   (default: loopback build of the hub web layer,
+//                                  run once with 1 slot and once with --slots)
+int cmdLoadtest(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  size_t clients = (size_t)args.num("clients", 16);
+  size_t slow = (size_t)args.num("slow", 2);
+  size_t slowBps = (size_t)args.num("slow-kbps", 256) * 1024 / 8;
+  double thinkMs = args.real("think-ms", 250);
+  double seconds = args.real("seconds", 5);
+  double captureEveryMs = args.real("capture-every-ms", 1000);
+  if (slowBps == 0) slowBps = 1;
+
+  if (args.has("server")) {
+    std::string host;
+    uint16_t port;
+    if (!splitHostPort(args.str("server"), host, port)) {
+      std::fprintf(stderr, "loadtest: bad --server\n");
+      return 1;
+    }
+    LoadRun r = runLoad(host, port, clients, slow, slowBps, seconds, captureEveryMs, thinkMs);
+    report(args.str("server").c_str(), r);
+    return r.errors ? 1 : 0;
+  }
+
+  std::vector<ImageFile> images = loadImages(args.str("images", "upload"));
+  if (images.empty()) {
+    std::fprintf(stderr, "loadtest: no JPEGs found in '%s'\n", args.str("images", "upload").c_str());
+    return 1;
+  }
+  std::printf("%zu dashboard clients, %zu slow viewers at %zu kbit/s, capture every %.0f ms, %.0f s per run\n",
+              clients, slow, slowBps * 8 / 1024, captureEveryMs, seconds);
+
+  size_t errors = 0;
+  size_t slotRuns[2] = {1, (size_t)args.num("slots", 4)};
+  for (size_t slots : slotRuns) {
+    LoopbackHubConfig cfg;
+    cfg.maxClients = slots;
+    cfg.captureMs = args.real("capture-ms", cfg.captureMs);
+    LoopbackHub hub(cfg, images);
+    if (!hub.start(0)) {
+      std::fprintf(stderr, "loadtest: cannot start loopback hub\n");
+      return 1;
+    }
+    LoadRun r = runLoad("127.0.0.1", hub.port(), clients, slow, slowBps, seconds, captureEveryMs, thinkMs);
+    hub.stop();
+    char label[32];
+    std::snprintf(label, sizeof(label), "slots=%zu", slots);
+    report(label, r);
+    errors += r.errors;
+  }
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "camera_scheduler.h"
+#include "commands.h"
+#include "crc16.h"
+#include "host_util.h"
+#include "uart_frame.h"
+
+// Simulated bench in virtual time (1 ms steps): N cameras on point-to-point
+// UARTs or one RS-485 bus, driven by the hub's CaptureScheduler, with the
+// frames they send framed byte for byte and parsed by UartFrameReader, and
+// one WiFi uplink that uploads queued frames one at a time.
+struct MulticamConfig {
+  bool bus = false;
+  uint32_t baud = 921600;
+  double camMs = 300;       // trigger to frame ready in the camera
+  double camJitterMs = 40;
+  size_t frameBytes = 40 * 1024;
+  double uplinkMbps = 8;    // effective WiFi throughput
+  double uploadOverheadMs = 60;  // connection, headers and the Pi's reply
+  size_t queueDepth = 2;    // HUB_CAM_QUEUE
+  double errorRate = 0;     // camera error frames
+  uint32_t turnaroundMs = 1;  // RS-485 direction change
+  double seconds = 60;
+};
+
+struct MulticamResult {
+  size_t cameras = 0;
+  size_t frames = 0;  // uploaded
+  double fps = 0;
+  double minCamFps = 0, maxCamFps = 0;
+  double fairness = 0;   // Jain's index over per-camera frames
+  double linkBusy = 0;   // mean over links
+  double uplinkBusy = 0;
+  double meanLatencyMs = 0;  // trigger to upload done
+  uint32_t failures = 0, timeouts = 0, stale = 0;
+};
+
+struct SimCamera {
+  uint8_t link = 0;
+  bool triggered = false;
+  bool granted = false;
+  uint32_t captureId = 0;
+  uint32_t triggerMs = 0;
+  uint32_t readyMs = 0;     // exposure done
+  bool sending = false;
+  bool error = false;       // this one answers with an error frame
+  uint32_t sendStartMs = 0;
+  uint32_t sendEndMs = 0;
+  std::vector<uint8_t> payload;
+  uint16_t crc = 0;
+};
+
+// Wire bytes of one camera frame: 'T' on a point-to-point link, 'A' on a
+// bus. Errors are an 'E' frame, or an 'A' frame without payload on a bus.
+static std::vector<uint8_t> wireFrame(bool bus, bool error, uint8_t address, uint32_t captureId,
+                                      uint16_t camMs, const std::vector<uint8_t>& payload, uint16_t crc) {
+  uint8_t type = bus ? FRAME_TYPE_ADDRESSED : error ? FRAME_TYPE_ERROR : FRAME_TYPE_TRACED;
+  uint32_t len = error ? 0 : (uint32_t)payload.size();
+  uint8_t head[FRAME_HEADER_MAX];
+  size_t n = encodeFrameHeader(type, len, error ? 0 : crc, captureId, camMs, address, head);
+  std::vector<uint8_t> w(head, head + n);
+  if (!error) w.insert(w.end(), payload.begin(), payload.end());
+  return w;
+}
+
+static MulticamResult simulate(size_t n, const MulticamConfig& cfg, uint32_t seed) {
+  CaptureScheduler sched(n, cfg.queueDepth, 8000);
+  sched.setCaptureIdBase(0x5a5a0000u);
+  size_t linkCount = cfg.bus ? 1 : n;
+  for (size_t i = 0; i < n; ++i) sched.setLink((uint8_t)i, cfg.bus ? 0 : (uint8_t)i, cfg.bus);
+
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> jitter(0.0, cfg.camJitterMs);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<SimCamera> cams(n);
+  for (size_t i = 0; i < n; ++i) {
+    cams[i].link = cfg.bus ? 0 : (uint8_t)i;
+    cams[i].payload.resize(cfg.frameBytes);
+    for (uint8_t& b : cams[i].payload) b = (uint8_t)rng();
+    cams[i].crc = crc16(cams[i].payload.data(), cams[i].payload.size());
+  }
+  std::vector<std::unique_ptr<UartFrameReader> > readers;
+  for (size_t l = 0; l < linkCount; ++l) readers.emplace_back(new UartFrameReader(cfg.frameBytes + 16));
+  std::vector<uint32_t> linkBusyMs(linkCount, 0);
+  const uint32_t xferMs = (uint32_t)std::ceil((cfg.frameBytes + 19) * 10.0 * 1000.0 / cfg.baud);
+
+  bool uplinkBusy = false;
+  uint32_t uplinkDoneMs = 0;
+  uint32_t uplinkBusyMs = 0;
+  QueuedFrame uploading;
+  std::vector<size_t> uploadedPerCam(n, 0);
+  double latencySum = 0;
+  size_t frames = 0;
+
+  const uint32_t endMs = (uint32_t)(cfg.seconds * 1000.0);
+  for (uint32_t now = 0; now < endMs; ++now) {
+    // Keep every camera asking for the next capture
+    for (size_t i = 0; i < n; ++i) {
+      if (sched.stats((uint8_t)i).pending == 0) sched.request((uint8_t)i);
+    }
+    CameraAction a;
+    while (sched.next(now, a)) {
+      SimCamera& c = cams[a.cam];
+      if (a.kind == CameraAction::TRIGGER) {
+        c.triggered = true;
+        c.granted = !cfg.bus;  // a point-to-point camera sends when ready
+        c.sending = false;
+        c.captureId = a.captureId;
+        c.triggerMs = now;
+        c.readyMs = now + (uint32_t)std::max(50.0, cfg.camMs + jitter(rng));
+      } else if (a.kind == CameraAction::GRANT && c.triggered) {
+        c.granted = true;
+      }
+    }
+    // Cameras: start sending once exposed and allowed, deliver at the end
+    for (size_t i = 0; i < n; ++i) {
+      SimCamera& c = cams[i];
+      if (c.triggered && c.granted && !c.sending && now >= c.readyMs) {
+        c.sending = true;
+        c.error = unit(rng) < cfg.errorRate;
+        c.sendStartMs = now + (cfg.bus ? cfg.turnaroundMs : 0);
+        c.sendEndMs = c.sendStartMs + (c.error ? 1 : xferMs);
+      }
+      if (c.sending && now >= c.sendEndMs) {
+        c.sending = false;
+        c.triggered = false;
+        linkBusyMs[c.link] += c.sendEndMs - c.sendStartMs;
+        uint16_t camMs = (uint16_t)std::min<uint32_t>(0xFFFF, c.readyMs - c.triggerMs);
+        std::vector<uint8_t> wire =
+            wireFrame(cfg.bus, c.error, (uint8_t)(i + 1), c.captureId, camMs, c.payload, c.crc);
+        UartFrameReader& r = *readers[c.link];
+        size_t off = 0;
+        while (off < wire.size()) {
+          size_t used = 0;
+          UartFrameReader::Event ev = r.feed(wire.data() + off, wire.size() - off, used);
+          off += used;
+          if (ev == UartFrameReader::NONE) break;
+          // An error answer carries no payload
+          uint8_t cam = cfg.bus ? sched.cameraAt(c.link, r.address()) : sched.cameraOn(c.link);
+          std::shared_ptr<std::vector<uint8_t> > jpg = ev == UartFrameReader::FRAME ? r.take() : nullptr;
+          if (jpg) {
+            sched.onFrame(cam, r.captureId(), jpg, r.crc(), r.camMs(), now);
+          } else {
+            sched.onFailure(cam, now);
+          }
+        }
+      }
+    }
+    // Uplink: one upload at a time, as the hub's loop() does them
+    if (uplinkBusy && now >= uplinkDoneMs) {
+      uplinkBusy = false;
+      sched.uploaded(uploading.cam, true);
+      ++uploadedPerCam[uploading.cam];
+      ++frames;
+      latencySum += (double)(now - (uploading.readyMs - uploading.linkMs));
+    }
+    if (!uplinkBusy && sched.takeUpload(uploading)) {
+      double ms = cfg.uploadOverheadMs + uploading.jpg->size() * 8.0 / (cfg.uplinkMbps * 1000.0);
+      uplinkBusy = true;
+      uplinkDoneMs = now + (uint32_t)std::ceil(ms);
+      uplinkBusyMs += (uint32_t)std::ceil(ms);
+    }
+  }
+
+  MulticamResult res;
+  res.cameras = n;
+  res.frames = frames;
+  res.fps = frames / cfg.seconds;
+  double sum = 0, sumSq = 0;
+  res.minCamFps = 1e9;
+  for (size_t i = 0; i < n; ++i) {
+    double f = uploadedPerCam[i] / cfg.seconds;
+    res.minCamFps = std::min(res.minCamFps, f);
+    res.maxCamFps = std::max(res.maxCamFps, f);
+    sum += (double)uploadedPerCam[i];
+    sumSq += (double)uploadedPerCam[i] * (double)uploadedPerCam[i];
+    CameraStats st = sched.stats((uint8_t)i);
+    res.failures += st.failures;
+    res.timeouts += st.timeouts;
+    res.stale += st.stale;
+  }
+  res.fairness = sumSq > 0 ? sum * sum / (n * sumSq) : 0;
+  double busy = 0;
+  for (uint32_t b : linkBusyMs) busy += b;
+  res.linkBusy = busy / (linkCount * (double)endMs);
+  res.uplinkBusy = std::min(1.0, uplinkBusyMs / (double)endMs);
+  res.meanLatencyMs = frames ? latencySum / frames : 0;
+  return res;
+}
+
+// multicam-sim [--cameras=8] [--bus=0] [--baud=921600] [--cam-ms=300] [--frame-kb=40]
+//              [--uplink-mbps=8] [--upload-overhead-ms=60] [--queue=2] [--errors=0]
+//              [--seconds=60]
+int cmdMulticamSim(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  MulticamConfig cfg;
+  size_t maxCams = (size_t)std::min<long>((long)CAM_MAX, std::max(1L, args.num("cameras", 8)));
+  cfg.bus = args.num("bus", 0) != 0;
+  cfg.baud = (uint32_t)args.num("baud", cfg.baud);
+  cfg.camMs = args.real("cam-ms", cfg.camMs);
+  cfg.camJitterMs = args.real("cam-jitter-ms", cfg.camJitterMs);
+  cfg.frameBytes = (size_t)(args.real("frame-kb", 40) * 1024);
+  cfg.uplinkMbps = args.real("uplink-mbps", cfg.uplinkMbps);
+  cfg.uploadOverheadMs = args.real("upload-overhead-ms", cfg.uploadOverheadMs);
+  cfg.queueDepth = (size_t)args.num("queue", (long)cfg.queueDepth);
+  cfg.errorRate = args.real("errors", 0);
+  cfg.seconds = args.real("seconds", cfg.seconds);
+  if (cfg.baud == 0 || cfg.uplinkMbps <= 0 || cfg.seconds <= 0) {
+    std::fprintf(stderr, "multicam-sim: bad --baud, --uplink-mbps or --seconds\n");
+    return 2;
+  }
+
+  double xferMs = (cfg.frameBytes + 19) * 10.0 * 1000.0 / cfg.baud;
+  double uploadMs = cfg.uploadOverheadMs + cfg.frameBytes * 8.0 / (cfg.uplinkMbps * 1000.0);
+  std::printf("%s, %.0f kB frames: camera %.0f ms + link %.0f ms per frame, upload %.0f ms "
+              "(uplink limit %.2f frames/s)\n",
+              cfg.bus ? "RS-485 bus" : "point-to-point UARTs", cfg.frameBytes / 1024.0, cfg.camMs,
+              xferMs, uploadMs, 1000.0 / uploadMs);
+  std::printf("%4s %9s %10s %10s %9s %8s %8s %10s %6s\n", "cams", "frames/s", "cam min", "cam max",
+              "fairness", "link", "uplink", "latency", "fail");
+  size_t bad = 0;
+  double prevFps = 0;
+  for (size_t n = 1; n <= maxCams; ++n) {
+    MulticamResult r = simulate(n, cfg, 1234 + (uint32_t)n);
+    std::printf("%4zu %9.2f %10.2f %10.2f %9.3f %7.0f%% %7.0f%% %8.0f ms %6u\n", r.cameras, r.fps,
+                r.minCamFps, r.maxCamFps, r.fairness, r.linkBusy * 100.0, r.uplinkBusy * 100.0,
+                r.meanLatencyMs, (unsigned)(r.failures + r.timeouts));
+    // More cameras must never lose throughput, and the scheduler stays fair
+    if (r.fps + 0.05 < prevFps || (cfg.errorRate == 0 && r.fairness < 0.95)) ++bad;
+    if (cfg.errorRate == 0 && (r.failures || r.timeouts || r.stale)) ++bad;
+    prevFps = std::max(prevFps, r.fps);
+  }
+  if (bad) std::printf("FAILED: throughput dropped, unfair shares or unexpected failures\n");
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "host_util.h"
+#include "jpeg_dc.h"
+#include "phash.h"
+
+struct HashedImage {
+  std::string name;
+  uint16_t w = 0, h = 0;
+  double decodeUs = 0;
+  uint64_t ahash = 0, dhash = 0;
+};
+
+static std::string baseName(const std::string& p) {
+  size_t slash = p.rfind('/');
+  return slash == std::string::npos ? p : p.substr(slash + 1);
+}
+
+// Prints how many image pairs fall within each Hamming distance, i.e. how many
+// uploads a given HUB_PHASH_MAX_DISTANCE would have skipped.
+static void thresholdTable(const char* label, const std::vector<int>& pairDist,
+                           const std::vector<int>& consecutiveDist, int maxT) {
+  std::printf("\n%s: pairs within distance t (all pairs / consecutive frames)\n", label);
+  for (int t = 0; t <= maxT; ++t) {
+    size_t all = 0, cons = 0;
+    for (int d : pairDist) all += d <= t ? 1 : 0;
+    for (int d : consecutiveDist) cons += d <= t ? 1 : 0;
+    std::printf("  t=%-2d %6zu / %-6zu\n", t, all, cons);
+  }
+}
+
+// Threshold hint: the lower edge of the widest gap among small pairwise
+// distances separates "same scene" from "different scene".
+static int suggestThreshold(std::vector<int> d) {
+  if (d.empty()) return -1;
+  std::sort(d.begin(), d.end());
+  int best = -1, bestGap = 0;
+  for (size_t i = 0; i + 1 < d.size() && d[i] <= 24; ++i) {
+    int gap = d[i + 1] - d[i];
+    if (gap > bestGap) {
+      bestGap = gap;
+      best = d[i];
+    }
+  }
+  return best;
+}
+
+// phash [--images=upload] [--max-t=16]
+int cmdPhash(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  std::string dir = args.str("images", "upload");
+  std::vector<ImageFile> images = loadImages(dir);
+  if (images.empty()) {
+    std::fprintf(stderr, "phash: no JPEGs found in '%s'\n", dir.c_str());
+    return 1;
+  }
+
+  std::vector<HashedImage> hashed;
+  std::printf("%-36s %9s %9s  %-16s  %-16s  %s\n", "image", "size", "decode", "ahash", "dhash", "d(prev) a/d");
+  for (auto& img : images) {
+    HashedImage h;
+    h.name = baseName(img.path);
+    DcImage dc;
+    std::string err;
+    uint64_t t0 = nowUs();
+    bool ok = decodeJpegDc(img.data.data(), img.data.size(), dc, err, true);
+    h.decodeUs = (double)(nowUs() - t0);
+    if (!ok) {
+      std::printf("%-36s skipped: %s\n", h.name.c_str(), err.c_str());
+      continue;
+    }
+    h.w = dc.width;
+    h.h = dc.height;
+    h.ahash = averageHash(dc);
+    h.dhash = differenceHash(dc);
+    char dim[16];
+    std::snprintf(dim, sizeof(dim), "%ux%u", (unsigned)h.w, (unsigned)h.h);
+    std::printf("%-36s %9s %7.0fus  %016llx  %016llx", h.name.c_str(), dim, h.decodeUs,
+                (unsigned long long)h.ahash, (unsigned long long)h.dhash);
+    if (!hashed.empty()) {
+      std::printf("  %2d/%-2d", hammingDistance64(h.ahash, hashed.back().ahash),
+                  hammingDistance64(h.dhash, hashed.back().dhash));
+    }
+    std::printf("\n");
+    hashed.push_back(h);
+  }
+  if (hashed.size() < 2) return 0;
+
+  std::vector<int> pairA, pairD, consA, consD;
+  for (size_t i = 0; i < hashed.size(); ++i) {
+    for (size_t j = i + 1; j < hashed.size(); ++j) {
+      int a = hammingDistance64(hashed[i].ahash, hashed[j].ahash);
+      int d = hammingDistance64(hashed[i].dhash, hashed[j].dhash);
+      pairA.push_back(a);
+      pairD.push_back(d);
+      if (j == i + 1) {
+        consA.push_back(a);
+        consD.push_back(d);
+      }
+    }
+  }
+  int maxT = (int)args.num("max-t", 16);
+  thresholdTable("ahash", pairA, consA, maxT);
+  thresholdTable("dhash (used by the hub)", pairD, consD, maxT);
+  int hint = suggestThreshold(pairD);
+  if (hint >= 0) {
+    std::printf("\nsuggested HUB_PHASH_MAX_DISTANCE: %d (widest gap in dhash distances)\n", hint);
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include <csignal>
+#include <cstdio>
+
+#include "commands.h"
+#include "host_util.h"
+#include "standin_server.h"
+
+static volatile std::sig_atomic_t gStop = 0;
+
+static void onSignal(int) { gStop = 1; }
+
+// serve [--port=8000] [--any] [--request-ms=8] [--lock-ms=2] [--infer-ms=25]
+int cmdServe(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  StandInServer server(standInConfigFromArgs(args));
+  uint16_t port = (uint16_t)args.num("port", 8000);
+  if (!server.start(port, !args.has("any"))) {
+    std::fprintf(stderr, "serve: cannot listen on port %u\n", (unsigned)port);
+    return 1;
+  }
+  std::printf("stand-in Pi server on port %u (Ctrl-C to stop)\n", (unsigned)server.port());
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  uint64_t lastReport = nowUs();
+  while (!gStop) {
+    sleepUs(100000);
+    if (nowUs() - lastReport >= 5000000) {
+      lastReport = nowUs();
+      std::printf("requests=%llu frames=%llu\n", (unsigned long long)server.requests(),
+                  (unsigned long long)server.framesAnalysed());
+      std::fflush(stdout);
+    }
+  }
+  server.stop();
+  return 0;
+}
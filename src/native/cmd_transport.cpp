@@ -0,0 +1,250 @@
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera_transport.h"
+#include "commands.h"
+#include "host_util.h"
+#include "sim_camera.h"
+#include "uart_frame.h"
+
+static std::vector<SharedBytes> benchFrames(const CliArgs& args) {
+  std::vector<ImageFile> images = loadImages(args.str("images", "upload"));
+  if (images.empty()) {
+    size_t len = (size_t)(args.real("frame-kb", 40) * 1024);
+    for (uint32_t i = 0; i < 4; ++i) images.push_back(syntheticFrame(len + i * 512, i));
+  }
+  std::vector<SharedBytes> frames;
+  for (const ImageFile& f : images) frames.push_back(std::make_shared<const std::vector<uint8_t> >(f.data));
+  return frames;
+}
+
+// "host:port" -> host, port
+static bool splitHostPort(const std::string& s, std::string& host, uint16_t& port) {
+  size_t colon = s.rfind(':');
+  if (colon == std::string::npos) return false;
+  host = s.substr(0, colon);
+  port = (uint16_t)std::atoi(s.c_str() + colon + 1);
+  return !host.empty() && port != 0;
+}
+
+struct TransportRun {
+  std::string name;
+  size_t captures = 0;
+  size_t ok = 0;
+  uint64_t bytes = 0;
+  double seconds = 0;
+  LatencySummary firstByte;  // command to first byte back
+  LatencySummary frame;      // command to CRC-checked frame
+};
+
+// The hub's side of one capture, as captureFromCam() does it over a
+// transport: drop stale bytes, send 'T' + ID, read until that ID's frame.
+static bool captureOver(CameraTransport& link, UartFrameReader& reader, uint32_t id,
+                        uint32_t timeoutMs, size_t& bytes, double& firstMs, double& frameMs) {
+  link.discard();
+  reader.reset();
+  const uint8_t cmd[5] = {'T', (uint8_t)(id >> 24), (uint8_t)(id >> 16), (uint8_t)(id >> 8), (uint8_t)id};
+  uint64_t t0 = nowUs();
+  if (!link.write(cmd, sizeof(cmd))) return false;
+  link.flush();
+  firstMs = -1;
+  uint8_t buf[4096];
+  while (nowUs() - t0 < timeoutMs * 1000ULL) {
+    size_t n = link.read(buf, sizeof(buf));
+    if (!n) {
+      sleepUs(50);
+      continue;
+    }
+    if (firstMs < 0) firstMs = (nowUs() - t0) / 1000.0;
+    size_t off = 0;
+    while (off < n) {
+      size_t used = 0;
+      UartFrameReader::Event ev = reader.feed(buf + off, n - off, used);
+      off += used;
+      if (ev != UartFrameReader::FRAME) continue;
+      std::shared_ptr<std::vector<uint8_t> > jpg = reader.take();
+      if (reader.type() == FRAME_TYPE_TRACED && reader.captureId() == id && jpg) {
+        frameMs = (nowUs() - t0) / 1000.0;
+        bytes = jpg->size();
+        return true;
+      }
+      if (reader.type() == FRAME_TYPE_ERROR) return false;
+    }
+  }
+  return false;
+}
+
+static TransportRun runCaptures(const std::string& name, CameraTransport& link, size_t captures) {
+  TransportRun r;
+  r.name = name;
+  r.captures = captures;
+  UartFrameReader reader(400000);  // the hub's frame limit
+  std::vector<double> first, frame;
+  uint64_t t0 = nowUs();
+  for (size_t i = 0; i < captures; ++i) {
+    size_t bytes = 0;
+    double firstMs = 0, frameMs = 0;
+    if (!captureOver(link, reader, 0x7a000000u | (uint32_t)(i + 1), 8000, bytes, firstMs, frameMs)) continue;
+    ++r.ok;
+    r.bytes += bytes;
+    first.push_back(firstMs);
+    frame.push_back(frameMs);
+  }
+  r.seconds = (nowUs() - t0) / 1e6;
+  r.firstByte = summarize(first);
+  r.frame = summarize(frame);
+  return r;
+}
+
+static void printRun(const TransportRun& r) {
+  double mbps = r.seconds > 0 ? r.bytes * 8.0 / r.seconds / 1e6 : 0;
+  std::printf("%-12s %5zu/%-5zu %9.2f %8.1f %9.2f %9.2f %9.2f %9.2f %9.2f\n", r.name.c_str(), r.ok,
+              r.captures, mbps, r.seconds > 0 ? r.ok / r.seconds : 0, r.firstByte.p50Ms,
+              r.frame.p50Ms, r.frame.p90Ms, r.frame.p99Ms, r.frame.maxMs);
+}
+
+// An in-process camera on the other end of a transport, for one run
+class CameraThread {
+ public:
+  CameraThread(CameraTransport& link, const std::vector<SharedBytes>& frames, double camMs)
+      : cam_(link, frames, camMs) {
+    running_ = true;
+    thread_ = std::thread([this]() { cam_.run(running_); });
+  }
+  ~CameraThread() {
+    running_ = false;
+    thread_.join();
+  }
+
+ private:
+  SimCameraDevice cam_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+// transport-bench [--transports=memory,uart,tcp] [--captures=200] [--images=upload]
+//                 [--frame-kb=40] [--baud=921600] [--cam-ms=0]
+//                 [--connect=host:port | --listen=port]   (camera in another process)
+int cmdTransportBench(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  std::vector<SharedBytes> frames = benchFrames(args);
+  size_t captures = (size_t)std::max(1L, args.num("captures", 200));
+  double camMs = args.real("cam-ms", 0);
+  double baud = args.real("baud", 921600);
+  size_t total = 0;
+  for (const SharedBytes& f : frames) total += f->size();
+  bool external = args.has("connect") || args.has("listen");
+  if (external) {
+    std::printf("%zu captures from a camera in another process\n", captures);
+  } else {
+    std::printf("%zu captures of %zu frame(s), %.1f kB average, camera %.0f ms\n", captures,
+                frames.size(), total / 1024.0 / frames.size(), camMs);
+  }
+  std::printf("%-12s %11s %9s %8s %9s %9s %9s %9s %9s\n", "transport", "ok", "Mbit/s", "frames/s",
+              "first p50", "frame p50", "p90", "p99", "max");
+
+  // Hub here, camera elsewhere: cam-sim, or an ESP32-CAM built with CAM_LINK_TCP
+  if (external) {
+    SocketCameraTransport link;
+    std::string host;
+    uint16_t port = 0;
+    if (args.has("connect")) {
+      if (!splitHostPort(args.str("connect"), host, port) || !link.connect(host.c_str(), port)) {
+        std::fprintf(stderr, "transport-bench: cannot connect to %s\n", args.str("connect").c_str());
+        return 1;
+      }
+    } else {
+      if (!link.listen((uint16_t)args.num("listen", 5000))) {
+        std::fprintf(stderr, "transport-bench: cannot listen on %ld\n", args.num("listen", 5000));
+        return 1;
+      }
+      std::fprintf(stderr, "waiting for a camera on port %u\n", (unsigned)link.port());
+      while (!link.connected()) sleepUs(10000);
+    }
+    TransportRun r = runCaptures("tcp", link, captures);
+    printRun(r);
+    return r.ok == captures ? 0 : 1;
+  }
+
+  int failed = 0;
+  std::stringstream list(args.str("transports", "memory,uart,tcp"));
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    TransportRun r;
+    if (name == "memory" || name == "uart") {
+      std::unique_ptr<PipeTransport> hub, cam;
+      PipeTransport::makePair(name == "uart" ? baud / 10.0 : 0, hub, cam);
+      CameraThread camera(*cam, frames, camMs);
+      r = runCaptures(hub->name(), *hub, captures);
+    } else if (name == "tcp") {
+      SocketCameraTransport hub, cam;
+      if (!hub.listen(0, true) || !cam.connect("127.0.0.1", hub.port()) || !hub.connected()) {
+        std::fprintf(stderr, "transport-bench: loopback TCP failed\n");
+        ++failed;
+        continue;
+      }
+      CameraThread camera(cam, frames, camMs);
+      r = runCaptures("tcp", hub, captures);
+    } else {
+      std::fprintf(stderr, "transport-bench: unknown transport '%s'\n", name.c_str());
+      return 2;
+    }
+    printRun(r);
+    if (r.ok != r.captures) ++failed;
+  }
+  return failed ? 1 : 0;
+}
+
+static volatile std::sig_atomic_t gStop = 0;
+
+static void onSignal(int) { gStop = 1; }
+
+// cam-sim [--connect=host:port | --listen=port] [--images=upload] [--frame-kb=40] [--cam-ms=300]
+// A camera over TCP for a hub in another process (transport-bench --listen,
+// or the hub built with HUB_CAM_TRANSPORT=1).
+int cmdCamSim(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  std::vector<SharedBytes> frames = benchFrames(args);
+  SocketCameraTransport link;
+  std::string host;
+  uint16_t port = 0;
+  bool connectMode = args.has("connect");
+  if (connectMode && !splitHostPort(args.str("connect"), host, port)) {
+    std::fprintf(stderr, "cam-sim: --connect wants host:port\n");
+    return 2;
+  }
+  if (!connectMode && !link.listen((uint16_t)args.num("listen", 5000))) {
+    std::fprintf(stderr, "cam-sim: cannot listen on %ld\n", args.num("listen", 5000));
+    return 1;
+  }
+  SimCameraDevice cam(link, frames, args.real("cam-ms", 300));
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  std::printf("camera simulator, %zu frame(s), %s %s:%u (Ctrl-C to stop)\n", frames.size(),
+              connectMode ? "connecting to" : "listening on", connectMode ? host.c_str() : "*",
+              (unsigned)(connectMode ? port : link.port()));
+  std::fflush(stdout);
+  uint64_t lastReport = nowUs();
+  uint64_t lastConnect = 0;
+  while (!gStop) {
+    // Reconnect like the camera firmware does after a hub restart
+    if (connectMode && !link.connected() && nowUs() - lastConnect > 1000000) {
+      lastConnect = nowUs();
+      link.connect(host.c_str(), port);
+    }
+    if (!cam.poll()) sleepUs(200);
+    if (nowUs() - lastReport >= 5000000) {
+      lastReport = nowUs();
+      std::printf("connects=%u frames=%u\n", (unsigned)link.connects(), (unsigned)cam.framesSent());
+      std::fflush(stdout);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "host_util.h"
+#include "jpeg_dc.h"
+#include "leaf_triage.h"
+
+static std::string baseName(const std::string& p) {
+  size_t slash = p.rfind('/');
+  return slash == std::string::npos ? p : p.substr(slash + 1);
+}
+
+// triage [--images=upload] [--repeat=50] [--min-confidence=0.8] [--baud=921600]
+// The camera's triage of each image, with DC decode and network time (best
+// of --repeat), then what a CAM_TRIAGE camera would have kept off the link:
+// frames whose verdict is "no leaf" or "healthy" at --min-confidence or
+// better go out as a verdict only.
+int cmdTriage(int argc, char** argv) {
+  CliArgs args(argc, argv);
+  std::string dir = args.str("images", "upload");
+  std::vector<ImageFile> images = loadImages(dir);
+  if (images.empty()) {
+    std::fprintf(stderr, "triage: no JPEGs found in '%s'\n", dir.c_str());
+    return 1;
+  }
+  long repeat = args.num("repeat", 50);
+  if (repeat < 1) repeat = 1;
+  double minConf = args.real("min-confidence", 0.8);
+  double baud = args.real("baud", 921600);
+
+  static LeafTriage triage;  // ~11 KB of activations, as on the camera
+  std::printf("model: %dx%d input, %u MACs per frame\n\n", TRIAGE_W, TRIAGE_H, (unsigned)LeafTriage::macs());
+  std::printf("%-32s %8s %8s %8s  %-8s %5s  %5s %5s %5s  %s\n", "image", "bytes", "dc", "net", "verdict",
+              "conf", "none", "ok", "check", "sent");
+  size_t counts[TRIAGE_CLASSES] = {0, 0, 0};
+  size_t framesSent = 0, usable = 0;
+  uint64_t bytesAll = 0, bytesSent = 0;
+  double dcTotalUs = 0, netTotalUs = 0;
+  for (const ImageFile& img : images) {
+    DcImage dc;
+    std::string err;
+    double dcUs = 0, netUs = 0;
+    bool ok = true;
+    for (long i = 0; i < repeat && ok; ++i) {
+      uint64_t t0 = nowUs();
+      ok = decodeJpegDc(img.data.data(), img.data.size(), dc, err);
+      double us = (double)(nowUs() - t0);
+      if (i == 0 || us < dcUs) dcUs = us;
+    }
+    if (!ok || !triage.setInput(dc)) {
+      std::printf("%-32s skipped: %s\n", baseName(img.path).c_str(), err.c_str());
+      continue;
+    }
+    TriageResult r;
+    for (long i = 0; i < repeat; ++i) {
+      uint64_t t0 = nowUs();
+      r = triage.run();
+      double us = (double)(nowUs() - t0);
+      if (i == 0 || us < netUs) netUs = us;
+    }
+    bool send = r.cls == TRIAGE_ANALYSE || r.confidence < minConf;
+    ++usable;
+    ++counts[r.cls];
+    bytesAll += img.data.size();
+    if (send) {
+      ++framesSent;
+      bytesSent += img.data.size();
+    }
+    dcTotalUs += dcUs;
+    netTotalUs += netUs;
+    std::printf("%-32s %8zu %6.0fus %6.0fus  %-8s %5.2f  %5.2f %5.2f %5.2f  %s\n",
+                baseName(img.path).c_str(), img.data.size(), dcUs, netUs, triageClassName(r.cls),
+                r.confidence, r.prob[TRIAGE_NO_LEAF], r.prob[TRIAGE_HEALTHY], r.prob[TRIAGE_ANALYSE],
+                send ? "jpeg" : "verdict");
+  }
+  if (!usable) return 1;
+
+  double bytesPerSec = baud / 10.0;
+  std::printf("\n%zu frame(s): %zu no leaf, %zu healthy, %zu to analyse\n", usable, counts[TRIAGE_NO_LEAF],
+              counts[TRIAGE_HEALTHY], counts[TRIAGE_ANALYSE]);
+  std::printf("mean triage cost here: %.0f us DC decode + %.0f us network\n", dcTotalUs / usable,
+              netTotalUs / usable);
+  std::printf("sent in full at confidence %.2f: %zu of %zu frames, %.1f of %.1f kB "
+              "(link time %.0f -> %.0f ms at %.0f baud)\n",
+              minConf, framesSent, usable, bytesSent / 1024.0, bytesAll / 1024.0,
+              bytesAll / bytesPerSec * 1000, bytesSent / bytesPerSec * 1000, baud);
+  return 0;
+}
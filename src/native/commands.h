@@ -0,0 +1,15 @@
+#pragma once
+
+// Subcommands of the host tool. Each returns a process exit code.
+int cmdServe(int argc, char** argv);
+int cmdBenchUpload(int argc, char** argv);
+int cmdPhash(int argc, char** argv);
+int cmdLeafStats(int argc, char** argv);
+int cmdJpegCheck(int argc, char** argv);
+int cmdTriage(int argc, char** argv);
+int cmdLoadtest(int argc, char** argv);
+int cmdHistoryBench(int argc, char** argv);
+int cmdMulticamSim(int argc, char** argv);
+int cmdTransportBench(int argc, char** argv);
+int cmdCamSim(int argc, char** argv);
+int cmdFleetSim(int argc, char** argv);
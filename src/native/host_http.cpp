@@ -0,0 +1,257 @@
+#include "host_http.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+static std::string lower(std::string s) {
+  for (auto& c : s) c = (char)std::tolower((unsigned char)c);
+  return s;
+}
+
+std::string HttpMessage::header(const std::string& name) const {
+  auto it = headers.find(lower(name));
+  return it == headers.end() ? std::string() : it->second;
+}
+
+std::string HttpMessage::queryParam(const std::string& name) const {
+  size_t pos = 0;
+  while (pos <= query.size()) {
+    size_t amp = query.find('&', pos);
+    if (amp == std::string::npos) amp = query.size();
+    std::string kv = query.substr(pos, amp - pos);
+    size_t eq = kv.find('=');
+    if (kv.substr(0, eq) == name) return eq == std::string::npos ? std::string() : kv.substr(eq + 1);
+    pos = amp + 1;
+  }
+  return std::string();
+}
+
+const char* httpReason(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
+}
+
+static bool waitFd(int fd, short events, int timeoutMs) {
+  pollfd p = { fd, events, 0 };
+  return ::poll(&p, 1, timeoutMs) > 0;
+}
+
+static bool sendAll(int fd, const char* data, size_t n, int timeoutMs) {
+  while (n) {
+    if (!waitFd(fd, POLLOUT, timeoutMs)) return false;
+    ssize_t w = ::send(fd, data, n, MSG_NOSIGNAL);
+    if (w <= 0) return false;
+    data += w;
+    n -= (size_t)w;
+  }
+  return true;
+}
+
+// Reads one message (request or response) terminated by Content-Length or EOF.
+static bool readMessage(int fd, bool isRequest, HttpMessage& msg, int timeoutMs) {
+  std::string buf;
+  char tmp[16384];
+  size_t headerEnd = std::string::npos;
+  while (headerEnd == std::string::npos) {
+    if (!waitFd(fd, POLLIN, timeoutMs)) return false;
+    ssize_t r = ::recv(fd, tmp, sizeof(tmp), 0);
+    if (r <= 0) return false;
+    buf.append(tmp, (size_t)r);
+    headerEnd = buf.find("\r\n\r\n");
+    if (buf.size() > 64 * 1024 && headerEnd == std::string::npos) return false;
+  }
+
+  size_t lineEnd = buf.find("\r\n");
+  std::string first = buf.substr(0, lineEnd);
+  size_t sp1 = first.find(' ');
+  size_t sp2 = first.find(' ', sp1 + 1);
+  if (sp1 == std::string::npos) return false;
+  if (isRequest) {
+    msg.method = first.substr(0, sp1);
+    std::string target = first.substr(sp1 + 1, sp2 == std::string::npos ? std::string::npos : sp2 - sp1 - 1);
+    size_t q = target.find('?');
+    msg.path = target.substr(0, q);
+    msg.query = q == std::string::npos ? std::string() : target.substr(q + 1);
+  } else {
+    msg.status = std::atoi(first.c_str() + sp1 + 1);
+  }
+
+  size_t pos = lineEnd + 2;
+  while (pos < headerEnd) {
+    size_t e = buf.find("\r\n", pos);
+    std::string line = buf.substr(pos, e - pos);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+      size_t v = colon + 1;
+      while (v < line.size() && line[v] == ' ') ++v;
+      msg.headers[lower(line.substr(0, colon))] = line.substr(v);
+    }
+    pos = e + 2;
+  }
+
+  msg.body = buf.substr(headerEnd + 4);
+  std::string cl = msg.header("content-length");
+  if (!cl.empty()) {
+    size_t want = (size_t)std::strtoul(cl.c_str(), nullptr, 10);
+    while (msg.body.size() < want) {
+      if (!waitFd(fd, POLLIN, timeoutMs)) return false;
+      ssize_t r = ::recv(fd, tmp, sizeof(tmp), 0);
+      if (r <= 0) return false;
+      msg.body.append(tmp, (size_t)r);
+    }
+    msg.body.resize(want);
+  } else if (!isRequest) {
+    for (;;) {
+      if (!waitFd(fd, POLLIN, timeoutMs)) return false;
+      ssize_t r = ::recv(fd, tmp, sizeof(tmp), 0);
+      if (r < 0) return false;
+      if (r == 0) break;
+      msg.body.append(tmp, (size_t)r);
+    }
+  }
+  return true;
+}
+
+bool HostHttpServer::start(uint16_t port, Handler handler, bool loopbackOnly) {
+  handler_ = handler;
+  listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd_ < 0) return false;
+  int one = 1;
+  ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+  if (::bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd_, 128) != 0) {
+    ::close(listenFd_);
+    listenFd_ = -1;
+    return false;
+  }
+  socklen_t alen = sizeof(addr);
+  ::getsockname(listenFd_, (sockaddr*)&addr, &alen);
+  port_ = ntohs(addr.sin_port);
+  running_ = true;
+  acceptThread_ = std::thread(&HostHttpServer::acceptLoop, this);
+  return true;
+}
+
+void HostHttpServer::stop() {
+  if (!running_.exchange(false)) return;
+  ::shutdown(listenFd_, SHUT_RDWR);
+  ::close(listenFd_);
+  if (acceptThread_.joinable()) acceptThread_.join();
+  while (active_.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  listenFd_ = -1;
+}
+
+void HostHttpServer::acceptLoop() {
+  while (running_) {
+    if (!waitFd(listenFd_, POLLIN, 100)) continue;
+    int fd = ::accept(listenFd_, nullptr, nullptr);
+    if (fd < 0) continue;
+    ++active_;
+    std::thread([this, fd]() {
+      serve(fd);
+      --active_;
+    }).detach();
+  }
+}
+
+void HostHttpServer::serve(int fd) {
+  int one = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  HttpMessage req;
+  HttpMessage resp;
+  if (readMessage(fd, true, req, 10000)) {
+    resp.status = 200;
+    handler_(req, resp);
+    if (!resp.headers.count("content-type")) resp.headers["content-type"] = "application/json";
+    std::string head = "HTTP/1.1 " + std::to_string(resp.status) + " " + httpReason(resp.status) + "\r\n";
+    for (auto& h : resp.headers) head += h.first + ": " + h.second + "\r\n";
+    head += "Content-Length: " + std::to_string(resp.body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (sendAll(fd, head.data(), head.size(), 10000) && req.method != "HEAD") {
+      sendAll(fd, resp.body.data(), resp.body.size(), 10000);
+    }
+  }
+  ::shutdown(fd, SHUT_WR);
+  ::close(fd);
+}
+
+bool httpRequest(const std::string& host, uint16_t port, const std::string& method,
+                 const std::string& target, const HeaderList& headers, const std::string& body,
+                 HttpMessage& resp, std::string& err, int timeoutMs) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) {
+    err = "resolve failed";
+    return false;
+  }
+  int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (fd < 0 || ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+    ::freeaddrinfo(res);
+    if (fd >= 0) ::close(fd);
+    err = "connect fail";
+    return false;
+  }
+  ::freeaddrinfo(res);
+  int one = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  std::string head = method + " " + target + " HTTP/1.1\r\nHost: " + host + ":" + std::to_string(port) + "\r\n";
+  for (auto& h : headers) head += h.first + ": " + h.second + "\r\n";
+  if (method == "POST" || method == "PUT" || !body.empty()) {
+    head += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  }
+  head += "Connection: close\r\n\r\n";
+  bool ok = sendAll(fd, head.data(), head.size(), timeoutMs) &&
+            sendAll(fd, body.data(), body.size(), timeoutMs);
+  if (!ok) {
+    ::close(fd);
+    err = "socket write";
+    return false;
+  }
+  resp = HttpMessage();
+  if (!readMessage(fd, false, resp, timeoutMs)) {
+    ::close(fd);
+    err = "resp timeout";
+    return false;
+  }
+  ::close(fd);
+  return true;
+}
+
+bool splitHostPort(const std::string& s, std::string& host, uint16_t& port) {
+  size_t colon = s.rfind(':');
+  host = s.substr(0, colon);
+  port = 8000;
+  if (colon != std::string::npos) {
+    long p = std::strtol(s.c_str() + colon + 1, nullptr, 10);
+    if (p <= 0 || p > 65535) return false;
+    port = (uint16_t)p;
+  }
+  return !host.empty();
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Minimal blocking HTTP/1.1 over POSIX sockets for the host tools. One request
+// per connection (Connection: close), the same way the hub talks to the Pi.
+
+struct HttpMessage {
+  std::string method;
+  std::string path;   // without query
+  std::string query;  // text after '?', may be empty
+  int status = 0;
+  std::map<std::string, std::string> headers;  // lower-case names
+  std::string body;
+
+  std::string header(const std::string& name) const;
+  std::string queryParam(const std::string& name) const;
+};
+
+typedef std::vector<std::pair<std::string, std::string> > HeaderList;
+
+class HostHttpServer {
+ public:
+  typedef std::function<void(const HttpMessage& req, HttpMessage& resp)> Handler;
+
+  ~HostHttpServer() { stop(); }
+
+  // port 0 picks a free loopback port; see port().
+  bool start(uint16_t port, Handler handler, bool loopbackOnly = true);
+  void stop();
+  uint16_t port() const { return port_; }
+
+ private:
+  void acceptLoop();
+  void serve(int fd);
+
+  Handler handler_;
+  int listenFd_ = -1;
+  uint16_t port_ = 0;
+  std::atomic<bool> running_{false};
+  std::atomic<int> active_{0};
+  std::thread acceptThread_;
+};
+
+bool httpRequest(const std::string& host, uint16_t port, const std::string& method,
+                 const std::string& target, const HeaderList& headers, const std::string& body,
+                 HttpMessage& resp, std::string& err, int timeoutMs = 10000);
+
+// Parses "host:port" (port defaults to 8000, the Pi server port).
+bool splitHostPort(const std::string& s, std::string& host, uint16_t& port);
+
+const char* httpReason(int status);
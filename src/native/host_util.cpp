@@ -0,0 +1,148 @@
+#include "host_util.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+CliArgs::CliArgs(int argc, char** argv) {
+  for (int i = 0; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a.compare(0, 2, "--") == 0) {
+      size_t eq = a.find('=');
+      if (eq == std::string::npos) opts_[a.substr(2)] = "1";
+      else opts_[a.substr(2, eq - 2)] = a.substr(eq + 1);
+    } else {
+      positional_.push_back(a);
+    }
+  }
+}
+
+std::string CliArgs::str(const std::string& key, const std::string& def) const {
+  auto it = opts_.find(key);
+  return it == opts_.end() ? def : it->second;
+}
+
+long CliArgs::num(const std::string& key, long def) const {
+  auto it = opts_.find(key);
+  return it == opts_.end() ? def : std::strtol(it->second.c_str(), nullptr, 10);
+}
+
+double CliArgs::real(const std::string& key, double def) const {
+  auto it = opts_.find(key);
+  return it == opts_.end() ? def : std::strtod(it->second.c_str(), nullptr);
+}
+
+bool readFileBytes(const std::string& path, std::vector<uint8_t>& out) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return false;
+  out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static bool isJpegName(const std::string& name) {
+  size_t dot = name.rfind('.');
+  if (dot == std::string::npos) return false;
+  std::string ext = name.substr(dot + 1);
+  for (auto& c : ext) c = (char)std::tolower((unsigned char)c);
+  return ext == "jpg" || ext == "jpeg";
+}
+
+std::vector<ImageFile> loadImages(const std::string& dir) {
+  std::vector<ImageFile> out;
+  struct stat st;
+  if (::stat(dir.c_str(), &st) != 0) return out;
+  std::vector<std::string> paths;
+  if (S_ISDIR(st.st_mode)) {
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) return out;
+    while (dirent* e = ::readdir(d)) {
+      std::string name = e->d_name;
+      if (isJpegName(name)) paths.push_back(dir + "/" + name);
+    }
+    ::closedir(d);
+    std::sort(paths.begin(), paths.end());
+  } else {
+    paths.push_back(dir);
+  }
+  for (auto& p : paths) {
+    ImageFile img;
+    img.path = p;
+    if (readFileBytes(p, img.data) && !img.data.empty()) out.push_back(std::move(img));
+  }
+  return out;
+}
+
+uint64_t nowUs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void sleepUs(uint64_t us) {
+  if (us) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+static double pct(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t idx = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+  return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+LatencySummary summarize(std::vector<double> samplesMs) {
+  LatencySummary s;
+  s.count = samplesMs.size();
+  if (samplesMs.empty()) return s;
+  std::sort(samplesMs.begin(), samplesMs.end());
+  double sum = 0;
+  for (double v : samplesMs) sum += v;
+  s.meanMs = sum / (double)samplesMs.size();
+  s.p50Ms = pct(samplesMs, 0.50);
+  s.p90Ms = pct(samplesMs, 0.90);
+  s.p99Ms = pct(samplesMs, 0.99);
+  s.maxMs = samplesMs.back();
+  return s;
+}
+
+std::string jsonEscape(const std::string& s) {
+  std::string out;
+  out.reserve(s.size() + 2);
+  for (char c : s) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+          out += buf;
+        } else {
+          out += c;
+        }
+    }
+  }
+  return out;
+}
+
+ImageFile syntheticFrame(size_t len, uint32_t seed) {
+  ImageFile f;
+  f.path = "synthetic";
+  f.data.resize(len < 4 ? 4 : len);
+  std::mt19937 rng(seed);
+  for (uint8_t& b : f.data) b = (uint8_t)rng();
+  f.data[0] = 0xFF;
+  f.data[1] = 0xD8;
+  f.data[f.data.size() - 2] = 0xFF;
+  f.data[f.data.size() - 1] = 0xD9;
+  return f;
+}
+
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Shared helpers for the host tools: --key=value options, image loading,
+// monotonic clocks and latency summaries.
+
+class CliArgs {
+ public:
+  CliArgs(int argc, char** argv);
+  bool has(const std::string& key) const { return opts_.count(key) != 0; }
+  std::string str(const std::string& key, const std::string& def = "") const;
+  long num(const std::string& key, long def) const;
+  double real(const std::string& key, double def) const;
+  const std::vector<std::string>& positional() const { return positional_; }
+
+ private:
+  std::map<std::string, std::string> opts_;
+  std::vector<std::string> positional_;
+};
+
+struct ImageFile {
+  std::string path;
+  std::vector<uint8_t> data;
+};
+
+bool readFileBytes(const std::string& path, std::vector<uint8_t>& out);
+
+// Loads every *.jpg / *.jpeg in dir (sorted by name), or the single file
+// when dir names a file.
+std::vector<ImageFile> loadImages(const std::string& dir);
+// Stand-in JPEG of len bytes (SOI, noise, EOI) for runs without sample images
+ImageFile syntheticFrame(size_t len, uint32_t seed);
+
+uint64_t nowUs();
+void sleepUs(uint64_t us);
+
+struct LatencySummary {
+  size_t count = 0;
+  double meanMs = 0, p50Ms = 0, p90Ms = 0, p99Ms = 0, maxMs = 0;
+};
+
+LatencySummary summarize(std::vector<double> samplesMs);
+
+std::string jsonEscape(const std::string& s);
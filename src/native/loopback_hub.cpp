@@ -0,0 +1,189 @@
+#include "loopback_hub.h"
+
+#include <poll.h>
+#include <algorithm>
+#include <cstdio>
+
+#include "../hub/web_assets.h"
+#include "crc16.h"
+#include "http_cache.h"
+#include "http_routes.h"
+
+static const uint8_t LOOPBACK_CHANNEL_MJPEG = 1;   // HTTP_CHANNEL_MJPEG on the hub
+static const uint8_t LOOPBACK_CHANNEL_EVENTS = 2;  // HTTP_CHANNEL_EVENTS on the hub
+
+LoopbackHub::LoopbackHub(const LoopbackHubConfig& cfg, const std::vector<ImageFile>& frames)
+    : cfg_(cfg),
+      historyStorage_(cfg.historyBytes),
+      history_(historyStorage_, cfg.historyEntries),
+      http_(cfg.maxClients, [this](const HttpRequest& req, HttpResponse& resp) { handle(req, resp); }) {
+  for (const ImageFile& f : frames) {
+    frames_.push_back(std::make_shared<const std::vector<uint8_t> >(f.data));
+    keys_.push_back(makeFrameKey(f.data.data(), f.data.size(), crc16(f.data.data(), f.data.size())));
+  }
+}
+
+bool LoopbackHub::start(uint16_t port, bool loopbackOnly) {
+  if (frames_.empty() || !listener_.begin(port, loopbackOnly)) return false;
+  listener_.setSendBuffer(cfg_.sendBufferBytes);
+  size_t largest = 0;
+  for (const SharedBytes& f : frames_) largest = std::max(largest, f->size());
+  history_.setReserve((uint32_t)largest);
+  publish(0);
+  running_ = true;
+  serveThread_ = std::thread([this]() { serveLoop(); });
+  cameraThread_ = std::thread([this]() { cameraLoop(); });
+  return true;
+}
+
+void LoopbackHub::stop() {
+  if (!running_.exchange(false)) return;
+  serveThread_.join();
+  cameraThread_.join();
+  listener_.end();
+}
+
+void LoopbackHub::publish(size_t index) {
+  std::lock_guard<std::mutex> g(lock_);
+  imageIndex_ = index % frames_.size();
+  image_ = frames_[imageIndex_];
+  imageKey_ = keys_[imageIndex_];
+}
+
+// The hub's HTTP task: wait for socket readiness, accept into free slots,
+// advance every connection.
+void LoopbackHub::serveLoop() {
+  std::vector<std::pair<int, bool> > watch;
+  std::vector<pollfd> fds;
+  while (running_) {
+    http_.watchList(watch);
+    fds.clear();
+    if (http_.hasFreeSlot()) fds.push_back(pollfd{listener_.fd(), POLLIN, 0});
+    for (auto& w : watch) fds.push_back(pollfd{w.first, (short)(w.second ? POLLOUT : POLLIN), 0});
+    // Short timeout: deferred completions arrive without a socket event.
+    ::poll(fds.data(), fds.size(), 2);
+    uint32_t now = (uint32_t)(nowUs() / 1000);
+    listener_.acceptInto(http_, now);
+    for (int i = 0; i < 8 && http_.poll(now); ++i) {
+    }
+  }
+}
+
+// The hub's loop(): runs captures one at a time, off the HTTP path, and
+// relays preview frames while /stream has viewers.
+void LoopbackHub::cameraLoop() {
+  const uint64_t previewUs = 1000000ULL / (uint64_t)(cfg_.streamFps > 0 ? cfg_.streamFps : 1);
+  uint64_t nextPreviewUs = 0;
+  size_t previewIndex = 0;
+  while (running_) {
+    while (history_.service()) {
+    }
+    if (http_.subscribers(LOOPBACK_CHANNEL_MJPEG) && nowUs() >= nextPreviewUs) {
+      const SharedBytes& f = frames_[previewIndex++ % frames_.size()];
+      http_.publish(LOOPBACK_CHANNEL_MJPEG, mjpegPart(f->data(), f->size()));
+      nextPreviewUs = nowUs() + previewUs;
+    }
+    std::vector<uint32_t> tokens;
+    {
+      std::lock_guard<std::mutex> g(lock_);
+      tokens.swap(captureQueue_);
+    }
+    if (tokens.empty()) {
+      sleepUs(1000);
+      continue;
+    }
+    uint32_t t0 = (uint32_t)(nowUs() / 1000);
+    char ev[160];
+    std::snprintf(ev, sizeof(ev), "{\"stage\":\"start\",\"t\":%u}", (unsigned)t0);
+    http_.publish(LOOPBACK_CHANNEL_EVENTS, sseEvent("capture", ev));
+    sleepUs((uint64_t)(cfg_.captureMs * 1000.0));
+    size_t next;
+    {
+      std::lock_guard<std::mutex> g(lock_);
+      next = imageIndex_ + 1;
+    }
+    publish(next);
+    ++captures_;
+    const SharedBytes& frame = frames_[next % frames_.size()];
+    history_.add(frame, keys_[next % frames_.size()].crc, 0, t0, 0,
+                 (uint16_t)cfg_.captureMs);
+    char etag[FRAME_ETAG_LEN];
+    {
+      std::lock_guard<std::mutex> g(lock_);
+      frameEtag(imageKey_, etag, sizeof(etag));
+    }
+    uint32_t t1 = (uint32_t)(nowUs() / 1000);
+    std::string version(etag + 1, std::string(etag).size() - 2);
+    std::snprintf(ev, sizeof(ev), "{\"stage\":\"done\",\"bytes\":%u,\"ms\":%u,\"etag\":\"%s\",\"t\":%u}",
+                  (unsigned)frames_[next % frames_.size()]->size(), (unsigned)(t1 - t0),
+                  version.c_str(), (unsigned)t1);
+    http_.publish(LOOPBACK_CHANNEL_EVENTS, sseEvent("capture", ev));
+    std::string body = "{\"ok\":true,\"uploaded\":false,\"etag\":" + std::string(etag) + "}";
+    for (uint32_t t : tokens) {
+      HttpResponse resp;
+      resp.send(200, "application/json", body);
+      http_.complete(t, resp);
+    }
+  }
+}
+
+void LoopbackHub::handle(const HttpRequest& req, HttpResponse& resp) {
+  ++requests_;
+  for (size_t i = 0; i < WEB_ASSET_COUNT; ++i) {
+    const WebAsset& a = WEB_ASSETS[i];
+    if (req.path == a.path) {
+      serveGzipAsset(req, resp, a.contentType, a.gz, a.gzLen, a.version, a.versioned);
+      return;
+    }
+  }
+  if (req.path == "/image.jpg") {
+    SharedBytes image;
+    FrameKey key;
+    {
+      std::lock_guard<std::mutex> g(lock_);
+      image = image_;
+      key = imageKey_;
+    }
+    serveFrame(req, resp, image, key);
+    return;
+  }
+  if (req.path == "/stats") {
+    char etag[FRAME_ETAG_LEN];
+    {
+      std::lock_guard<std::mutex> g(lock_);
+      frameEtag(imageKey_, etag, sizeof(etag));
+    }
+    std::string version(etag + 1, std::string(etag).size() - 2);
+    char body[256];
+    std::snprintf(body, sizeof(body),
+                  "{\"cache_hits\":0,\"cache_misses\":0,\"cache_entries\":0,\"cache_capacity\":0,"
+                  "\"near_dup_skips\":0,\"batch_queued\":0,\"http_clients\":%u,"
+                  "\"stream_viewers\":%u,\"image_etag\":\"%s\"}",
+                  (unsigned)http_.clients(), (unsigned)http_.subscribers(LOOPBACK_CHANNEL_MJPEG),
+                  version.c_str());
+    resp.setHeader("Cache-Control", "no-store");
+    resp.send(200, "application/json", body);
+    return;
+  }
+  if (req.path == "/stream") {
+    resp.setHeader("Cache-Control", "no-cache, no-store");
+    resp.stream(LOOPBACK_CHANNEL_MJPEG, MJPEG_CONTENT_TYPE, 1);
+    return;
+  }
+  if (req.path == "/events") {
+    resp.setHeader("Cache-Control", "no-cache, no-store");
+    resp.stream(LOOPBACK_CHANNEL_EVENTS, SSE_CONTENT_TYPE, 16);
+    return;
+  }
+  if (req.path == "/history" || req.path.compare(0, 9, "/history/") == 0) {
+    serveHistory(req, resp, history_);
+    return;
+  }
+  if (req.path == "/capture") {
+    std::lock_guard<std::mutex> g(lock_);
+    captureQueue_.push_back(resp.token());
+    resp.defer();
+    return;
+  }
+  resp.send(404, "text/plain", "Not found");
+}
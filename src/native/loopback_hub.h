@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "history_store.h"
+#include "host_util.h"
+#include "http_event.h"
+#include "http_socket.h"
+#include "result_cache.h"
+
+// The hub's web layer built for Linux: the same HttpEventServer, socket
+// binding and shared handlers (dashboard assets, /image.jpg, /stats,
+// /stream, /events, /history), with a thread standing in for the camera
+// loop. Captures go into a HistoryStore on a RAM stand-in for the hub's
+// history partition. /capture is
+// deferred to that thread exactly as on the hub, so a slow capture never
+// stalls other clients; while /stream has viewers the same thread publishes
+// the sample frames as preview at streamFps.
+struct LoopbackHubConfig {
+  size_t maxClients = 4;        // HUB_HTTP_MAX_CLIENTS
+  double captureMs = 300.0;     // UART transfer of one frame at 921600 baud
+  int sendBufferBytes = 5744;   // lwIP TCP_SND_BUF on the ESP32; 0 = host default
+  int streamFps = 5;            // HUB_STREAM_FPS
+  size_t historyEntries = 128;  // HUB_HISTORY_ENTRIES
+  uint32_t historyBytes = 0x270000;  // history partition in partitions_hub.csv
+};
+
+class LoopbackHub {
+ public:
+  LoopbackHub(const LoopbackHubConfig& cfg, const std::vector<ImageFile>& frames);
+  ~LoopbackHub() { stop(); }
+
+  bool start(uint16_t port, bool loopbackOnly = true);
+  void stop();
+  uint16_t port() const { return listener_.port(); }
+
+  uint32_t requests() const { return requests_.load(); }
+  uint32_t captures() const { return captures_.load(); }
+  HistoryStore& history() { return history_; }
+
+ private:
+  void handle(const HttpRequest& req, HttpResponse& resp);
+  void serveLoop();
+  void cameraLoop();
+  void publish(size_t index);
+
+  LoopbackHubConfig cfg_;
+  std::vector<SharedBytes> frames_;
+  std::vector<FrameKey> keys_;
+  MemoryHistoryStorage historyStorage_;
+  HistoryStore history_;
+  HttpEventServer http_;
+  SocketHttpListener listener_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint32_t> requests_{0};
+  std::atomic<uint32_t> captures_{0};
+  std::thread serveThread_;
+  std::thread cameraThread_;
+
+  std::mutex lock_;              // guards everything below
+  SharedBytes image_;
+  FrameKey imageKey_;
+  size_t imageIndex_ = 0;
+  std::vector<uint32_t> captureQueue_;  // deferred /capture tokens
+};
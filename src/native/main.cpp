@@ -0,0 +1,46 @@
+// ========= Host tools (PlatformIO env:native) =========
+// Runs the hub-side protocol code on Linux against local stand-ins:
+//   pio run -e native && .pio/build/native/program <command> [--key=value ...]
+#include <cstdio>
+#include <cstring>
+
+#include "commands.h"
+
+struct Command {
+  const char* name;
+  int (*run)(int argc, char** argv);
+  const char* help;
+};
+
+static const Command COMMANDS[] = {
+  { "serve", cmdServe, "stand-in Pi server (/upload, /upload_batch, /result)" },
+  { "bench-upload", cmdBenchUpload, "frames/s for single vs batched uploads" },
+  { "phash", cmdPhash, "perceptual hashes of a JPEG set, to tune HUB_PHASH_MAX_DISTANCE" },
+  { "leaf-stats", cmdLeafStats, "colour statistics and quick verdict from JPEG DC coefficients" },
+  { "jpeg-check", cmdJpegCheck, "JPEG pre-validation cost and how many damaged frames it rejects" },
+  { "triage", cmdTriage, "on-camera int8 triage (no leaf / healthy / analyse) over a JPEG set" },
+  { "loadtest", cmdLoadtest, "concurrent dashboard clients against the hub web layer (p50/p99)" },
+  { "history-bench", cmdHistoryBench, "capture history: add/evict/lookup costs and /history endpoints" },
+  { "multicam-sim", cmdMulticamSim, "N simulated cameras through the capture scheduler: frames/s vs uplink" },
+  { "transport-bench", cmdTransportBench, "capture latency and throughput over memory, modelled UART and TCP links" },
+  { "cam-sim", cmdCamSim, "camera over TCP for a hub in another process (transport-bench --listen)" },
+  { "fleet-sim", cmdFleetSim, "N emulated hubs uploading and polling a Pi server: throughput, latency, errors" },
+};
+
+static void usage(const char* prog) {
+  std::printf("usage: %s <command> [--key=value ...]\n\ncommands:\n", prog);
+  for (const Command& c : COMMANDS) std::printf("  %-16s %s\n", c.name, c.help);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return 2;
+  }
+  for (const Command& c : COMMANDS) {
+    if (std::strcmp(argv[1], c.name) == 0) return c.run(argc - 2, argv + 2);
+  }
+  std::fprintf(stderr, "unknown command '%s'\n\n", argv[1]);
+  usage(argv[0]);
+  return 2;
+}
@@ -0,0 +1,103 @@
+#include "sim_camera.h"
+
+#include <algorithm>
+
+#include "crc16.h"
+#include "host_util.h"
+#include "uart_frame.h"
+
+static const size_t PIPE_CHUNK = 64;  // bytes released together on a modelled UART
+
+void PipeTransport::makePair(double bytesPerSec, std::unique_ptr<PipeTransport>& a,
+                             std::unique_ptr<PipeTransport>& b) {
+  std::shared_ptr<Channel> ab = std::make_shared<Channel>();
+  std::shared_ptr<Channel> ba = std::make_shared<Channel>();
+  a.reset(new PipeTransport(ba, ab, bytesPerSec));
+  b.reset(new PipeTransport(ab, ba, bytesPerSec));
+}
+
+size_t PipeTransport::read(uint8_t* buf, size_t n) {
+  uint64_t now = nowUs();
+  std::lock_guard<std::mutex> g(in_->lock);
+  size_t got = 0;
+  while (got < n && !in_->chunks.empty()) {
+    Chunk& c = in_->chunks.front();
+    if (c.readyUs > now) break;
+    size_t take = std::min(n - got, c.bytes.size() - c.pos);
+    std::copy(c.bytes.begin() + c.pos, c.bytes.begin() + c.pos + take, buf + got);
+    got += take;
+    c.pos += take;
+    if (c.pos == c.bytes.size()) in_->chunks.pop_front();
+  }
+  return got;
+}
+
+bool PipeTransport::write(const uint8_t* data, size_t n) {
+  uint64_t now = nowUs();
+  std::lock_guard<std::mutex> g(out_->lock);
+  size_t step = bytesPerSec_ > 0 ? PIPE_CHUNK : n;
+  for (size_t off = 0; off < n; off += step) {
+    size_t len = std::min(step, n - off);
+    uint64_t ready = now;
+    if (bytesPerSec_ > 0) {
+      ready = std::max(now, out_->lastReadyUs) + (uint64_t)(len * 1e6 / bytesPerSec_);
+    }
+    out_->lastReadyUs = ready;
+    out_->chunks.push_back(Chunk{ready, std::vector<uint8_t>(data + off, data + off + len), 0});
+  }
+  return true;
+}
+
+void PipeTransport::flush() {
+  uint64_t until;
+  {
+    std::lock_guard<std::mutex> g(out_->lock);
+    until = out_->lastReadyUs;
+  }
+  uint64_t now = nowUs();
+  if (until > now) sleepUs(until - now);
+}
+
+SimCameraDevice::SimCameraDevice(CameraTransport& link, const std::vector<SharedBytes>& frames,
+                                 double camMs)
+    : link_(link), frames_(frames), camMs_(camMs) {
+  for (const SharedBytes& f : frames_) crcs_.push_back(crc16(f->data(), f->size()));
+}
+
+void SimCameraDevice::sendStill(uint8_t type, uint32_t captureId) {
+  uint64_t t0 = nowUs();
+  if (camMs_ > 0) sleepUs((uint64_t)(camMs_ * 1000.0));
+  size_t i = next_++ % frames_.size();
+  const std::vector<uint8_t>& jpg = *frames_[i];
+  uint32_t ms = (uint32_t)((nowUs() - t0) / 1000);
+  uint8_t head[FRAME_HEADER_MAX];
+  size_t n = encodeFrameHeader(type, (uint32_t)jpg.size(), crcs_[i], captureId,
+                               (uint16_t)std::min<uint32_t>(ms, 0xFFFF), 0, head);
+  if (link_.write(head, n) && link_.write(jpg.data(), jpg.size())) ++framesSent_;
+}
+
+bool SimCameraDevice::poll() {
+  uint8_t buf[64];
+  size_t n = link_.read(buf, sizeof(buf));
+  cmd_.insert(cmd_.end(), buf, buf + n);
+  bool any = n > 0;
+  while (!cmd_.empty()) {
+    uint8_t c = cmd_[0];
+    size_t need = c == 'T' ? 5 : c == 'S' ? 2 : 1;
+    if (cmd_.size() < need) break;  // arguments still on their way
+    if (c == 'C') {
+      sendStill(FRAME_TYPE_STILL, 0);
+    } else if (c == 'T') {
+      uint32_t id = (uint32_t)cmd_[1] << 24 | (uint32_t)cmd_[2] << 16 | (uint32_t)cmd_[3] << 8 | cmd_[4];
+      sendStill(FRAME_TYPE_TRACED, id);
+    }
+    cmd_.erase(cmd_.begin(), cmd_.begin() + need);
+  }
+  return any;
+}
+
+void SimCameraDevice::run(const std::atomic<bool>& running) {
+  while (running) {
+    if (!poll()) sleepUs(100);
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "camera_transport.h"
+#include "http_event.h"
+
+// In-process camera link for the host tools: two ends sharing a byte queue
+// each way. With bytesPerSec > 0 written bytes become readable at that
+// rate, as on a UART (baud / 10), so protocol timing can be measured
+// without hardware; flush() waits until the last byte is "on the wire".
+class PipeTransport : public CameraTransport {
+ public:
+  static void makePair(double bytesPerSec, std::unique_ptr<PipeTransport>& a,
+                       std::unique_ptr<PipeTransport>& b);
+
+  const char* name() const { return bytesPerSec_ > 0 ? "uart-model" : "memory"; }
+  size_t read(uint8_t* buf, size_t n);
+  bool write(const uint8_t* data, size_t n);
+  void flush();
+
+ private:
+  struct Chunk {
+    uint64_t readyUs;
+    std::vector<uint8_t> bytes;
+    size_t pos;
+  };
+  struct Channel {
+    std::mutex lock;
+    std::deque<Chunk> chunks;
+    uint64_t lastReadyUs = 0;
+  };
+  PipeTransport(std::shared_ptr<Channel> in, std::shared_ptr<Channel> out, double bytesPerSec)
+      : in_(in), out_(out), bytesPerSec_(bytesPerSec) {}
+
+  std::shared_ptr<Channel> in_;
+  std::shared_ptr<Channel> out_;
+  double bytesPerSec_;
+};
+
+// Answers hub commands on a transport the way src/cam/main.cpp does: 'C'
+// and 'T' + capture ID with a still (the frames in turn, after camMs of
+// "exposure"); preview commands 'S' + fps and 'X' are accepted and ignored.
+class SimCameraDevice {
+ public:
+  SimCameraDevice(CameraTransport& link, const std::vector<SharedBytes>& frames, double camMs);
+
+  // Handles the commands that have arrived; false if there were none
+  bool poll();
+  // poll() until running turns false
+  void run(const std::atomic<bool>& running);
+  uint32_t framesSent() const { return framesSent_.load(); }
+
+ private:
+  void sendStill(uint8_t type, uint32_t captureId);
+
+  CameraTransport& link_;
+  std::vector<SharedBytes> frames_;
+  std::vector<uint16_t> crcs_;
+  double camMs_;
+  size_t next_ = 0;
+  std::vector<uint8_t> cmd_;  // command bytes not handled yet
+  std::atomic<uint32_t> framesSent_{0};
+};
@@ -0,0 +1,115 @@
+#include "standin_server.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "batch_frame.h"
+#include "host_util.h"
+
+StandInConfig standInConfigFromArgs(const CliArgs& args) {
+  StandInConfig cfg;
+  cfg.requestMs = args.real("request-ms", cfg.requestMs);
+  cfg.lockMs = args.real("lock-ms", cfg.lockMs);
+  cfg.inferMs = args.real("infer-ms", cfg.inferMs);
+  return cfg;
+}
+
+bool StandInServer::start(uint16_t port, bool loopbackOnly) {
+  return http_.start(port, [this](const HttpMessage& req, HttpMessage& resp) { handle(req, resp); },
+                     loopbackOnly);
+}
+
+// Result fields mirror pi5_server.py's _latest_result, including the
+// capture ID the hub sent (X-Capture-Id / X-Capture-Ids).
+std::string StandInServer::analyse(const uint8_t* jpg, size_t len, uint64_t seq, const std::string& captureId) {
+  (void)jpg;
+  sleepUs((uint64_t)(cfg_.inferMs * 1000.0));
+  char ts[32];
+  std::snprintf(ts, sizeof(ts), "standin_%06llu", (unsigned long long)seq);
+  std::string out = "{\"timestamp\":\"" + std::string(ts) + "\"";
+  out += ",\"filename\":\"image_" + std::string(ts) + ".jpg\"";
+  out += ",\"leaf_name\":\"Healthy Leaf\",\"disease\":\"No obvious disease\"";
+  out += ",\"solution\":\"Continue regular care.\"";
+  out += ",\"species\":\"Healthy Leaf\",\"condition\":\"No obvious disease\"";
+  out += ",\"recommendation\":\"Continue regular care.\"";
+  if (!captureId.empty()) out += ",\"capture_id\":\"" + jsonEscape(captureId) + "\"";
+  out += ",\"size_bytes\":" + std::to_string(len) + "}";
+  return out;
+}
+
+void StandInServer::handle(const HttpMessage& req, HttpMessage& resp) {
+  ++requests_;
+  if (req.method == "GET" && req.path == "/result") {
+    std::lock_guard<std::mutex> g(resultLock_);
+    if (latest_.empty()) {
+      resp.status = 404;
+      resp.body = "{\"error\":\"No analysis available yet\"}";
+    } else {
+      resp.body = latest_;
+    }
+    return;
+  }
+  if (req.method != "POST" || (req.path != "/upload" && req.path != "/upload_batch")) {
+    resp.status = 404;
+    resp.body = "{\"detail\":\"Not Found\"}";
+    return;
+  }
+
+  sleepUs((uint64_t)(cfg_.requestMs * 1000.0));
+  const uint8_t* body = (const uint8_t*)req.body.data();
+
+  if (req.path == "/upload") {
+    if (req.body.empty()) {
+      resp.status = 400;
+      resp.body = "{\"status\":\"error\",\"message\":\"No image payload received\"}";
+      return;
+    }
+    std::string result;
+    {
+      std::lock_guard<std::mutex> g(inferLock_);
+      sleepUs((uint64_t)(cfg_.lockMs * 1000.0));
+      result = analyse(body, req.body.size(), ++frames_, req.header("x-capture-id"));
+    }
+    {
+      std::lock_guard<std::mutex> g(resultLock_);
+      latest_ = result;
+    }
+    resp.body = "{\"status\":\"success\"," + result.substr(1);
+    return;
+  }
+
+  std::vector<BatchFrameView> frames;
+  std::string err;
+  if (!parseBatch(body, req.body.size(), frames, err)) {
+    resp.status = 400;
+    resp.body = "{\"status\":\"error\",\"message\":\"" + jsonEscape(err) + "\"}";
+    return;
+  }
+  // One ID per frame, in batch order; ignored if the count is off
+  std::vector<std::string> ids;
+  std::string list = req.header("x-capture-ids");
+  for (size_t start = 0; !list.empty() && start <= list.size();) {
+    size_t comma = list.find(',', start);
+    if (comma == std::string::npos) comma = list.size();
+    ids.push_back(list.substr(start, comma - start));
+    start = comma + 1;
+  }
+  if (ids.size() != frames.size()) ids.assign(frames.size(), std::string());
+  std::string results = "[";
+  {
+    std::lock_guard<std::mutex> g(inferLock_);
+    sleepUs((uint64_t)(cfg_.lockMs * 1000.0));
+    for (size_t i = 0; i < frames.size(); ++i) {
+      std::string r = analyse(frames[i].data, frames[i].len, ++frames_, ids[i]);
+      if (i) results += ",";
+      results += r;
+      if (i + 1 == frames.size()) {
+        std::lock_guard<std::mutex> rg(resultLock_);
+        latest_ = r;
+      }
+    }
+  }
+  results += "]";
+  resp.body = "{\"status\":\"success\",\"count\":" + std::to_string(frames.size()) +
+              ",\"results\":" + results + "}";
+}
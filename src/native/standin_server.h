@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "host_http.h"
+#include "host_util.h"
+
+// Local stand-in for pi5_server.py. Speaks the same /upload, /upload_batch and
+// /result protocol and models its costs: a per-request overhead (HTTP, body
+// read, file save) outside the lock, and inference serialised on one lock the
+// way _tflite_lock serialises the TFLite interpreter.
+struct StandInConfig {
+  double requestMs = 8.0;    // per HTTP request, outside the lock
+  double lockMs = 2.0;       // fixed cost each time the lock is taken
+  double inferMs = 25.0;     // per frame, inside the lock
+};
+
+// --request-ms, --lock-ms, --infer-ms
+StandInConfig standInConfigFromArgs(const CliArgs& args);
+
+class StandInServer {
+ public:
+  explicit StandInServer(const StandInConfig& cfg) : cfg_(cfg) {}
+
+  bool start(uint16_t port, bool loopbackOnly = true);
+  void stop() { http_.stop(); }
+  uint16_t port() const { return http_.port(); }
+
+  uint64_t framesAnalysed() const { return frames_.load(); }
+  uint64_t requests() const { return requests_.load(); }
+
+ private:
+  void handle(const HttpMessage& req, HttpMessage& resp);
+  std::string analyse(const uint8_t* jpg, size_t len, uint64_t seq, const std::string& captureId);
+
+  StandInConfig cfg_;
+  HostHttpServer http_;
+  std::mutex inferLock_;
+  std::mutex resultLock_;
+  std::string latest_;
+  std::atomic<uint64_t> frames_{0};
+  std::atomic<uint64_t> requests_{0};
+};
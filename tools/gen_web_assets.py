@@ -0,0 +1,159 @@
+"""Generate gzip-compressed PROGMEM headers for the web dashboards.
+
+Each directory in TARGETS holds a static page (index.html plus its CSS/JS).
+Every file is gzipped once at build time and emitted as a byte array in a
+header the firmware includes, so the HTTP handler only streams flash bytes
+with `Content-Encoding: gzip`.
+
+index.html refers to its assets as `{{name}}`; those are replaced with
+`name?v=<hash>` so the assets can be cached as immutable while the page
+itself is revalidated with its ETag.
+
+Runs standalone (`python3 tools/gen_web_assets.py`) or as a PlatformIO
+`extra_scripts = pre:` script from the root or the esp/ project. Headers are
+only rewritten when their content changes, so incremental builds stay
+incremental.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+# web source directory -> generated header (relative to the repo root)
+TARGETS = {
+    "web/hub": "src/hub/web_assets.h",
+    "web/esp": "esp/src/web_assets.h",
+}
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+    ".json": "application/json",
+}
+
+PLACEHOLDER = re.compile(r"\{\{([A-Za-z0-9_.-]+)\}\}")
+
+
+def find_root(start):
+    d = os.path.abspath(start)
+    while True:
+        if os.path.isfile(os.path.join(d, "tools", "gen_web_assets.py")):
+            return d
+        parent = os.path.dirname(d)
+        if parent == d:
+            raise RuntimeError("gen_web_assets: repo root not found from " + start)
+        d = parent
+
+
+def short_hash(data):
+    return hashlib.sha1(data).hexdigest()[:12]
+
+
+def c_ident(name):
+    return re.sub(r"[^A-Za-z0-9]", "_", name).upper()
+
+
+def c_bytes(data, indent="  ", per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append(indent + ", ".join("0x%02x" % b for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def load_assets(src_dir):
+    names = sorted(n for n in os.listdir(src_dir)
+                   if os.path.splitext(n)[1] in CONTENT_TYPES and n != "index.html")
+    assets = []
+    versions = {}
+    for name in names:
+        with open(os.path.join(src_dir, name), "rb") as f:
+            data = f.read()
+        versions[name] = short_hash(data)
+        assets.append((name, data, True))
+
+    with open(os.path.join(src_dir, "index.html"), "rb") as f:
+        page = f.read().decode("utf-8")
+
+    def versioned(m):
+        name = m.group(1)
+        if name not in versions:
+            raise RuntimeError("gen_web_assets: %s/index.html refers to missing %s" % (src_dir, name))
+        return "%s?v=%s" % (name, versions[name])
+
+    page = PLACEHOLDER.sub(versioned, page)
+    assets.insert(0, ("index.html", page.encode("utf-8"), False))
+    return assets
+
+
+def render_header(rel_src, assets):
+    out = [
+        "// Generated by tools/gen_web_assets.py from %s/ -- do not edit." % rel_src,
+        "#pragma once",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "// Plain const data on the ESP32 (flash is memory-mapped) and on the host",
+        "#ifndef PROGMEM",
+        "#define PROGMEM",
+        "#endif",
+        "",
+        "struct WebAsset {",
+        "  const char* path;",
+        "  const char* contentType;",
+        "  const uint8_t* gz;      // gzip-compressed body",
+        "  size_t gzLen;",
+        "  size_t rawLen;",
+        "  const char* version;    // content hash; the ETag is the quoted version",
+        "  bool versioned;         // linked as path?v=version, cacheable forever",
+        "};",
+        "",
+    ]
+    table = []
+    for name, data, versioned in assets:
+        ident = c_ident(name)
+        # mtime=0 keeps the output byte-identical between builds.
+        gz = gzip.compress(data, compresslevel=9, mtime=0)
+        version = short_hash(data)
+        out.append("// %s: %u -> %u bytes" % (name, len(data), len(gz)))
+        out.append("static const uint8_t %s_GZ[] PROGMEM = {" % ident)
+        out.append(c_bytes(gz))
+        out.append("};")
+        out.append("")
+        path = "/" if name == "index.html" else "/" + name
+        ctype = CONTENT_TYPES[os.path.splitext(name)[1]]
+        table.append('  {"%s", "%s", %s_GZ, sizeof(%s_GZ), %u, "%s", %s},'
+                     % (path, ctype, ident, ident, len(data), version,
+                        "true" if versioned else "false"))
+    out.append("static const WebAsset WEB_ASSETS[] = {")
+    out.extend(table)
+    out.append("};")
+    out.append("static const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);")
+    out.append("")
+    return "\n".join(out)
+
+
+def generate(root):
+    for rel_src, rel_out in TARGETS.items():
+        src_dir = os.path.join(root, rel_src)
+        out_path = os.path.join(root, rel_out)
+        text = render_header(rel_src, load_assets(src_dir))
+        old = None
+        if os.path.exists(out_path):
+            with open(out_path, "r") as f:
+                old = f.read()
+        if old != text:
+            with open(out_path, "w") as f:
+                f.write(text)
+            print("gen_web_assets: wrote %s" % rel_out)
+
+
+if "Import" in globals():
+    # PlatformIO/SCons extra script: $PROJECT_DIR is the root or esp/.
+    Import("env")  # noqa: F821
+    generate(find_root(env.subst("$PROJECT_DIR")))  # noqa: F821
+elif __name__ == "__main__":
+    generate(find_root(os.path.dirname(os.path.abspath(sys.argv[0]))))
@@ -0,0 +1,44 @@
+function $(id){ return document.getElementById(id); }
+async function status(){
+  try {
+    const s = await (await fetch('/status.json')).json();
+    $('ip').textContent = s.ip;
+    $('target').textContent = s.target;
+    if (!s.uploads) $('status').textContent = 'No uploads yet';
+    else if (s.last_ok) $('status').textContent = 'Last upload OK → ' + s.last_name;
+    else $('status').textContent = 'Last upload FAIL: ' + s.last_err;
+    if (s.captures) $('img').src = '/image?n=' + s.captures;
+  } catch(e){}
+}
+// Stage events pushed by the hub while a capture runs (button or page)
+function listen(){
+  const es = new EventSource('/events');
+  es.addEventListener('capture', (m) => {
+    const e = JSON.parse(m.data);
+    if (e.stage === 'start') $('progress').textContent = 'Capturing...';
+    else if (e.stage === 'done') {
+      $('progress').textContent = 'Captured ' + e.bytes + ' bytes in ' + e.ms + ' ms';
+      $('img').src = '/image?n=' + e.captures;
+    } else $('progress').textContent = 'Capture failed: ' + e.err;
+  });
+  es.addEventListener('upload', (m) => {
+    const e = JSON.parse(m.data);
+    if (e.stage === 'start') $('progress').textContent = 'Uploading ' + e.bytes + ' bytes...';
+    else if (e.stage === 'done') $('progress').textContent = 'Uploaded in ' + e.ms + ' ms';
+    else $('progress').textContent = 'Upload failed: ' + e.err;
+    if (e.stage !== 'start') status();
+  });
+  es.addEventListener('result', (m) => {
+    const e = JSON.parse(m.data);
+    if (e.leaf_name) $('result').textContent = e.leaf_name + ': ' + e.disease + ' - ' + e.solution;
+  });
+  es.onopen = status;
+}
+async function capture(){
+  $('capture').disabled = true;
+  try { await fetch('/capture'); } catch(e){}
+  $('capture').disabled = false;
+  if (!window.EventSource) status();
+}
+if (window.EventSource) listen();
+else status();
@@ -0,0 +1,112 @@
+function showImage(v){
+  if (v) document.getElementById('img').src = '/image.jpg?v=' + v;
+}
+function setProgress(text){
+  document.getElementById('progress').textContent = text;
+}
+async function stats(){
+  try {
+    const s = await (await fetch('/stats')).json();
+    showImage(s.image_etag);
+    if (s.cameras > 1) {
+      document.getElementById('live').hidden = true;  // preview needs one camera
+      cameras();
+    }
+    document.getElementById('stats').textContent =
+      'Result cache: ' + s.cache_hits + ' hits, ' + s.cache_misses + ' misses (' +
+      s.cache_entries + '/' + s.cache_capacity + ' entries), ' +
+      s.near_dup_skips + ' near-duplicates skipped';
+  } catch(e){}
+}
+// Several cameras: a panel each, from /cameras
+function showCamera(c){
+  let p = document.getElementById('cam' + c.id);
+  if (!p) {
+    p = document.createElement('div');
+    p.id = 'cam' + c.id;
+    p.className = 'cam';
+    p.innerHTML = '<b>Camera ' + c.id + '</b> <button>Capture</button><p></p><img alt="No image yet" />';
+    p.querySelector('button').onclick = () => fetch('/capture?cam=' + c.id);
+    document.getElementById('cameras').appendChild(p);
+  }
+  if (c.etag) p.querySelector('img').src = '/cameras/' + c.id + '.jpg?v=' + c.etag;
+  p.querySelector('p').textContent = c.state + ', ' + c.frames + ' frames, ' + c.uploads +
+    ' uploaded, ' + (c.failures + c.timeouts) + ' failed' +
+    (c.frames ? ' (camera ' + c.cam_ms + ' ms, link ' + c.link_ms + ' ms)' : '') +
+    (c.leaf_name ? ' - ' + c.leaf_name + ': ' + c.disease : '') + (c.err ? ' - ' + c.err : '');
+}
+async function cameras(){
+  try {
+    const s = await (await fetch('/cameras')).json();
+    s.cameras.forEach(showCamera);
+  } catch(e){}
+}
+// Stage events from /events; each carries the hub time t and, once a stage
+// ends, its duration ms.
+let started = 0;
+function since(e){ return started ? ' (+' + (e.t - started) + ' ms)' : ''; }
+function listen(){
+  const es = new EventSource('/events');
+  es.addEventListener('capture', (m) => {
+    const e = JSON.parse(m.data);
+    if (e.stage === 'start') {
+      started = e.t;
+      setProgress('Capturing...');
+    } else if (e.stage === 'done') {
+      showImage(e.etag);
+      setProgress('Captured ' + e.bytes + ' bytes in ' + e.ms + ' ms');
+    } else {
+      setProgress('Capture failed: ' + e.err);
+    }
+  });
+  es.addEventListener('upload', (m) => {
+    const e = JSON.parse(m.data);
+    if (e.stage === 'start') setProgress('Uploading ' + e.bytes + ' bytes' + since(e));
+    else if (e.stage === 'done') setProgress('Uploaded in ' + e.ms + ' ms, waiting for result' + since(e));
+    else if (e.stage === 'queued') setProgress('Queued, ' + e.batch_queued + ' in batch' + since(e));
+    else if (e.stage === 'skipped') setProgress('Seen before (' + e.reason + '), upload skipped' + since(e));
+    else setProgress('Upload failed: ' + e.err + since(e));
+    if (e.stage !== 'start') stats();
+  });
+  es.addEventListener('result', (m) => {
+    const e = JSON.parse(m.data);
+    document.getElementById('result').textContent =
+      e.leaf_name + ': ' + e.disease + ' - ' + e.solution;
+    setProgress('Result' + since(e));
+    started = 0;
+    stats();
+  });
+  es.addEventListener('camera', (m) => {
+    const e = JSON.parse(m.data);
+    setProgress('Camera ' + e.cam + ': ' + (e.ok ? e.bytes + ' bytes uploaded' : 'upload failed: ' + e.err) + since(e));
+    cameras();
+  });
+  es.addEventListener('trace', (m) => {
+    const e = JSON.parse(m.data);
+    document.getElementById('trace').textContent = 'Capture ' + e.capture_id +
+      ': camera ' + e.cam_ms + ' ms, UART ' + e.uart_ms + ' ms, network ' +
+      e.network_ms + ' ms, Pi ' + e.pi_ms + ' ms (analysis ' + e.pi_analyze_ms + ' ms)';
+  });
+  es.onopen = stats;  // catch up on anything missed while disconnected
+}
+function toggleLive(){
+  const img = document.getElementById('stream');
+  const btn = document.getElementById('live');
+  if (img.hidden) {
+    img.src = '/stream';
+    btn.textContent = 'Stop preview';
+  } else {
+    img.removeAttribute('src');  // closes the connection; the hub stops the camera
+    btn.textContent = 'Live preview';
+  }
+  img.hidden = !img.hidden;
+}
+async function capture(){
+  try {
+    const r = await fetch('/capture');
+    if (!r.ok) setProgress('Capture failed: ' + await r.text());
+    if (!window.EventSource) stats();
+  } catch(e){ alert('Capture failed'); }
+}
+if (window.EventSource) listen();
+else stats();